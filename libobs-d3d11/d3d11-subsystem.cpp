@@ -1845,6 +1845,50 @@ void gs_vertexbuffer_flush(gs_vertbuffer_t *vertbuffer)
 	}
 }
 
+void gs_vertexbuffer_flush_range(gs_vertbuffer_t *vertbuffer,
+		uint32_t start_vert, uint32_t num_verts, bool discard)
+{
+	if (!vertbuffer->dynamic) {
+		blog(LOG_ERROR, "gs_vertexbuffer_flush_range: vertex buffer is "
+		                "not dynamic");
+		return;
+	}
+
+	gs_vb_data *data = vertbuffer->vbd.data;
+
+	try {
+		vertbuffer->FlushBufferRange(vertbuffer->vertexBuffer,
+				data->points, sizeof(vec3), start_vert,
+				num_verts, discard);
+
+		if (vertbuffer->normalBuffer)
+			vertbuffer->FlushBufferRange(vertbuffer->normalBuffer,
+					data->normals, sizeof(vec3),
+					start_vert, num_verts, discard);
+
+		if (vertbuffer->tangentBuffer)
+			vertbuffer->FlushBufferRange(vertbuffer->tangentBuffer,
+					data->tangents, sizeof(vec3),
+					start_vert, num_verts, discard);
+
+		if (vertbuffer->colorBuffer)
+			vertbuffer->FlushBufferRange(vertbuffer->colorBuffer,
+					data->colors, sizeof(uint32_t),
+					start_vert, num_verts, discard);
+
+		for (size_t i = 0; i < vertbuffer->uvBuffers.size(); i++) {
+			gs_tvertarray &tv = data->tvarray[i];
+			vertbuffer->FlushBufferRange(vertbuffer->uvBuffers[i],
+					tv.array, tv.width*sizeof(float),
+					start_vert, num_verts, discard);
+		}
+
+	} catch (HRError error) {
+		blog(LOG_ERROR, "gs_vertexbuffer_flush_range (D3D11): "
+		                "%s (%08lX)", error.str, error.hr);
+	}
+}
+
 struct gs_vb_data *gs_vertexbuffer_get_data(const gs_vertbuffer_t *vertbuffer)
 {
 	return vertbuffer->vbd.data;
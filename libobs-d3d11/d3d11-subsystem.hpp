@@ -218,6 +218,9 @@ struct gs_vertex_buffer {
 
 	void FlushBuffer(ID3D11Buffer *buffer, void *array,
 			size_t elementSize);
+	void FlushBufferRange(ID3D11Buffer *buffer, void *array,
+			size_t elementSize, size_t start, size_t num,
+			bool discard);
 
 	void MakeBufferList(gs_vertex_shader *shader,
 			vector<ID3D11Buffer*> &buffers,
@@ -0,0 +1,204 @@
+/******************************************************************************
+    Copyright (C) 2013 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <math.h>
+#include <graphics/vec2.h>
+#include <graphics/vec3.h>
+#include <graphics/vec4.h>
+#include "null-subsystem.h"
+
+enum blend_mode {
+	BLEND_COPY,
+	BLEND_ALPHA,
+	BLEND_PREMULTIPLIED
+};
+
+struct sprite_vert {
+	float x, y;
+	float u, v;
+};
+
+static inline void to_target(struct sprite_vert *out, const struct vec3 *pos,
+		const struct vec2 *uv, const struct matrix4 *viewproj,
+		const struct gs_rect *viewport)
+{
+	struct vec4 v;
+
+	vec4_from_vec3(&v, pos);
+	vec4_transform(&v, &v, viewproj);
+	if (v.w != 0.0f)
+		vec4_divf(&v, &v, v.w);
+
+	out->x = (float)viewport->x + (v.x + 1.0f) * 0.5f *
+		(float)viewport->cx;
+	out->y = (float)viewport->y + (1.0f - v.y) * 0.5f *
+		(float)viewport->cy;
+	out->u = uv->x;
+	out->v = uv->y;
+}
+
+static inline enum blend_mode get_blend_mode(const gs_device_t *device)
+{
+	if (!device->blend || device->blend_dest != GS_BLEND_INVSRCALPHA)
+		return BLEND_COPY;
+	if (device->blend_src == GS_BLEND_SRCALPHA)
+		return BLEND_ALPHA;
+	if (device->blend_src == GS_BLEND_ONE)
+		return BLEND_PREMULTIPLIED;
+	return BLEND_COPY;
+}
+
+/* RGBA and BGRA differ only in the order of the red and blue channels */
+static inline uint32_t swap_red_blue(uint32_t pixel)
+{
+	return (pixel & 0xFF00FF00) | ((pixel & 0xFF) << 16) |
+		((pixel >> 16) & 0xFF);
+}
+
+static inline uint32_t blend_pixel(uint32_t src, uint32_t dst,
+		enum blend_mode mode)
+{
+	uint32_t alpha = src >> 24;
+	uint32_t out = 0;
+
+	if (mode == BLEND_COPY || alpha == 255)
+		return src;
+
+	for (int shift = 0; shift < 32; shift += 8) {
+		uint32_t s = (src >> shift) & 0xFF;
+		uint32_t d = (dst >> shift) & 0xFF;
+		uint32_t c = mode == BLEND_ALPHA ?
+			(s * alpha + d * (255 - alpha)) / 255 :
+			s + d * (255 - alpha) / 255;
+
+		out |= (c > 255 ? 255 : c) << shift;
+	}
+
+	return out;
+}
+
+static inline int clamp_int(int val, int min, int max)
+{
+	return val < min ? min : (val > max ? max : val);
+}
+
+static void fill_sprite(gs_texture_t *target, uint8_t *plane,
+		const gs_texture_t *tex, const struct sprite_vert *tl,
+		const struct sprite_vert *br, const struct gs_rect *viewport,
+		enum blend_mode mode)
+{
+	bool swap = (target->format == GS_RGBA) != (tex->format == GS_RGBA);
+	uint32_t alpha_mask = tex->format == GS_BGRX ? 0xFF000000 : 0;
+	float dx = br->x - tl->x;
+	float dy = br->y - tl->y;
+
+	int left   = (int)ceilf(fminf(tl->x, br->x) - 0.5f);
+	int right  = (int)ceilf(fmaxf(tl->x, br->x) - 0.5f);
+	int top    = (int)ceilf(fminf(tl->y, br->y) - 0.5f);
+	int bottom = (int)ceilf(fmaxf(tl->y, br->y) - 0.5f);
+
+	left   = clamp_int(left,   viewport->x, viewport->x + viewport->cx);
+	right  = clamp_int(right,  viewport->x, viewport->x + viewport->cx);
+	top    = clamp_int(top,    viewport->y, viewport->y + viewport->cy);
+	bottom = clamp_int(bottom, viewport->y, viewport->y + viewport->cy);
+	left   = clamp_int(left,   0, (int)target->width);
+	right  = clamp_int(right,  0, (int)target->width);
+	top    = clamp_int(top,    0, (int)target->height);
+	bottom = clamp_int(bottom, 0, (int)target->height);
+
+	if (left >= right || top >= bottom || dx == 0.0f || dy == 0.0f)
+		return;
+
+	/* texel coordinates at the center of the first pixel, and their
+	 * steps per pixel */
+	float du = (br->u - tl->u) / dx * (float)tex->width;
+	float dv = (br->v - tl->v) / dy * (float)tex->height;
+	float u0 = tl->u * (float)tex->width +
+		((float)left + 0.5f - tl->x) * du;
+	float v  = tl->v * (float)tex->height +
+		((float)top + 0.5f - tl->y) * dv;
+
+	for (int y = top; y < bottom; y++, v += dv) {
+		uint32_t *dst = (uint32_t*)(plane +
+				(size_t)y * target->linesize);
+		int ty = clamp_int((int)floorf(v), 0, (int)tex->height - 1);
+		const uint32_t *src = (const uint32_t*)(tex->data +
+				(size_t)ty * tex->linesize);
+		float u = u0;
+
+		for (int x = left; x < right; x++, u += du) {
+			int tx = clamp_int((int)floorf(u), 0,
+					(int)tex->width - 1);
+			uint32_t pixel = src[tx] | alpha_mask;
+
+			if (swap)
+				pixel = swap_red_blue(pixel);
+			dst[x] = blend_pixel(pixel, dst[x], mode);
+		}
+	}
+}
+
+void null_draw_sprite(gs_device_t *device, uint32_t start_vert,
+		uint32_t num_verts)
+{
+	gs_texture_t *target = device->cur_render_target;
+	struct gs_vertex_buffer *vb = device->cur_vertex_buffer;
+	struct gs_vb_data *data = vb->data;
+	struct vec2 *uvs;
+	struct sprite_vert verts[3];
+	struct matrix4 view, viewproj;
+	gs_texture_t *tex;
+
+	if (!num_verts)
+		num_verts = (uint32_t)vb->num;
+
+	if (!target || !target->data || !null_format_is_32bit(target->format))
+		return;
+	if (num_verts != 4 || (size_t)start_vert + 4 > vb->num)
+		return;
+	if (!data || !data->num_tex || data->tvarray[0].width != 2)
+		return;
+	if (!device->cur_pixel_shader)
+		return;
+
+	tex = null_shader_get_texture(device->cur_pixel_shader);
+	if (!tex || tex->type != GS_TEXTURE_2D || !tex->data ||
+	    !null_format_is_32bit(tex->format))
+		return;
+
+	gs_matrix_get(&view);
+	matrix4_mul(&viewproj, &view, &device->cur_proj);
+
+	/* the first, second and last vertices of the strip: top left, top
+	 * right and bottom right of an unrotated sprite */
+	uvs = (struct vec2*)data->tvarray[0].array + start_vert;
+	to_target(verts,   data->points + start_vert,     uvs,
+			&viewproj, &device->cur_viewport);
+	to_target(verts+1, data->points + start_vert + 1, uvs + 1,
+			&viewproj, &device->cur_viewport);
+	to_target(verts+2, data->points + start_vert + 3, uvs + 3,
+			&viewproj, &device->cur_viewport);
+
+	/* only sprites that are not rotated are drawn */
+	if (fabsf(verts[0].y - verts[1].y) > 0.5f)
+		return;
+
+	fill_sprite(target, target->data + target->plane_size *
+				(size_t)device->cur_render_side,
+			tex, verts, verts+2, &device->cur_viewport,
+			get_blend_mode(device));
+}
@@ -0,0 +1,156 @@
+/******************************************************************************
+    Copyright (C) 2013 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+/*
+ * Null graphics module
+ *
+ *   A graphics module that needs no GPU or window system, so that libobs can
+ * run headless (for example to benchmark the video pipeline on machines
+ * without a GPU).  Textures and staging surfaces are kept in system memory,
+ * shaders are only parsed for their parameters, and draws are done in
+ * software for the one case libobs relies on: textured, axis aligned sprites
+ * on 32-bit render targets, with nearest sampling.  All other draws are
+ * ignored.  Swap chains have no back buffer, so drawing to them does
+ * nothing.
+ */
+
+#include <util/darray.h>
+#include <graphics/graphics.h>
+#include <graphics/device-exports.h>
+#include <graphics/matrix4.h>
+
+#define GS_DEVICE_NULL_NAME "Null"
+
+struct gs_texture {
+	gs_device_t          *device;
+	enum gs_texture_type type;
+	enum gs_color_format format;
+	uint32_t             width;
+	uint32_t             height;
+	uint32_t             levels;
+	bool                 is_dynamic;
+	bool                 is_render_target;
+
+	/* level 0 only, one plane per cube face */
+	uint8_t              *data;
+	uint32_t             linesize;
+	size_t               plane_size;
+};
+
+struct gs_stage_surface {
+	gs_device_t          *device;
+	enum gs_color_format format;
+	uint32_t             width;
+	uint32_t             height;
+	uint32_t             linesize;
+	uint8_t              *data;
+};
+
+struct gs_zstencil_buffer {
+	gs_device_t          *device;
+	enum gs_zstencil_format format;
+	uint32_t             width;
+	uint32_t             height;
+};
+
+struct gs_sampler_state {
+	gs_device_t          *device;
+	struct gs_sampler_info info;
+};
+
+struct gs_vertex_buffer {
+	gs_device_t          *device;
+	struct gs_vb_data    *data;
+	size_t               num;
+	bool                 dynamic;
+};
+
+struct gs_index_buffer {
+	gs_device_t          *device;
+	enum gs_index_type   type;
+	void                 *data;
+	size_t               num;
+	bool                 dynamic;
+};
+
+struct gs_shader_param {
+	char                 *name;
+	enum gs_shader_param_type type;
+	int                  array_count;
+	gs_texture_t         *texture;
+
+	DARRAY(uint8_t)      cur_value;
+	DARRAY(uint8_t)      def_value;
+};
+
+struct gs_shader {
+	gs_device_t          *device;
+	enum gs_shader_type  type;
+
+	struct gs_shader_param *viewproj;
+	struct gs_shader_param *world;
+
+	DARRAY(struct gs_shader_param) params;
+};
+
+struct gs_swap_chain {
+	gs_device_t          *device;
+	uint32_t             cx;
+	uint32_t             cy;
+};
+
+struct gs_device {
+	gs_texture_t         *cur_render_target;
+	gs_zstencil_t        *cur_zstencil_buffer;
+	int                  cur_render_side;
+	gs_texture_t         *cur_textures[GS_MAX_TEXTURES];
+	gs_samplerstate_t    *cur_samplers[GS_MAX_TEXTURES];
+	gs_vertbuffer_t      *cur_vertex_buffer;
+	gs_indexbuffer_t     *cur_index_buffer;
+	gs_shader_t          *cur_vertex_shader;
+	gs_shader_t          *cur_pixel_shader;
+	gs_swapchain_t       *cur_swap;
+
+	enum gs_cull_mode    cur_cull_mode;
+	struct gs_rect       cur_viewport;
+	bool                 blend;
+	enum gs_blend_type   blend_src;
+	enum gs_blend_type   blend_dest;
+
+	struct matrix4       cur_proj;
+	DARRAY(struct matrix4) proj_stack;
+};
+
+static inline bool null_format_is_32bit(enum gs_color_format format)
+{
+	return format == GS_RGBA || format == GS_BGRA || format == GS_BGRX;
+}
+
+static inline uint32_t null_get_linesize(enum gs_color_format format,
+		uint32_t width)
+{
+	uint32_t bpp = gs_get_format_bpp(format);
+	return (width * bpp + 7) / 8;
+}
+
+extern gs_texture_t *null_shader_get_texture(gs_shader_t *shader);
+
+/** Draws the current vertex buffer as a textured sprite, if it is one */
+extern void null_draw_sprite(gs_device_t *device, uint32_t start_vert,
+		uint32_t num_verts);
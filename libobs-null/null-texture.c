@@ -0,0 +1,411 @@
+/******************************************************************************
+    Copyright (C) 2013 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "null-subsystem.h"
+
+static void copy_plane(uint8_t *dst, uint32_t dst_linesize,
+		const uint8_t *src, uint32_t src_linesize, uint32_t row_size,
+		uint32_t height)
+{
+	if (dst_linesize == src_linesize && row_size == src_linesize) {
+		memcpy(dst, src, (size_t)row_size * height);
+		return;
+	}
+
+	for (uint32_t y = 0; y < height; y++)
+		memcpy(dst + (size_t)y * dst_linesize,
+		       src + (size_t)y * src_linesize, row_size);
+}
+
+static gs_texture_t *texture_create(gs_device_t *device,
+		enum gs_texture_type type, uint32_t width, uint32_t height,
+		enum gs_color_format color_format, uint32_t levels,
+		const uint8_t **data, uint32_t flags, uint32_t planes)
+{
+	struct gs_texture *tex = bzalloc(sizeof(struct gs_texture));
+
+	tex->device           = device;
+	tex->type             = type;
+	tex->format           = color_format;
+	tex->width            = width;
+	tex->height           = height;
+	tex->levels           = levels;
+	tex->is_dynamic       = (flags & GS_DYNAMIC) != 0;
+	tex->is_render_target = (flags & GS_RENDER_TARGET) != 0;
+	tex->linesize         = null_get_linesize(color_format, width);
+	tex->plane_size       = (size_t)tex->linesize * height;
+
+	if (flags & GS_GL_DUMMYTEX)
+		return tex;
+
+	tex->data = bzalloc(tex->plane_size * planes);
+
+	/* only the first level is kept, lower levels are never sampled */
+	if (data) {
+		for (uint32_t i = 0; i < planes && data[0]; i++) {
+			copy_plane(tex->data + tex->plane_size * i,
+					tex->linesize, data[0], tex->linesize,
+					tex->linesize, height);
+			data += levels ? levels : 1;
+		}
+	}
+
+	return tex;
+}
+
+gs_texture_t *device_texture_create(gs_device_t *device, uint32_t width,
+		uint32_t height, enum gs_color_format color_format,
+		uint32_t levels, const uint8_t **data, uint32_t flags)
+{
+	return texture_create(device, GS_TEXTURE_2D, width, height,
+			color_format, levels, data, flags, 1);
+}
+
+gs_texture_t *device_cubetexture_create(gs_device_t *device, uint32_t size,
+		enum gs_color_format color_format, uint32_t levels,
+		const uint8_t **data, uint32_t flags)
+{
+	return texture_create(device, GS_TEXTURE_CUBE, size, size,
+			color_format, levels, data, flags, 6);
+}
+
+gs_texture_t *device_voltexture_create(gs_device_t *device, uint32_t width,
+		uint32_t height, uint32_t depth,
+		enum gs_color_format color_format, uint32_t levels,
+		const uint8_t **data, uint32_t flags)
+{
+	blog(LOG_ERROR, "device_voltexture_create (null): Volume textures "
+	                "are not supported");
+
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(width);
+	UNUSED_PARAMETER(height);
+	UNUSED_PARAMETER(depth);
+	UNUSED_PARAMETER(color_format);
+	UNUSED_PARAMETER(levels);
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(flags);
+	return NULL;
+}
+
+/* volume textures can't be created, so whatever is passed to these functions
+ * isn't one */
+static inline void voltexture_unsupported(const char *func)
+{
+	blog(LOG_ERROR, "%s (null): Volume textures are not supported", func);
+}
+
+static inline bool is_texture_2d(const gs_texture_t *tex, const char *func)
+{
+	bool is_tex2d = tex->type == GS_TEXTURE_2D;
+	if (!is_tex2d)
+		blog(LOG_ERROR, "%s (null): Texture is not a 2D texture", func);
+	return is_tex2d;
+}
+
+static void unload_texture(gs_texture_t *tex)
+{
+	gs_device_t *device = tex->device;
+
+	for (size_t i = 0; i < GS_MAX_TEXTURES; i++) {
+		if (device->cur_textures[i] == tex)
+			device->cur_textures[i] = NULL;
+	}
+
+	if (device->cur_render_target == tex)
+		device->cur_render_target = NULL;
+}
+
+void gs_texture_destroy(gs_texture_t *tex)
+{
+	if (!tex)
+		return;
+
+	unload_texture(tex);
+	bfree(tex->data);
+	bfree(tex);
+}
+
+uint32_t gs_texture_get_width(const gs_texture_t *tex)
+{
+	if (!is_texture_2d(tex, "gs_texture_get_width"))
+		return 0;
+
+	return tex->width;
+}
+
+uint32_t gs_texture_get_height(const gs_texture_t *tex)
+{
+	if (!is_texture_2d(tex, "gs_texture_get_height"))
+		return 0;
+
+	return tex->height;
+}
+
+enum gs_color_format gs_texture_get_color_format(const gs_texture_t *tex)
+{
+	if (!is_texture_2d(tex, "gs_texture_get_color_format"))
+		return GS_UNKNOWN;
+
+	return tex->format;
+}
+
+bool gs_texture_map(gs_texture_t *tex, uint8_t **ptr, uint32_t *linesize)
+{
+	if (!is_texture_2d(tex, "gs_texture_map"))
+		goto fail;
+
+	if (!tex->data) {
+		blog(LOG_ERROR, "Texture has no data");
+		goto fail;
+	}
+
+	*ptr      = tex->data;
+	*linesize = tex->linesize;
+	return true;
+
+fail:
+	blog(LOG_ERROR, "gs_texture_map (null) failed");
+	return false;
+}
+
+void gs_texture_unmap(gs_texture_t *tex)
+{
+	is_texture_2d(tex, "gs_texture_unmap");
+}
+
+void *gs_texture_get_obj(gs_texture_t *tex)
+{
+	if (!is_texture_2d(tex, "gs_texture_get_obj"))
+		return NULL;
+
+	return tex->data;
+}
+
+void gs_cubetexture_destroy(gs_texture_t *cubetex)
+{
+	gs_texture_destroy(cubetex);
+}
+
+static inline bool is_texture_cube(const gs_texture_t *tex, const char *func)
+{
+	bool is_texcube = tex->type == GS_TEXTURE_CUBE;
+	if (!is_texcube)
+		blog(LOG_ERROR, "%s (null): Texture is not a cube texture",
+				func);
+	return is_texcube;
+}
+
+uint32_t gs_cubetexture_get_size(const gs_texture_t *cubetex)
+{
+	if (!is_texture_cube(cubetex, "gs_cubetexture_get_size"))
+		return 0;
+
+	return cubetex->width;
+}
+
+enum gs_color_format gs_cubetexture_get_color_format(
+		const gs_texture_t *cubetex)
+{
+	return cubetex->format;
+}
+
+void gs_voltexture_destroy(gs_texture_t *voltex)
+{
+	if (voltex)
+		voltexture_unsupported("gs_voltexture_destroy");
+}
+
+uint32_t gs_voltexture_get_width(const gs_texture_t *voltex)
+{
+	voltexture_unsupported("gs_voltexture_get_width");
+	UNUSED_PARAMETER(voltex);
+	return 0;
+}
+
+uint32_t gs_voltexture_get_height(const gs_texture_t *voltex)
+{
+	voltexture_unsupported("gs_voltexture_get_height");
+	UNUSED_PARAMETER(voltex);
+	return 0;
+}
+
+uint32_t gs_voltexture_get_depth(const gs_texture_t *voltex)
+{
+	voltexture_unsupported("gs_voltexture_get_depth");
+	UNUSED_PARAMETER(voltex);
+	return 0;
+}
+
+enum gs_color_format gs_voltexture_get_color_format(const gs_texture_t *voltex)
+{
+	voltexture_unsupported("gs_voltexture_get_color_format");
+	UNUSED_PARAMETER(voltex);
+	return GS_UNKNOWN;
+}
+
+void device_copy_texture_region(gs_device_t *device,
+		gs_texture_t *dst, uint32_t dst_x, uint32_t dst_y,
+		gs_texture_t *src, uint32_t src_x, uint32_t src_y,
+		uint32_t src_w, uint32_t src_h)
+{
+	uint32_t bytes_per_pixel;
+
+	if (!src) {
+		blog(LOG_ERROR, "Source texture is NULL");
+		goto fail;
+	}
+
+	if (!dst) {
+		blog(LOG_ERROR, "Destination texture is NULL");
+		goto fail;
+	}
+
+	if (dst->type != GS_TEXTURE_2D || src->type != GS_TEXTURE_2D) {
+		blog(LOG_ERROR, "Source and destination textures must be 2D "
+		                "textures");
+		goto fail;
+	}
+
+	if (dst->format != src->format) {
+		blog(LOG_ERROR, "Source and destination formats do not match");
+		goto fail;
+	}
+
+	uint32_t nw = src_w ? src_w : (src->width - src_x);
+	uint32_t nh = src_h ? src_h : (src->height - src_y);
+
+	if (dst->width - dst_x < nw || dst->height - dst_y < nh) {
+		blog(LOG_ERROR, "Destination texture region is not big "
+		                "enough to hold the source region");
+		goto fail;
+	}
+
+	if (!src->data || !dst->data)
+		return;
+
+	bytes_per_pixel = gs_get_format_bpp(src->format) / 8;
+	copy_plane(dst->data + (size_t)dst_y * dst->linesize +
+				dst_x * bytes_per_pixel, dst->linesize,
+			src->data + (size_t)src_y * src->linesize +
+				src_x * bytes_per_pixel, src->linesize,
+			nw * bytes_per_pixel, nh);
+
+	UNUSED_PARAMETER(device);
+	return;
+
+fail:
+	blog(LOG_ERROR, "device_copy_texture_region (null) failed");
+}
+
+void device_copy_texture(gs_device_t *device, gs_texture_t *dst,
+		gs_texture_t *src)
+{
+	device_copy_texture_region(device, dst, 0, 0, src, 0, 0, 0, 0);
+}
+
+gs_stagesurf_t *device_stagesurface_create(gs_device_t *device, uint32_t width,
+		uint32_t height, enum gs_color_format color_format)
+{
+	struct gs_stage_surface *surf;
+
+	surf = bzalloc(sizeof(struct gs_stage_surface));
+	surf->device   = device;
+	surf->format   = color_format;
+	surf->width    = width;
+	surf->height   = height;
+	surf->linesize = null_get_linesize(color_format, width);
+	surf->data     = bzalloc((size_t)surf->linesize * height);
+	return surf;
+}
+
+void gs_stagesurface_destroy(gs_stagesurf_t *stagesurf)
+{
+	if (stagesurf) {
+		bfree(stagesurf->data);
+		bfree(stagesurf);
+	}
+}
+
+uint32_t gs_stagesurface_get_width(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->width;
+}
+
+uint32_t gs_stagesurface_get_height(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->height;
+}
+
+enum gs_color_format gs_stagesurface_get_color_format(
+		const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->format;
+}
+
+bool gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data,
+		uint32_t *linesize)
+{
+	*data     = stagesurf->data;
+	*linesize = stagesurf->linesize;
+	return true;
+}
+
+void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
+{
+	UNUSED_PARAMETER(stagesurf);
+}
+
+void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst,
+		gs_texture_t *src)
+{
+	if (!src) {
+		blog(LOG_ERROR, "Source texture is NULL");
+		goto fail;
+	}
+
+	if (src->type != GS_TEXTURE_2D) {
+		blog(LOG_ERROR, "Source texture must be a 2D texture");
+		goto fail;
+	}
+
+	if (!dst) {
+		blog(LOG_ERROR, "Destination surface is NULL");
+		goto fail;
+	}
+
+	if (src->format != dst->format) {
+		blog(LOG_ERROR, "Source and destination formats do not match");
+		goto fail;
+	}
+
+	if (src->width != dst->width || src->height != dst->height) {
+		blog(LOG_ERROR, "Source and destination must have the same "
+		                "dimensions");
+		goto fail;
+	}
+
+	if (src->data)
+		copy_plane(dst->data, dst->linesize, src->data, src->linesize,
+				src->linesize, src->height);
+
+	UNUSED_PARAMETER(device);
+	return;
+
+fail:
+	blog(LOG_ERROR, "device_stage_texture (null) failed");
+}
@@ -170,3 +170,33 @@ bool update_buffer(GLenum target, GLuint buffer, void *data, size_t size)
 	gl_bind_buffer(target, 0);
 	return success;
 }
+
+bool update_buffer_range(GLenum target, GLuint buffer, const void *data,
+		size_t offset, size_t size, bool discard)
+{
+	GLbitfield access = GL_MAP_WRITE_BIT;
+	void *ptr;
+	bool success = true;
+
+	if (!gl_bind_buffer(target, buffer))
+		return false;
+
+	/* without discard the range is guaranteed to not be in use by pending
+	 * draws, so there is no need to synchronize with them */
+	if (discard)
+		access |= GL_MAP_INVALIDATE_BUFFER_BIT;
+	else
+		access |= GL_MAP_INVALIDATE_RANGE_BIT |
+			GL_MAP_UNSYNCHRONIZED_BIT;
+
+	ptr = glMapBufferRange(target, (GLintptr)offset, (GLsizeiptr)size,
+			access);
+	success = gl_success("glMapBufferRange");
+	if (success && ptr) {
+		memcpy(ptr, (const uint8_t*)data + offset, size);
+		glUnmapBuffer(target);
+	}
+
+	gl_bind_buffer(target, 0);
+	return success;
+}
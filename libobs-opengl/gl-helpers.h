@@ -159,3 +159,5 @@ extern bool gl_create_buffer(GLenum target, GLuint *buffer, GLsizeiptr size,
 
 extern bool update_buffer(GLenum target, GLuint buffer, void *data,
 		size_t size);
+extern bool update_buffer_range(GLenum target, GLuint buffer,
+		const void *data, size_t offset, size_t size, bool discard);
@@ -170,6 +170,65 @@ failed:
 	blog(LOG_ERROR, "gs_vertexbuffer_flush (GL) failed");
 }
 
+void gs_vertexbuffer_flush_range(gs_vertbuffer_t *vb, uint32_t start_vert,
+		uint32_t num_verts, bool discard)
+{
+	size_t i;
+
+	if (!vb->dynamic) {
+		blog(LOG_ERROR, "vertex buffer is not dynamic");
+		goto failed;
+	}
+
+	if (!update_buffer_range(GL_ARRAY_BUFFER, vb->vertex_buffer,
+				vb->data->points,
+				start_vert * sizeof(struct vec3),
+				num_verts * sizeof(struct vec3), discard))
+		goto failed;
+
+	if (vb->normal_buffer) {
+		if (!update_buffer_range(GL_ARRAY_BUFFER, vb->normal_buffer,
+					vb->data->normals,
+					start_vert * sizeof(struct vec3),
+					num_verts * sizeof(struct vec3),
+					discard))
+			goto failed;
+	}
+
+	if (vb->tangent_buffer) {
+		if (!update_buffer_range(GL_ARRAY_BUFFER, vb->tangent_buffer,
+					vb->data->tangents,
+					start_vert * sizeof(struct vec3),
+					num_verts * sizeof(struct vec3),
+					discard))
+			goto failed;
+	}
+
+	if (vb->color_buffer) {
+		if (!update_buffer_range(GL_ARRAY_BUFFER, vb->color_buffer,
+					vb->data->colors,
+					start_vert * sizeof(uint32_t),
+					num_verts * sizeof(uint32_t), discard))
+			goto failed;
+	}
+
+	for (i = 0; i < vb->data->num_tex; i++) {
+		GLuint buffer = vb->uv_buffers.array[i];
+		struct gs_tvertarray *tv = vb->data->tvarray+i;
+		size_t width = tv->width * sizeof(float);
+
+		if (!update_buffer_range(GL_ARRAY_BUFFER, buffer, tv->array,
+					start_vert * width, num_verts * width,
+					discard))
+			goto failed;
+	}
+
+	return;
+
+failed:
+	blog(LOG_ERROR, "gs_vertexbuffer_flush_range (GL) failed");
+}
+
 struct gs_vb_data *gs_vertexbuffer_get_data(const gs_vertbuffer_t *vb)
 {
 	return vb->data;
@@ -51,6 +51,20 @@ struct calldata {
 
 typedef struct calldata calldata_t;
 
+/*
+ *   Typed call argument, used in place of a calldata stack to pass parameters
+ * by position.  The member used depends on the parameter type: 'i' for int,
+ * 'f' for float, 'b' for bool, 'ptr' for ptr and 'str' for string.
+ */
+
+union call_arg {
+	long long  i;
+	double     f;
+	bool       b;
+	void       *ptr;
+	const char *str;
+};
+
 static inline void calldata_init(struct calldata *data)
 {
 	memset(data, 0, sizeof(struct calldata));
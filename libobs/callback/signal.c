@@ -21,20 +21,33 @@
 #include "signal.h"
 
 struct signal_callback {
-	signal_callback_t callback;
-	void              *data;
-	bool              remove;
+	signal_callback_t      callback;
+	signal_args_callback_t args_callback;
+	void                   *data;
+	bool                   remove;
 };
 
 struct signal_info {
 	struct decl_info               func;
+	uint32_t                       hash;
+	bool                           has_out_params;
 	DARRAY(struct signal_callback) callbacks;
 	pthread_mutex_t                mutex;
 	bool                           signalling;
-
-	struct signal_info             *next;
 };
 
+static inline uint32_t signal_name_hash(const char *name)
+{
+	uint32_t hash = 2166136261U;
+
+	while (*name) {
+		hash ^= (uint8_t)*(name++);
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
 static inline struct signal_info *signal_info_create(struct decl_info *info)
 {
 	pthread_mutexattr_t attr;
@@ -47,11 +60,17 @@ static inline struct signal_info *signal_info_create(struct decl_info *info)
 
 	si = bmalloc(sizeof(struct signal_info));
 
-	si->func       = *info;
-	si->next       = NULL;
-	si->signalling = false;
+	si->func           = *info;
+	si->hash           = signal_name_hash(info->name);
+	si->has_out_params = false;
+	si->signalling     = false;
 	da_init(si->callbacks);
 
+	for (size_t i = 0; i < info->params.num; i++) {
+		if ((info->params.array[i].flags & CALL_PARAM_OUT) != 0)
+			si->has_out_params = true;
+	}
+
 	if (pthread_mutex_init(&si->mutex, &attr) != 0) {
 		blog(LOG_ERROR, "Could not create signal");
 
@@ -74,48 +93,90 @@ static inline void signal_info_destroy(struct signal_info *si)
 }
 
 static inline size_t signal_get_callback_idx(struct signal_info *si,
-		signal_callback_t callback, void *data)
+		signal_callback_t callback,
+		signal_args_callback_t args_callback, void *data)
 {
 	for (size_t i = 0; i < si->callbacks.num; i++) {
 		struct signal_callback *sc = si->callbacks.array+i;
 
-		if (sc->callback == callback && sc->data == data)
+		if (sc->callback == callback &&
+		    sc->args_callback == args_callback &&
+		    sc->data == data)
 			return i;
 	}
 
 	return DARRAY_INVALID;
 }
 
+/*
+ *   Signals are stored by ID, and found by name through an open addressing
+ * hash table of their IDs.  Signals are never removed, so IDs stay valid
+ * until the handler is destroyed.
+ */
+
+#define SIGNAL_TABLE_MIN_SIZE 32
+
 struct signal_handler {
-	struct signal_info *first;
-	pthread_mutex_t    mutex;
+	DARRAY(struct signal_info*) signals;
+	signal_id_t                 *table;
+	size_t                      table_size;
+	pthread_mutex_t             mutex;
 };
 
-static struct signal_info *getsignal(signal_handler_t *handler,
-		const char *name, struct signal_info **p_last)
+static void signal_table_insert(signal_handler_t *handler, signal_id_t id)
 {
-	struct signal_info *signal, *last= NULL;
+	size_t mask = handler->table_size - 1;
+	size_t idx  = handler->signals.array[id]->hash & mask;
 
-	signal = handler->first;
-	while (signal != NULL) {
-		if (strcmp(signal->func.name, name) == 0)
-			break;
+	while (handler->table[idx] != SIGNAL_INVALID_ID)
+		idx = (idx + 1) & mask;
+
+	handler->table[idx] = id;
+}
+
+static void signal_table_resize(signal_handler_t *handler, size_t size)
+{
+	bfree(handler->table);
+
+	handler->table      = bmalloc(size * sizeof(signal_id_t));
+	handler->table_size = size;
+	memset(handler->table, 0xFF, size * sizeof(signal_id_t));
+
+	for (signal_id_t id = 0; id < handler->signals.num; id++)
+		signal_table_insert(handler, id);
+}
+
+static signal_id_t getsignal_id(signal_handler_t *handler, const char *name)
+{
+	uint32_t hash = signal_name_hash(name);
+	size_t   mask = handler->table_size - 1;
+	size_t   idx  = hash & mask;
+	signal_id_t id;
 
-		last = signal;
-		signal = signal->next;
+	while ((id = handler->table[idx]) != SIGNAL_INVALID_ID) {
+		struct signal_info *sig = handler->signals.array[id];
+
+		if (sig->hash == hash && strcmp(sig->func.name, name) == 0)
+			return id;
+
+		idx = (idx + 1) & mask;
 	}
 
-	if (p_last)
-		*p_last = last;
-	return signal;
+	return SIGNAL_INVALID_ID;
+}
+
+static inline struct signal_info *getsignal(signal_handler_t *handler,
+		const char *name)
+{
+	signal_id_t id = getsignal_id(handler, name);
+	return (id != SIGNAL_INVALID_ID) ? handler->signals.array[id] : NULL;
 }
 
 /* ------------------------------------------------------------------------- */
 
 signal_handler_t *signal_handler_create(void)
 {
-	struct signal_handler *handler = bmalloc(sizeof(struct signal_handler));
-	handler->first = NULL;
+	struct signal_handler *handler = bzalloc(sizeof(struct signal_handler));
 
 	if (pthread_mutex_init(&handler->mutex, NULL) != 0) {
 		blog(LOG_ERROR, "Couldn't create signal handler!");
@@ -123,19 +184,18 @@ signal_handler_t *signal_handler_create(void)
 		return NULL;
 	}
 
+	signal_table_resize(handler, SIGNAL_TABLE_MIN_SIZE);
 	return handler;
 }
 
 void signal_handler_destroy(signal_handler_t *handler)
 {
 	if (handler) {
-		struct signal_info *sig = handler->first;
-		while (sig != NULL) {
-			struct signal_info *next = sig->next;
-			signal_info_destroy(sig);
-			sig = next;
-		}
+		for (size_t i = 0; i < handler->signals.num; i++)
+			signal_info_destroy(handler->signals.array[i]);
 
+		da_free(handler->signals);
+		bfree(handler->table);
 		pthread_mutex_destroy(&handler->mutex);
 		bfree(handler);
 	}
@@ -144,7 +204,7 @@ void signal_handler_destroy(signal_handler_t *handler)
 bool signal_handler_add(signal_handler_t *handler, const char *signal_decl)
 {
 	struct decl_info func = {0};
-	struct signal_info *sig, *last;
+	struct signal_info *sig;
 	bool success = true;
 
 	if (!parse_decl_string(&func, signal_decl)) {
@@ -154,17 +214,26 @@ bool signal_handler_add(signal_handler_t *handler, const char *signal_decl)
 
 	pthread_mutex_lock(&handler->mutex);
 
-	sig = getsignal(handler, func.name, &last);
+	sig = getsignal(handler, func.name);
 	if (sig) {
 		blog(LOG_WARNING, "Signal declaration '%s' exists", func.name);
 		decl_info_free(&func);
 		success = false;
 	} else {
 		sig = signal_info_create(&func);
-		if (!last)
-			handler->first = sig;
-		else
-			last->next = sig;
+		if (sig) {
+			da_push_back(handler->signals, &sig);
+
+			if (handler->signals.num * 2 > handler->table_size)
+				signal_table_resize(handler,
+						handler->table_size * 2);
+			else
+				signal_table_insert(handler,
+						handler->signals.num - 1);
+		} else {
+			decl_info_free(&func);
+			success = false;
+		}
 	}
 
 	pthread_mutex_unlock(&handler->mutex);
@@ -172,54 +241,87 @@ bool signal_handler_add(signal_handler_t *handler, const char *signal_decl)
 	return success;
 }
 
-void signal_handler_connect(signal_handler_t *handler, const char *signal,
-		signal_callback_t callback, void *data)
+static inline struct signal_info *getsignal_locked(signal_handler_t *handler,
+		const char *name)
 {
-	struct signal_info *sig, *last;
-	struct signal_callback cb_data = {callback, data, false};
-	size_t idx;
+	struct signal_info *sig;
 
 	if (!handler)
-		return;
+		return NULL;
 
 	pthread_mutex_lock(&handler->mutex);
-	sig = getsignal(handler, signal, &last);
+	sig = getsignal(handler, name);
 	pthread_mutex_unlock(&handler->mutex);
 
+	return sig;
+}
+
+static inline struct signal_info *getsignal_by_id(signal_handler_t *handler,
+		signal_id_t id)
+{
+	struct signal_info *sig = NULL;
+
+	if (!handler)
+		return NULL;
+
+	pthread_mutex_lock(&handler->mutex);
+	if (id < handler->signals.num)
+		sig = handler->signals.array[id];
+	pthread_mutex_unlock(&handler->mutex);
+
+	return sig;
+}
+
+signal_id_t signal_handler_get_id(signal_handler_t *handler,
+		const char *signal)
+{
+	signal_id_t id;
+
+	if (!handler || !signal)
+		return SIGNAL_INVALID_ID;
+
+	pthread_mutex_lock(&handler->mutex);
+	id = getsignal_id(handler, signal);
+	pthread_mutex_unlock(&handler->mutex);
+
+	return id;
+}
+
+static void connect_callback(signal_handler_t *handler, const char *signal,
+		struct signal_callback *cb_data)
+{
+	struct signal_info *sig = getsignal_locked(handler, signal);
+	size_t idx;
+
 	if (!sig) {
 		blog(LOG_WARNING, "signal_handler_connect: "
 		                  "signal '%s' not found", signal);
 		return;
 	}
 
+	if (cb_data->args_callback &&
+	    sig->func.params.num > SIGNAL_MAX_ARGS) {
+		blog(LOG_WARNING, "signal_handler_connect_args: "
+		                  "signal '%s' has too many parameters",
+		                  signal);
+		return;
+	}
+
 	/* -------------- */
 
 	pthread_mutex_lock(&sig->mutex);
 
-	idx = signal_get_callback_idx(sig, callback, data);
+	idx = signal_get_callback_idx(sig, cb_data->callback,
+			cb_data->args_callback, cb_data->data);
 	if (idx == DARRAY_INVALID)
-		da_push_back(sig->callbacks, &cb_data);
+		da_push_back(sig->callbacks, cb_data);
 	
 	pthread_mutex_unlock(&sig->mutex);
 }
 
-static inline struct signal_info *getsignal_locked(signal_handler_t *handler,
-		const char *name)
-{
-	struct signal_info *sig;
-
-	if (!handler)
-		return NULL;
-
-	pthread_mutex_lock(&handler->mutex);
-	sig = getsignal(handler, name, NULL);
-	pthread_mutex_unlock(&handler->mutex);
-
-	return sig;
-}
-
-void signal_handler_disconnect(signal_handler_t *handler, const char *signal,
-		signal_callback_t callback, void *data)
+static void disconnect_callback(signal_handler_t *handler, const char *signal,
+		signal_callback_t callback,
+		signal_args_callback_t args_callback, void *data)
 {
 	struct signal_info *sig = getsignal_locked(handler, signal);
 	size_t idx;
@@ -229,7 +331,7 @@ void signal_handler_disconnect(signal_handler_t *handler, const char *signal,
 
 	pthread_mutex_lock(&sig->mutex);
 
-	idx = signal_get_callback_idx(sig, callback, data);
+	idx = signal_get_callback_idx(sig, callback, args_callback, data);
 	if (idx != DARRAY_INVALID) {
 		if (sig->signalling)
 			sig->callbacks.array[idx].remove = true;
@@ -240,21 +342,158 @@ void signal_handler_disconnect(signal_handler_t *handler, const char *signal,
 	pthread_mutex_unlock(&sig->mutex);
 }
 
-void signal_handler_signal(signal_handler_t *handler, const char *signal,
-		calldata_t *params)
+void signal_handler_connect(signal_handler_t *handler, const char *signal,
+		signal_callback_t callback, void *data)
 {
-	struct signal_info *sig = getsignal_locked(handler, signal);
+	struct signal_callback cb_data = {callback, NULL, data, false};
 
-	if (!sig)
-		return;
+	if (handler && callback)
+		connect_callback(handler, signal, &cb_data);
+}
+
+void signal_handler_disconnect(signal_handler_t *handler, const char *signal,
+		signal_callback_t callback, void *data)
+{
+	if (callback)
+		disconnect_callback(handler, signal, callback, NULL, data);
+}
+
+void signal_handler_connect_args(signal_handler_t *handler,
+		const char *signal, signal_args_callback_t callback,
+		void *data)
+{
+	struct signal_callback cb_data = {NULL, callback, data, false};
+
+	if (handler && callback)
+		connect_callback(handler, signal, &cb_data);
+}
+
+void signal_handler_disconnect_args(signal_handler_t *handler,
+		const char *signal, signal_args_callback_t callback,
+		void *data)
+{
+	if (callback)
+		disconnect_callback(handler, signal, NULL, callback, data);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void args_to_calldata(const struct signal_info *sig,
+		const union call_arg *args, calldata_t *cd, bool out_only)
+{
+	for (size_t i = 0; i < sig->func.params.num; i++) {
+		const struct decl_param *param = sig->func.params.array+i;
+		const union call_arg    *arg   = args+i;
+
+		if (out_only && (param->flags & CALL_PARAM_OUT) == 0)
+			continue;
+
+		switch (param->type) {
+		case CALL_PARAM_TYPE_INT:
+			calldata_set_int(cd, param->name, arg->i);
+			break;
+		case CALL_PARAM_TYPE_FLOAT:
+			calldata_set_float(cd, param->name, arg->f);
+			break;
+		case CALL_PARAM_TYPE_BOOL:
+			calldata_set_bool(cd, param->name, arg->b);
+			break;
+		case CALL_PARAM_TYPE_PTR:
+			calldata_set_ptr(cd, param->name, arg->ptr);
+			break;
+		case CALL_PARAM_TYPE_STRING:
+			calldata_set_string(cd, param->name, arg->str);
+			break;
+		case CALL_PARAM_TYPE_VOID:
+			break;
+		}
+	}
+}
+
+static void calldata_to_args(const struct signal_info *sig,
+		const calldata_t *cd, union call_arg *args, bool out_only)
+{
+	for (size_t i = 0; i < sig->func.params.num; i++) {
+		const struct decl_param *param = sig->func.params.array+i;
+		union call_arg          *arg   = args+i;
+
+		if (out_only && (param->flags & CALL_PARAM_OUT) == 0)
+			continue;
+
+		switch (param->type) {
+		case CALL_PARAM_TYPE_INT:
+			calldata_get_int(cd, param->name, &arg->i);
+			break;
+		case CALL_PARAM_TYPE_FLOAT:
+			calldata_get_float(cd, param->name, &arg->f);
+			break;
+		case CALL_PARAM_TYPE_BOOL:
+			calldata_get_bool(cd, param->name, &arg->b);
+			break;
+		case CALL_PARAM_TYPE_PTR:
+			calldata_get_ptr(cd, param->name, &arg->ptr);
+			break;
+		case CALL_PARAM_TYPE_STRING:
+			/* strings out of a calldata stack are only valid
+			 * while it lives, so are never written back */
+			if (!out_only)
+				calldata_get_string(cd, param->name,
+						&arg->str);
+			break;
+		case CALL_PARAM_TYPE_VOID:
+			break;
+		}
+	}
+}
+
+/*
+ *   Calls the callbacks of a signal with either calldata or typed arguments,
+ * whichever the signal was emitted with, converting to the other the first
+ * time a callback of the other kind is found.  Once both exist, out
+ * parameters set by each callback are copied over for the next callbacks.
+ */
+static void signal_emit(struct signal_info *sig, calldata_t *params,
+		union call_arg *args)
+{
+	union call_arg local_args[SIGNAL_MAX_ARGS];
+	calldata_t     local_cd;
+	bool           typed  = args != NULL;
+	bool           own_cd = false;
 
 	pthread_mutex_lock(&sig->mutex);
 	sig->signalling = true;
 
 	for (size_t i = 0; i < sig->callbacks.num; i++) {
 		struct signal_callback *cb = sig->callbacks.array+i;
-		if (!cb->remove)
+		if (cb->remove)
+			continue;
+
+		if (cb->callback) {
+			if (typed && !params) {
+				calldata_init(&local_cd);
+				args_to_calldata(sig, args, &local_cd, false);
+				params = &local_cd;
+				own_cd = true;
+			}
+
 			cb->callback(cb->data, params);
+
+			if (args && sig->has_out_params)
+				calldata_to_args(sig, params, args, true);
+
+		} else {
+			if (!args) {
+				memset(local_args, 0, sizeof(local_args));
+				calldata_to_args(sig, params, local_args,
+						false);
+				args = local_args;
+			}
+
+			cb->args_callback(cb->data, args);
+
+			if (params && sig->has_out_params)
+				args_to_calldata(sig, args, params, true);
+		}
 	}
 
 	for (size_t i = sig->callbacks.num; i > 0; i--) {
@@ -265,4 +504,42 @@ void signal_handler_signal(signal_handler_t *handler, const char *signal,
 
 	sig->signalling = false;
 	pthread_mutex_unlock(&sig->mutex);
+
+	if (own_cd)
+		calldata_free(&local_cd);
+}
+
+void signal_handler_signal(signal_handler_t *handler, const char *signal,
+		calldata_t *params)
+{
+	struct signal_info *sig = getsignal_locked(handler, signal);
+
+	if (sig)
+		signal_emit(sig, params, NULL);
+}
+
+void signal_handler_signal_id(signal_handler_t *handler, signal_id_t id,
+		calldata_t *params)
+{
+	struct signal_info *sig = getsignal_by_id(handler, id);
+
+	if (sig)
+		signal_emit(sig, params, NULL);
+}
+
+void signal_handler_signal_args(signal_handler_t *handler, signal_id_t id,
+		union call_arg *args)
+{
+	struct signal_info *sig = getsignal_by_id(handler, id);
+
+	if (!sig || !args)
+		return;
+	if (sig->func.params.num > SIGNAL_MAX_ARGS) {
+		blog(LOG_WARNING, "signal_handler_signal_args: "
+		                  "signal '%s' has too many parameters",
+		                  sig->func.name);
+		return;
+	}
+
+	signal_emit(sig, NULL, args);
 }
@@ -35,6 +35,30 @@ struct signal_handler;
 typedef struct signal_handler signal_handler_t;
 typedef void (*signal_callback_t)(void*, calldata_t*);
 
+/*
+ *   Signals can also be connected to and emitted with typed arguments, which
+ * are stored by position in the order of the signal's declared parameters
+ * rather than by name.  Typed callbacks and typed emitters can be mixed
+ * freely with calldata callbacks and emitters on the same signal: arguments
+ * are converted once per emit, and only if a callback of the other kind is
+ * connected.  Out parameters are passed back in both directions, except for
+ * strings, which are input only on the typed path.
+ */
+
+typedef void (*signal_args_callback_t)(void*, union call_arg*);
+
+/*
+ *   Signals are identified by stable IDs, valid for the lifetime of their
+ * handler, which can be looked up once and used to signal without searching
+ * for the signal's name.
+ */
+
+typedef size_t signal_id_t;
+#define SIGNAL_INVALID_ID ((signal_id_t)-1)
+
+/** Maximum number of parameters a signal can have for typed arguments */
+#define SIGNAL_MAX_ARGS 16
+
 EXPORT signal_handler_t *signal_handler_create(void);
 EXPORT void signal_handler_destroy(signal_handler_t *handler);
 
@@ -63,6 +87,27 @@ EXPORT void signal_handler_disconnect(signal_handler_t *handler,
 EXPORT void signal_handler_signal(signal_handler_t *handler, const char *signal,
 		calldata_t *params);
 
+/** Returns the ID of a signal, or SIGNAL_INVALID_ID if it does not exist */
+EXPORT signal_id_t signal_handler_get_id(signal_handler_t *handler,
+		const char *signal);
+
+EXPORT void signal_handler_signal_id(signal_handler_t *handler,
+		signal_id_t id, calldata_t *params);
+
+EXPORT void signal_handler_connect_args(signal_handler_t *handler,
+		const char *signal, signal_args_callback_t callback,
+		void *data);
+EXPORT void signal_handler_disconnect_args(signal_handler_t *handler,
+		const char *signal, signal_args_callback_t callback,
+		void *data);
+
+/**
+ * Emits a signal with typed arguments, one for each declared parameter of
+ * the signal.  Out parameters are written back to the arguments.
+ */
+EXPORT void signal_handler_signal_args(signal_handler_t *handler,
+		signal_id_t id, union call_arg *args);
+
 #ifdef __cplusplus
 }
 #endif
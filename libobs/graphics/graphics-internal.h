@@ -189,6 +189,8 @@ struct gs_exports {
 
 	void (*gs_vertexbuffer_destroy)(gs_vertbuffer_t *vertbuffer);
 	void (*gs_vertexbuffer_flush)(gs_vertbuffer_t *vertbuffer);
+	void (*gs_vertexbuffer_flush_range)(gs_vertbuffer_t *vertbuffer,
+			uint32_t start_vert, uint32_t num_verts, bool discard);
 	struct gs_vb_data *(*gs_vertexbuffer_get_data)(
 			const gs_vertbuffer_t *vertbuffer);
 
@@ -266,6 +268,22 @@ struct blend_state {
 	enum gs_blend_type dest_a;
 };
 
+/*
+ * Sprites are drawn from a ring of quads in one dynamic vertex buffer.  Each
+ * quad is only uploaded when no quad with the same size and texture
+ * coordinates is left in the ring, so sprites that are drawn every frame
+ * usually need no upload at all.  When the ring wraps around, the buffer is
+ * discarded and the cached quads are forgotten.
+ */
+#define SPRITE_RING_QUADS 256
+#define SPRITE_TABLE_SIZE (SPRITE_RING_QUADS * 2)
+
+struct sprite_quad {
+	float fcx, fcy;
+	float start_u, end_u;
+	float start_v, end_v;
+};
+
 struct graphics_subsystem {
 	void                   *module;
 	gs_device_t            *device;
@@ -280,6 +298,11 @@ struct graphics_subsystem {
 	struct gs_effect       *cur_effect;
 
 	gs_vertbuffer_t        *sprite_buffer;
+	struct sprite_quad     *sprite_quads;
+	uint16_t               *sprite_table;
+	uint32_t               sprite_pos;
+
+	struct gs_stats        stats;
 
 	bool                   using_immediate;
 	struct gs_vb_data      *vbd;
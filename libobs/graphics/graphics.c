@@ -124,23 +124,25 @@ static bool graphics_init_immediate_vb(struct graphics_subsystem *graphics)
 static bool graphics_init_sprite_vb(struct graphics_subsystem *graphics)
 {
 	struct gs_vb_data *vbd;
+	size_t num = SPRITE_RING_QUADS * 4;
 
 	vbd = gs_vbdata_create();
-	vbd->num     = 4;
-	vbd->points  = bmalloc(sizeof(struct vec3) * 4);
+	vbd->num     = num;
+	vbd->points  = bzalloc(sizeof(struct vec3) * num);
 	vbd->num_tex = 1;
 	vbd->tvarray = bmalloc(sizeof(struct gs_tvertarray));
 	vbd->tvarray[0].width = 2;
-	vbd->tvarray[0].array = bmalloc(sizeof(struct vec2) * 4);
-
-	memset(vbd->points,           0, sizeof(struct vec3) * 4);
-	memset(vbd->tvarray[0].array, 0, sizeof(struct vec2) * 4);
+	vbd->tvarray[0].array = bzalloc(sizeof(struct vec2) * num);
 
 	graphics->sprite_buffer = graphics->exports.
 		device_vertexbuffer_create(graphics->device, vbd, GS_DYNAMIC);
 	if (!graphics->sprite_buffer)
 		return false;
 
+	graphics->sprite_quads = bzalloc(sizeof(struct sprite_quad) *
+			SPRITE_RING_QUADS);
+	graphics->sprite_table = bzalloc(sizeof(uint16_t) *
+			SPRITE_TABLE_SIZE);
 	return true;
 }
 
@@ -236,6 +238,8 @@ void gs_destroy(graphics_t *graphics)
 
 		graphics->exports.gs_vertexbuffer_destroy(
 				graphics->sprite_buffer);
+		bfree(graphics->sprite_quads);
+		bfree(graphics->sprite_table);
 		graphics->exports.gs_vertexbuffer_destroy(
 				graphics->immediate_vertbuffer);
 		graphics->exports.device_destroy(graphics->device);
@@ -919,51 +923,91 @@ static inline void assign_sprite_uv(float *start, float *end, bool flip)
 	}
 }
 
-static void build_sprite(struct gs_vb_data *data, float fcx, float fcy,
-		float start_u, float end_u, float start_v, float end_v)
+static void build_sprite(struct gs_vb_data *data, size_t start,
+		const struct sprite_quad *quad)
 {
-	struct vec2 *tvarray = data->tvarray[0].array;
+	struct vec3 *points  = data->points + start;
+	struct vec2 *tvarray = (struct vec2*)data->tvarray[0].array + start;
 
-	vec3_zero(data->points);
-	vec3_set(data->points+1,  fcx, 0.0f, 0.0f);
-	vec3_set(data->points+2, 0.0f,  fcy, 0.0f);
-	vec3_set(data->points+3,  fcx,  fcy, 0.0f);
-	vec2_set(tvarray,   start_u, start_v);
-	vec2_set(tvarray+1, end_u,   start_v);
-	vec2_set(tvarray+2, start_u, end_v);
-	vec2_set(tvarray+3, end_u,   end_v);
+	vec3_zero(points);
+	vec3_set(points+1, quad->fcx,      0.0f, 0.0f);
+	vec3_set(points+2,      0.0f, quad->fcy, 0.0f);
+	vec3_set(points+3, quad->fcx, quad->fcy, 0.0f);
+	vec2_set(tvarray,   quad->start_u, quad->start_v);
+	vec2_set(tvarray+1, quad->end_u,   quad->start_v);
+	vec2_set(tvarray+2, quad->start_u, quad->end_v);
+	vec2_set(tvarray+3, quad->end_u,   quad->end_v);
 }
 
-static inline void build_sprite_norm(struct gs_vb_data *data, float fcx,
-		float fcy, uint32_t flip)
+static inline void build_sprite_norm(struct sprite_quad *quad, uint32_t flip)
 {
-	float start_u, end_u;
-	float start_v, end_v;
-
-	assign_sprite_uv(&start_u, &end_u, (flip & GS_FLIP_U) != 0);
-	assign_sprite_uv(&start_v, &end_v, (flip & GS_FLIP_V) != 0);
-	build_sprite(data, fcx, fcy, start_u, end_u, start_v, end_v);
+	assign_sprite_uv(&quad->start_u, &quad->end_u, (flip & GS_FLIP_U) != 0);
+	assign_sprite_uv(&quad->start_v, &quad->end_v, (flip & GS_FLIP_V) != 0);
 }
 
-static inline void build_sprite_rect(struct gs_vb_data *data, gs_texture_t *tex,
-		float fcx, float fcy, uint32_t flip)
+static inline void build_sprite_rect(struct sprite_quad *quad,
+		gs_texture_t *tex, uint32_t flip)
 {
-	float start_u, end_u;
-	float start_v, end_v;
 	float width  = (float)gs_texture_get_width(tex);
 	float height = (float)gs_texture_get_height(tex);
 
-	assign_sprite_rect(&start_u, &end_u, width,  (flip & GS_FLIP_U) != 0);
-	assign_sprite_rect(&start_v, &end_v, height, (flip & GS_FLIP_V) != 0);
-	build_sprite(data, fcx, fcy, start_u, end_u, start_v, end_v);
+	assign_sprite_rect(&quad->start_u, &quad->end_u, width,
+			(flip & GS_FLIP_U) != 0);
+	assign_sprite_rect(&quad->start_v, &quad->end_v, height,
+			(flip & GS_FLIP_V) != 0);
+}
+
+static inline size_t sprite_hash(const struct sprite_quad *quad)
+{
+	uint32_t words[sizeof(*quad) / sizeof(uint32_t)];
+	uint32_t hash = 2166136261U;
+
+	memcpy(words, quad, sizeof(words));
+	for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++)
+		hash = (hash ^ words[i]) * 16777619U;
+
+	return hash % SPRITE_TABLE_SIZE;
+}
+
+/* returns the first vertex of the quad in the sprite buffer, uploading it
+ * to the ring if it is not already there */
+static uint32_t get_sprite_quad(struct graphics_subsystem *graphics,
+		const struct sprite_quad *quad)
+{
+	size_t   hash = sprite_hash(quad);
+	uint16_t slot = graphics->sprite_table[hash];
+	bool     discard = false;
+
+	if (slot && memcmp(graphics->sprite_quads + slot - 1, quad,
+				sizeof(*quad)) == 0)
+		return (uint32_t)(slot - 1) * 4;
+
+	if (graphics->sprite_pos == SPRITE_RING_QUADS) {
+		memset(graphics->sprite_table, 0,
+				sizeof(uint16_t) * SPRITE_TABLE_SIZE);
+		graphics->sprite_pos = 0;
+		discard = true;
+	}
+
+	slot = (uint16_t)graphics->sprite_pos++;
+	graphics->sprite_quads[slot] = *quad;
+	graphics->sprite_table[hash] = slot + 1;
+
+	build_sprite(gs_vertexbuffer_get_data(graphics->sprite_buffer),
+			(size_t)slot * 4, quad);
+	gs_vertexbuffer_flush_range(graphics->sprite_buffer, slot * 4, 4,
+			discard);
+
+	graphics->stats.sprite_uploads++;
+	return (uint32_t)slot * 4;
 }
 
 void gs_draw_sprite(gs_texture_t *tex, uint32_t flip, uint32_t width,
 		uint32_t height)
 {
 	graphics_t *graphics = thread_graphics;
-	float fcx, fcy;
-	struct gs_vb_data *data;
+	struct sprite_quad quad;
+	uint32_t start_vert;
 
 	if (!gs_valid_p("gs_draw_sprite", tex))
 		return;
@@ -973,20 +1017,21 @@ void gs_draw_sprite(gs_texture_t *tex, uint32_t flip, uint32_t width,
 		return;
 	}
 
-	fcx = width  ? (float)width  : (float)gs_texture_get_width(tex);
-	fcy = height ? (float)height : (float)gs_texture_get_height(tex);
+	quad.fcx = width  ? (float)width  : (float)gs_texture_get_width(tex);
+	quad.fcy = height ? (float)height : (float)gs_texture_get_height(tex);
 
-	data = gs_vertexbuffer_get_data(graphics->sprite_buffer);
 	if (gs_texture_is_rect(tex))
-		build_sprite_rect(data, tex, fcx, fcy, flip);
+		build_sprite_rect(&quad, tex, flip);
 	else
-		build_sprite_norm(data, fcx, fcy, flip);
+		build_sprite_norm(&quad, flip);
+
+	start_vert = get_sprite_quad(graphics, &quad);
+	graphics->stats.sprites++;
 
-	gs_vertexbuffer_flush(graphics->sprite_buffer);
 	gs_load_vertexbuffer(graphics->sprite_buffer);
 	gs_load_indexbuffer(NULL);
 
-	gs_draw(GS_TRISTRIP, 0, 0);
+	gs_draw(GS_TRISTRIP, start_vert, 4);
 }
 
 void gs_draw_cube_backdrop(gs_texture_t *cubetex, const struct quat *rot,
@@ -1091,6 +1136,7 @@ void gs_texture_set_image(gs_texture_t *tex, const uint8_t *data,
 			       row_copy);
 	}
 
+	thread_graphics->stats.upload_bytes += (uint64_t)row_copy * height;
 	gs_texture_unmap(tex);
 }
 
@@ -1606,6 +1652,7 @@ void gs_draw(enum gs_draw_mode draw_mode, uint32_t start_vert,
 	if (!gs_valid("gs_draw"))
 		return;
 
+	graphics->stats.draw_calls++;
 	graphics->exports.device_draw(graphics->device, draw_mode,
 			start_vert, num_verts);
 }
@@ -1662,6 +1709,22 @@ void gs_flush(void)
 	graphics->exports.device_flush(graphics->device);
 }
 
+void gs_get_stats(struct gs_stats *stats)
+{
+	if (!gs_valid_p("gs_get_stats", stats))
+		return;
+
+	*stats = thread_graphics->stats;
+}
+
+void gs_reset_stats(void)
+{
+	if (!gs_valid("gs_reset_stats"))
+		return;
+
+	memset(&thread_graphics->stats, 0, sizeof(thread_graphics->stats));
+}
+
 void gs_set_cull_mode(enum gs_cull_mode mode)
 {
 	graphics_t *graphics = thread_graphics;
@@ -2333,14 +2396,56 @@ void gs_vertexbuffer_destroy(gs_vertbuffer_t *vertbuffer)
 	graphics->exports.gs_vertexbuffer_destroy(vertbuffer);
 }
 
+static size_t vb_vertex_size(const struct gs_vb_data *data)
+{
+	size_t size = sizeof(struct vec3);
+
+	if (data->normals)
+		size += sizeof(struct vec3);
+	if (data->tangents)
+		size += sizeof(struct vec3);
+	if (data->colors)
+		size += sizeof(uint32_t);
+	for (size_t i = 0; i < data->num_tex; i++)
+		size += data->tvarray[i].width * sizeof(float);
+
+	return size;
+}
+
 void gs_vertexbuffer_flush(gs_vertbuffer_t *vertbuffer)
 {
+	struct gs_vb_data *data;
+
 	if (!gs_valid_p("gs_vertexbuffer_flush", vertbuffer))
 		return;
 
+	data = thread_graphics->exports.gs_vertexbuffer_get_data(vertbuffer);
+	if (data)
+		thread_graphics->stats.upload_bytes +=
+			vb_vertex_size(data) * data->num;
+
 	thread_graphics->exports.gs_vertexbuffer_flush(vertbuffer);
 }
 
+void gs_vertexbuffer_flush_range(gs_vertbuffer_t *vertbuffer,
+		uint32_t start_vert, uint32_t num_verts, bool discard)
+{
+	struct gs_vb_data *data;
+
+	if (!gs_valid_p("gs_vertexbuffer_flush_range", vertbuffer))
+		return;
+
+	data = thread_graphics->exports.gs_vertexbuffer_get_data(vertbuffer);
+	if (!data || (size_t)start_vert + num_verts > data->num) {
+		blog(LOG_ERROR, "gs_vertexbuffer_flush_range: invalid range");
+		return;
+	}
+
+	thread_graphics->stats.upload_bytes += vb_vertex_size(data) * num_verts;
+	thread_graphics->exports.gs_vertexbuffer_flush_range(vertbuffer,
+			start_vert, num_verts, discard);
+}
+
 struct gs_vb_data *gs_vertexbuffer_get_data(const gs_vertbuffer_t *vertbuffer)
 {
 	if (!gs_valid_p("gs_vertexbuffer_get_data", vertbuffer))
@@ -2366,6 +2471,10 @@ void   gs_indexbuffer_flush(gs_indexbuffer_t *indexbuffer)
 	if (!gs_valid_p("gs_indexbuffer_flush", indexbuffer))
 		return;
 
+	thread_graphics->stats.upload_bytes +=
+		gs_indexbuffer_get_num_indices(indexbuffer) *
+		(gs_indexbuffer_get_type(indexbuffer) == GS_UNSIGNED_SHORT ?
+			sizeof(uint16_t) : sizeof(uint32_t));
 	thread_graphics->exports.gs_indexbuffer_flush(indexbuffer);
 }
 
@@ -444,6 +444,7 @@ struct gs_init_data {
 
 #define GS_DEVICE_OPENGL      1
 #define GS_DEVICE_DIRECT3D_11 2
+#define GS_DEVICE_NULL        3
 
 EXPORT const char *gs_get_device_name(void);
 EXPORT int gs_get_device_type(void);
@@ -503,6 +504,14 @@ EXPORT gs_shader_t *gs_pixelshader_create_from_file(const char *file,
 
 EXPORT gs_texture_t *gs_texture_create_from_file(const char *file);
 
+/**
+ * Decodes an image file to a 32-bit bitmap without creating a texture.  Does
+ * not require the graphics context, so it can be called from any thread.
+ * Returns the pixels (free with bfree), or NULL on failure.
+ */
+EXPORT uint8_t *gs_create_texture_file_data(const char *file,
+		enum gs_color_format *format, uint32_t *cx, uint32_t *cy);
+
 #define GS_FLIP_U (1<<0)
 #define GS_FLIP_V (1<<1)
 
@@ -623,6 +632,20 @@ EXPORT void gs_clear(uint32_t clear_flags, const struct vec4 *color,
 EXPORT void gs_present(void);
 EXPORT void gs_flush(void);
 
+/**
+ * Rendering counters of the current graphics context, since the last call to
+ * gs_reset_stats.
+ */
+struct gs_stats {
+	uint64_t draw_calls;
+	uint64_t upload_bytes;
+	uint64_t sprites;
+	uint64_t sprite_uploads;
+};
+
+EXPORT void gs_get_stats(struct gs_stats *stats);
+EXPORT void gs_reset_stats(void);
+
 EXPORT void gs_set_cull_mode(enum gs_cull_mode mode);
 EXPORT enum gs_cull_mode gs_get_cull_mode(void);
 
@@ -704,6 +727,16 @@ EXPORT void     gs_samplerstate_destroy(gs_samplerstate_t *samplerstate);
 
 EXPORT void     gs_vertexbuffer_destroy(gs_vertbuffer_t *vertbuffer);
 EXPORT void     gs_vertexbuffer_flush(gs_vertbuffer_t *vertbuffer);
+
+/**
+ * Uploads only a range of vertices of a dynamic vertex buffer.
+ *
+ *   The range must not overlap vertices used by draws that may still be
+ * pending on the GPU, unless discard is set.  With discard, the contents of
+ * the buffer outside of the range become undefined.
+ */
+EXPORT void     gs_vertexbuffer_flush_range(gs_vertbuffer_t *vertbuffer,
+		uint32_t start_vert, uint32_t num_verts, bool discard);
 EXPORT struct gs_vb_data *gs_vertexbuffer_get_data(
 		const gs_vertbuffer_t *vertbuffer);
 
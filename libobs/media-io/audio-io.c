@@ -25,6 +25,7 @@
 #include "../util/profiler.h"
 
 #include "audio-io.h"
+#include "audio-mix.h"
 #include "audio-resampler.h"
 
 extern profiler_name_store_t *obs_get_profiler_name_store(void);
@@ -46,24 +47,92 @@ static inline void audio_input_free(struct audio_input *input)
 	audio_resampler_destroy(input->resampler);
 }
 
+/* audio data received from a line's source, and the volume the audio thread
+ * applies to it once it's metered */
+struct audio_packet {
+	DARRAY(uint8_t)            data[MAX_AV_PLANES];
+	uint64_t                   timestamp;
+	uint32_t                   frames;
+	float                      volume;
+
+	struct audio_packet        *next;
+};
+
+/* how far ahead of the line's buffers audio data is accepted */
+#define MAX_DELAY_NS 6000000000ULL
+
+/* the packet queue of a line can hold all the audio the line accepts, unless
+ * the source sends packets smaller than this */
+#define AUDIO_LINE_MIN_PACKET_FRAMES 64
+
+/* the sequence number is odd while the audio thread writes the entry */
+struct audio_level_entry {
+	volatile long              seq;
+	struct audio_line_levels   levels;
+};
+
+/*
+ * The source thread never touches the line's buffers or timing state.  It
+ * queues packets in a single producer/single consumer list, and the audio
+ * thread places them into the buffers when it mixes the line, so neither side
+ * takes a lock for the line in the steady state.
+ *
+ * The list grows when the audio thread falls behind.  Packets stay in the
+ * list once placed, and the source thread reuses them from the front, so
+ * there's no allocation once the list is long enough.
+ */
 struct audio_line {
 	char                       *name;
 
 	struct audio_output        *audio;
 	struct circlebuf           buffers[MAX_AV_PLANES];
-	pthread_mutex_t            mutex;
-	DARRAY(uint8_t)            volume_buffers[MAX_AV_PLANES];
 	uint64_t                   base_timestamp;
 	uint64_t                   last_timestamp;
 
 	uint64_t                   next_ts_min;
 
+	/* the oldest packet, the last one queued and the last one placed.
+	 * every packet before the last placed one can be reused */
+	struct audio_packet        *first_packet;
+	struct audio_packet        *last_packet;
+	struct audio_packet        *read_packet;
+
+	/* packets queued and placed so far */
+	volatile long              write_count;
+	volatile long              read_count;
+
+	/* packets allocated and packets reused so far (source thread only) */
+	long                       num_packets;
+	long                       reused_packets;
+
+	/* packets dropped because the audio thread fell too far behind for the
+	 * queue to hold them, and
+	 * whether that's currently happening (source thread only) */
+	long                       dropped_packets;
+	bool                       packets_dropping;
+
+	/* levels of the last ticks, written by the audio thread as it places
+	 * the packets, and read without locks */
+	struct audio_level_entry   levels[AUDIO_LINE_LEVELS];
+	uint64_t                   levels_index;
+
+	/* levels measured but not yet published because the audio they were
+	 * measured on hasn't been mixed yet (audio thread only) */
+	struct audio_line_levels   pending_levels[AUDIO_LINE_LEVELS];
+	size_t                     pending_start;
+	size_t                     pending_num;
+
+	volatile long              true_peak_users;
+	bool                       true_peak_active;
+	float                      true_peak_history[MAX_AV_PLANES]
+	                                            [AUDIO_TRUE_PEAK_TAPS - 1];
+
 	/* specifies which mixes this line applies to via bits */
 	uint32_t                   mixers;
 
 	/* states whether this line is still being used.  if not, then when the
 	 * buffer is depleted, it's destroyed */
-	bool                       alive;
+	volatile bool              alive;
 
 	/* gets set when audio is getting cut off in the front of the buffer */
 	bool                       audio_getting_cut_off;
@@ -78,12 +147,22 @@ struct audio_line {
 
 static inline void audio_line_destroy_data(struct audio_line *line)
 {
-	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+	if (line->dropped_packets)
+		blog(LOG_INFO, "Audio line '%s': %ld packets dropped",
+				line->name, line->dropped_packets);
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++)
 		circlebuf_free(&line->buffers[i]);
-		da_free(line->volume_buffers[i]);
+
+	while (line->first_packet) {
+		struct audio_packet *packet = line->first_packet;
+		line->first_packet = packet->next;
+
+		for (size_t i = 0; i < MAX_AV_PLANES; i++)
+			da_free(packet->data[i]);
+		bfree(packet);
 	}
 
-	pthread_mutex_destroy(&line->mutex);
 	bfree(line->name);
 	bfree(line);
 }
@@ -102,27 +181,54 @@ struct audio_output {
 	pthread_t                  thread;
 	os_event_t                 *stop_event;
 
+	uint64_t                   tick_time;
+
+	/* limit of the packet queue of each line */
+	long                       line_max_packets;
+
+	/* how late the audio thread wakes up relative to its schedule */
+	uint64_t                   total_ticks;
+	uint64_t                   missed_ticks;
+	uint64_t                   total_tick_latency;
+	uint64_t                   max_tick_latency;
+
 	bool                       initialized;
 
+	/* only guards adding and removing lines, the audio thread walks the
+	 * list without it since it's the only one that removes lines */
 	pthread_mutex_t            line_mutex;
 	struct audio_line          *first_line;
 
+	/* lines to remove after the current tick (audio thread only) */
+	DARRAY(struct audio_line*) dead_lines;
+
 	pthread_mutex_t            input_mutex;
 
 	struct audio_mix           mixes[MAX_AUDIO_MIXES];
 };
 
-static inline void audio_output_removeline(struct audio_output *audio,
-		struct audio_line *line)
+static void audio_output_remove_dead_lines(struct audio_output *audio)
 {
+	if (!audio->dead_lines.num)
+		return;
+
 	pthread_mutex_lock(&audio->line_mutex);
-	if (line->prev_next)
-		*line->prev_next = line->next;
-	if (line->next)
-		line->next->prev_next = line->prev_next;
+
+	for (size_t i = 0; i < audio->dead_lines.num; i++) {
+		struct audio_line *line = audio->dead_lines.array[i];
+
+		if (line->prev_next)
+			*line->prev_next = line->next;
+		if (line->next)
+			line->next->prev_next = line->prev_next;
+	}
+
 	pthread_mutex_unlock(&audio->line_mutex);
 
-	audio_line_destroy_data(line);
+	for (size_t i = 0; i < audio->dead_lines.num; i++)
+		audio_line_destroy_data(audio->dead_lines.array[i]);
+
+	da_resize(audio->dead_lines, 0);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -163,6 +269,19 @@ static inline uint64_t conv_frames_to_time(const audio_t *audio,
 		(uint64_t)audio->info.samples_per_sec;
 }
 
+/* same as above, for frame counts that can exceed 32 bits */
+static inline uint64_t conv_total_frames_to_time(const audio_t *audio,
+		uint64_t frames)
+{
+	uint64_t rate = audio->info.samples_per_sec;
+	return frames / rate * 1000000000ULL +
+		frames % rate * 1000000000ULL / rate;
+}
+
+static void audio_line_place_packets(struct audio_line *line);
+static void audio_line_publish_mixed_levels(struct audio_line *line,
+		uint64_t mixed_time);
+
 /* ------------------------------------------------------------------------- */
 
 /* this only really happens with the very initial data insertion.  can be
@@ -211,38 +330,47 @@ static inline size_t min_size(size_t a, size_t b)
 	((val > maxval) ? maxval : ((val < minval) ? minval : val))
 #endif
 
-#define MIX_BUFFER_SIZE 256
-
-/* TODO: optimize mixing */
+/* adds the line's samples to every mix the line is assigned to, reading
+ * them straight out of the line's circular buffer */
 static void mix_float(struct audio_output *audio, struct audio_line *line,
 		size_t size, size_t time_offset, size_t plane)
 {
+	struct circlebuf *buf = &line->buffers[plane];
 	float *mixes[MAX_AUDIO_MIXES];
-	float vals[MIX_BUFFER_SIZE];
+	size_t num_mixes = 0;
+	size_t pos = buf->start_pos;
+	size_t remaining = size;
 
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
-		uint8_t *bytes = audio->mixes[mix_idx].mix_buffers[plane].array;
-		mixes[mix_idx] = (float*)&bytes[time_offset];
+		uint8_t *bytes;
+
+		/* only include this audio line in this mix if it's set
+		 * via the line's 'mixes' variable */
+		if ((line->mixers & (1 << mix_idx)) == 0)
+			continue;
+
+		bytes = audio->mixes[mix_idx].mix_buffers[plane].array;
+		mixes[num_mixes++] = (float*)&bytes[time_offset];
 	}
 
-	while (size) {
-		size_t pop_count = min_size(size, sizeof(vals));
-		size -= pop_count;
+	/* at most two segments: up to the end of the buffer, then from the
+	 * beginning of it if the data wraps around */
+	while (num_mixes && remaining) {
+		size_t segment = min_size(remaining, buf->capacity - pos);
+		size_t count = segment / sizeof(float);
 
-		circlebuf_pop_front(&line->buffers[plane], vals, pop_count);
-		pop_count /= sizeof(float);
+		audio_mix_float(mixes, num_mixes,
+				(const float*)((uint8_t*)buf->data + pos),
+				count);
 
-		for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
-			/* only include this audio line in this mix if it's set
-			 * via the line's 'mixes' variable */
-			if ((line->mixers & (1 << mix_idx)) == 0)
-				continue;
+		for (size_t i = 0; i < num_mixes; i++)
+			mixes[i] += count;
 
-			for (size_t i = 0; i < pop_count; i++) {
-				*(mixes[mix_idx]++) += vals[i];
-			}
-		}
+		remaining -= segment;
+		pos = 0;
 	}
+
+	circlebuf_pop_front(buf, NULL, size);
 }
 
 static inline bool mix_audio_line(struct audio_output *audio,
@@ -332,14 +460,7 @@ static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
 
 		for (size_t plane = 0; plane < audio->planes; plane++) {
 			float *mix_data = (float*)mix->mix_buffers[plane].array;
-			float *mix_end = &mix_data[float_size];
-
-			while (mix_data < mix_end) {
-				float val = *mix_data;
-				val = (val >  1.0f) ?  1.0f : val;
-				val = (val < -1.0f) ? -1.0f : val;
-				*(mix_data++) = val;
-			}
+			audio_clamp_float(mix_data, float_size);
 		}
 	}
 }
@@ -347,7 +468,7 @@ static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
 static uint64_t mix_and_output(struct audio_output *audio, uint64_t audio_time,
 		uint64_t prev_time)
 {
-	struct audio_line *line = audio->first_line;
+	struct audio_line *line;
 	uint32_t frames = (uint32_t)ts_diff_frames(audio, audio_time,
 	                                           prev_time);
 	size_t bytes = frames * audio->block_size;
@@ -371,20 +492,28 @@ static uint64_t mix_and_output(struct audio_output *audio, uint64_t audio_time,
 		}
 	}
 
+	/* lines created after this only get mixed from the next tick on */
+	pthread_mutex_lock(&audio->line_mutex);
+	line = audio->first_line;
+	pthread_mutex_unlock(&audio->line_mutex);
+
 	/* mix audio lines */
 	while (line) {
 		struct audio_line *next = line->next;
 
-		/* if line marked for removal, destroy and move to the next */
-		if (!line->buffers[0].size) {
-			if (!line->alive) {
-				audio_output_removeline(audio, line);
-				line = next;
-				continue;
-			}
-		}
+		/* read before taking the packets: once the line is destroyed
+		 * nothing else gets queued, so if this is false, every packet
+		 * the line will ever get is about to be placed */
+		bool alive = os_atomic_load_bool(&line->alive);
+
+		audio_line_place_packets(line);
 
-		pthread_mutex_lock(&line->mutex);
+		/* if line marked for removal, remove it after the tick */
+		if (!line->buffers[0].size && !alive) {
+			da_push_back(audio->dead_lines, &line);
+			line = next;
+			continue;
+		}
 
 		if (line->buffers[0].size && line->base_timestamp < prev_time) {
 			clear_excess_audio_data(line, prev_time);
@@ -400,7 +529,7 @@ static uint64_t mix_and_output(struct audio_output *audio, uint64_t audio_time,
 		if (mix_audio_line(audio, line, bytes, prev_time))
 			line->base_timestamp = audio_time;
 
-		pthread_mutex_unlock(&line->mutex);
+		audio_line_publish_mixed_levels(line, audio_time);
 
 		line = next;
 	}
@@ -412,36 +541,76 @@ static uint64_t mix_and_output(struct audio_output *audio, uint64_t audio_time,
 	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++)
 		do_audio_output(audio, i, prev_time, frames);
 
+	audio_output_remove_dead_lines(audio);
 	return audio_time;
 }
 
-/* sample audio 40 times a second */
-#define AUDIO_WAIT_TIME (1000/40)
+static inline void record_tick_latency(struct audio_output *audio,
+		uint64_t wake_time)
+{
+	uint64_t cur_time = os_gettime_ns();
+	uint64_t latency = cur_time > wake_time ? cur_time - wake_time : 0;
+
+	audio->total_ticks++;
+	audio->total_tick_latency += latency;
+
+	if (latency > audio->max_tick_latency)
+		audio->max_tick_latency = latency;
+	if (latency >= audio->tick_time)
+		audio->missed_ticks++;
+}
+
+static void log_tick_latency(const struct audio_output *audio)
+{
+	double avg_latency;
+
+	if (!audio->total_ticks)
+		return;
+
+	avg_latency = (double)audio->total_tick_latency /
+		(double)audio->total_ticks / 1000000.0;
 
+	blog(LOG_INFO, "audio_thread(%s): %"PRIu64" ticks of %"PRIu32
+	               " frames, wakeup latency avg %.3f ms, max %.3f ms, "
+	               "%"PRIu64" late by a full tick or more",
+	               audio->info.name, audio->total_ticks,
+	               audio->info.frames_per_tick, avg_latency,
+	               (double)audio->max_tick_latency / 1000000.0,
+	               audio->missed_ticks);
+}
+
+/* the thread wakes up on a fixed schedule of one tick per 'frames_per_tick'
+ * frames, computed from the total number of frames mixed so it never drifts,
+ * and mixes exactly one tick's worth of audio each time.  if it wakes up
+ * late, the following ticks are mixed back to back until it catches up. */
 static void *audio_thread(void *param)
 {
 	struct audio_output *audio = param;
 	uint64_t buffer_time = audio->info.buffer_ms * 1000000;
-	uint64_t prev_time = os_gettime_ns() - buffer_time;
-	uint64_t audio_time;
+	uint64_t start_time = os_gettime_ns();
+	uint64_t prev_time = start_time - buffer_time;
+	uint64_t total_frames = 0;
 
 	os_set_thread_name("audio-io: audio thread");
 
 	const char *audio_thread_name =
 		profile_store_name(obs_get_profiler_name_store(),
 				"audio_thread(%s)", audio->info.name);
-	
+	profile_register_root(audio_thread_name, audio->tick_time);
+
 	while (os_event_try(audio->stop_event) == EAGAIN) {
-		os_sleep_ms(AUDIO_WAIT_TIME);
+		uint64_t wake_time;
 
-		profile_start(audio_thread_name);
-		pthread_mutex_lock(&audio->line_mutex);
+		total_frames += audio->info.frames_per_tick;
+		wake_time = start_time +
+			conv_total_frames_to_time(audio, total_frames);
 
-		audio_time = os_gettime_ns() - buffer_time;
-		audio_time = mix_and_output(audio, audio_time, prev_time);
-		prev_time  = audio_time;
+		os_sleepto_ns(wake_time);
+		record_tick_latency(audio, wake_time);
 
-		pthread_mutex_unlock(&audio->line_mutex);
+		profile_start(audio_thread_name);
+		prev_time = mix_and_output(audio, wake_time - buffer_time,
+				prev_time);
 		profile_end(audio_thread_name);
 
 		profile_reenable_thread();
@@ -578,11 +747,17 @@ int audio_output_open(audio_t **audio, struct audio_output_info *info)
 		goto fail;
 
 	memcpy(&out->info, info, sizeof(struct audio_output_info));
+	if (!out->info.frames_per_tick)
+		out->info.frames_per_tick = AUDIO_OUTPUT_FRAMES_PER_TICK;
 	pthread_mutex_init_value(&out->line_mutex);
 	out->channels   = get_audio_channels(info->speakers);
 	out->planes     = planar ? out->channels : 1;
 	out->block_size = (planar ? 1 : out->channels) *
 	                  get_audio_bytes_per_channel(info->format);
+	out->tick_time  = conv_frames_to_time(out, out->info.frames_per_tick);
+	out->line_max_packets = (long)((out->info.buffer_ms * 1000000ULL +
+			MAX_DELAY_NS) / conv_frames_to_time(out,
+				AUDIO_LINE_MIN_PACKET_FRAMES));
 
 	if (pthread_mutexattr_init(&attr) != 0)
 		goto fail;
@@ -617,6 +792,7 @@ void audio_output_close(audio_t *audio)
 	if (audio->initialized) {
 		os_event_signal(audio->stop_event);
 		pthread_join(audio->thread, &thread_ret);
+		log_tick_latency(audio);
 	}
 
 	line = audio->first_line;
@@ -638,6 +814,7 @@ void audio_output_close(audio_t *audio)
 		da_free(mix->inputs);
 	}
 
+	da_free(audio->dead_lines);
 	os_event_destroy(audio->stop_event);
 	pthread_mutex_destroy(&audio->line_mutex);
 	bfree(audio);
@@ -652,13 +829,13 @@ audio_line_t *audio_output_create_line(audio_t *audio, const char *name,
 	line->alive = true;
 	line->audio = audio;
 	line->mixers = mixers;
+	line->name = bstrdup(name ? name : "(unnamed audio line)");
 
-	if (pthread_mutex_init(&line->mutex, NULL) != 0) {
-		blog(LOG_ERROR, "audio_output_createline: Failed to create "
-		                "mutex");
-		bfree(line);
-		return NULL;
-	}
+	/* the list starts out with a packet that counts as placed */
+	line->first_packet = bzalloc(sizeof(struct audio_packet));
+	line->last_packet  = line->first_packet;
+	line->read_packet  = line->first_packet;
+	line->num_packets  = 1;
 
 	pthread_mutex_lock(&audio->line_mutex);
 
@@ -672,7 +849,6 @@ audio_line_t *audio_output_create_line(audio_t *audio, const char *name,
 
 	pthread_mutex_unlock(&audio->line_mutex);
 
-	line->name = bstrdup(name ? name : "(unnamed audio line)");
 	return line;
 }
 
@@ -681,14 +857,11 @@ const struct audio_output_info *audio_output_get_info(const audio_t *audio)
 	return audio ? &audio->info : NULL;
 }
 
+/* the audio thread removes the line once it has played out its data */
 void audio_line_destroy(struct audio_line *line)
 {
-	if (line) {
-		if (!line->buffers[0].size)
-			audio_output_removeline(line->audio, line);
-		else
-			line->alive = false;
-	}
+	if (line)
+		os_atomic_set_bool(&line->alive, false);
 }
 
 bool audio_output_active(const audio_t *audio)
@@ -732,33 +905,17 @@ static inline void mul_vol_float(float *array, float volume, size_t count)
 		array[i] *= volume;
 }
 
+/* ------------------------------------------------------------------------- */
+/* audio thread side of the line */
+
 static void audio_line_place_data_pos(struct audio_line *line,
-		const struct audio_data *data, size_t position)
+		const struct audio_packet *packet, size_t position)
 {
-	bool   planar     = line->audio->planes > 1;
-	size_t total_num  = data->frames * (planar ? 1 : line->audio->channels);
-	size_t total_size = data->frames * line->audio->block_size;
-
-	for (size_t i = 0; i < line->audio->planes; i++) {
-		da_copy_array(line->volume_buffers[i], data->data[i],
-				total_size);
-
-		uint8_t *array = line->volume_buffers[i].array;
-
-		switch (line->audio->info.format) {
-		case AUDIO_FORMAT_FLOAT:
-		case AUDIO_FORMAT_FLOAT_PLANAR:
-			mul_vol_float((float*)array, data->volume, total_num);
-			break;
-		default:
-			blog(LOG_ERROR, "audio_line_place_data_pos: "
-			                "Unsupported or unknown format");
-			break;
-		}
+	size_t total_size = packet->frames * line->audio->block_size;
 
+	for (size_t i = 0; i < line->audio->planes; i++)
 		circlebuf_place(&line->buffers[i], position,
-				line->volume_buffers[i].array, total_size);
-	}
+				packet->data[i].array, total_size);
 }
 
 static inline uint64_t smooth_ts(struct audio_line *line, uint64_t timestamp)
@@ -781,10 +938,10 @@ static inline uint64_t smooth_ts(struct audio_line *line, uint64_t timestamp)
 }
 
 static bool audio_line_place_data(struct audio_line *line,
-		const struct audio_data *data)
+		const struct audio_packet *packet)
 {
 	int64_t pos;
-	uint64_t timestamp = smooth_ts(line, data->timestamp);
+	uint64_t timestamp = smooth_ts(line, packet->timestamp);
 
 	pos = ts_diff_bytes(line->audio, timestamp, line->base_timestamp);
 
@@ -793,22 +950,20 @@ static bool audio_line_place_data(struct audio_line *line,
 	}
 
 	line->next_ts_min =
-		timestamp + conv_frames_to_time(line->audio, data->frames);
+		timestamp + conv_frames_to_time(line->audio, packet->frames);
 
 #ifdef DEBUG_AUDIO
 	blog(LOG_DEBUG, "data->timestamp: %llu, line->base_timestamp: %llu, "
 			"pos: %lu, bytes: %lu, buf size: %lu",
 			timestamp, line->base_timestamp, pos,
-			data->frames * line->audio->block_size,
+			packet->frames * line->audio->block_size,
 			line->buffers[0].size);
 #endif
 
-	audio_line_place_data_pos(line, data, (size_t)pos);
+	audio_line_place_data_pos(line, packet, (size_t)pos);
 	return true;
 }
 
-#define MAX_DELAY_NS 6000000000ULL
-
 /* prevent insertation of data too far away from expected audio timing */
 static inline bool valid_timestamp_range(struct audio_line *line, uint64_t ts)
 {
@@ -818,21 +973,18 @@ static inline bool valid_timestamp_range(struct audio_line *line, uint64_t ts)
 	return ts >= line->base_timestamp && ts < max_ts;
 }
 
-void audio_line_output(audio_line_t *line, const struct audio_data *data)
+static void audio_line_insert_packet(struct audio_line *line,
+		const struct audio_packet *packet)
 {
 	bool inserted_audio = false;
 
-	if (!line || !data) return;
-
-	pthread_mutex_lock(&line->mutex);
-
 	if (!line->buffers[0].size) {
-		line->base_timestamp = data->timestamp -
+		line->base_timestamp = packet->timestamp -
 		                       line->audio->info.buffer_ms * 1000000;
-		inserted_audio = audio_line_place_data(line, data);
+		inserted_audio = audio_line_place_data(line, packet);
 
-	} else if (valid_timestamp_range(line, data->timestamp)) {
-		inserted_audio = audio_line_place_data(line, data);
+	} else if (valid_timestamp_range(line, packet->timestamp)) {
+		inserted_audio = audio_line_place_data(line, packet);
 	}
 
 	if (!inserted_audio) {
@@ -849,7 +1001,7 @@ void audio_line_output(audio_line_t *line, const struct audio_data *data)
 		                "data->timestamp: %"PRIu64", "
 		                "line->base_timestamp: %"PRIu64".  This can "
 		                "sometimes happen when there's a pause in "
-		                "the threads.", line->name, data->timestamp,
+		                "the threads.", line->name, packet->timestamp,
 		                line->base_timestamp);*/
 
 	} else if (line->audio_data_out_of_bounds) {
@@ -857,8 +1009,202 @@ void audio_line_output(audio_line_t *line, const struct audio_data *data)
 		                  "out of bounds audio data.", line->name);
 		line->audio_data_out_of_bounds = false;
 	}
+}
 
-	pthread_mutex_unlock(&line->mutex);
+/* true peaks are only measured per channel, which interleaved audio with
+ * more than one channel doesn't allow */
+static inline bool can_measure_true_peak(const struct audio_output *audio)
+{
+	return audio->planes > 1 || audio->channels == 1;
+}
+
+/* meters the packet as the source sent it, then applies the volume before
+ * it gets placed into the line's buffers */
+static void audio_line_meter_packet(struct audio_line *line,
+		struct audio_packet *packet, struct audio_line_levels *levels)
+{
+	struct audio_output *audio = line->audio;
+	size_t count = packet->frames *
+		(audio->planes > 1 ? 1 : audio->channels);
+	uint64_t end_ts = packet->timestamp +
+		conv_frames_to_time(audio, packet->frames);
+
+	for (size_t i = 0; i < audio->planes; i++) {
+		float *data = (float*)packet->data[i].array;
+
+		audio_meter_float(data, count, &levels->sum, &levels->peak);
+
+		if (line->true_peak_active)
+			audio_true_peak_float(line->true_peak_history[i],
+					data, count, &levels->true_peak);
+
+		if (packet->volume != 1.0f)
+			mul_vol_float(data, packet->volume, count);
+	}
+
+	levels->frames += packet->frames;
+	if (end_ts > levels->timestamp)
+		levels->timestamp = end_ts;
+}
+
+static void audio_line_publish_levels(struct audio_line *line,
+		struct audio_line_levels *levels)
+{
+	struct audio_level_entry *entry;
+
+	levels->index = ++line->levels_index;
+	entry = &line->levels[levels->index % AUDIO_LINE_LEVELS];
+
+	os_atomic_inc_long(&entry->seq);
+	entry->levels = *levels;
+	os_atomic_inc_long(&entry->seq);
+}
+
+static void audio_line_queue_levels(struct audio_line *line,
+		const struct audio_line_levels *levels)
+{
+	size_t idx;
+
+	/* if the line's audio is that far ahead, publish the oldest levels
+	 * early rather than losing them */
+	if (line->pending_num == AUDIO_LINE_LEVELS) {
+		audio_line_publish_levels(line,
+				&line->pending_levels[line->pending_start]);
+		line->pending_start = (line->pending_start + 1) %
+			AUDIO_LINE_LEVELS;
+		line->pending_num--;
+	}
+
+	idx = (line->pending_start + line->pending_num) % AUDIO_LINE_LEVELS;
+	line->pending_levels[idx] = *levels;
+	line->pending_num++;
+}
+
+/* publishes the levels of the audio mixed up to 'mixed_time', so that meters
+ * follow the buffering delay like the mixes do */
+static void audio_line_publish_mixed_levels(struct audio_line *line,
+		uint64_t mixed_time)
+{
+	while (line->pending_num) {
+		struct audio_line_levels *levels =
+			&line->pending_levels[line->pending_start];
+
+		if (levels->timestamp > mixed_time)
+			break;
+
+		audio_line_publish_levels(line, levels);
+		line->pending_start = (line->pending_start + 1) %
+			AUDIO_LINE_LEVELS;
+		line->pending_num--;
+	}
+}
+
+/* meters each packet while placing it, so the levels of every line are
+ * measured in the same pass over the lines as the mixing.  the levels are
+ * held back until the audio is mixed, after the buffering delay */
+static void audio_line_place_packets(struct audio_line *line)
+{
+	struct audio_line_levels levels = {0};
+	long read_count  = line->read_count;
+	long write_count = os_atomic_load_long(&line->write_count);
+	bool true_peak   = os_atomic_load_long(&line->true_peak_users) > 0 &&
+		can_measure_true_peak(line->audio);
+
+	if (true_peak && !line->true_peak_active)
+		memset(line->true_peak_history, 0,
+				sizeof(line->true_peak_history));
+	line->true_peak_active = true_peak;
+
+	while (read_count != write_count) {
+		struct audio_packet *packet = line->read_packet->next;
+
+		audio_line_meter_packet(line, packet, &levels);
+		audio_line_insert_packet(line, packet);
+
+		/* hands the previous packet back to the source thread */
+		line->read_packet = packet;
+		read_count = os_atomic_inc_long(&line->read_count);
+	}
+
+	if (levels.frames)
+		audio_line_queue_levels(line, &levels);
+}
+
+/* ------------------------------------------------------------------------- */
+/* source thread side of the line */
+
+/* reuses a packet the audio thread is done with, or allocates a new one if
+ * it's falling behind */
+static struct audio_packet *audio_line_get_packet(struct audio_line *line)
+{
+	long read_count = os_atomic_load_long(&line->read_count);
+	struct audio_packet *packet;
+
+	if (line->reused_packets != read_count) {
+		packet = line->first_packet;
+		line->first_packet = packet->next;
+		line->reused_packets++;
+
+	} else if (line->num_packets < line->audio->line_max_packets) {
+		packet = bzalloc(sizeof(struct audio_packet));
+		line->num_packets++;
+
+	} else {
+		return NULL;
+	}
+
+	packet->next = NULL;
+	return packet;
+}
+
+static bool audio_line_push_packet(struct audio_line *line,
+		const struct audio_data *data)
+{
+	struct audio_output *audio = line->audio;
+	size_t total_size = data->frames * audio->block_size;
+	struct audio_packet *packet = audio_line_get_packet(line);
+
+	if (!packet)
+		return false;
+
+	if (audio->info.format != AUDIO_FORMAT_FLOAT &&
+	    audio->info.format != AUDIO_FORMAT_FLOAT_PLANAR)
+		blog(LOG_ERROR, "audio_line_push_packet: "
+		                "Unsupported or unknown format");
+
+	for (size_t i = 0; i < audio->planes; i++)
+		da_copy_array(packet->data[i], data->data[i], total_size);
+
+	packet->timestamp = data->timestamp;
+	packet->frames    = data->frames;
+	packet->volume    = data->volume;
+
+	/* publishes the packet to the audio thread */
+	line->last_packet->next = packet;
+	line->last_packet = packet;
+	os_atomic_inc_long(&line->write_count);
+	return true;
+}
+
+void audio_line_output(audio_line_t *line, const struct audio_data *data)
+{
+	if (!line || !data) return;
+
+	if (!audio_line_push_packet(line, data)) {
+		line->dropped_packets++;
+
+		if (!line->packets_dropping) {
+			blog(LOG_WARNING, "Audio line '%s' is dropping audio "
+			                  "data, the audio thread is not "
+			                  "keeping up.", line->name);
+			line->packets_dropping = true;
+		}
+
+	} else if (line->packets_dropping) {
+		blog(LOG_WARNING, "Audio line '%s' no longer dropping "
+		                  "audio data.", line->name);
+		line->packets_dropping = false;
+	}
 }
 
 void audio_line_set_mixers(audio_line_t *line, uint32_t mixers)
@@ -871,3 +1217,64 @@ uint32_t audio_line_get_mixers(audio_line_t *line)
 {
 	return !!line ? line->mixers : 0;
 }
+
+static bool read_level_entry(struct audio_level_entry *entry,
+		struct audio_line_levels *levels)
+{
+	long seq = os_atomic_load_long(&entry->seq);
+
+	if (seq & 1)
+		return false;
+
+	*levels = entry->levels;
+	return os_atomic_load_long(&entry->seq) == seq;
+}
+
+size_t audio_line_get_levels(audio_line_t *line, uint64_t index,
+		struct audio_line_levels *levels, size_t max)
+{
+	size_t num = 0;
+
+	if (!line || !levels || !max)
+		return 0;
+
+	for (size_t i = 0; i < AUDIO_LINE_LEVELS; i++) {
+		struct audio_line_levels cur;
+		size_t pos;
+
+		/* entries being written are about to be newer than 'index'
+		 * anyway, they are picked up by the next call */
+		if (!read_level_entry(&line->levels[i], &cur) ||
+		    cur.index <= index)
+			continue;
+
+		/* keep the oldest 'max' entries, sorted */
+		if (num == max) {
+			if (cur.index > levels[num - 1].index)
+				continue;
+			num--;
+		}
+
+		for (pos = num; pos > 0; pos--) {
+			if (levels[pos - 1].index < cur.index)
+				break;
+			levels[pos] = levels[pos - 1];
+		}
+
+		levels[pos] = cur;
+		num++;
+	}
+
+	return num;
+}
+
+void audio_line_enable_true_peak(audio_line_t *line, bool enable)
+{
+	if (!line)
+		return;
+
+	if (enable)
+		os_atomic_inc_long(&line->true_peak_users);
+	else
+		os_atomic_dec_long(&line->true_peak_users);
+}
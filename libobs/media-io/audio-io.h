@@ -26,6 +26,9 @@ extern "C" {
 
 #define MAX_AUDIO_MIXES 4
 
+/* default number of frames mixed per tick of the audio thread */
+#define AUDIO_OUTPUT_FRAMES_PER_TICK 1024
+
 /*
  * Base audio output component.  Use this to create an audio output track
  * for the media.
@@ -78,6 +81,9 @@ struct audio_output_info {
 	enum audio_format   format;
 	enum speaker_layout speakers;
 	uint64_t            buffer_ms;
+
+	/* number of frames mixed per audio thread tick (0 = default) */
+	uint32_t            frames_per_tick;
 };
 
 struct audio_convert_info {
@@ -199,6 +205,43 @@ EXPORT uint32_t audio_line_get_mixers(audio_line_t *line);
 EXPORT void audio_line_destroy(audio_line_t *line);
 EXPORT void audio_line_output(audio_line_t *line, const struct audio_data *data);
 
+/**
+ * Levels of the audio a line received during one tick of the audio thread,
+ * measured before the volume of the audio data is applied.  The levels are
+ * published once the audio thread has mixed the audio they were measured on,
+ * so they lag the source by the buffering delay just like the mixes.
+ */
+struct audio_line_levels {
+	/* increases by one for each tick in which the line received audio */
+	uint64_t            index;
+	uint32_t            frames;
+	/* end of the audio that was measured */
+	uint64_t            timestamp;
+
+	/* sum of the squares of the samples of all channels */
+	float               sum;
+	/* largest absolute sample value of all channels */
+	float               peak;
+	/* largest absolute value with 4x oversampling, 0 if not enabled */
+	float               true_peak;
+};
+
+#define AUDIO_LINE_LEVELS 64
+
+/**
+ * Copies the levels of the ticks after 'index' that are still in the line's
+ * history of AUDIO_LINE_LEVELS ticks, oldest first, and returns how many
+ * were copied.  Never waits for the audio thread.
+ */
+EXPORT size_t audio_line_get_levels(audio_line_t *line, uint64_t index,
+		struct audio_line_levels *levels, size_t max);
+
+/**
+ * Enables or disables true peak measurement for a line.  Calls nest: true
+ * peaks are measured until every enable has been matched by a disable.
+ */
+EXPORT void audio_line_enable_true_peak(audio_line_t *line, bool enable);
+
 
 #ifdef __cplusplus
 }
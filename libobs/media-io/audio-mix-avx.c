@@ -0,0 +1,109 @@
+/******************************************************************************
+    Copyright (C) 2013 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "audio-mix.h"
+#include <immintrin.h>
+
+/* 8 samples per iteration.  this file is compiled with AVX enabled, so it
+ * must only be called once the CPU has been checked. */
+
+void audio_mix_float_avx(float *const mixes[], size_t num_mixes,
+		const float *src, size_t count)
+{
+	size_t wide_count = count & ~(size_t)7;
+	size_t i;
+
+	for (i = 0; i < wide_count; i += 8) {
+		__m256 val = _mm256_loadu_ps(src + i);
+
+		for (size_t mix_idx = 0; mix_idx < num_mixes; mix_idx++) {
+			float *mix = mixes[mix_idx] + i;
+			_mm256_storeu_ps(mix,
+					_mm256_add_ps(_mm256_loadu_ps(mix), val));
+		}
+	}
+
+	for (; i < count; i++) {
+		for (size_t mix_idx = 0; mix_idx < num_mixes; mix_idx++)
+			mixes[mix_idx][i] += src[i];
+	}
+
+	_mm256_zeroupper();
+}
+
+/* same operand order as the SSE version, lets NaN through like the C one */
+void audio_clamp_float_avx(float *data, size_t count)
+{
+	size_t wide_count = count & ~(size_t)7;
+	__m256 max_val = _mm256_set1_ps(1.0f);
+	__m256 min_val = _mm256_set1_ps(-1.0f);
+	size_t i;
+
+	for (i = 0; i < wide_count; i += 8) {
+		__m256 val = _mm256_loadu_ps(data + i);
+		val = _mm256_max_ps(min_val, _mm256_min_ps(max_val, val));
+		_mm256_storeu_ps(data + i, val);
+	}
+
+	for (; i < count; i++) {
+		float val = data[i];
+		val = (val >  1.0f) ?  1.0f : val;
+		val = (val < -1.0f) ? -1.0f : val;
+		data[i] = val;
+	}
+
+	_mm256_zeroupper();
+}
+
+void audio_meter_float_avx(const float *data, size_t count,
+		float *sum, float *peak)
+{
+	size_t wide_count = count & ~(size_t)7;
+	__m256 sign_mask = _mm256_set1_ps(-0.0f);
+	__m256 sums  = _mm256_setzero_ps();
+	__m256 peaks = _mm256_set1_ps(*peak);
+	float  vals[8];
+	float  s, p;
+	size_t i;
+
+	for (i = 0; i < wide_count; i += 8) {
+		__m256 val = _mm256_loadu_ps(data + i);
+		sums  = _mm256_add_ps(sums, _mm256_mul_ps(val, val));
+		peaks = _mm256_max_ps(peaks, _mm256_andnot_ps(sign_mask, val));
+	}
+
+	_mm256_storeu_ps(vals, sums);
+	s = *sum + ((vals[0] + vals[1]) + (vals[2] + vals[3])) +
+		((vals[4] + vals[5]) + (vals[6] + vals[7]));
+
+	_mm256_storeu_ps(vals, peaks);
+	p = vals[0];
+	for (size_t j = 1; j < 8; j++)
+		p = (vals[j] > p) ? vals[j] : p;
+
+	for (; i < count; i++) {
+		float val = data[i];
+		s  += val * val;
+		val = (val < 0.0f) ? -val : val;
+		p   = (val > p) ? val : p;
+	}
+
+	*sum  = s;
+	*peak = p;
+
+	_mm256_zeroupper();
+}
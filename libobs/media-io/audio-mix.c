@@ -0,0 +1,358 @@
+/******************************************************************************
+    Copyright (C) 2013 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "audio-mix.h"
+#include "cpu-features.h"
+#include "../util/threading.h"
+#include "../util/base.h"
+#include <string.h>
+#include <math.h>
+#include <xmmintrin.h>
+
+/* compiled with AVX enabled, see audio-mix-avx.c */
+extern void audio_mix_float_avx(float *const mixes[], size_t num_mixes,
+		const float *src, size_t count);
+extern void audio_clamp_float_avx(float *data, size_t count);
+extern void audio_meter_float_avx(const float *data, size_t count,
+		float *sum, float *peak);
+
+#define TRUE_PEAK_HISTORY (AUDIO_TRUE_PEAK_TAPS - 1)
+#define TRUE_PEAK_CHUNK   256
+
+/* the 48 tap interpolation filter of ITU-R BS.1770-4 annex 2, as the four
+ * phases of each tap, so that all four interpolated values of an input
+ * sample can be computed together */
+static const float true_peak_taps[AUDIO_TRUE_PEAK_TAPS][4] = {
+	{ 0.0017089843750f, -0.0291748046875f, -0.0189208984375f, -0.0083007812500f},
+	{ 0.0109863281250f,  0.0292968750000f,  0.0330810546875f,  0.0148925781250f},
+	{-0.0196533203125f, -0.0517578125000f, -0.0582275390625f, -0.0266113281250f},
+	{ 0.0332031250000f,  0.0891113281250f,  0.1015625000000f,  0.0476074218750f},
+	{-0.0594482421875f, -0.1665039062500f, -0.2003173828125f, -0.1022949218750f},
+	{ 0.1373291015625f,  0.4650878906250f,  0.7797851562500f,  0.9721679687500f},
+	{ 0.9721679687500f,  0.7797851562500f,  0.4650878906250f,  0.1373291015625f},
+	{-0.1022949218750f, -0.2003173828125f, -0.1665039062500f, -0.0594482421875f},
+	{ 0.0476074218750f,  0.1015625000000f,  0.0891113281250f,  0.0332031250000f},
+	{-0.0266113281250f, -0.0582275390625f, -0.0517578125000f, -0.0196533203125f},
+	{ 0.0148925781250f,  0.0330810546875f,  0.0292968750000f,  0.0109863281250f},
+	{-0.0083007812500f, -0.0189208984375f, -0.0291748046875f,  0.0017089843750f}
+};
+
+static void audio_mix_float_c(float *const mixes[], size_t num_mixes,
+		const float *src, size_t count)
+{
+	for (size_t mix_idx = 0; mix_idx < num_mixes; mix_idx++) {
+		float *mix = mixes[mix_idx];
+
+		for (size_t i = 0; i < count; i++)
+			mix[i] += src[i];
+	}
+}
+
+static void audio_clamp_float_c(float *data, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		float val = data[i];
+		val = (val >  1.0f) ?  1.0f : val;
+		val = (val < -1.0f) ? -1.0f : val;
+		data[i] = val;
+	}
+}
+
+static void audio_meter_float_c(const float *data, size_t count,
+		float *sum, float *peak)
+{
+	float s = *sum;
+	float p = *peak;
+
+	for (size_t i = 0; i < count; i++) {
+		float val = data[i];
+		s  += val * val;
+		val = fabsf(val);
+		p   = (val > p) ? val : p;
+	}
+
+	*sum  = s;
+	*peak = p;
+}
+
+/* 'buf' holds TRUE_PEAK_HISTORY samples before the 'count' samples to
+ * filter, returns the largest absolute interpolated value */
+static float true_peak_filter_c(const float *buf, size_t count)
+{
+	float peak = 0.0f;
+
+	for (size_t n = 0; n < count; n++) {
+		const float *x = buf + TRUE_PEAK_HISTORY + n;
+
+		for (size_t phase = 0; phase < 4; phase++) {
+			float val = 0.0f;
+
+			for (size_t k = 0; k < AUDIO_TRUE_PEAK_TAPS; k++)
+				val += true_peak_taps[k][phase] * *(x - k);
+
+			val  = fabsf(val);
+			peak = (val > peak) ? val : peak;
+		}
+	}
+
+	return peak;
+}
+
+static void audio_mix_float_sse(float *const mixes[], size_t num_mixes,
+		const float *src, size_t count)
+{
+	size_t wide_count = count & ~(size_t)3;
+	size_t i;
+
+	for (i = 0; i < wide_count; i += 4) {
+		__m128 val = _mm_loadu_ps(src + i);
+
+		for (size_t mix_idx = 0; mix_idx < num_mixes; mix_idx++) {
+			float *mix = mixes[mix_idx] + i;
+			_mm_storeu_ps(mix, _mm_add_ps(_mm_loadu_ps(mix), val));
+		}
+	}
+
+	for (; i < count; i++) {
+		for (size_t mix_idx = 0; mix_idx < num_mixes; mix_idx++)
+			mixes[mix_idx][i] += src[i];
+	}
+}
+
+/* min/max return their second operand if either one is NaN, so the order
+ * of the operands lets NaN through just like the C version */
+static void audio_clamp_float_sse(float *data, size_t count)
+{
+	size_t wide_count = count & ~(size_t)3;
+	__m128 max_val = _mm_set1_ps(1.0f);
+	__m128 min_val = _mm_set1_ps(-1.0f);
+	size_t i;
+
+	for (i = 0; i < wide_count; i += 4) {
+		__m128 val = _mm_loadu_ps(data + i);
+		val = _mm_max_ps(min_val, _mm_min_ps(max_val, val));
+		_mm_storeu_ps(data + i, val);
+	}
+
+	audio_clamp_float_c(data + i, count - i);
+}
+
+static void audio_meter_float_sse(const float *data, size_t count,
+		float *sum, float *peak)
+{
+	size_t wide_count = count & ~(size_t)3;
+	__m128 sign_mask = _mm_set1_ps(-0.0f);
+	__m128 sums  = _mm_setzero_ps();
+	__m128 peaks = _mm_set1_ps(*peak);
+	float  vals[4];
+	size_t i;
+
+	for (i = 0; i < wide_count; i += 4) {
+		__m128 val = _mm_loadu_ps(data + i);
+		sums  = _mm_add_ps(sums, _mm_mul_ps(val, val));
+		peaks = _mm_max_ps(peaks, _mm_andnot_ps(sign_mask, val));
+	}
+
+	_mm_storeu_ps(vals, sums);
+	*sum += (vals[0] + vals[1]) + (vals[2] + vals[3]);
+
+	_mm_storeu_ps(vals, peaks);
+	*peak = fmaxf(fmaxf(vals[0], vals[1]), fmaxf(vals[2], vals[3]));
+
+	audio_meter_float_c(data + i, count - i, sum, peak);
+}
+
+/* the same sums as the C version, in the same order, for all four phases at
+ * once.  four input samples are filtered together, so that their sums don't
+ * wait on each other */
+static float true_peak_filter_sse(const float *buf, size_t count)
+{
+	size_t wide_count = count & ~(size_t)3;
+	__m128 sign_mask = _mm_set1_ps(-0.0f);
+	__m128 peaks = _mm_setzero_ps();
+	float  vals[4];
+	size_t n;
+
+	for (n = 0; n < wide_count; n += 4) {
+		const float *x = buf + TRUE_PEAK_HISTORY + n;
+		__m128 val0 = _mm_setzero_ps();
+		__m128 val1 = _mm_setzero_ps();
+		__m128 val2 = _mm_setzero_ps();
+		__m128 val3 = _mm_setzero_ps();
+
+		for (size_t k = 0; k < AUDIO_TRUE_PEAK_TAPS; k++) {
+			__m128 taps = _mm_loadu_ps(true_peak_taps[k]);
+			const float *xk = x - k;
+
+			val0 = _mm_add_ps(val0, _mm_mul_ps(taps,
+						_mm_set1_ps(xk[0])));
+			val1 = _mm_add_ps(val1, _mm_mul_ps(taps,
+						_mm_set1_ps(xk[1])));
+			val2 = _mm_add_ps(val2, _mm_mul_ps(taps,
+						_mm_set1_ps(xk[2])));
+			val3 = _mm_add_ps(val3, _mm_mul_ps(taps,
+						_mm_set1_ps(xk[3])));
+		}
+
+		peaks = _mm_max_ps(peaks, _mm_andnot_ps(sign_mask, val0));
+		peaks = _mm_max_ps(peaks, _mm_andnot_ps(sign_mask, val1));
+		peaks = _mm_max_ps(peaks, _mm_andnot_ps(sign_mask, val2));
+		peaks = _mm_max_ps(peaks, _mm_andnot_ps(sign_mask, val3));
+	}
+
+	for (; n < count; n++) {
+		const float *x = buf + TRUE_PEAK_HISTORY + n;
+		__m128 val = _mm_setzero_ps();
+
+		for (size_t k = 0; k < AUDIO_TRUE_PEAK_TAPS; k++)
+			val = _mm_add_ps(val, _mm_mul_ps(
+					_mm_loadu_ps(true_peak_taps[k]),
+					_mm_set1_ps(*(x - k))));
+
+		peaks = _mm_max_ps(peaks, _mm_andnot_ps(sign_mask, val));
+	}
+
+	_mm_storeu_ps(vals, peaks);
+	return fmaxf(fmaxf(vals[0], vals[1]), fmaxf(vals[2], vals[3]));
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct audio_mix_kernels {
+	const char *name;
+	void (*mix)(float *const mixes[], size_t num_mixes,
+			const float *src, size_t count);
+	void (*clamp)(float *data, size_t count);
+	void (*meter)(const float *data, size_t count,
+			float *sum, float *peak);
+	float (*true_peak_filter)(const float *buf, size_t count);
+};
+
+static const struct audio_mix_kernels kernel_sets[] = {
+	[AUDIO_MIX_C] = {
+		"C",
+		audio_mix_float_c,
+		audio_clamp_float_c,
+		audio_meter_float_c,
+		true_peak_filter_c
+	},
+	[AUDIO_MIX_SSE] = {
+		"SSE",
+		audio_mix_float_sse,
+		audio_clamp_float_sse,
+		audio_meter_float_sse,
+		true_peak_filter_sse
+	},
+	[AUDIO_MIX_AVX] = {
+		"AVX",
+		audio_mix_float_avx,
+		audio_clamp_float_avx,
+		audio_meter_float_avx,
+		true_peak_filter_sse
+	}
+};
+
+#define NUM_KERNEL_SETS (sizeof(kernel_sets) / sizeof(kernel_sets[0]))
+
+static pthread_once_t                 kernel_init_token = PTHREAD_ONCE_INIT;
+static enum audio_mix_isa             best_isa          = AUDIO_MIX_SSE;
+static const struct audio_mix_kernels *cur_kernels      =
+	&kernel_sets[AUDIO_MIX_SSE];
+
+static void init_kernels(void)
+{
+	if (cpu_has_avx())
+		best_isa = AUDIO_MIX_AVX;
+
+	cur_kernels = &kernel_sets[best_isa];
+
+	blog(LOG_INFO, "Using %s kernels for audio mixing", cur_kernels->name);
+}
+
+static inline const struct audio_mix_kernels *get_kernels(void)
+{
+	pthread_once(&kernel_init_token, init_kernels);
+	return cur_kernels;
+}
+
+enum audio_mix_isa audio_mix_get_isa(void)
+{
+	return (enum audio_mix_isa)(get_kernels() - kernel_sets);
+}
+
+bool audio_mix_set_isa(enum audio_mix_isa isa)
+{
+	pthread_once(&kernel_init_token, init_kernels);
+
+	if ((unsigned)isa >= NUM_KERNEL_SETS || isa > best_isa)
+		return false;
+
+	cur_kernels = &kernel_sets[isa];
+	return true;
+}
+
+const char *audio_mix_isa_name(enum audio_mix_isa isa)
+{
+	if ((unsigned)isa >= NUM_KERNEL_SETS)
+		return NULL;
+	return kernel_sets[isa].name;
+}
+
+void audio_mix_float(float *const mixes[], size_t num_mixes,
+		const float *src, size_t count)
+{
+	get_kernels()->mix(mixes, num_mixes, src, count);
+}
+
+void audio_clamp_float(float *data, size_t count)
+{
+	get_kernels()->clamp(data, count);
+}
+
+void audio_meter_float(const float *data, size_t count,
+		float *sum, float *peak)
+{
+	get_kernels()->meter(data, count, sum, peak);
+}
+
+void audio_true_peak_float(float *history, const float *data,
+		size_t count, float *peak)
+{
+	float (*filter)(const float *buf, size_t count) =
+		get_kernels()->true_peak_filter;
+	float buf[TRUE_PEAK_HISTORY + TRUE_PEAK_CHUNK];
+
+	memcpy(buf, history, TRUE_PEAK_HISTORY * sizeof(float));
+
+	while (count) {
+		size_t chunk = (count < TRUE_PEAK_CHUNK) ?
+			count : TRUE_PEAK_CHUNK;
+		float  chunk_peak;
+
+		memcpy(buf + TRUE_PEAK_HISTORY, data, chunk * sizeof(float));
+
+		chunk_peak = filter(buf, chunk);
+		if (chunk_peak > *peak)
+			*peak = chunk_peak;
+
+		memmove(buf, buf + chunk, TRUE_PEAK_HISTORY * sizeof(float));
+		data  += chunk;
+		count -= chunk;
+	}
+
+	memcpy(history, buf, TRUE_PEAK_HISTORY * sizeof(float));
+}
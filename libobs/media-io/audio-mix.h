@@ -0,0 +1,80 @@
+/******************************************************************************
+    Copyright (C) 2013 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "../util/c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Functions for mixing float audio planes
+ */
+
+enum audio_mix_isa {
+	AUDIO_MIX_C,
+	AUDIO_MIX_SSE,
+	AUDIO_MIX_AVX
+};
+
+/**
+ * The mixing functions use the widest kernels the CPU supports, detected the
+ * first time any of them is used.  All kernels produce output identical to
+ * the plain C kernels.
+ *
+ * audio_mix_set_isa forces a specific kernel set (for testing and
+ * benchmarking), and fails if the CPU does not support it.
+ */
+EXPORT enum audio_mix_isa audio_mix_get_isa(void);
+EXPORT bool audio_mix_set_isa(enum audio_mix_isa isa);
+EXPORT const char *audio_mix_isa_name(enum audio_mix_isa isa);
+
+/**
+ * Adds 'count' samples of 'src' to each of the 'num_mixes' buffers in
+ * 'mixes', reading the source only once.
+ */
+EXPORT void audio_mix_float(float *const mixes[], size_t num_mixes,
+		const float *src, size_t count);
+
+/** Clamps 'count' samples to the -1.0 to 1.0 range */
+EXPORT void audio_clamp_float(float *data, size_t count);
+
+/**
+ * Adds the squares of 'count' samples to 'sum', and raises 'peak' to the
+ * largest absolute sample value.  The wider kernels add the squares in a
+ * different order, so the sum may differ from the C kernel's by rounding.
+ */
+EXPORT void audio_meter_float(const float *data, size_t count,
+		float *sum, float *peak);
+
+#define AUDIO_TRUE_PEAK_TAPS 12
+
+/**
+ * Raises 'peak' to the largest absolute value of the samples oversampled
+ * four times with the interpolation filter of ITU-R BS.1770 (the true peak).
+ * 'history' holds the last AUDIO_TRUE_PEAK_TAPS - 1 samples of the channel
+ * before 'data', oldest first, and is updated to end with 'data'.  Start a
+ * channel with a history of zeros.
+ */
+EXPORT void audio_true_peak_float(float *history, const float *data,
+		size_t count, float *peak);
+
+#ifdef __cplusplus
+}
+#endif
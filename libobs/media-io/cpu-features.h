@@ -0,0 +1,82 @@
+/******************************************************************************
+    Copyright (C) 2016 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+/* cpuid and xgetbv access for picking the kernels of the media-io code */
+
+#include "../util/c99defs.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+#ifdef _MSC_VER
+static inline void get_cpuid(unsigned leaf, unsigned subleaf,
+		unsigned regs[4])
+{
+	__cpuidex((int*)regs, (int)leaf, (int)subleaf);
+}
+
+static inline uint64_t get_xcr0(void)
+{
+	return _xgetbv(0);
+}
+#else
+static inline void get_cpuid(unsigned leaf, unsigned subleaf,
+		unsigned regs[4])
+{
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+}
+
+static inline uint64_t get_xcr0(void)
+{
+	uint32_t eax, edx;
+	__asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((uint64_t)edx << 32) | eax;
+}
+#endif
+
+#define CPUID1_ECX_SSSE3       (1 << 9)
+#define CPUID1_ECX_OSXSAVE     (1 << 27)
+#define CPUID1_ECX_AVX         (1 << 28)
+#define CPUID7_EBX_AVX2        (1 << 5)
+#define CPUID7_EBX_AVX512F     (1 << 16)
+#define CPUID7_EBX_AVX512BW    (1u << 30)
+
+#define XCR0_AVX_STATE         0x06
+#define XCR0_AVX512_STATE      0xE6
+
+/* AVX needs both the CPU and the OS to support it, the OS has to save the
+ * upper halves of the YMM registers */
+static inline bool cpu_has_avx(void)
+{
+	unsigned regs[4];
+
+	get_cpuid(0, 0, regs);
+	if (regs[0] < 1)
+		return false;
+
+	get_cpuid(1, 0, regs);
+	if ((regs[2] & CPUID1_ECX_OSXSAVE) == 0 ||
+	    (regs[2] & CPUID1_ECX_AVX) == 0)
+		return false;
+
+	return (get_xcr0() & XCR0_AVX_STATE) == XCR0_AVX_STATE;
+}
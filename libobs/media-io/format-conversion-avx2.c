@@ -0,0 +1,215 @@
+/******************************************************************************
+    Copyright (C) 2013 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "format-conversion-internal.h"
+#include <immintrin.h>
+
+/* 16 pixels per iteration: two 32 byte loads per line.  pshufb only works
+ * within 128 bit lanes, so each lane gathers its 4 bytes of the first load
+ * into dword 0 and of the second load into dword 1, and a single dword
+ * permute puts all 16 results in order in the low 128 bits. */
+
+#define PIXELS_PER_LOOP 16
+
+#define gather_mask_a(k) _mm256_broadcastsi128_si256(_mm_setr_epi8( \
+		k, 4+k, 8+k, 12+k, \
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1))
+#define gather_mask_b(k) _mm256_broadcastsi128_si256(_mm_setr_epi8( \
+		-1, -1, -1, -1, \
+		k, 4+k, 8+k, 12+k, -1, -1, -1, -1, -1, -1, -1, -1))
+
+static FORCE_INLINE __m128i gather(__m256i a, __m256i b,
+		__m256i mask_a, __m256i mask_b, __m256i order)
+{
+	__m256i val = _mm256_or_si256(
+			_mm256_shuffle_epi8(a, mask_a),
+			_mm256_shuffle_epi8(b, mask_b));
+	return _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(val, order));
+}
+
+static FORCE_INLINE __m256i chroma_avg(__m256i line1, __m256i line2,
+		__m256i uv_mask)
+{
+	__m256i sum = _mm256_add_epi16(
+			_mm256_and_si256(line1, uv_mask),
+			_mm256_and_si256(line2, uv_mask));
+	sum = _mm256_add_epi16(sum, _mm256_srli_epi64(sum, 32));
+	return _mm256_srli_epi16(sum, 2);
+}
+
+#define load_px(ptr) _mm256_loadu_si256((const __m256i*)(ptr))
+
+#define gather_order() _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7)
+
+/* chroma of 16 pixels as interleaved U/V, 8 pairs */
+static FORCE_INLINE __m128i chroma_nv12(
+		__m256i a1, __m256i b1, __m256i a2, __m256i b2,
+		__m256i uv_mask, __m256i uv_a, __m256i uv_b, __m256i order)
+{
+	return gather(chroma_avg(a1, a2, uv_mask),
+			chroma_avg(b1, b2, uv_mask),
+			uv_a, uv_b, order);
+}
+
+void compress_uyvx_to_i420_avx2(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width      = uyvx_ref_width(in_linesize, out_linesize[0]);
+	uint32_t wide_width = width & ~(PIXELS_PER_LOOP - 1);
+	uint32_t y;
+
+	__m256i order   = gather_order();
+	__m256i lum_a   = gather_mask_a(1);
+	__m256i lum_b   = gather_mask_b(1);
+	__m256i uv_mask = _mm256_set1_epi32(0x00FF00FF);
+	__m256i uv_a    = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+			0, 2, 8, 10, -1, -1, -1, -1,
+			-1, -1, -1, -1, -1, -1, -1, -1));
+	__m256i uv_b    = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+			-1, -1, -1, -1, 0, 2, 8, 10,
+			-1, -1, -1, -1, -1, -1, -1, -1));
+	__m128i split   = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14,
+			1, 3, 5, 7, 9, 11, 13, 15);
+
+	for (y = start_y; y < end_y; y += 2) {
+		const uint8_t *line1 = input + y * in_linesize;
+		const uint8_t *line2 = line1 + in_linesize;
+		uint8_t *lum0 = output[0] + y * out_linesize[0];
+		uint8_t *lum1 = lum0 + out_linesize[0];
+		uint8_t *u    = output[1] + (y>>1) * out_linesize[1];
+		uint8_t *v    = output[2] + (y>>1) * out_linesize[1];
+		uint32_t x;
+
+		for (x = 0; x < wide_width; x += PIXELS_PER_LOOP) {
+			__m256i a1 = load_px(line1 + x*4);
+			__m256i b1 = load_px(line1 + x*4 + 32);
+			__m256i a2 = load_px(line2 + x*4);
+			__m256i b2 = load_px(line2 + x*4 + 32);
+			__m128i uv;
+
+			_mm_storeu_si128((__m128i*)(lum0 + x),
+					gather(a1, b1, lum_a, lum_b, order));
+			_mm_storeu_si128((__m128i*)(lum1 + x),
+					gather(a2, b2, lum_a, lum_b, order));
+
+			uv = chroma_nv12(a1, b1, a2, b2,
+					uv_mask, uv_a, uv_b, order);
+			uv = _mm_shuffle_epi8(uv, split);
+
+			_mm_storel_epi64((__m128i*)(u + (x>>1)), uv);
+			_mm_storel_epi64((__m128i*)(v + (x>>1)),
+					_mm_srli_si128(uv, 8));
+		}
+
+		uyvx_to_420_tail(line1, line2, lum0, lum1,
+				u + (x>>1), v + (x>>1), 1, x, width);
+	}
+}
+
+void compress_uyvx_to_nv12_avx2(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width      = uyvx_ref_width(in_linesize, out_linesize[0]);
+	uint32_t wide_width = width & ~(PIXELS_PER_LOOP - 1);
+	uint32_t y;
+
+	__m256i order   = gather_order();
+	__m256i lum_a   = gather_mask_a(1);
+	__m256i lum_b   = gather_mask_b(1);
+	__m256i uv_mask = _mm256_set1_epi32(0x00FF00FF);
+	__m256i uv_a    = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+			0, 2, 8, 10, -1, -1, -1, -1,
+			-1, -1, -1, -1, -1, -1, -1, -1));
+	__m256i uv_b    = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+			-1, -1, -1, -1, 0, 2, 8, 10,
+			-1, -1, -1, -1, -1, -1, -1, -1));
+
+	for (y = start_y; y < end_y; y += 2) {
+		const uint8_t *line1 = input + y * in_linesize;
+		const uint8_t *line2 = line1 + in_linesize;
+		uint8_t *lum0   = output[0] + y * out_linesize[0];
+		uint8_t *lum1   = lum0 + out_linesize[0];
+		uint8_t *chroma = output[1] + (y>>1) * out_linesize[1];
+		uint32_t x;
+
+		for (x = 0; x < wide_width; x += PIXELS_PER_LOOP) {
+			__m256i a1 = load_px(line1 + x*4);
+			__m256i b1 = load_px(line1 + x*4 + 32);
+			__m256i a2 = load_px(line2 + x*4);
+			__m256i b2 = load_px(line2 + x*4 + 32);
+
+			_mm_storeu_si128((__m128i*)(lum0 + x),
+					gather(a1, b1, lum_a, lum_b, order));
+			_mm_storeu_si128((__m128i*)(lum1 + x),
+					gather(a2, b2, lum_a, lum_b, order));
+			_mm_storeu_si128((__m128i*)(chroma + x),
+					chroma_nv12(a1, b1, a2, b2, uv_mask,
+						uv_a, uv_b, order));
+		}
+
+		uyvx_to_420_tail(line1, line2, lum0, lum1,
+				chroma + x, chroma + x + 1, 2, x, width);
+	}
+}
+
+void convert_uyvx_to_i444_avx2(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width      = uyvx_ref_width(in_linesize, out_linesize[0]);
+	uint32_t wide_width = width & ~(PIXELS_PER_LOOP - 1);
+	uint32_t y, i;
+
+	__m256i order = gather_order();
+	__m256i lum_a = gather_mask_a(1);
+	__m256i lum_b = gather_mask_b(1);
+	__m256i u_a   = gather_mask_a(0);
+	__m256i u_b   = gather_mask_b(0);
+	__m256i v_a   = gather_mask_a(2);
+	__m256i v_b   = gather_mask_b(2);
+
+	for (y = start_y; y < end_y; y += 2) {
+		for (i = 0; i < 2; i++) {
+			uint32_t line_pos = (y + i) * out_linesize[0];
+			const uint8_t *line = input + (y + i) * in_linesize;
+			uint8_t *lum = output[0] + line_pos;
+			uint8_t *u   = output[1] + line_pos;
+			uint8_t *v   = output[2] + line_pos;
+			uint32_t x;
+
+			for (x = 0; x < wide_width; x += PIXELS_PER_LOOP) {
+				__m256i a = load_px(line + x*4);
+				__m256i b = load_px(line + x*4 + 32);
+
+				_mm_storeu_si128((__m128i*)(lum + x),
+						gather(a, b, lum_a, lum_b,
+							order));
+				_mm_storeu_si128((__m128i*)(u + x),
+						gather(a, b, u_a, u_b, order));
+				_mm_storeu_si128((__m128i*)(v + x),
+						gather(a, b, v_a, v_b, order));
+			}
+
+			uyvx_to_444_tail(line, lum, u, v, x, width);
+		}
+	}
+}
@@ -0,0 +1,220 @@
+/******************************************************************************
+    Copyright (C) 2013 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "format-conversion-internal.h"
+#include <immintrin.h>
+
+/* 32 pixels per iteration: two 64 byte loads per line.  same lane-wise
+ * gather as the AVX2 version, the final dword permute just spans four lanes
+ * instead of two. */
+
+#define PIXELS_PER_LOOP 32
+
+#define gather_mask_a(k) _mm512_broadcast_i32x4(_mm_setr_epi8( \
+		k, 4+k, 8+k, 12+k, \
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1))
+#define gather_mask_b(k) _mm512_broadcast_i32x4(_mm_setr_epi8( \
+		-1, -1, -1, -1, \
+		k, 4+k, 8+k, 12+k, -1, -1, -1, -1, -1, -1, -1, -1))
+
+static FORCE_INLINE __m256i gather(__m512i a, __m512i b,
+		__m512i mask_a, __m512i mask_b, __m512i order)
+{
+	__m512i val = _mm512_or_si512(
+			_mm512_shuffle_epi8(a, mask_a),
+			_mm512_shuffle_epi8(b, mask_b));
+	return _mm512_castsi512_si256(_mm512_permutexvar_epi32(order, val));
+}
+
+static FORCE_INLINE __m512i chroma_avg(__m512i line1, __m512i line2,
+		__m512i uv_mask)
+{
+	__m512i sum = _mm512_add_epi16(
+			_mm512_and_si512(line1, uv_mask),
+			_mm512_and_si512(line2, uv_mask));
+	sum = _mm512_add_epi16(sum, _mm512_srli_epi64(sum, 32));
+	return _mm512_srli_epi16(sum, 2);
+}
+
+#define load_px(ptr) _mm512_loadu_si512((const void*)(ptr))
+
+#define gather_order() _mm512_setr_epi32( \
+		0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15)
+
+/* chroma of 32 pixels as interleaved U/V, 16 pairs */
+static FORCE_INLINE __m256i chroma_nv12(
+		__m512i a1, __m512i b1, __m512i a2, __m512i b2,
+		__m512i uv_mask, __m512i uv_a, __m512i uv_b, __m512i order)
+{
+	return gather(chroma_avg(a1, a2, uv_mask),
+			chroma_avg(b1, b2, uv_mask),
+			uv_a, uv_b, order);
+}
+
+void compress_uyvx_to_i420_avx512bw(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width      = uyvx_ref_width(in_linesize, out_linesize[0]);
+	uint32_t wide_width = width & ~(PIXELS_PER_LOOP - 1);
+	uint32_t y;
+
+	__m512i order   = gather_order();
+	__m512i lum_a   = gather_mask_a(1);
+	__m512i lum_b   = gather_mask_b(1);
+	__m512i uv_mask = _mm512_set1_epi32(0x00FF00FF);
+	__m512i uv_a    = _mm512_broadcast_i32x4(_mm_setr_epi8(
+			0, 2, 8, 10, -1, -1, -1, -1,
+			-1, -1, -1, -1, -1, -1, -1, -1));
+	__m512i uv_b    = _mm512_broadcast_i32x4(_mm_setr_epi8(
+			-1, -1, -1, -1, 0, 2, 8, 10,
+			-1, -1, -1, -1, -1, -1, -1, -1));
+	__m256i split   = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+			0, 2, 4, 6, 8, 10, 12, 14,
+			1, 3, 5, 7, 9, 11, 13, 15));
+
+	for (y = start_y; y < end_y; y += 2) {
+		const uint8_t *line1 = input + y * in_linesize;
+		const uint8_t *line2 = line1 + in_linesize;
+		uint8_t *lum0 = output[0] + y * out_linesize[0];
+		uint8_t *lum1 = lum0 + out_linesize[0];
+		uint8_t *u    = output[1] + (y>>1) * out_linesize[1];
+		uint8_t *v    = output[2] + (y>>1) * out_linesize[1];
+		uint32_t x;
+
+		for (x = 0; x < wide_width; x += PIXELS_PER_LOOP) {
+			__m512i a1 = load_px(line1 + x*4);
+			__m512i b1 = load_px(line1 + x*4 + 64);
+			__m512i a2 = load_px(line2 + x*4);
+			__m512i b2 = load_px(line2 + x*4 + 64);
+			__m256i uv;
+
+			_mm256_storeu_si256((__m256i*)(lum0 + x),
+					gather(a1, b1, lum_a, lum_b, order));
+			_mm256_storeu_si256((__m256i*)(lum1 + x),
+					gather(a2, b2, lum_a, lum_b, order));
+
+			/* per lane: 8 U then 8 V, then U/V halves together */
+			uv = chroma_nv12(a1, b1, a2, b2,
+					uv_mask, uv_a, uv_b, order);
+			uv = _mm256_shuffle_epi8(uv, split);
+			uv = _mm256_permute4x64_epi64(uv,
+					_MM_SHUFFLE(3, 1, 2, 0));
+
+			_mm_storeu_si128((__m128i*)(u + (x>>1)),
+					_mm256_castsi256_si128(uv));
+			_mm_storeu_si128((__m128i*)(v + (x>>1)),
+					_mm256_extracti128_si256(uv, 1));
+		}
+
+		uyvx_to_420_tail(line1, line2, lum0, lum1,
+				u + (x>>1), v + (x>>1), 1, x, width);
+	}
+}
+
+void compress_uyvx_to_nv12_avx512bw(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width      = uyvx_ref_width(in_linesize, out_linesize[0]);
+	uint32_t wide_width = width & ~(PIXELS_PER_LOOP - 1);
+	uint32_t y;
+
+	__m512i order   = gather_order();
+	__m512i lum_a   = gather_mask_a(1);
+	__m512i lum_b   = gather_mask_b(1);
+	__m512i uv_mask = _mm512_set1_epi32(0x00FF00FF);
+	__m512i uv_a    = _mm512_broadcast_i32x4(_mm_setr_epi8(
+			0, 2, 8, 10, -1, -1, -1, -1,
+			-1, -1, -1, -1, -1, -1, -1, -1));
+	__m512i uv_b    = _mm512_broadcast_i32x4(_mm_setr_epi8(
+			-1, -1, -1, -1, 0, 2, 8, 10,
+			-1, -1, -1, -1, -1, -1, -1, -1));
+
+	for (y = start_y; y < end_y; y += 2) {
+		const uint8_t *line1 = input + y * in_linesize;
+		const uint8_t *line2 = line1 + in_linesize;
+		uint8_t *lum0   = output[0] + y * out_linesize[0];
+		uint8_t *lum1   = lum0 + out_linesize[0];
+		uint8_t *chroma = output[1] + (y>>1) * out_linesize[1];
+		uint32_t x;
+
+		for (x = 0; x < wide_width; x += PIXELS_PER_LOOP) {
+			__m512i a1 = load_px(line1 + x*4);
+			__m512i b1 = load_px(line1 + x*4 + 64);
+			__m512i a2 = load_px(line2 + x*4);
+			__m512i b2 = load_px(line2 + x*4 + 64);
+
+			_mm256_storeu_si256((__m256i*)(lum0 + x),
+					gather(a1, b1, lum_a, lum_b, order));
+			_mm256_storeu_si256((__m256i*)(lum1 + x),
+					gather(a2, b2, lum_a, lum_b, order));
+			_mm256_storeu_si256((__m256i*)(chroma + x),
+					chroma_nv12(a1, b1, a2, b2, uv_mask,
+						uv_a, uv_b, order));
+		}
+
+		uyvx_to_420_tail(line1, line2, lum0, lum1,
+				chroma + x, chroma + x + 1, 2, x, width);
+	}
+}
+
+void convert_uyvx_to_i444_avx512bw(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width      = uyvx_ref_width(in_linesize, out_linesize[0]);
+	uint32_t wide_width = width & ~(PIXELS_PER_LOOP - 1);
+	uint32_t y, i;
+
+	__m512i order = gather_order();
+	__m512i lum_a = gather_mask_a(1);
+	__m512i lum_b = gather_mask_b(1);
+	__m512i u_a   = gather_mask_a(0);
+	__m512i u_b   = gather_mask_b(0);
+	__m512i v_a   = gather_mask_a(2);
+	__m512i v_b   = gather_mask_b(2);
+
+	for (y = start_y; y < end_y; y += 2) {
+		for (i = 0; i < 2; i++) {
+			uint32_t line_pos = (y + i) * out_linesize[0];
+			const uint8_t *line = input + (y + i) * in_linesize;
+			uint8_t *lum = output[0] + line_pos;
+			uint8_t *u   = output[1] + line_pos;
+			uint8_t *v   = output[2] + line_pos;
+			uint32_t x;
+
+			for (x = 0; x < wide_width; x += PIXELS_PER_LOOP) {
+				__m512i a = load_px(line + x*4);
+				__m512i b = load_px(line + x*4 + 64);
+
+				_mm256_storeu_si256((__m256i*)(lum + x),
+						gather(a, b, lum_a, lum_b,
+							order));
+				_mm256_storeu_si256((__m256i*)(u + x),
+						gather(a, b, u_a, u_b, order));
+				_mm256_storeu_si256((__m256i*)(v + x),
+						gather(a, b, v_a, v_b, order));
+			}
+
+			uyvx_to_444_tail(line, lum, u, v, x, width);
+		}
+	}
+}
@@ -0,0 +1,94 @@
+/******************************************************************************
+    Copyright (C) 2013 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "format-conversion.h"
+
+/*
+ * Private declarations shared by the instruction set specific conversion
+ * kernels.  Each kernel file is compiled with its own instruction set flags,
+ * so nothing in here may be called before the CPU has been checked.
+ */
+
+typedef void (*uyvx_convert_func_t)(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[]);
+
+#define DECLARE_UYVX_KERNELS(isa) \
+	extern void compress_uyvx_to_i420_##isa( \
+			const uint8_t *input, uint32_t in_linesize, \
+			uint32_t start_y, uint32_t end_y, \
+			uint8_t *output[], const uint32_t out_linesize[]); \
+	extern void compress_uyvx_to_nv12_##isa( \
+			const uint8_t *input, uint32_t in_linesize, \
+			uint32_t start_y, uint32_t end_y, \
+			uint8_t *output[], const uint32_t out_linesize[]); \
+	extern void convert_uyvx_to_i444_##isa( \
+			const uint8_t *input, uint32_t in_linesize, \
+			uint32_t start_y, uint32_t end_y, \
+			uint8_t *output[], const uint32_t out_linesize[])
+
+DECLARE_UYVX_KERNELS(ssse3);
+DECLARE_UYVX_KERNELS(avx2);
+DECLARE_UYVX_KERNELS(avx512bw);
+
+/* ------------------------------------------------------------------------- */
+/* scalar helpers for the columns left over after the wide loops.  these
+ * produce exactly what the SSE2 reference produces, including writing up to
+ * the next multiple of 4 pixels like the reference does. */
+
+static inline uint32_t uyvx_ref_width(uint32_t in_linesize,
+		uint32_t out_linesize)
+{
+	uint32_t width = in_linesize < out_linesize ? in_linesize : out_linesize;
+	return (width + 3) & ~3;
+}
+
+static inline void uyvx_to_420_tail(const uint8_t *line1,
+		const uint8_t *line2, uint8_t *lum0, uint8_t *lum1,
+		uint8_t *u, uint8_t *v, uint32_t uv_step,
+		uint32_t x, uint32_t width)
+{
+	for (; x < width; x += 2) {
+		const uint8_t *p0 = line1 + x * 4;
+		const uint8_t *p1 = line2 + x * 4;
+
+		lum0[x]     = p0[1];
+		lum0[x + 1] = p0[5];
+		lum1[x]     = p1[1];
+		lum1[x + 1] = p1[5];
+
+		*u = (uint8_t)((p0[0] + p0[4] + p1[0] + p1[4]) >> 2);
+		*v = (uint8_t)((p0[2] + p0[6] + p1[2] + p1[6]) >> 2);
+		u += uv_step;
+		v += uv_step;
+	}
+}
+
+static inline void uyvx_to_444_tail(const uint8_t *line, uint8_t *lum,
+		uint8_t *u, uint8_t *v, uint32_t x, uint32_t width)
+{
+	for (; x < width; x++) {
+		const uint8_t *p = line + x * 4;
+
+		lum[x] = p[1];
+		u[x]   = p[0];
+		v[x]   = p[2];
+	}
+}
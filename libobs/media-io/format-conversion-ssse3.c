@@ -0,0 +1,196 @@
+/******************************************************************************
+    Copyright (C) 2013 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "format-conversion-internal.h"
+#include <tmmintrin.h>
+
+/* 8 pixels per iteration: two 16 byte loads per line, gathered with pshufb
+ * instead of the mask/shift/pack sequence used by the SSE2 version */
+
+#define PIXELS_PER_LOOP 8
+
+/* masks that move byte 'k' of each pixel of the first load into bytes 0-3,
+ * and of the second load into bytes 4-7 */
+#define gather_mask_a(k) _mm_setr_epi8(k, 4+k, 8+k, 12+k, \
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)
+#define gather_mask_b(k) _mm_setr_epi8(-1, -1, -1, -1, \
+		k, 4+k, 8+k, 12+k, -1, -1, -1, -1, -1, -1, -1, -1)
+
+static FORCE_INLINE __m128i gather(__m128i a, __m128i b,
+		__m128i mask_a, __m128i mask_b)
+{
+	return _mm_or_si128(_mm_shuffle_epi8(a, mask_a),
+			_mm_shuffle_epi8(b, mask_b));
+}
+
+/* averages the U/V values of each 2x2 block, the result of each block is in
+ * the low two words of each quadword */
+static FORCE_INLINE __m128i chroma_avg(__m128i line1, __m128i line2,
+		__m128i uv_mask)
+{
+	__m128i sum = _mm_add_epi16(
+			_mm_and_si128(line1, uv_mask),
+			_mm_and_si128(line2, uv_mask));
+	sum = _mm_add_epi16(sum, _mm_srli_epi64(sum, 32));
+	return _mm_srli_epi16(sum, 2);
+}
+
+#define load_px(ptr) _mm_loadu_si128((const __m128i*)(ptr))
+
+void compress_uyvx_to_i420_ssse3(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width      = uyvx_ref_width(in_linesize, out_linesize[0]);
+	uint32_t wide_width = width & ~(PIXELS_PER_LOOP - 1);
+	uint32_t y;
+
+	__m128i lum_a   = gather_mask_a(1);
+	__m128i lum_b   = gather_mask_b(1);
+	__m128i uv_mask = _mm_set1_epi32(0x00FF00FF);
+
+	/* U of both loads into bytes 0-3, V into bytes 4-7 */
+	__m128i uv_a = _mm_setr_epi8(0, 8, -1, -1, 2, 10, -1, -1,
+			-1, -1, -1, -1, -1, -1, -1, -1);
+	__m128i uv_b = _mm_setr_epi8(-1, -1, 0, 8, -1, -1, 2, 10,
+			-1, -1, -1, -1, -1, -1, -1, -1);
+
+	for (y = start_y; y < end_y; y += 2) {
+		const uint8_t *line1 = input + y * in_linesize;
+		const uint8_t *line2 = line1 + in_linesize;
+		uint8_t *lum0 = output[0] + y * out_linesize[0];
+		uint8_t *lum1 = lum0 + out_linesize[0];
+		uint8_t *u    = output[1] + (y>>1) * out_linesize[1];
+		uint8_t *v    = output[2] + (y>>1) * out_linesize[1];
+		uint32_t x;
+
+		for (x = 0; x < wide_width; x += PIXELS_PER_LOOP) {
+			__m128i a1 = load_px(line1 + x*4);
+			__m128i b1 = load_px(line1 + x*4 + 16);
+			__m128i a2 = load_px(line2 + x*4);
+			__m128i b2 = load_px(line2 + x*4 + 16);
+			__m128i uv;
+
+			_mm_storel_epi64((__m128i*)(lum0 + x),
+					gather(a1, b1, lum_a, lum_b));
+			_mm_storel_epi64((__m128i*)(lum1 + x),
+					gather(a2, b2, lum_a, lum_b));
+
+			uv = gather(chroma_avg(a1, a2, uv_mask),
+					chroma_avg(b1, b2, uv_mask),
+					uv_a, uv_b);
+
+			*(uint32_t*)(u + (x>>1)) = (uint32_t)_mm_cvtsi128_si32(uv);
+			*(uint32_t*)(v + (x>>1)) = (uint32_t)_mm_cvtsi128_si32(
+					_mm_srli_si128(uv, 4));
+		}
+
+		uyvx_to_420_tail(line1, line2, lum0, lum1,
+				u + (x>>1), v + (x>>1), 1, x, width);
+	}
+}
+
+void compress_uyvx_to_nv12_ssse3(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width      = uyvx_ref_width(in_linesize, out_linesize[0]);
+	uint32_t wide_width = width & ~(PIXELS_PER_LOOP - 1);
+	uint32_t y;
+
+	__m128i lum_a   = gather_mask_a(1);
+	__m128i lum_b   = gather_mask_b(1);
+	__m128i uv_mask = _mm_set1_epi32(0x00FF00FF);
+
+	/* interleaved U/V of the first load into bytes 0-3, second into 4-7 */
+	__m128i uv_a = _mm_setr_epi8(0, 2, 8, 10, -1, -1, -1, -1,
+			-1, -1, -1, -1, -1, -1, -1, -1);
+	__m128i uv_b = _mm_setr_epi8(-1, -1, -1, -1, 0, 2, 8, 10,
+			-1, -1, -1, -1, -1, -1, -1, -1);
+
+	for (y = start_y; y < end_y; y += 2) {
+		const uint8_t *line1 = input + y * in_linesize;
+		const uint8_t *line2 = line1 + in_linesize;
+		uint8_t *lum0   = output[0] + y * out_linesize[0];
+		uint8_t *lum1   = lum0 + out_linesize[0];
+		uint8_t *chroma = output[1] + (y>>1) * out_linesize[1];
+		uint32_t x;
+
+		for (x = 0; x < wide_width; x += PIXELS_PER_LOOP) {
+			__m128i a1 = load_px(line1 + x*4);
+			__m128i b1 = load_px(line1 + x*4 + 16);
+			__m128i a2 = load_px(line2 + x*4);
+			__m128i b2 = load_px(line2 + x*4 + 16);
+
+			_mm_storel_epi64((__m128i*)(lum0 + x),
+					gather(a1, b1, lum_a, lum_b));
+			_mm_storel_epi64((__m128i*)(lum1 + x),
+					gather(a2, b2, lum_a, lum_b));
+			_mm_storel_epi64((__m128i*)(chroma + x),
+					gather(chroma_avg(a1, a2, uv_mask),
+						chroma_avg(b1, b2, uv_mask),
+						uv_a, uv_b));
+		}
+
+		uyvx_to_420_tail(line1, line2, lum0, lum1,
+				chroma + x, chroma + x + 1, 2, x, width);
+	}
+}
+
+void convert_uyvx_to_i444_ssse3(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width      = uyvx_ref_width(in_linesize, out_linesize[0]);
+	uint32_t wide_width = width & ~(PIXELS_PER_LOOP - 1);
+	uint32_t y, i;
+
+	__m128i lum_a = gather_mask_a(1);
+	__m128i lum_b = gather_mask_b(1);
+	__m128i u_a   = gather_mask_a(0);
+	__m128i u_b   = gather_mask_b(0);
+	__m128i v_a   = gather_mask_a(2);
+	__m128i v_b   = gather_mask_b(2);
+
+	for (y = start_y; y < end_y; y += 2) {
+		for (i = 0; i < 2; i++) {
+			uint32_t line_pos = (y + i) * out_linesize[0];
+			const uint8_t *line = input + (y + i) * in_linesize;
+			uint8_t *lum = output[0] + line_pos;
+			uint8_t *u   = output[1] + line_pos;
+			uint8_t *v   = output[2] + line_pos;
+			uint32_t x;
+
+			for (x = 0; x < wide_width; x += PIXELS_PER_LOOP) {
+				__m128i a = load_px(line + x*4);
+				__m128i b = load_px(line + x*4 + 16);
+
+				_mm_storel_epi64((__m128i*)(lum + x),
+						gather(a, b, lum_a, lum_b));
+				_mm_storel_epi64((__m128i*)(u + x),
+						gather(a, b, u_a, u_b));
+				_mm_storel_epi64((__m128i*)(v + x),
+						gather(a, b, v_a, v_b));
+			}
+
+			uyvx_to_444_tail(line, lum, u, v, x, width);
+		}
+	}
+}
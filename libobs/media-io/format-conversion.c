@@ -15,7 +15,10 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
-#include "format-conversion.h"
+#include "format-conversion-internal.h"
+#include "../util/threading.h"
+#include "../util/base.h"
+#include "cpu-features.h"
 #include <xmmintrin.h>
 #include <emmintrin.h>
 
@@ -89,7 +92,7 @@ static FORCE_INLINE uint32_t min_uint32(uint32_t a, uint32_t b)
 	return a < b ? a : b;
 }
 
-void compress_uyvx_to_i420(
+static void compress_uyvx_to_i420_sse2(
 		const uint8_t *input, uint32_t in_linesize,
 		uint32_t start_y, uint32_t end_y,
 		uint8_t *output[], const uint32_t out_linesize[])
@@ -127,7 +130,7 @@ void compress_uyvx_to_i420(
 	}
 }
 
-void compress_uyvx_to_nv12(
+static void compress_uyvx_to_nv12_sse2(
 		const uint8_t *input, uint32_t in_linesize,
 		uint32_t start_y, uint32_t end_y,
 		uint8_t *output[], const uint32_t out_linesize[])
@@ -163,7 +166,7 @@ void compress_uyvx_to_nv12(
 	}
 }
 
-void convert_uyvx_to_i444(
+static void convert_uyvx_to_i444_sse2(
 		const uint8_t *input, uint32_t in_linesize,
 		uint32_t start_y, uint32_t end_y,
 		uint8_t *output[], const uint32_t out_linesize[])
@@ -202,6 +205,158 @@ void convert_uyvx_to_i444(
 	}
 }
 
+/* ------------------------------------------------------------------------- */
+/* runtime kernel selection */
+
+struct uyvx_kernels {
+	const char          *name;
+	uyvx_convert_func_t to_i420;
+	uyvx_convert_func_t to_nv12;
+	uyvx_convert_func_t to_i444;
+};
+
+static const struct uyvx_kernels kernel_sets[] = {
+	[FORMAT_CONVERSION_SSE2] = {
+		"SSE2",
+		compress_uyvx_to_i420_sse2,
+		compress_uyvx_to_nv12_sse2,
+		convert_uyvx_to_i444_sse2
+	},
+	[FORMAT_CONVERSION_SSSE3] = {
+		"SSSE3",
+		compress_uyvx_to_i420_ssse3,
+		compress_uyvx_to_nv12_ssse3,
+		convert_uyvx_to_i444_ssse3
+	},
+	[FORMAT_CONVERSION_AVX2] = {
+		"AVX2",
+		compress_uyvx_to_i420_avx2,
+		compress_uyvx_to_nv12_avx2,
+		convert_uyvx_to_i444_avx2
+	},
+	[FORMAT_CONVERSION_AVX512BW] = {
+		"AVX-512BW",
+		compress_uyvx_to_i420_avx512bw,
+		compress_uyvx_to_nv12_avx512bw,
+		convert_uyvx_to_i444_avx512bw
+	}
+};
+
+#define NUM_KERNEL_SETS (sizeof(kernel_sets) / sizeof(kernel_sets[0]))
+
+static pthread_once_t                 kernel_init_token = PTHREAD_ONCE_INIT;
+static enum format_conversion_isa     best_isa          = FORMAT_CONVERSION_SSE2;
+static const struct uyvx_kernels      *cur_kernels      =
+	&kernel_sets[FORMAT_CONVERSION_SSE2];
+
+static enum format_conversion_isa detect_isa(void)
+{
+	unsigned regs[4];
+	unsigned max_leaf;
+	unsigned ecx1, ebx7 = 0;
+	uint64_t xcr0 = 0;
+
+	get_cpuid(0, 0, regs);
+	max_leaf = regs[0];
+	if (max_leaf < 1)
+		return FORMAT_CONVERSION_SSE2;
+
+	get_cpuid(1, 0, regs);
+	ecx1 = regs[2];
+
+	if (max_leaf >= 7) {
+		get_cpuid(7, 0, regs);
+		ebx7 = regs[1];
+	}
+
+	/* the OS must also save the upper register state for AVX/AVX-512 */
+	if ((ecx1 & CPUID1_ECX_OSXSAVE) && (ecx1 & CPUID1_ECX_AVX))
+		xcr0 = get_xcr0();
+
+	if ((xcr0 & XCR0_AVX512_STATE) == XCR0_AVX512_STATE &&
+	    (ebx7 & CPUID7_EBX_AVX512F) &&
+	    (ebx7 & CPUID7_EBX_AVX512BW))
+		return FORMAT_CONVERSION_AVX512BW;
+
+	if ((xcr0 & XCR0_AVX_STATE) == XCR0_AVX_STATE &&
+	    (ebx7 & CPUID7_EBX_AVX2))
+		return FORMAT_CONVERSION_AVX2;
+
+	if (ecx1 & CPUID1_ECX_SSSE3)
+		return FORMAT_CONVERSION_SSSE3;
+
+	return FORMAT_CONVERSION_SSE2;
+}
+
+static void init_kernels(void)
+{
+	best_isa    = detect_isa();
+	cur_kernels = &kernel_sets[best_isa];
+
+	blog(LOG_INFO, "Using %s kernels for CPU format conversion",
+			cur_kernels->name);
+}
+
+static inline const struct uyvx_kernels *get_kernels(void)
+{
+	pthread_once(&kernel_init_token, init_kernels);
+	return cur_kernels;
+}
+
+enum format_conversion_isa format_conversion_get_isa(void)
+{
+	return (enum format_conversion_isa)(get_kernels() - kernel_sets);
+}
+
+bool format_conversion_isa_supported(enum format_conversion_isa isa)
+{
+	pthread_once(&kernel_init_token, init_kernels);
+	return (unsigned)isa < NUM_KERNEL_SETS && isa <= best_isa;
+}
+
+bool format_conversion_set_isa(enum format_conversion_isa isa)
+{
+	if (!format_conversion_isa_supported(isa))
+		return false;
+
+	cur_kernels = &kernel_sets[isa];
+	return true;
+}
+
+const char *format_conversion_isa_name(enum format_conversion_isa isa)
+{
+	if ((unsigned)isa >= NUM_KERNEL_SETS)
+		return NULL;
+	return kernel_sets[isa].name;
+}
+
+void compress_uyvx_to_i420(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	get_kernels()->to_i420(input, in_linesize, start_y, end_y,
+			output, out_linesize);
+}
+
+void compress_uyvx_to_nv12(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	get_kernels()->to_nv12(input, in_linesize, start_y, end_y,
+			output, out_linesize);
+}
+
+void convert_uyvx_to_i444(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	get_kernels()->to_i444(input, in_linesize, start_y, end_y,
+			output, out_linesize);
+}
+
 void decompress_420(
 		const uint8_t *const input[], const uint32_t in_linesize[],
 		uint32_t start_y, uint32_t end_y,
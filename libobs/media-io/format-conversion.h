@@ -27,6 +27,26 @@ extern "C" {
  * Functions for converting to and from packed 444 YUV
  */
 
+enum format_conversion_isa {
+	FORMAT_CONVERSION_SSE2,
+	FORMAT_CONVERSION_SSSE3,
+	FORMAT_CONVERSION_AVX2,
+	FORMAT_CONVERSION_AVX512BW
+};
+
+/**
+ * The packed 444 compression functions use the widest kernels the CPU
+ * supports, detected the first time any of them is used.  The SSE2 kernels
+ * are the reference; all others produce identical output.
+ *
+ * format_conversion_set_isa forces a specific kernel set (for testing and
+ * benchmarking), and fails if the CPU does not support it.
+ */
+EXPORT enum format_conversion_isa format_conversion_get_isa(void);
+EXPORT bool format_conversion_isa_supported(enum format_conversion_isa isa);
+EXPORT bool format_conversion_set_isa(enum format_conversion_isa isa);
+EXPORT const char *format_conversion_isa_name(enum format_conversion_isa isa);
+
 EXPORT void compress_uyvx_to_i420(
 		const uint8_t *input, uint32_t in_linesize,
 		uint32_t start_y, uint32_t end_y,
@@ -131,3 +131,66 @@ void video_frame_copy(struct video_frame *dst, const struct video_frame *src,
 		break;
 	}
 }
+
+static inline void copy_plane_lines(uint8_t *dst, uint32_t dst_linesize,
+		const uint8_t *src, uint32_t src_linesize, uint32_t lines)
+{
+	uint32_t width = dst_linesize < src_linesize ?
+		dst_linesize : src_linesize;
+
+	if (dst_linesize == src_linesize) {
+		memcpy(dst, src, src_linesize * lines);
+		return;
+	}
+
+	for (uint32_t y = 0; y < lines; y++) {
+		memcpy(dst, src, width);
+		dst += dst_linesize;
+		src += src_linesize;
+	}
+}
+
+void video_frame_copy_lines(struct video_frame *dst,
+		const struct video_frame *src, enum video_format format,
+		uint32_t cy)
+{
+	switch (format) {
+	case VIDEO_FORMAT_NONE:
+		return;
+
+	case VIDEO_FORMAT_I420:
+		copy_plane_lines(dst->data[0], dst->linesize[0],
+				src->data[0], src->linesize[0], cy);
+		copy_plane_lines(dst->data[1], dst->linesize[1],
+				src->data[1], src->linesize[1], cy / 2);
+		copy_plane_lines(dst->data[2], dst->linesize[2],
+				src->data[2], src->linesize[2], cy / 2);
+		break;
+
+	case VIDEO_FORMAT_NV12:
+		copy_plane_lines(dst->data[0], dst->linesize[0],
+				src->data[0], src->linesize[0], cy);
+		copy_plane_lines(dst->data[1], dst->linesize[1],
+				src->data[1], src->linesize[1], cy / 2);
+		break;
+
+	case VIDEO_FORMAT_YVYU:
+	case VIDEO_FORMAT_YUY2:
+	case VIDEO_FORMAT_UYVY:
+	case VIDEO_FORMAT_RGBA:
+	case VIDEO_FORMAT_BGRA:
+	case VIDEO_FORMAT_BGRX:
+		copy_plane_lines(dst->data[0], dst->linesize[0],
+				src->data[0], src->linesize[0], cy);
+		break;
+
+	case VIDEO_FORMAT_I444:
+		copy_plane_lines(dst->data[0], dst->linesize[0],
+				src->data[0], src->linesize[0], cy);
+		copy_plane_lines(dst->data[1], dst->linesize[1],
+				src->data[1], src->linesize[1], cy);
+		copy_plane_lines(dst->data[2], dst->linesize[2],
+				src->data[2], src->linesize[2], cy);
+		break;
+	}
+}
@@ -57,3 +57,9 @@ static inline void video_frame_destroy(struct video_frame *frame)
 EXPORT void video_frame_copy(struct video_frame *dst,
 		const struct video_frame *src, enum video_format format,
 		uint32_t height);
+
+/* like video_frame_copy, but copies line by line, for when the source and
+ * destination linesizes differ */
+EXPORT void video_frame_copy_lines(struct video_frame *dst,
+		const struct video_frame *src, enum video_format format,
+		uint32_t height);
@@ -32,34 +32,78 @@ extern profiler_name_store_t *obs_get_profiler_name_store(void);
 #define MAX_CONVERT_BUFFERS 3
 #define MAX_CACHE_SIZE 16
 
+/*
+ * The frame cache is filled by a single producer (the thread calling
+ * lock/unlock or video_output_ref_frame), which takes any free slot and
+ * publishes it by setting its count and appending its index to the
+ * published ring.  The video thread decrements the count once per delivery
+ * it hands to the inputs.  Each entry of the published ring holds a
+ * reference to its slot until the video thread is done with it, and every
+ * delivery queued on an input holds one until the input's own thread is done
+ * with it.  A slot is free again once both are 0, and a referenced frame is
+ * released when the last reference is.  Inputs can fall behind and hold on to
+ * older slots, which is why slots aren't simply reused in order.
+ */
 struct cached_frame_info {
 	struct video_data frame;
-	int count;
+	volatile long count;
+	volatile long refs;
+
+	/* set when the frame references memory owned by the caller of
+	 * video_output_ref_frame rather than the cache frame above */
+	struct video_data ref;
+	void (*release)(void *param);
+	void *release_param;
+
+	/* set when the producer republishes the slot to repeat it */
+	bool repeated;
+};
+
+/* an entry of an input's queue.  works like the frame cache: the video thread
+ * publishes it by setting count, and raises the count instead of queueing a
+ * new entry when the input falls behind, so the input repeats its newest
+ * frame rather than losing time. */
+struct queued_frame {
+	struct cached_frame_info  *frame_info;
+	struct video_data         frame;
+	bool                      referenced;
+	volatile long             count;
 };
 
 struct video_input {
 	struct video_scale_info   conversion;
+	uint32_t                  flags;
 	video_scaler_t            *scaler;
 	struct video_frame        frame[MAX_CONVERT_BUFFERS];
 	int                       cur_frame;
 
 	void (*callback)(void *param, struct video_data *frame);
 	void *param;
-};
 
-static inline void video_input_free(struct video_input *input)
-{
-	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-		video_frame_free(&input->frame[i]);
-	video_scaler_destroy(input->scaler);
-}
+	struct video_output       *video;
+	pthread_t                 thread;
+	bool                      thread_initialized;
+	volatile bool             stop;
+	volatile bool             exited;
+	os_sem_t                  *queue_semaphore;
+
+	/* queue_write and queue_last are only touched by the video thread,
+	 * queue_read only by the input thread */
+	struct queued_frame       queue[MAX_CACHE_SIZE];
+	volatile long             queued;
+	size_t                    queue_read;
+	size_t                    queue_write;
+	size_t                    queue_last;
+
+	uint32_t                  total_frames;
+	uint32_t                  skipped_frames;
+};
 
 struct video_output {
 	struct video_output_info   info;
 
 	pthread_t                  thread;
-	pthread_mutex_t            data_mutex;
-	bool                       stop;
+	volatile bool              stop;
 
 	os_sem_t                   *update_semaphore;
 	uint64_t                   frame_time;
@@ -69,14 +113,33 @@ struct video_output {
 	bool                       initialized;
 
 	pthread_mutex_t            input_mutex;
-	DARRAY(struct video_input) inputs;
+	DARRAY(struct video_input*) inputs;
+
+	/* inputs disconnected from their own callback, which can't join
+	 * their own thread.  they are joined once their thread has exited */
+	DARRAY(struct video_input*) detached_inputs;
 
-	size_t                     available_frames;
+	/* first_added is only touched by the video thread, last_added,
+	 * next_added and the locked frame only by the producer */
+	size_t                     published[MAX_CACHE_SIZE];
 	size_t                     first_added;
+	size_t                     next_added;
 	size_t                     last_added;
+	struct cached_frame_info   *locked_frame;
+	int                        locked_count;
 	struct cached_frame_info   cache[MAX_CACHE_SIZE];
 };
 
+static inline void release_cache_frame(struct cached_frame_info *cfi)
+{
+	void (*release)(void *param) = cfi->release;
+	void *release_param = cfi->release_param;
+
+	/* the slot can be reused by the producer as soon as refs reaches 0 */
+	if (os_atomic_dec_long(&cfi->refs) == 0 && release)
+		release(release_param);
+}
+
 /* ------------------------------------------------------------------------- */
 
 static inline bool scale_video_output(struct video_input *input,
@@ -110,53 +173,297 @@ static inline bool scale_video_output(struct video_input *input,
 	return success;
 }
 
-static inline bool video_output_cur_frame(struct video_output *video)
+/* referenced frames keep the linesizes of the caller's memory.  inputs that
+ * need packed planes get a copy unless the scaler is going to repack them
+ * anyway. */
+static inline void pack_video_output(struct video_output *video,
+		struct video_input *input, struct video_data *data,
+		const struct video_data *packed)
 {
-	struct cached_frame_info *frame_info;
-	bool complete;
+	struct video_frame *frame;
+	bool needs_copy = false;
 
-	/* -------------------------------- */
+	if (input->scaler || (input->flags & VIDEO_INPUT_ANY_LINESIZE) != 0)
+		return;
 
-	pthread_mutex_lock(&video->data_mutex);
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		if (data->linesize[i] != packed->linesize[i]) {
+			needs_copy = true;
+			break;
+		}
+	}
 
-	frame_info = &video->cache[video->first_added];
+	if (!needs_copy)
+		return;
 
-	pthread_mutex_unlock(&video->data_mutex);
+	if (++input->cur_frame == MAX_CONVERT_BUFFERS)
+		input->cur_frame = 0;
 
-	/* -------------------------------- */
+	frame = &input->frame[input->cur_frame];
+	if (!frame->data[0])
+		video_frame_init(frame, video->info.format,
+				video->info.width, video->info.height);
+
+	video_frame_copy_lines(frame, (const struct video_frame*)data,
+			video->info.format, video->info.height);
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		data->data[i]     = frame->data[i];
+		data->linesize[i] = frame->linesize[i];
+	}
+}
+
+static void video_input_destroy(struct video_input *input)
+{
+	/* frames still queued (or partly delivered) hold a reference */
+	for (size_t i = 0; i < MAX_CACHE_SIZE; i++) {
+		struct queued_frame *qf = &input->queue[i];
+		if (qf->count) {
+			release_cache_frame(qf->frame_info);
+			qf->count = 0;
+		}
+	}
+
+	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
+		video_frame_free(&input->frame[i]);
+	video_scaler_destroy(input->scaler);
+	os_sem_destroy(input->queue_semaphore);
+	bfree(input);
+}
+
+static void video_input_free(struct video_input *input)
+{
+	if (input->thread_initialized) {
+		os_atomic_set_bool(&input->stop, true);
+
+		/* an input can be disconnected from within its callback (an
+		 * encoder failing stops its outputs), which must not join
+		 * its own thread */
+		if (pthread_equal(pthread_self(), input->thread)) {
+			struct video_output *video = input->video;
+
+			pthread_mutex_lock(&video->input_mutex);
+			da_push_back(video->detached_inputs, &input);
+			pthread_mutex_unlock(&video->input_mutex);
+			return;
+		}
+
+		os_sem_post(input->queue_semaphore);
+		pthread_join(input->thread, NULL);
+	}
+
+	video_input_destroy(input);
+}
+
+/* joins and destroys the detached inputs whose thread has exited, or all of
+ * them if 'wait' is set */
+static void video_free_detached_inputs(struct video_output *video, bool wait)
+{
+	DARRAY(struct video_input*) inputs;
+	size_t i = 0;
+
+	da_init(inputs);
 
 	pthread_mutex_lock(&video->input_mutex);
+	while (i < video->detached_inputs.num) {
+		struct video_input *input = video->detached_inputs.array[i];
 
-	for (size_t i = 0; i < video->inputs.num; i++) {
-		struct video_input *input = video->inputs.array+i;
-		struct video_data frame = frame_info->frame;
+		if (wait || os_atomic_load_bool(&input->exited)) {
+			da_push_back(inputs, &input);
+			da_erase(video->detached_inputs, i);
+		} else {
+			i++;
+		}
+	}
+	pthread_mutex_unlock(&video->input_mutex);
+
+	for (i = 0; i < inputs.num; i++) {
+		pthread_join(inputs.array[i]->thread, NULL);
+		video_input_destroy(inputs.array[i]);
+	}
+
+	da_free(inputs);
+}
+
+static inline void video_input_cur_frame(struct video_input *input)
+{
+	struct queued_frame *qf = &input->queue[input->queue_read];
+	struct cached_frame_info *frame_info = qf->frame_info;
+	struct video_data source = qf->frame;
+
+	for (;;) {
+		struct video_data frame = source;
+
+		if (qf->referenced)
+			pack_video_output(input->video, input, &frame,
+					&frame_info->frame);
 
 		if (scale_video_output(input, &frame))
 			input->callback(input->param, &frame);
+
+		input->total_frames++;
+
+		if (os_atomic_dec_long(&qf->count) == 0)
+			break;
+
+		/* the entry is cleaned up in video_input_destroy */
+		if (os_atomic_load_bool(&input->stop))
+			return;
+
+		source.timestamp += input->video->frame_time;
 	}
 
-	pthread_mutex_unlock(&video->input_mutex);
+	if (++input->queue_read == MAX_CACHE_SIZE)
+		input->queue_read = 0;
+
+	release_cache_frame(frame_info);
+	os_atomic_dec_long(&input->queued);
+}
 
-	/* -------------------------------- */
+static void *video_input_thread(void *param)
+{
+	struct video_input *input = param;
 
-	pthread_mutex_lock(&video->data_mutex);
+	os_set_thread_name("video-io: input thread");
 
-	frame_info->frame.timestamp += video->frame_time;
-	complete = --frame_info->count == 0;
+	const char *input_thread_name =
+		profile_store_name(obs_get_profiler_name_store(),
+				"video_input_thread(%s)",
+				input->video->info.name);
 
-	if (complete) {
-		if (++video->first_added == video->info.cache_size)
-			video->first_added = 0;
+	while (os_sem_wait(input->queue_semaphore) == 0) {
+		if (os_atomic_load_bool(&input->stop))
+			break;
+
+		profile_start(input_thread_name);
+		video_input_cur_frame(input);
+		profile_end(input_thread_name);
+
+		profile_reenable_thread();
+
+		if (os_atomic_load_bool(&input->stop))
+			break;
+	}
+
+	os_atomic_set_bool(&input->exited, true);
+	return NULL;
+}
+
+static inline void video_input_push_frame(struct video_input *input,
+		struct cached_frame_info *frame_info,
+		const struct video_data *frame, bool referenced)
+{
+	struct queued_frame *qf = &input->queue[input->queue_write];
+
+	os_atomic_inc_long(&frame_info->refs);
+	os_atomic_inc_long(&input->queued);
+
+	qf->frame_info = frame_info;
+	qf->frame      = *frame;
+	qf->referenced = referenced;
+	os_atomic_compare_swap_long(&qf->count, 0, 1);
+
+	input->queue_last = input->queue_write;
+	if (++input->queue_write == MAX_CACHE_SIZE)
+		input->queue_write = 0;
+
+	os_sem_post(input->queue_semaphore);
+}
+
+static void video_input_queue_frame(struct video_input *input,
+		size_t queue_limit, struct cached_frame_info *frame_info,
+		const struct video_data *frame, bool referenced)
+{
+	for (;;) {
+		struct queued_frame *last = &input->queue[input->queue_last];
+		long last_count;
+
+		if (input->queued < (long)queue_limit) {
+			video_input_push_frame(input, frame_info, frame,
+					referenced);
+			return;
+		}
+
+		/* entries finish in order, so if the newest one is done the
+		 * queue is empty apart from the count catching up */
+		last_count = last->count;
+		if (last_count == 0) {
+			video_input_push_frame(input, frame_info, frame,
+					referenced);
+			return;
+		}
+
+		if (os_atomic_compare_swap_long(&last->count, last_count,
+					last_count + 1)) {
+			input->skipped_frames++;
+			return;
+		}
+	}
+}
+
+/* every queued frame holds a cache slot, so the inputs share the cache
+ * between them, leaving room for the frame being handed out and the one
+ * being rendered */
+static inline size_t video_input_queue_limit(const struct video_output *video)
+{
+	size_t slots = video->info.cache_size > 2 ?
+		video->info.cache_size - 2 : 1;
+	size_t limit = video->inputs.num ? slots / video->inputs.num : slots;
 
-		if (++video->available_frames == video->info.cache_size)
-			video->last_added = video->first_added;
+	return limit ? limit : 1;
+}
+
+static inline void video_output_cur_frame(struct video_output *video)
+{
+	struct cached_frame_info *frame_info =
+		&video->cache[video->published[video->first_added]];
+	bool referenced = frame_info->release != NULL;
+	struct video_data source;
+
+	source = referenced ? frame_info->ref : frame_info->frame;
+	source.timestamp = frame_info->frame.timestamp;
+
+	/* a frame republished to repeat it counts as skipped like any other
+	 * repeat */
+	if (frame_info->repeated) {
+		frame_info->repeated = false;
+		video->skipped_frames++;
 	}
 
-	pthread_mutex_unlock(&video->data_mutex);
+	/* the producer can raise the count while the frame is being
+	 * handed out if it runs out of free slots */
+	for (;;) {
+		size_t queue_limit;
+
+		pthread_mutex_lock(&video->input_mutex);
+
+		queue_limit = video_input_queue_limit(video);
+
+		for (size_t i = 0; i < video->inputs.num; i++)
+			video_input_queue_frame(video->inputs.array[i],
+					queue_limit, frame_info, &source,
+					referenced);
+
+		pthread_mutex_unlock(&video->input_mutex);
+
+		video->total_frames++;
+
+		if (os_atomic_dec_long(&frame_info->count) == 0)
+			break;
+
+		/* the entry keeps its reference, and is released in
+		 * video_output_close */
+		if (os_atomic_load_bool(&video->stop))
+			return;
+
+		source.timestamp += video->frame_time;
+		video->skipped_frames++;
+	}
 
-	/* -------------------------------- */
+	if (++video->first_added == MAX_CACHE_SIZE)
+		video->first_added = 0;
 
-	return complete;
+	release_cache_frame(frame_info);
 }
 
 static void *video_thread(void *param)
@@ -170,16 +477,11 @@ static void *video_thread(void *param)
 				"video_thread(%s)", video->info.name);
 
 	while (os_sem_wait(video->update_semaphore) == 0) {
-		if (video->stop)
+		if (os_atomic_load_bool(&video->stop))
 			break;
 
 		profile_start(video_thread_name);
-		while (!video->stop && !video_output_cur_frame(video)) {
-			video->total_frames++;
-			video->skipped_frames++;
-		}
-
-		video->total_frames++;
+		video_output_cur_frame(video);
 		profile_end(video_thread_name);
 
 		profile_reenable_thread();
@@ -209,7 +511,6 @@ static inline void init_cache(struct video_output *video)
 				video->info.width, video->info.height);
 	}
 
-	video->available_frames = video->info.cache_size;
 }
 
 int video_output_open(video_t **video, struct video_output_info *info)
@@ -233,8 +534,6 @@ int video_output_open(video_t **video, struct video_output_info *info)
 		goto fail;
 	if (pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE) != 0)
 		goto fail;
-	if (pthread_mutex_init(&out->data_mutex, &attr) != 0)
-		goto fail;
 	if (pthread_mutex_init(&out->input_mutex, &attr) != 0)
 		goto fail;
 	if (os_sem_init(&out->update_semaphore, 0) != 0)
@@ -261,14 +560,25 @@ void video_output_close(video_t *video)
 	video_output_stop(video);
 
 	for (size_t i = 0; i < video->inputs.num; i++)
-		video_input_free(&video->inputs.array[i]);
+		video_input_free(video->inputs.array[i]);
 	da_free(video->inputs);
 
+	video_free_detached_inputs(video, true);
+	da_free(video->detached_inputs);
+
+	/* frames the video thread never finished handing out still hold
+	 * the reference of their published entry */
+	while (video->first_added != video->next_added) {
+		release_cache_frame(
+				&video->cache[video->published[video->first_added]]);
+		if (++video->first_added == MAX_CACHE_SIZE)
+			video->first_added = 0;
+	}
+
 	for (size_t i = 0; i < video->info.cache_size; i++)
 		video_frame_free((struct video_frame*)&video->cache[i]);
 
 	os_sem_destroy(video->update_semaphore);
-	pthread_mutex_destroy(&video->data_mutex);
 	pthread_mutex_destroy(&video->input_mutex);
 	bfree(video);
 }
@@ -278,7 +588,7 @@ static size_t video_get_input_idx(const video_t *video,
 		void *param)
 {
 	for (size_t i = 0; i < video->inputs.num; i++) {
-		struct video_input *input = video->inputs.array+i;
+		struct video_input *input = video->inputs.array[i];
 		if (input->callback == callback && input->param == param)
 			return i;
 	}
@@ -319,6 +629,15 @@ static inline bool video_input_init(struct video_input *input,
 					input->conversion.height);
 	}
 
+	input->video = video;
+
+	if (os_sem_init(&input->queue_semaphore, 0) != 0)
+		return false;
+	if (pthread_create(&input->thread, NULL, video_input_thread,
+				input) != 0)
+		return false;
+
+	input->thread_initialized = true;
 	return true;
 }
 
@@ -326,37 +645,50 @@ bool video_output_connect(video_t *video,
 		const struct video_scale_info *conversion,
 		void (*callback)(void *param, struct video_data *frame),
 		void *param)
+{
+	return video_output_connect_flags(video, conversion, 0, callback,
+			param);
+}
+
+bool video_output_connect_flags(video_t *video,
+		const struct video_scale_info *conversion, uint32_t flags,
+		void (*callback)(void *param, struct video_data *frame),
+		void *param)
 {
 	bool success = false;
 
 	if (!video || !callback)
 		return false;
 
+	video_free_detached_inputs(video, false);
+
 	pthread_mutex_lock(&video->input_mutex);
 
 	if (video_get_input_idx(video, callback, param) == DARRAY_INVALID) {
-		struct video_input input;
-		memset(&input, 0, sizeof(input));
+		struct video_input *input = bzalloc(sizeof(*input));
 
-		input.callback = callback;
-		input.param    = param;
+		input->callback = callback;
+		input->param    = param;
+		input->flags    = flags;
 
 		if (conversion) {
-			input.conversion = *conversion;
+			input->conversion = *conversion;
 		} else {
-			input.conversion.format    = video->info.format;
-			input.conversion.width     = video->info.width;
-			input.conversion.height    = video->info.height;
+			input->conversion.format    = video->info.format;
+			input->conversion.width     = video->info.width;
+			input->conversion.height    = video->info.height;
 		}
 
-		if (input.conversion.width == 0)
-			input.conversion.width = video->info.width;
-		if (input.conversion.height == 0)
-			input.conversion.height = video->info.height;
+		if (input->conversion.width == 0)
+			input->conversion.width = video->info.width;
+		if (input->conversion.height == 0)
+			input->conversion.height = video->info.height;
 
-		success = video_input_init(&input, video);
+		success = video_input_init(input, video);
 		if (success)
 			da_push_back(video->inputs, &input);
+		else
+			video_input_free(input);
 	}
 
 	pthread_mutex_unlock(&video->input_mutex);
@@ -368,6 +700,8 @@ void video_output_disconnect(video_t *video,
 		void (*callback)(void *param, struct video_data *frame),
 		void *param)
 {
+	struct video_input *input = NULL;
+
 	if (!video || !callback)
 		return;
 
@@ -375,11 +709,43 @@ void video_output_disconnect(video_t *video,
 
 	size_t idx = video_get_input_idx(video, callback, param);
 	if (idx != DARRAY_INVALID) {
-		video_input_free(video->inputs.array+idx);
+		input = video->inputs.array[idx];
 		da_erase(video->inputs, idx);
 	}
 
 	pthread_mutex_unlock(&video->input_mutex);
+
+	/* the input thread can be in a callback that needs the input mutex,
+	 * so it's joined without holding it */
+	if (input)
+		video_input_free(input);
+}
+
+bool video_output_get_input_stats(video_t *video,
+		void (*callback)(void *param, struct video_data *frame),
+		void *param, struct video_input_stats *stats)
+{
+	bool found = false;
+
+	if (!video || !callback || !stats)
+		return false;
+
+	pthread_mutex_lock(&video->input_mutex);
+
+	size_t idx = video_get_input_idx(video, callback, param);
+	if (idx != DARRAY_INVALID) {
+		struct video_input *input = video->inputs.array[idx];
+
+		stats->total_frames   = input->total_frames;
+		stats->skipped_frames = input->skipped_frames;
+		stats->queued_frames  = (uint32_t)input->queued;
+
+		found = true;
+	}
+
+	pthread_mutex_unlock(&video->input_mutex);
+
+	return found;
 }
 
 bool video_output_active(const video_t *video)
@@ -393,50 +759,111 @@ const struct video_output_info *video_output_get_info(const video_t *video)
 	return video ? &video->info : NULL;
 }
 
+static inline void publish_cache_frame(struct video_output *video,
+		struct cached_frame_info *cfi, int count)
+{
+	/* full barrier: the frame contents are visible before the count */
+	os_atomic_compare_swap_long(&cfi->count, 0, count);
+
+	video->last_added = cfi - video->cache;
+	video->published[video->next_added] = video->last_added;
+	if (++video->next_added == MAX_CACHE_SIZE)
+		video->next_added = 0;
+
+	os_sem_post(video->update_semaphore);
+}
+
+/* returns a free slot, or NULL if every slot is still in use, in which case
+ * the most recent frame is repeated instead */
+static struct cached_frame_info *next_cache_frame(struct video_output *video,
+		int count, uint64_t timestamp)
+{
+	for (;;) {
+		struct cached_frame_info *last = &video->cache[video->last_added];
+		long last_count, last_refs;
+
+		for (size_t i = 0; i < video->info.cache_size; i++) {
+			struct cached_frame_info *cfi = &video->cache[i];
+			if (cfi->count == 0 && cfi->refs == 0)
+				return cfi;
+		}
+
+		last_count = last->count;
+		if (last_count != 0) {
+			if (os_atomic_compare_swap_long(&last->count,
+						last_count, last_count + count))
+				return NULL;
+
+			/* the video thread finished the most recent frame
+			 * after the check above, try again */
+			continue;
+		}
+
+		/* the most recent frame has been handed out but is still held
+		 * by inputs, so publish it again.  the reference taken here
+		 * keeps the slot (and a referenced frame's memory) from being
+		 * released, and is held by the new published entry */
+		last_refs = last->refs;
+		if (last_refs == 0 || !os_atomic_compare_swap_long(&last->refs,
+					last_refs, last_refs + 1))
+			continue;
+
+		last->frame.timestamp = timestamp;
+		last->repeated        = true;
+		publish_cache_frame(video, last, count);
+		return NULL;
+	}
+}
+
 bool video_output_lock_frame(video_t *video, struct video_frame *frame,
 		int count, uint64_t timestamp)
 {
 	struct cached_frame_info *cfi;
-	bool locked;
 
 	if (!video) return false;
 
-	pthread_mutex_lock(&video->data_mutex);
+	cfi = next_cache_frame(video, count, timestamp);
+	if (!cfi)
+		return false;
 
-	if (video->available_frames == 0) {
-		video->cache[video->last_added].count += count;
-		locked = false;
+	cfi->frame.timestamp = timestamp;
+	cfi->release         = NULL;
 
-	} else {
-		if (video->available_frames != video->info.cache_size) {
-			if (++video->last_added == video->info.cache_size)
-				video->last_added = 0;
-		}
+	video->locked_frame = cfi;
+	video->locked_count = count;
 
-		cfi = &video->cache[video->last_added];
-		cfi->frame.timestamp = timestamp;
-		cfi->count = count;
+	memcpy(frame, &cfi->frame, sizeof(*frame));
+	return true;
+}
 
-		memcpy(frame, &cfi->frame, sizeof(*frame));
+bool video_output_ref_frame(video_t *video, const struct video_data *frame,
+		int count, void (*release)(void *param), void *param)
+{
+	struct cached_frame_info *cfi;
 
-		locked = true;
-	}
+	if (!video || !release) return false;
 
-	pthread_mutex_unlock(&video->data_mutex);
+	cfi = next_cache_frame(video, count, frame->timestamp);
+	if (!cfi)
+		return false;
 
-	return locked;
+	cfi->frame.timestamp = frame->timestamp;
+	cfi->ref             = *frame;
+	cfi->release         = release;
+	cfi->release_param   = param;
+
+	os_atomic_inc_long(&cfi->refs);
+	publish_cache_frame(video, cfi, count);
+	return true;
 }
 
 void video_output_unlock_frame(video_t *video)
 {
-	if (!video) return;
-
-	pthread_mutex_lock(&video->data_mutex);
-
-	video->available_frames--;
-	os_sem_post(video->update_semaphore);
+	if (!video || !video->locked_frame) return;
 
-	pthread_mutex_unlock(&video->data_mutex);
+	os_atomic_inc_long(&video->locked_frame->refs);
+	publish_cache_frame(video, video->locked_frame, video->locked_count);
+	video->locked_frame = NULL;
 }
 
 uint64_t video_output_get_frame_time(const video_t *video)
@@ -453,7 +880,7 @@ void video_output_stop(video_t *video)
 
 	if (video->initialized) {
 		video->initialized = false;
-		video->stop = true;
+		os_atomic_set_bool(&video->stop, true);
 		os_sem_post(video->update_semaphore);
 		pthread_join(video->thread, &thread_ret);
 	}
@@ -464,7 +891,7 @@ bool video_output_stopped(video_t *video)
 	if (!video)
 		return true;
 
-	return video->stop;
+	return os_atomic_load_bool(&video->stop);
 }
 
 enum video_format video_output_get_format(const video_t *video)
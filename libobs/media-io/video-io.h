@@ -150,10 +150,20 @@ EXPORT bool video_format_get_parameters(enum video_colorspace color_space,
 EXPORT int video_output_open(video_t **video, struct video_output_info *info);
 EXPORT void video_output_close(video_t *video);
 
+/**
+ * The input accepts frames whose planes are not tightly packed, so frames
+ * referenced with video_output_ref_frame can be passed to it without copying.
+ */
+#define VIDEO_INPUT_ANY_LINESIZE (1<<0)
+
 EXPORT bool video_output_connect(video_t *video,
 		const struct video_scale_info *conversion,
 		void (*callback)(void *param, struct video_data *frame),
 		void *param);
+EXPORT bool video_output_connect_flags(video_t *video,
+		const struct video_scale_info *conversion, uint32_t flags,
+		void (*callback)(void *param, struct video_data *frame),
+		void *param);
 EXPORT void video_output_disconnect(video_t *video,
 		void (*callback)(void *param, struct video_data *frame),
 		void *param);
@@ -165,6 +175,18 @@ EXPORT const struct video_output_info *video_output_get_info(
 EXPORT bool video_output_lock_frame(video_t *video, struct video_frame *frame,
 		int count, uint64_t timestamp);
 EXPORT void video_output_unlock_frame(video_t *video);
+
+/**
+ * Queues a frame that references memory owned by the caller instead of
+ * copying it into the frame cache.  If this returns true, release(param) is
+ * called exactly once from the video thread (or from video_output_close)
+ * after every input has finished with the frame, and the memory must stay
+ * valid until then.  Inputs connected without VIDEO_INPUT_ANY_LINESIZE still
+ * receive packed planes, copied per input only if the linesizes differ.
+ */
+EXPORT bool video_output_ref_frame(video_t *video,
+		const struct video_data *frame, int count,
+		void (*release)(void *param), void *param);
 EXPORT uint64_t video_output_get_frame_time(const video_t *video);
 EXPORT void video_output_stop(video_t *video);
 EXPORT bool video_output_stopped(video_t *video);
@@ -177,6 +199,23 @@ EXPORT double video_output_get_frame_rate(const video_t *video);
 EXPORT uint32_t video_output_get_skipped_frames(const video_t *video);
 EXPORT uint32_t video_output_get_total_frames(const video_t *video);
 
+struct video_input_stats {
+	/** Frames passed to the input's callback, including repeats */
+	uint32_t total_frames;
+	/** Frames the input fell behind on and received as repeats */
+	uint32_t skipped_frames;
+	/** Frames currently waiting in the input's queue */
+	uint32_t queued_frames;
+};
+
+/**
+ * Gets the frame counters of a single input.  Each input is fed from its own
+ * thread and queue, so an input that falls behind only skips frames itself.
+ */
+EXPORT bool video_output_get_input_stats(video_t *video,
+		void (*callback)(void *param, struct video_data *frame),
+		void *param, struct video_input_stats *stats);
+
 
 #ifdef __cplusplus
 }
@@ -48,6 +48,10 @@ struct obs_fader {
 };
 
 struct obs_volmeter {
+	/* held by the owner, and by the graphics thread while it updates the
+	 * volume meter */
+	volatile long          refs;
+
 	pthread_mutex_t        mutex;
 	signal_handler_t       *signals;
 	obs_fader_conversion_t pos_to_db;
@@ -55,6 +59,13 @@ struct obs_volmeter {
 	obs_source_t           *source;
 	enum obs_fader_type    type;
 	float                  cur_db;
+	bool                   true_peak;
+
+	/* the last tick of the source's audio line that was processed, and
+	 * whether the levels changed since obs_volmeter_get_levels returned
+	 * them */
+	uint64_t               levels_index;
+	bool                   levels_changed;
 
 	unsigned int           channels;
 	unsigned int           update_ms;
@@ -276,28 +287,6 @@ static void volmeter_source_destroyed(void *vptr, calldata_t *calldata)
 	obs_volmeter_detach_source(volmeter);
 }
 
-/* TODO: Separate for individual channels */
-static void volmeter_sum_and_max(float *data[MAX_AV_PLANES], size_t frames,
-		float *sum, float *max)
-{
-	float s  = *sum;
-	float m  = *max;
-
-	for (size_t plane = 0; plane < MAX_AV_PLANES; plane++) {
-		if (!data[plane])
-			break;
-
-		for (float *c = data[plane]; c < data[plane] + frames; ++c) {
-			const float pow = *c * *c;
-			s += pow;
-			m  = (m > pow) ? m : pow;
-		}
-	}
-
-	*sum = s;
-	*max = m;
-}
-
 /**
  * @todo The IIR low pass filter has a different behavior depending on the
  *       update interval and sample rate, it should be replaced with something
@@ -334,73 +323,135 @@ static void volmeter_calc_ival_levels(obs_volmeter_t *volmeter)
 	volmeter->ival_max    = 0.0f;
 }
 
-static bool volmeter_process_audio_data(obs_volmeter_t *volmeter,
-		struct audio_data *data)
+/* TODO: Separate for individual channels */
+static bool volmeter_process_levels(obs_volmeter_t *volmeter,
+		const struct audio_line_levels *levels)
 {
-	bool updated   = false;
-	size_t frames  = 0;
-	size_t left    = data->frames;
-	float *adata[MAX_AV_PLANES];
+	float peak = levels->peak;
 
-	for (size_t i = 0; i < MAX_AV_PLANES; i++)
-		adata[i] = (float*)data->data[i];
+	if (volmeter->true_peak && levels->true_peak > peak)
+		peak = levels->true_peak;
 
-	while (left) {
-		frames  = (volmeter->ival_frames + left >
-				volmeter->update_frames)
-			? volmeter->update_frames - volmeter->ival_frames
-			: left;
+	volmeter->levels_index  = levels->index;
+	volmeter->ival_sum     += levels->sum;
+	volmeter->ival_max      = fmaxf(volmeter->ival_max, peak * peak);
+	volmeter->ival_frames  += levels->frames;
 
-		volmeter_sum_and_max(adata, frames, &volmeter->ival_sum,
-				&volmeter->ival_max);
+	/* the interval ends with the tick that completes it */
+	if (volmeter->ival_frames < volmeter->update_frames)
+		return false;
 
-		volmeter->ival_frames += (unsigned int)frames;
-		left                  -= frames;
+	volmeter_calc_ival_levels(volmeter);
+	return true;
+}
+
+static inline audio_line_t *volmeter_get_line(obs_volmeter_t *volmeter)
+{
+	return volmeter->source ? volmeter->source->audio_line : NULL;
+}
 
-		for (size_t i = 0; i < MAX_AV_PLANES; i++) {
-			if (!adata[i])
-				break;
-			adata[i] += frames;
-		}
+/* processes the levels the audio thread measured since the last call, and
+ * returns true if an interval was completed.  the mutex must be held */
+static bool volmeter_update_levels(obs_volmeter_t *volmeter)
+{
+	struct audio_line_levels levels[AUDIO_LINE_LEVELS];
+	bool updated = false;
+	size_t num;
 
-		/* break if we did not reach the end of the interval */
-		if (volmeter->ival_frames != volmeter->update_frames)
-			break;
+	num = audio_line_get_levels(volmeter_get_line(volmeter),
+			volmeter->levels_index, levels, AUDIO_LINE_LEVELS);
 
-		volmeter_calc_ival_levels(volmeter);
-		updated = true;
+	for (size_t i = 0; i < num; i++) {
+		if (volmeter_process_levels(volmeter, &levels[i]))
+			updated = true;
 	}
 
+	if (updated)
+		volmeter->levels_changed = true;
 	return updated;
 }
 
-static void volmeter_source_data_received(void *vptr, calldata_t *calldata)
+/* the levels are measured before the volume is applied, the volume of the
+ * source is applied here.  the mutex must be held */
+static void volmeter_get_positions(obs_volmeter_t *volmeter,
+		float *level, float *magnitude, float *peak, bool *muted)
 {
-	struct obs_volmeter *volmeter = (struct obs_volmeter *) vptr;
-	bool updated = false;
-	float mul, level, mag, peak;
-	signal_handler_t *sh;
+	const float mul = db_to_mul(volmeter->cur_db);
 
-	pthread_mutex_lock(&volmeter->mutex);
+	*level     = volmeter->db_to_pos(mul_to_db(volmeter->vol_max * mul));
+	*magnitude = volmeter->db_to_pos(mul_to_db(volmeter->vol_mag * mul));
+	*peak      = volmeter->db_to_pos(mul_to_db(volmeter->vol_peak * mul));
+	*muted     = volmeter->source && obs_source_muted(volmeter->source);
+}
 
-	struct audio_data *data = calldata_ptr(calldata, "data");
-	updated = volmeter_process_audio_data(volmeter, data);
+static void volmeter_add(obs_volmeter_t *volmeter)
+{
+	if (!obs)
+		return;
 
-	if (updated) {
-		mul   = db_to_mul(volmeter->cur_db);
+	pthread_mutex_lock(&obs->data.volmeters_mutex);
+	da_push_back(obs->data.volmeters, &volmeter);
+	pthread_mutex_unlock(&obs->data.volmeters_mutex);
+}
 
-		level = volmeter->db_to_pos(mul_to_db(volmeter->vol_max * mul));
-		mag   = volmeter->db_to_pos(mul_to_db(volmeter->vol_mag * mul));
-		peak  = volmeter->db_to_pos(
-				mul_to_db(volmeter->vol_peak * mul));
-		sh    = volmeter->signals;
-	}
+static void volmeter_remove(obs_volmeter_t *volmeter)
+{
+	if (!obs)
+		return;
 
-	pthread_mutex_unlock(&volmeter->mutex);
+	pthread_mutex_lock(&obs->data.volmeters_mutex);
+	da_erase_item(obs->data.volmeters, &volmeter);
+	pthread_mutex_unlock(&obs->data.volmeters_mutex);
+}
 
-	if (updated)
-		signal_levels_updated(sh, volmeter, level, mag, peak,
-				calldata_bool(calldata, "muted"));
+static void volmeter_release(obs_volmeter_t *volmeter)
+{
+	if (os_atomic_dec_long(&volmeter->refs) != 0)
+		return;
+
+	signal_handler_destroy(volmeter->signals);
+	pthread_mutex_destroy(&volmeter->mutex);
+	bfree(volmeter);
+}
+
+/* called by the graphics thread once per frame, so levels_updated is
+ * emitted for every attached volume meter even if nobody polls it.  the
+ * signals are emitted from a referenced copy of the list, so the handlers
+ * can attach, detach or destroy volume meters */
+void obs_volmeters_update(void)
+{
+	struct obs_core_data *data = &obs->data;
+
+	pthread_mutex_lock(&data->volmeters_mutex);
+
+	da_copy(data->volmeters_updating, data->volmeters);
+	for (size_t i = 0; i < data->volmeters_updating.num; i++)
+		os_atomic_inc_long(&data->volmeters_updating.array[i]->refs);
+
+	pthread_mutex_unlock(&data->volmeters_mutex);
+
+	for (size_t i = 0; i < data->volmeters_updating.num; i++) {
+		obs_volmeter_t *volmeter = data->volmeters_updating.array[i];
+		float level, magnitude, peak;
+		signal_handler_t *sh;
+		bool updated, muted;
+
+		pthread_mutex_lock(&volmeter->mutex);
+
+		updated = volmeter_update_levels(volmeter);
+		if (updated)
+			volmeter_get_positions(volmeter, &level, &magnitude,
+					&peak, &muted);
+		sh = volmeter->signals;
+
+		pthread_mutex_unlock(&volmeter->mutex);
+
+		if (updated)
+			signal_levels_updated(sh, volmeter, level, magnitude,
+					peak, muted);
+
+		volmeter_release(volmeter);
+	}
 }
 
 static void volmeter_update_audio_settings(obs_volmeter_t *volmeter)
@@ -614,6 +665,8 @@ obs_volmeter_t *obs_volmeter_create(enum obs_fader_type type)
 	if (!volmeter)
 		return NULL;
 
+	volmeter->refs = 1;
+
 	pthread_mutex_init_value(&volmeter->mutex);
 	if (pthread_mutex_init(&volmeter->mutex, NULL) != 0)
 		goto fail;
@@ -658,10 +711,7 @@ void obs_volmeter_destroy(obs_volmeter_t *volmeter)
 		return;
 
 	obs_volmeter_detach_source(volmeter);
-	signal_handler_destroy(volmeter->signals);
-	pthread_mutex_destroy(&volmeter->mutex);
-
-	bfree(volmeter);
+	volmeter_release(volmeter);
 }
 
 bool obs_volmeter_attach_source(obs_volmeter_t *volmeter, obs_source_t *source)
@@ -678,16 +728,19 @@ bool obs_volmeter_attach_source(obs_volmeter_t *volmeter, obs_source_t *source)
 	sh = obs_source_get_signal_handler(source);
 	signal_handler_connect(sh, "volume",
 			volmeter_source_volume_changed, volmeter);
-	signal_handler_connect(sh, "audio_data",
-			volmeter_source_data_received, volmeter);
 	signal_handler_connect(sh, "destroy",
 			volmeter_source_destroyed, volmeter);
 
-	volmeter->source = source;
-	volmeter->cur_db = mul_to_db(obs_source_get_volume(source));
+	volmeter->source       = source;
+	volmeter->cur_db       = mul_to_db(obs_source_get_volume(source));
+	volmeter->levels_index = 0;
+
+	if (volmeter->true_peak)
+		audio_line_enable_true_peak(source->audio_line, true);
 
 	pthread_mutex_unlock(&volmeter->mutex);
 
+	volmeter_add(volmeter);
 	return true;
 }
 
@@ -698,6 +751,8 @@ void obs_volmeter_detach_source(obs_volmeter_t *volmeter)
 	if (!volmeter)
 		return;
 
+	volmeter_remove(volmeter);
+
 	pthread_mutex_lock(&volmeter->mutex);
 
 	if (!volmeter->source)
@@ -706,11 +761,13 @@ void obs_volmeter_detach_source(obs_volmeter_t *volmeter)
 	sh = obs_source_get_signal_handler(volmeter->source);
 	signal_handler_disconnect(sh, "volume",
 			volmeter_source_volume_changed, volmeter);
-	signal_handler_disconnect(sh, "audio_data",
-			volmeter_source_data_received, volmeter);
 	signal_handler_disconnect(sh, "destroy",
 			volmeter_source_destroyed, volmeter);
 
+	if (volmeter->true_peak)
+		audio_line_enable_true_peak(volmeter->source->audio_line,
+				false);
+
 	volmeter->source = NULL;
 
 exit:
@@ -722,6 +779,72 @@ signal_handler_t *obs_volmeter_get_signal_handler(obs_volmeter_t *volmeter)
 	return (volmeter) ? volmeter->signals : NULL;
 }
 
+bool obs_volmeter_get_levels(obs_volmeter_t *volmeter,
+		float *level, float *magnitude, float *peak, bool *muted)
+{
+	float cur_level, cur_magnitude, cur_peak;
+	signal_handler_t *sh;
+	bool cur_muted, updated, changed;
+
+	if (!volmeter)
+		return false;
+
+	pthread_mutex_lock(&volmeter->mutex);
+
+	updated = volmeter_update_levels(volmeter);
+	changed = volmeter->levels_changed;
+	volmeter->levels_changed = false;
+
+	volmeter_get_positions(volmeter, &cur_level, &cur_magnitude,
+			&cur_peak, &cur_muted);
+	sh = volmeter->signals;
+
+	pthread_mutex_unlock(&volmeter->mutex);
+
+	if (updated)
+		signal_levels_updated(sh, volmeter, cur_level, cur_magnitude,
+				cur_peak, cur_muted);
+
+	if (level)
+		*level = cur_level;
+	if (magnitude)
+		*magnitude = cur_magnitude;
+	if (peak)
+		*peak = cur_peak;
+	if (muted)
+		*muted = cur_muted;
+
+	return changed;
+}
+
+void obs_volmeter_set_true_peak(obs_volmeter_t *volmeter, bool enable)
+{
+	if (!volmeter)
+		return;
+
+	pthread_mutex_lock(&volmeter->mutex);
+
+	if (volmeter->true_peak != enable) {
+		volmeter->true_peak = enable;
+		audio_line_enable_true_peak(volmeter_get_line(volmeter),
+				enable);
+	}
+
+	pthread_mutex_unlock(&volmeter->mutex);
+}
+
+bool obs_volmeter_get_true_peak(obs_volmeter_t *volmeter)
+{
+	if (!volmeter)
+		return false;
+
+	pthread_mutex_lock(&volmeter->mutex);
+	const bool true_peak = volmeter->true_peak;
+	pthread_mutex_unlock(&volmeter->mutex);
+
+	return true_peak;
+}
+
 void obs_volmeter_set_update_interval(obs_volmeter_t *volmeter,
 		const unsigned int ms)
 {
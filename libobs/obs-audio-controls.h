@@ -187,9 +187,12 @@ EXPORT void obs_volmeter_destroy(obs_volmeter_t *volmeter);
  * @param source pointer to the source object
  * @return true on success
  *
- * When the volume meter is attached to a source it will start to listen to
- * volume updates on the source and after preparing the data emit its own
- * signal.
+ * Once attached, the levels of the source's audio are available from
+ * obs_volmeter_get_levels and the levels_updated signal.  The levels are
+ * measured by the audio thread for all sources at once, before the volume
+ * and mute of the source are applied.  The volume meter applies the volume
+ * of the source itself, and reports the mute state, so a muted source still
+ * shows its levels.
  */
 EXPORT bool obs_volmeter_attach_source(obs_volmeter_t *volmeter,
 		obs_source_t *source);
@@ -204,27 +207,65 @@ EXPORT void obs_volmeter_detach_source(obs_volmeter_t *volmeter);
  * @brief Get signal handler for the volume meter object
  * @param volmeter pointer to the volume meter object
  * @return signal handler
+ *
+ * levels_updated(ptr volmeter, float level, float magnitude, float peak,
+ * bool muted) is emitted whenever an update interval of levels has been
+ * processed, once per frame from the graphics thread, or from a thread that
+ * calls obs_volmeter_get_levels.
  */
 EXPORT signal_handler_t *obs_volmeter_get_signal_handler(
 		obs_volmeter_t *volmeter);
 
+/**
+ * @brief Get the current levels of the volume meter
+ * @param volmeter pointer to the volume meter object
+ * @param level current level (smoothed peak), as a meter position
+ * @param magnitude current magnitude (smoothed RMS), as a meter position
+ * @param peak held peak, as a meter position
+ * @param muted whether the source is muted
+ * @return true if the levels changed since the last call
+ *
+ * Processes the levels the audio thread measured that the graphics thread
+ * hasn't processed yet, and never waits for the audio thread.  Meant to be
+ * polled by the UI, about once per update interval or more often, as an
+ * alternative to the levels_updated signal.  Any of the pointers may be
+ * NULL.
+ */
+EXPORT bool obs_volmeter_get_levels(obs_volmeter_t *volmeter,
+		float *level, float *magnitude, float *peak, bool *muted);
+
+/**
+ * @brief Use the true peak rather than the sample peak
+ * @param volmeter pointer to the volume meter object
+ * @param enable true to measure true peaks
+ *
+ * The true peak is the peak of the audio oversampled four times as specified
+ * by ITU-R BS.1770, which also catches peaks between samples.  Measuring it
+ * costs more CPU time on the audio thread than the sample peak.
+ */
+EXPORT void obs_volmeter_set_true_peak(obs_volmeter_t *volmeter, bool enable);
+
+/**
+ * @brief Whether the volume meter uses the true peak
+ * @param volmeter pointer to the volume meter object
+ * @return true if true peaks are measured
+ */
+EXPORT bool obs_volmeter_get_true_peak(obs_volmeter_t *volmeter);
+
 /**
  * @brief Set the update interval for the volume meter
  * @param volmeter pointer to the volume meter object
  * @param ms update interval in ms
  *
- * This sets the update interval in milliseconds that should be processed before
- * the resulting values are emitted by the levels_updated signal. The resulting
- * number of audio samples is rounded to an integer.
+ * This sets the update interval in milliseconds of audio that is processed
+ * before the levels are updated. The resulting number of audio samples is
+ * rounded to an integer.
  *
- * Please note that due to way obs does receive audio data from the sources
- * this is no hard guarantee for the timing of the signal itself. When the
- * volume meter receives a chunk of data that is multiple the size of the sample
- * interval, all data will be sampled and the values updated accordingly, but
- * only the signal for the last segment is actually emitted.
- * On the other hand data might be received in a way that will cause the signal
- * to be emitted in shorter intervals than specified here under some
- * circumstances.
+ * Please note that the audio thread measures the levels once per tick, so an
+ * interval always ends on a tick and may be slightly longer than specified.
+ * When more than one interval of audio was measured since the last call to
+ * obs_volmeter_get_levels, all of it is processed, but only the levels of the
+ * last interval are returned.
  */
 EXPORT void obs_volmeter_set_update_interval(obs_volmeter_t *volmeter,
 		const unsigned int ms);
@@ -132,23 +132,41 @@ static void serialize_avc_data(struct serializer *s, const uint8_t *data,
 	}
 }
 
-void obs_parse_avc_packet(struct encoder_packet *avc_packet,
-		const struct encoder_packet *src)
+static void parse_avc_packet(struct encoder_packet *avc_packet,
+		const struct encoder_packet *src, bool refcounted)
 {
 	struct array_output_data output;
 	struct serializer s;
+	size_t offset = refcounted ? sizeof(long) : 0;
+	long ref = 1;
 
 	array_output_serializer_init(&s, &output);
 	*avc_packet = *src;
 
+	/* the reference count of a reference counted packet is stored right
+	 * before the data */
+	if (refcounted)
+		s_write(&s, &ref, sizeof(ref));
 	serialize_avc_data(&s, src->data, src->size, &avc_packet->keyframe,
 			&avc_packet->priority);
 
-	avc_packet->data          = output.bytes.array;
-	avc_packet->size          = output.bytes.num;
+	avc_packet->data          = output.bytes.array + offset;
+	avc_packet->size          = output.bytes.num - offset;
 	avc_packet->drop_priority = get_drop_priority(avc_packet->priority);
 }
 
+void obs_parse_avc_packet(struct encoder_packet *avc_packet,
+		const struct encoder_packet *src)
+{
+	parse_avc_packet(avc_packet, src, false);
+}
+
+void obs_parse_avc_packet_ref(struct encoder_packet *avc_packet,
+		const struct encoder_packet *src)
+{
+	parse_avc_packet(avc_packet, src, true);
+}
+
 static inline bool has_start_code(const uint8_t *data)
 {
 	if (data[0] != 0 || data[1] != 0)
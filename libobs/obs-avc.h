@@ -51,8 +51,13 @@ enum {
 EXPORT bool obs_avc_keyframe(const uint8_t *data, size_t size);
 EXPORT const uint8_t *obs_avc_find_startcode(const uint8_t *p,
 		const uint8_t *end);
+/* converts to AVCC, the result must be freed with obs_free_encoder_packet */
 EXPORT void obs_parse_avc_packet(struct encoder_packet *avc_packet,
 		const struct encoder_packet *src);
+/* converts to AVCC as a reference counted packet, which can be kept with
+ * obs_encoder_packet_ref and must be freed with obs_encoder_packet_release */
+EXPORT void obs_parse_avc_packet_ref(struct encoder_packet *avc_packet,
+		const struct encoder_packet *src);
 EXPORT size_t obs_parse_avc_header(uint8_t **header, const uint8_t *data,
 		size_t size);
 
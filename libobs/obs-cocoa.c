@@ -1251,6 +1251,17 @@ void obs_hotkeys_platform_free(struct obs_core_hotkeys *hotkeys)
 	hotkeys_release(hotkeys->platform_context);
 }
 
+bool obs_hotkeys_platform_wait(struct obs_core_hotkeys *hotkeys)
+{
+	return os_event_timedwait(hotkeys->stop_event, OBS_HOTKEY_POLL_MS) ==
+		ETIMEDOUT;
+}
+
+void obs_hotkeys_platform_wake(struct obs_core_hotkeys *hotkeys)
+{
+	UNUSED_PARAMETER(hotkeys);
+}
+
 typedef unsigned long NSUInteger;
 static bool mouse_button_pressed(obs_key_t key, bool *pressed)
 {
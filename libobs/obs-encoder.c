@@ -15,6 +15,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include <inttypes.h>
 #include "obs.h"
 #include "obs-internal.h"
 
@@ -179,23 +180,45 @@ static void add_connection(struct obs_encoder *encoder)
 				&audio_info, receive_audio, encoder);
 	} else {
 		struct video_scale_info info = {0};
+		uint32_t flags = 0;
 		get_video_info(encoder, &info);
 
-		video_output_connect(encoder->media, &info, receive_video,
-			encoder);
+		if ((encoder->info.caps & OBS_ENCODER_CAP_ANY_LINESIZE) != 0)
+			flags |= VIDEO_INPUT_ANY_LINESIZE;
+
+		video_output_connect_flags(encoder->media, &info, flags,
+				receive_video, encoder);
 	}
 
 	encoder->active = true;
 }
 
+static void log_video_input_stats(struct obs_encoder *encoder)
+{
+	struct video_input_stats stats;
+
+	if (!video_output_get_input_stats(encoder->media, receive_video,
+				encoder, &stats))
+		return;
+
+	if (stats.skipped_frames)
+		blog(LOG_INFO, "Video encoder '%s': %"PRIu32" of %"PRIu32
+				" frames were repeats because the encoder "
+				"fell behind",
+				encoder->context.name,
+				stats.skipped_frames, stats.total_frames);
+}
+
 static void remove_connection(struct obs_encoder *encoder)
 {
-	if (encoder->info.type == OBS_ENCODER_AUDIO)
+	if (encoder->info.type == OBS_ENCODER_AUDIO) {
 		audio_output_disconnect(encoder->media, encoder->mixer_idx,
 				receive_audio, encoder);
-	else
+	} else {
+		log_video_input_stats(encoder);
 		video_output_disconnect(encoder->media, receive_video,
 				encoder);
+	}
 
 	obs_encoder_shutdown(encoder);
 	encoder->active = false;
@@ -322,11 +345,28 @@ void obs_encoder_update(obs_encoder_t *encoder, obs_data_t *settings)
 
 	obs_data_apply(encoder->context.settings, settings);
 
+	/* the new settings replace any bitrate that is still pending */
+	pthread_mutex_lock(&encoder->callbacks_mutex);
+	encoder->pending_bitrate = 0;
+	pthread_mutex_unlock(&encoder->callbacks_mutex);
+
 	if (encoder->info.update && encoder->context.data)
 		encoder->info.update(encoder->context.data,
 				encoder->context.settings);
 }
 
+void obs_encoder_set_bitrate(obs_encoder_t *encoder, int kbps)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_set_bitrate"))
+		return;
+	if (kbps <= 0)
+		return;
+
+	pthread_mutex_lock(&encoder->callbacks_mutex);
+	encoder->pending_bitrate = kbps;
+	pthread_mutex_unlock(&encoder->callbacks_mutex);
+}
+
 bool obs_encoder_get_extra_data(const obs_encoder_t *encoder,
 		uint8_t **extra_data, size_t *size)
 {
@@ -391,6 +431,11 @@ bool obs_encoder_initialize(obs_encoder_t *encoder)
 	encoder->paired_encoder  = NULL;
 	encoder->start_ts        = 0;
 
+	/* the new context was created with the configured bitrate */
+	pthread_mutex_lock(&encoder->callbacks_mutex);
+	encoder->pending_bitrate = 0;
+	pthread_mutex_unlock(&encoder->callbacks_mutex);
+
 	if (encoder->info.type == OBS_ENCODER_AUDIO)
 		intitialize_audio_encoder(encoder);
 
@@ -687,10 +732,15 @@ static void send_first_video_packet(struct obs_encoder *encoder,
 	first_packet.data = data.array;
 	first_packet.size = data.num;
 
+	/* the SEI makes this packet different from the one the other
+	 * callbacks receive, so it needs its own instance */
+	obs_encoder_packet_create_instance(&first_packet, &first_packet);
+	da_free(data);
+
 	cb->new_packet(cb->param, &first_packet);
 	cb->sent_first_packet = true;
 
-	da_free(data);
+	obs_encoder_packet_release(&first_packet);
 }
 
 static inline void send_packet(struct obs_encoder *encoder,
@@ -713,6 +763,31 @@ static void full_stop(struct obs_encoder *encoder)
 	}
 }
 
+/* applies a bitrate requested with obs_encoder_set_bitrate on the encoder
+ * thread, so the encoder is never reconfigured while it's encoding.  the
+ * encoder gets a copy of its settings, and the configured bitrate stays in
+ * context.settings */
+static void apply_pending_bitrate(struct obs_encoder *encoder)
+{
+	obs_data_t *settings;
+	int kbps;
+
+	pthread_mutex_lock(&encoder->callbacks_mutex);
+	kbps = encoder->pending_bitrate;
+	encoder->pending_bitrate = 0;
+	pthread_mutex_unlock(&encoder->callbacks_mutex);
+
+	if (!kbps || !encoder->info.update)
+		return;
+
+	settings = obs_data_create();
+	obs_data_apply(settings, encoder->context.settings);
+	obs_data_set_int(settings, "bitrate", kbps);
+
+	encoder->info.update(encoder->context.data, settings);
+	obs_data_release(settings);
+}
+
 static const char *do_encode_name = "do_encode";
 static inline void do_encode(struct obs_encoder *encoder,
 		struct encoder_frame *frame)
@@ -731,6 +806,9 @@ static inline void do_encode(struct obs_encoder *encoder,
 	pkt.timebase_den = encoder->timebase_den;
 	pkt.encoder = encoder;
 
+	if (encoder->pending_bitrate)
+		apply_pending_bitrate(encoder);
+
 	profile_start(encoder->profile_encoder_encode_name);
 	success = encoder->info.encode(encoder->context.data, frame, &pkt,
 			&received);
@@ -743,19 +821,27 @@ static inline void do_encode(struct obs_encoder *encoder,
 	}
 
 	if (received) {
+		struct encoder_packet shared;
+
 		/* we use system time here to ensure sync with other encoders,
 		 * you do not want to use relative timestamps here */
 		pkt.dts_usec = encoder->start_ts / 1000 + packet_dts_usec(&pkt);
 
+		/* the encoder reuses its packet buffer, so copy it once into
+		 * a refcounted instance that all outputs can share */
+		obs_encoder_packet_create_instance(&shared, &pkt);
+
 		pthread_mutex_lock(&encoder->callbacks_mutex);
 
 		for (size_t i = encoder->callbacks.num; i > 0; i--) {
 			struct encoder_callback *cb;
 			cb = encoder->callbacks.array+(i-1);
-			send_packet(encoder, cb, &pkt);
+			send_packet(encoder, cb, &shared);
 		}
 
 		pthread_mutex_unlock(&encoder->callbacks_mutex);
+
+		obs_encoder_packet_release(&shared);
 	}
 
 	profile_end(do_encode_name);
@@ -916,6 +1002,51 @@ void obs_free_encoder_packet(struct encoder_packet *packet)
 	memset(packet, 0, sizeof(struct encoder_packet));
 }
 
+/* refcounted packets store their reference count right before the data */
+static inline volatile long *packet_refs(const struct encoder_packet *packet)
+{
+	return ((volatile long*)packet->data) - 1;
+}
+
+void obs_encoder_packet_create_instance(struct encoder_packet *dst,
+		const struct encoder_packet *src)
+{
+	long *p_refs = bmalloc(src->size + sizeof(long));
+	uint8_t *data = (uint8_t*)(p_refs + 1);
+
+	*p_refs = 1;
+	memcpy(data, src->data, src->size);
+
+	*dst = *src;
+	dst->data = data;
+}
+
+void obs_encoder_packet_ref(struct encoder_packet *dst,
+		struct encoder_packet *src)
+{
+	if (!src)
+		return;
+
+	if (src->data)
+		os_atomic_inc_long(packet_refs(src));
+
+	*dst = *src;
+}
+
+void obs_encoder_packet_release(struct encoder_packet *packet)
+{
+	if (!packet)
+		return;
+
+	if (packet->data) {
+		volatile long *p_refs = packet_refs(packet);
+		if (os_atomic_dec_long(p_refs) == 0)
+			bfree((void*)p_refs);
+	}
+
+	memset(packet, 0, sizeof(struct encoder_packet));
+}
+
 void obs_encoder_set_preferred_video_format(obs_encoder_t *encoder,
 		enum video_format format)
 {
@@ -29,6 +29,12 @@
 extern "C" {
 #endif
 
+/**
+ * Encoder can take video frames with any plane linesizes, so raw video can be
+ * passed to it straight from the staging surface without being repacked.
+ */
+#define OBS_ENCODER_CAP_ANY_LINESIZE (1<<0)
+
 /** Specifies the encoder type */
 enum obs_encoder_type {
 	OBS_ENCODER_AUDIO, /**< The encoder provides an audio codec */
@@ -227,6 +233,9 @@ struct obs_encoder_info {
 
 	void *type_data;
 	void (*free_type_data)(void *type_data);
+
+	/** Encoder capability flags (OBS_ENCODER_CAP_*) */
+	uint32_t caps;
 };
 
 EXPORT void obs_register_encoder_s(const struct obs_encoder_info *info,
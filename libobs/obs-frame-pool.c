@@ -0,0 +1,249 @@
+/******************************************************************************
+    Copyright (C) 2016 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <inttypes.h>
+
+#include "obs-internal.h"
+
+/*
+ * Global pool of async source frames.  Frames that a source no longer needs
+ * go back to the pool instead of being freed, and any source that needs a
+ * frame of the same format and size gets it from there.  Idle frames are
+ * freed least recently used first once they take up more than the pool's
+ * limit, or once they've been idle for MAX_IDLE_FRAME_TIME.
+ */
+
+struct pool_frame {
+	struct obs_source_frame frame; /* must be first */
+	size_t                  size;
+	uint64_t                idle_since;
+
+	/* set for frames that only reference data owned by a source */
+	bool                    wrapped;
+	void                    (*release)(void *param);
+	void                    *release_param;
+};
+
+#define DEFAULT_FRAME_POOL_LIMIT (256ULL * 1024ULL * 1024ULL)
+#define MAX_IDLE_FRAME_TIME      10000000000ULL
+
+static inline size_t frame_data_size(const struct obs_source_frame *frame)
+{
+	bool   half_height = frame->format == VIDEO_FORMAT_I420 ||
+	                     frame->format == VIDEO_FORMAT_NV12;
+	size_t size        = 0;
+
+	for (size_t i = 0; i < MAX_AV_PLANES && frame->data[i]; i++) {
+		uint32_t height = (i && half_height) ?
+			frame->height / 2 : frame->height;
+		size += (size_t)frame->linesize[i] * height;
+	}
+
+	return size;
+}
+
+static void destroy_pool_frame(struct obs_frame_pool *pool,
+		struct pool_frame *pf)
+{
+	pool->stats.frames_resident--;
+	pool->stats.bytes_resident -= pf->size;
+
+	bfree(pf->frame.data[0]);
+	bfree(pf);
+}
+
+/* frees idle frames until the pool is within its limit and nothing left has
+ * been idle for too long.  the oldest idle frames are at the front. */
+static void trim_idle_frames(struct obs_frame_pool *pool, uint64_t cur_time)
+{
+	size_t count = 0;
+
+	while (count < pool->idle_frames.num) {
+		struct pool_frame *pf = pool->idle_frames.array[count];
+
+		if (pool->stats.bytes_idle <= pool->stats.bytes_limit &&
+		    cur_time - pf->idle_since < MAX_IDLE_FRAME_TIME)
+			break;
+
+		pool->stats.frames_idle--;
+		pool->stats.bytes_idle -= pf->size;
+		pool->stats.evicted++;
+
+		destroy_pool_frame(pool, pf);
+		count++;
+	}
+
+	if (count)
+		da_erase_range(pool->idle_frames, 0, count);
+}
+
+bool obs_frame_pool_init(struct obs_frame_pool *pool)
+{
+	pthread_mutex_init_value(&pool->mutex);
+	if (pthread_mutex_init(&pool->mutex, NULL) != 0)
+		return false;
+
+	pool->stats.bytes_limit = DEFAULT_FRAME_POOL_LIMIT;
+	return true;
+}
+
+void obs_frame_pool_free(struct obs_frame_pool *pool)
+{
+	for (size_t i = 0; i < pool->idle_frames.num; i++)
+		destroy_pool_frame(pool, pool->idle_frames.array[i]);
+
+	if (pool->stats.frames_resident)
+		blog(LOG_WARNING, "Frame pool: %"PRIu64" frames still in use "
+		                  "on shutdown",
+		                  pool->stats.frames_resident);
+
+	if (pool->stats.misses)
+		blog(LOG_INFO, "Frame pool: %"PRIu64" hits, %"PRIu64" misses, "
+		               "%"PRIu64" evicted",
+		               pool->stats.hits, pool->stats.misses,
+		               pool->stats.evicted);
+
+	da_free(pool->idle_frames);
+	pthread_mutex_destroy(&pool->mutex);
+}
+
+struct obs_source_frame *obs_frame_pool_get(enum video_format format,
+		uint32_t width, uint32_t height)
+{
+	struct obs_frame_pool *pool = &obs->frame_pool;
+	struct pool_frame *pf = NULL;
+
+	pthread_mutex_lock(&pool->mutex);
+
+	/* most recently used first, it's the most likely to still be in
+	 * the CPU cache */
+	for (size_t i = pool->idle_frames.num; i > 0; i--) {
+		struct pool_frame *cur = pool->idle_frames.array[i - 1];
+
+		if (cur->frame.format == format &&
+		    cur->frame.width  == width &&
+		    cur->frame.height == height) {
+			da_erase(pool->idle_frames, i - 1);
+			pf = cur;
+			break;
+		}
+	}
+
+	if (pf) {
+		pool->stats.hits++;
+		pool->stats.frames_idle--;
+		pool->stats.bytes_idle -= pf->size;
+	} else {
+		pool->stats.misses++;
+	}
+
+	pthread_mutex_unlock(&pool->mutex);
+
+	if (!pf) {
+		pf = bzalloc(sizeof(struct pool_frame));
+		obs_source_frame_init(&pf->frame, format, width, height);
+		pf->size = frame_data_size(&pf->frame);
+
+		pthread_mutex_lock(&pool->mutex);
+		pool->stats.frames_resident++;
+		pool->stats.bytes_resident += pf->size;
+		pthread_mutex_unlock(&pool->mutex);
+	}
+
+	pf->frame.refs   = 0;
+	pf->frame.pooled = true;
+	return &pf->frame;
+}
+
+struct obs_source_frame *obs_frame_pool_wrap(
+		const struct obs_source_frame *frame,
+		void (*release)(void *param), void *param)
+{
+	struct pool_frame *pf = bzalloc(sizeof(struct pool_frame));
+
+	pf->frame         = *frame;
+	pf->frame.refs    = 0;
+	pf->frame.pooled  = true;
+	pf->wrapped       = true;
+	pf->release       = release;
+	pf->release_param = param;
+	return &pf->frame;
+}
+
+void obs_frame_pool_release(struct obs_source_frame *frame)
+{
+	struct obs_frame_pool *pool = &obs->frame_pool;
+	struct pool_frame *pf = (struct pool_frame*)frame;
+	uint64_t cur_time;
+
+	if (!frame)
+		return;
+
+	/* frames that didn't come from the pool aren't a pool_frame, and are
+	 * freed like any other frame */
+	if (!frame->pooled) {
+		obs_source_frame_destroy(frame);
+		return;
+	}
+
+	/* wrapped frames go back to their owner, not the pool */
+	if (pf->wrapped) {
+		if (pf->release)
+			pf->release(pf->release_param);
+		bfree(pf);
+		return;
+	}
+
+	cur_time = os_gettime_ns();
+
+	pf->idle_since = cur_time;
+
+	pthread_mutex_lock(&pool->mutex);
+
+	da_push_back(pool->idle_frames, &pf);
+	pool->stats.frames_idle++;
+	pool->stats.bytes_idle += pf->size;
+
+	trim_idle_frames(pool, cur_time);
+
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+void obs_get_frame_pool_stats(struct obs_frame_pool_stats *stats)
+{
+	if (!obs || !obs_ptr_valid(stats, "obs_get_frame_pool_stats"))
+		return;
+
+	pthread_mutex_lock(&obs->frame_pool.mutex);
+	*stats = obs->frame_pool.stats;
+	pthread_mutex_unlock(&obs->frame_pool.mutex);
+}
+
+void obs_set_frame_pool_limit(uint64_t max_idle_bytes)
+{
+	struct obs_frame_pool *pool;
+
+	if (!obs)
+		return;
+
+	pool = &obs->frame_pool;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->stats.bytes_limit = max_idle_bytes;
+	trim_idle_frames(pool, os_gettime_ns());
+	pthread_mutex_unlock(&pool->mutex);
+}
@@ -1249,6 +1249,16 @@ void obs_hotkey_enable_strict_modifiers(bool enable)
 	unlock();
 }
 
+void obs_hotkey_enable_input_events(bool enable)
+{
+	if (!lock())
+		return;
+
+	obs->hotkeys.input_events = enable;
+	obs_hotkeys_platform_wake(&obs->hotkeys);
+	unlock();
+}
+
 struct obs_query_hotkeys_helper {
 	uint32_t modifiers;
 	bool     no_press : 1;
@@ -1296,10 +1306,12 @@ void *obs_hotkey_thread(void *arg)
 
 	const char *hotkey_thread_name =
 		profile_store_name(obs_get_profiler_name_store(),
-				"obs_hotkey_thread(%g"NBSP"ms)", 25.);
-	profile_register_root(hotkey_thread_name, (uint64_t)25000000);
+				"obs_hotkey_thread(%g"NBSP"ms)",
+				(double)OBS_HOTKEY_POLL_MS);
+	profile_register_root(hotkey_thread_name,
+			(uint64_t)OBS_HOTKEY_POLL_MS * 1000000);
 
-	while (os_event_timedwait(obs->hotkeys.stop_event, 25) == ETIMEDOUT) {
+	while (obs_hotkeys_platform_wait(&obs->hotkeys)) {
 		if (!lock())
 			continue;
 
@@ -246,6 +246,10 @@ EXPORT void obs_hotkey_enable_background_press(bool enable);
 
 EXPORT void obs_hotkey_enable_strict_modifiers(bool enable);
 
+/* wakes the hotkey thread on key and button input events instead of polling
+ * key states, where supported (X11 with XInput 2), and polls otherwise */
+EXPORT void obs_hotkey_enable_input_events(bool enable);
+
 /* hotkey callback routing (trigger callbacks through e.g. a UI thread) */
 
 typedef void (*obs_hotkey_callback_router_func)(void *data,
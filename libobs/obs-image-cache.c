@@ -0,0 +1,360 @@
+/******************************************************************************
+    Copyright (C) 2016 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <inttypes.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "obs-internal.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+/*
+ * Global cache of image file textures.  Images are keyed by the path,
+ * modification time and size of their file, so every user of the same file
+ * shares a single texture, and a file that changes on disk no longer matches
+ * its old texture.  Textures no longer in use stay cached and are destroyed
+ * least recently used first once they take up more than the cache's limit,
+ * or as soon as they are idle once a newer version of their file is cached.
+ */
+
+struct cached_image {
+	char            *file;
+	struct obs_image_file_key key;
+	gs_texture_t    *tex;
+	size_t          size;
+	long            refs;
+
+	/* a newer version of the file has been cached */
+	bool            stale;
+};
+
+#define DEFAULT_IMAGE_CACHE_LIMIT (256ULL * 1024ULL * 1024ULL)
+
+#ifdef _WIN32
+bool obs_image_file_get_key(const char *file, struct obs_image_file_key *key)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attribs;
+	wchar_t *wfile = NULL;
+	uint64_t time;
+	bool success;
+
+	if (!file || !*file || !key)
+		return false;
+
+	os_utf8_to_wcs_ptr(file, 0, &wfile);
+	if (!wfile)
+		return false;
+
+	success = !!GetFileAttributesExW(wfile, GetFileExInfoStandard,
+			&attribs);
+	bfree(wfile);
+
+	if (!success)
+		return false;
+
+	/* 100 nanosecond units */
+	time = ((uint64_t)attribs.ftLastWriteTime.dwHighDateTime << 32) |
+		attribs.ftLastWriteTime.dwLowDateTime;
+
+	key->mtime_ns = (int64_t)(time * 100);
+	key->size     = (int64_t)(((uint64_t)attribs.nFileSizeHigh << 32) |
+			attribs.nFileSizeLow);
+	return true;
+}
+#else
+bool obs_image_file_get_key(const char *file, struct obs_image_file_key *key)
+{
+	struct stat stats;
+
+	if (!file || !*file || !key || stat(file, &stats) != 0)
+		return false;
+
+#ifdef __APPLE__
+	key->mtime_ns = (int64_t)stats.st_mtimespec.tv_sec * 1000000000 +
+		stats.st_mtimespec.tv_nsec;
+#else
+	key->mtime_ns = (int64_t)stats.st_mtim.tv_sec * 1000000000 +
+		stats.st_mtim.tv_nsec;
+#endif
+	key->size     = (int64_t)stats.st_size;
+	return true;
+}
+#endif
+
+static struct cached_image *find_image(struct obs_image_cache *cache,
+		const char *file, const struct obs_image_file_key *key)
+{
+	for (size_t i = 0; i < cache->images.num; i++) {
+		struct cached_image *image = cache->images.array[i];
+
+		if (!image->stale &&
+		    image->key.mtime_ns == key->mtime_ns &&
+		    image->key.size  == key->size &&
+		    strcmp(image->file, file) == 0)
+			return image;
+	}
+
+	return NULL;
+}
+
+static struct cached_image *find_texture(struct obs_image_cache *cache,
+		const gs_texture_t *tex)
+{
+	for (size_t i = 0; i < cache->images.num; i++) {
+		struct cached_image *image = cache->images.array[i];
+
+		if (image->tex == tex)
+			return image;
+	}
+
+	return NULL;
+}
+
+static void acquire_image(struct obs_image_cache *cache,
+		struct cached_image *image)
+{
+	if (image->refs++ == 0) {
+		da_erase_item(cache->idle_images, &image);
+		cache->stats.images_idle--;
+		cache->stats.bytes_idle -= image->size;
+	}
+}
+
+/* must be called within the graphics context */
+static void destroy_image(struct obs_image_cache *cache,
+		struct cached_image *image)
+{
+	da_erase_item(cache->images, &image);
+	cache->stats.images_resident--;
+	cache->stats.bytes_resident -= image->size;
+
+	gs_texture_destroy(image->tex);
+	bfree(image->file);
+	bfree(image);
+}
+
+/* destroys idle textures until the cache is within its limit, and any idle
+ * texture of an outdated file.  the oldest idle textures are at the front.
+ * must be called within the graphics context. */
+static void trim_idle_images(struct obs_image_cache *cache)
+{
+	size_t i = 0;
+
+	while (i < cache->idle_images.num) {
+		struct cached_image *image = cache->idle_images.array[i];
+
+		if (!image->stale &&
+		    cache->stats.bytes_idle <= cache->stats.bytes_limit) {
+			i++;
+			continue;
+		}
+
+		da_erase(cache->idle_images, i);
+		cache->stats.images_idle--;
+		cache->stats.bytes_idle -= image->size;
+		cache->stats.evicted++;
+
+		destroy_image(cache, image);
+	}
+}
+
+bool obs_image_cache_init(struct obs_image_cache *cache)
+{
+	pthread_mutex_init_value(&cache->mutex);
+	if (pthread_mutex_init(&cache->mutex, NULL) != 0)
+		return false;
+
+	cache->stats.bytes_limit = DEFAULT_IMAGE_CACHE_LIMIT;
+	return true;
+}
+
+void obs_image_cache_free(struct obs_image_cache *cache)
+{
+	size_t in_use = cache->images.num - cache->idle_images.num;
+
+	if (in_use)
+		blog(LOG_WARNING, "Image cache: %"PRIu64" images still in "
+		                  "use on shutdown", (uint64_t)in_use);
+
+	if (cache->stats.misses)
+		blog(LOG_INFO, "Image cache: %"PRIu64" hits, %"PRIu64" misses, "
+		               "%"PRIu64" evicted",
+		               cache->stats.hits, cache->stats.misses,
+		               cache->stats.evicted);
+
+	obs_enter_graphics();
+
+	for (size_t i = 0; i < cache->images.num; i++) {
+		struct cached_image *image = cache->images.array[i];
+
+		gs_texture_destroy(image->tex);
+		bfree(image->file);
+		bfree(image);
+	}
+
+	obs_leave_graphics();
+
+	da_free(cache->images);
+	da_free(cache->idle_images);
+	pthread_mutex_destroy(&cache->mutex);
+}
+
+gs_texture_t *obs_image_cache_get(const char *file)
+{
+	struct obs_image_cache *cache;
+	struct cached_image *image;
+	struct obs_image_file_key key;
+	gs_texture_t *tex = NULL;
+
+	if (!obs || !obs_image_file_get_key(file, &key))
+		return NULL;
+
+	cache = &obs->image_cache;
+
+	pthread_mutex_lock(&cache->mutex);
+
+	image = find_image(cache, file, &key);
+	if (image) {
+		acquire_image(cache, image);
+		tex = image->tex;
+		cache->stats.hits++;
+	} else {
+		cache->stats.misses++;
+	}
+
+	pthread_mutex_unlock(&cache->mutex);
+	return tex;
+}
+
+gs_texture_t *obs_image_cache_add(const char *file,
+		const struct obs_image_file_key *key, const uint8_t *data,
+		enum gs_color_format format, uint32_t cx, uint32_t cy)
+{
+	struct obs_image_cache *cache;
+	struct cached_image *image;
+	gs_texture_t *tex;
+
+	if (!obs || !obs_ptr_valid(data, "obs_image_cache_add"))
+		return NULL;
+
+	/* files that can't be keyed are not cached */
+	if (!file || !*file || !key)
+		return gs_texture_create(cx, cy, format, 1, &data, 0);
+
+	cache = &obs->image_cache;
+
+	/* another user decoded the same file in the meantime.  textures are
+	 * only added within the graphics context, so no other texture for
+	 * the file can be added until this one is */
+	pthread_mutex_lock(&cache->mutex);
+	image = find_image(cache, file, key);
+	if (image)
+		acquire_image(cache, image);
+	pthread_mutex_unlock(&cache->mutex);
+
+	if (image)
+		return image->tex;
+
+	tex = gs_texture_create(cx, cy, format, 1, &data, 0);
+	if (!tex)
+		return NULL;
+
+	pthread_mutex_lock(&cache->mutex);
+
+	for (size_t i = 0; i < cache->images.num; i++) {
+		struct cached_image *old = cache->images.array[i];
+		if (strcmp(old->file, file) == 0)
+			old->stale = true;
+	}
+
+	image       = bzalloc(sizeof(struct cached_image));
+	image->file = bstrdup(file);
+	image->key  = *key;
+	image->tex  = tex;
+	image->size = (size_t)cx * cy * gs_get_format_bpp(format) / 8;
+	image->refs = 1;
+
+	da_push_back(cache->images, &image);
+	cache->stats.images_resident++;
+	cache->stats.bytes_resident += image->size;
+
+	trim_idle_images(cache);
+
+	pthread_mutex_unlock(&cache->mutex);
+	return tex;
+}
+
+void obs_image_cache_release(gs_texture_t *tex)
+{
+	struct obs_image_cache *cache;
+	struct cached_image *image;
+
+	if (!obs || !tex)
+		return;
+
+	cache = &obs->image_cache;
+
+	pthread_mutex_lock(&cache->mutex);
+
+	image = find_texture(cache, tex);
+	if (image && --image->refs == 0) {
+		da_push_back(cache->idle_images, &image);
+		cache->stats.images_idle++;
+		cache->stats.bytes_idle += image->size;
+
+		trim_idle_images(cache);
+	}
+
+	pthread_mutex_unlock(&cache->mutex);
+
+	/* not cached because its file could not be keyed */
+	if (!image)
+		gs_texture_destroy(tex);
+}
+
+void obs_get_image_cache_stats(struct obs_image_cache_stats *stats)
+{
+	if (!obs || !obs_ptr_valid(stats, "obs_get_image_cache_stats"))
+		return;
+
+	pthread_mutex_lock(&obs->image_cache.mutex);
+	*stats = obs->image_cache.stats;
+	pthread_mutex_unlock(&obs->image_cache.mutex);
+}
+
+void obs_set_image_cache_limit(uint64_t max_idle_bytes)
+{
+	struct obs_image_cache *cache;
+
+	if (!obs)
+		return;
+
+	cache = &obs->image_cache;
+
+	obs_enter_graphics();
+	pthread_mutex_lock(&cache->mutex);
+
+	cache->stats.bytes_limit = max_idle_bytes;
+	trim_idle_images(cache);
+
+	pthread_mutex_unlock(&cache->mutex);
+	obs_leave_graphics();
+}
@@ -24,6 +24,8 @@
 #include "util/threading.h"
 #include "util/platform.h"
 #include "util/profiler.h"
+#include "util/worker-pool.h"
+#include "util/mmap-file.h"
 #include "callback/signal.h"
 #include "callback/proc.h"
 
@@ -36,6 +38,9 @@
 #include "obs.h"
 
 #define NUM_TEXTURES 2
+/* one being staged, one mapped for the current frame, and one that can still
+ * be held by video-io consumers from the previous frame */
+#define NUM_COPY_SURFACES 3
 #define MICROSECOND_DEN 1000000
 
 static inline int64_t packet_dts_usec(struct encoder_packet *packet)
@@ -150,12 +155,23 @@ typedef struct obs_hotkeys_platform obs_hotkeys_platform_t;
 
 void *obs_hotkey_thread(void *param);
 
+#define OBS_HOTKEY_POLL_MS 25
+
 struct obs_core_hotkeys;
 bool obs_hotkeys_platform_init(struct obs_core_hotkeys *hotkeys);
 void obs_hotkeys_platform_free(struct obs_core_hotkeys *hotkeys);
 bool obs_hotkeys_platform_is_pressed(obs_hotkeys_platform_t *context,
 		obs_key_t key);
 
+/* waits until the bindings should be queried again, which is every
+ * OBS_HOTKEY_POLL_MS, or on input events if enabled and supported.  key
+ * states are read once per wait and shared by the is_pressed calls until
+ * the next wait.  returns false once the stop event is signalled */
+bool obs_hotkeys_platform_wait(struct obs_core_hotkeys *hotkeys);
+
+/* wakes the hotkey thread from obs_hotkeys_platform_wait */
+void obs_hotkeys_platform_wake(struct obs_core_hotkeys *hotkeys);
+
 const char *obs_get_hotkey_translation(obs_key_t key, const char *def);
 
 struct obs_context_data;
@@ -219,13 +235,16 @@ struct obs_vframe_info {
 
 struct obs_core_video {
 	graphics_t                      *graphics;
-	gs_stagesurf_t                  *copy_surfaces[NUM_TEXTURES];
+	gs_stagesurf_t                  *copy_surfaces[NUM_COPY_SURFACES];
+	bool                            copy_surfaces_mapped[NUM_COPY_SURFACES];
+	volatile long                   copy_surface_refs[NUM_COPY_SURFACES];
+	int                             staged_surface;
+	int                             download_surface;
 	gs_texture_t                    *render_textures[NUM_TEXTURES];
 	gs_texture_t                    *output_textures[NUM_TEXTURES];
 	gs_texture_t                    *convert_textures[NUM_TEXTURES];
 	bool                            textures_rendered[NUM_TEXTURES];
 	bool                            textures_output[NUM_TEXTURES];
-	bool                            textures_copied[NUM_TEXTURES];
 	bool                            textures_converted[NUM_TEXTURES];
 	struct circlebuf                vframe_info_buffer;
 	gs_effect_t                     *default_effect;
@@ -236,7 +255,6 @@ struct obs_core_video {
 	gs_effect_t                     *bicubic_effect;
 	gs_effect_t                     *lanczos_effect;
 	gs_effect_t                     *bilinear_lowres_effect;
-	gs_stagesurf_t                  *mapped_surface;
 	int                             cur_texture;
 
 	uint64_t                        video_time;
@@ -251,6 +269,10 @@ struct obs_core_video {
 	uint32_t                        plane_sizes[3];
 	uint32_t                        plane_linewidth[3];
 
+	uint32_t                        conversion_threads;
+	worker_pool_t                   *conversion_pool;
+	DARRAY(const char*)             conversion_slice_names;
+
 	uint32_t                        output_width;
 	uint32_t                        output_height;
 	uint32_t                        base_width;
@@ -284,6 +306,12 @@ struct obs_core_data {
 	pthread_mutex_t                 encoders_mutex;
 	pthread_mutex_t                 services_mutex;
 
+	/* volume meters attached to a source, and the copy of the list the
+	 * graphics thread emits the levels from */
+	pthread_mutex_t                 volmeters_mutex;
+	DARRAY(struct obs_volmeter*)    volmeters;
+	DARRAY(struct obs_volmeter*)    volmeters_updating;
+
 	struct obs_view                 main_view;
 
 	volatile long                   active_transitions;
@@ -307,6 +335,7 @@ struct obs_core_hotkeys {
 	bool                            thread_disable_press : 1;
 	bool                            strict_modifiers : 1;
 	bool                            reroute_hotkeys : 1;
+	volatile bool                   input_events;
 	DARRAY(obs_hotkey_binding_t)    bindings;
 
 	obs_hotkey_callback_router_func router_func;
@@ -328,6 +357,57 @@ struct obs_core_hotkeys {
 	char                            *sceneitem_hide;
 };
 
+/* ------------------------------------------------------------------------- */
+/* async source frame pool */
+
+struct pool_frame;
+
+struct obs_frame_pool {
+	pthread_mutex_t                 mutex;
+
+	/* least recently used first */
+	DARRAY(struct pool_frame*)      idle_frames;
+
+	struct obs_frame_pool_stats     stats;
+};
+
+extern bool obs_frame_pool_init(struct obs_frame_pool *pool);
+extern void obs_frame_pool_free(struct obs_frame_pool *pool);
+
+extern struct obs_source_frame *obs_frame_pool_get(enum video_format format,
+		uint32_t width, uint32_t height);
+extern void obs_frame_pool_release(struct obs_source_frame *frame);
+
+/* wraps data owned by a source, 'release' is called instead of returning
+ * the frame to the pool */
+extern struct obs_source_frame *obs_frame_pool_wrap(
+		const struct obs_source_frame *frame,
+		void (*release)(void *param), void *param);
+
+
+/* ------------------------------------------------------------------------- */
+/* image file texture cache */
+
+struct cached_image;
+
+struct obs_image_cache {
+	pthread_mutex_t                 mutex;
+	DARRAY(struct cached_image*)    images;
+
+	/* least recently used first */
+	DARRAY(struct cached_image*)    idle_images;
+
+	struct obs_image_cache_stats    stats;
+};
+
+extern bool obs_image_cache_init(struct obs_image_cache *cache);
+
+/* must be called within the graphics context */
+extern void obs_image_cache_free(struct obs_image_cache *cache);
+
+
+/* ------------------------------------------------------------------------- */
+
 struct obs_core {
 	struct obs_module               *first_module;
 	DARRAY(struct obs_module_path)  module_paths;
@@ -352,15 +432,21 @@ struct obs_core {
 	/* segmented into multiple sub-structures to keep things a bit more
 	 * clean and organized */
 	struct obs_core_video           video;
+	struct obs_image_cache          image_cache;
 	struct obs_core_audio           audio;
 	struct obs_core_data            data;
 	struct obs_core_hotkeys         hotkeys;
+	struct obs_frame_pool           frame_pool;
 };
 
 extern struct obs_core *obs;
 
 extern void *obs_video_thread(void *param);
 
+/* processes the levels of the attached volume meters and emits their
+ * levels_updated signals, called by the graphics thread */
+extern void obs_volmeters_update(void);
+
 
 /* ------------------------------------------------------------------------- */
 /* obs shared context data */
@@ -503,6 +589,7 @@ struct obs_source {
 	audio_line_t                    *audio_line;
 	pthread_mutex_t                 audio_mutex;
 	struct obs_audio_data           audio_data;
+	signal_id_t                     audio_data_signal;
 	size_t                          audio_storage_size;
 	float                           base_volume;
 	float                           user_volume;
@@ -592,8 +679,96 @@ struct delay_data {
 	enum delay_msg msg;
 	uint64_t ts;
 	struct encoder_packet packet;
+
+	/* packet data is in the spill file at this offset */
+	bool spilled;
+	uint64_t spill_offset;
+};
+
+/* ring file that delayed packet data is written to instead of being kept in
+ * memory.  it is only accessed through a write view and a read view of at
+ * most 'window' bytes each, which bounds the memory it takes up.
+ *
+ * the data is copied to and from the file outside of the delay mutex: the
+ * writers hold write_mutex until their packet is queued so that packets are
+ * queued in the order they are placed in the ring, and the readers hold
+ * read_mutex from popping a packet until it is read back.  'mutex' only
+ * guards the ring offsets. */
+struct delay_spill_view {
+	uint8_t                 *data;
+	uint64_t                offset;
+	size_t                  size;
+};
+
+struct delay_spill {
+	os_mmap_file_t          *file;
+	uint64_t                size;
+	size_t                  window;
+
+	pthread_mutex_t         mutex;
+	uint64_t                head;
+	uint64_t                tail;
+	size_t                  num_packets;
+
+	pthread_mutex_t         write_mutex;
+	pthread_mutex_t         read_mutex;
+	struct delay_spill_view write_view;
+	struct delay_spill_view read_view;
+	bool                    warned_full;
+	bool                    warned_oversize;
+};
+
+bool delay_spill_init(struct delay_spill *spill);
+void delay_spill_free(struct delay_spill *spill);
+bool delay_spill_open(struct delay_spill *spill, const char *dir,
+		uint64_t size, size_t window);
+void delay_spill_close(struct delay_spill *spill);
+
+/* called with write_mutex held */
+bool delay_spill_write(struct delay_spill *spill,
+		struct delay_data *dd, struct encoder_packet *packet);
+
+/* called with read_mutex held, in the order the packets were written */
+bool delay_spill_read(struct delay_spill *spill,
+		struct delay_data *dd);
+
+/* packets waiting to be interleaved, in one queue per track (video first,
+ * then the audio tracks).  each track is sorted by dts on its own, so the
+ * interleaved order is just a merge of the track queues by dts, with the
+ * arrival order breaking ties. */
+struct interleaved_packet {
+	struct encoder_packet packet;
+	uint64_t              order;
+};
+
+struct interleave_track {
+	DARRAY(struct interleaved_packet) packets;
+	size_t                            first;
+};
+
+#define INTERLEAVE_TRACKS (MAX_AUDIO_MIXES + 1)
+
+struct interleave_queue {
+	struct interleave_track tracks[INTERLEAVE_TRACKS];
+	size_t                  num_packets;
+	uint64_t                next_order;
 };
 
+void interleave_queue_free(struct interleave_queue *queue);
+void interleave_queue_push(struct interleave_queue *queue,
+		struct encoder_packet *packet);
+bool interleave_queue_pop(struct interleave_queue *queue,
+		struct encoder_packet *packet);
+struct encoder_packet *interleave_queue_peek(
+		struct interleave_queue *queue, size_t idx);
+struct encoder_packet *interleave_queue_track_front(
+		struct interleave_queue *queue, enum obs_encoder_type type,
+		size_t track_idx);
+void interleave_queue_enum(struct interleave_queue *queue,
+		void (*callback)(void *param, struct encoder_packet *packet),
+		void *param);
+void interleave_queue_reset_order(struct interleave_queue *queue);
+
 typedef void (*encoded_callback_t)(void *data, struct encoder_packet *packet);
 
 struct obs_weak_output {
@@ -616,7 +791,10 @@ struct obs_output {
 	int64_t                         highest_audio_ts;
 	int64_t                         highest_video_ts;
 	pthread_mutex_t                 interleaved_mutex;
-	DARRAY(struct encoder_packet)   interleaved_packets;
+	struct interleave_queue         interleaved_packets;
+
+	pthread_mutex_t                 packet_stats_mutex;
+	struct obs_output_packet_stats  packet_stats;
 
 	int                             reconnect_retry_sec;
 	int                             reconnect_retry_max;
@@ -661,6 +839,11 @@ struct obs_output {
 	volatile long                   delay_restart_refs;
 	bool                            delay_active;
 	bool                            delay_capturing;
+
+	char                            *delay_spill_dir;
+	uint64_t                        delay_spill_size;
+	size_t                          delay_spill_window;
+	struct delay_spill              delay_spill;
 };
 
 static inline void do_output_signal(struct obs_output *output,
@@ -674,6 +857,7 @@ static inline void do_output_signal(struct obs_output *output,
 
 extern void process_delay(void *data, struct encoder_packet *packet);
 extern void obs_output_cleanup_delay(obs_output_t *output);
+extern void obs_output_open_delay_spill(obs_output_t *output);
 extern bool obs_output_delay_start(obs_output_t *output);
 extern void obs_output_delay_stop(obs_output_t *output);
 extern bool obs_output_actual_start(obs_output_t *output);
@@ -750,6 +934,10 @@ struct obs_encoder {
 	pthread_mutex_t                 callbacks_mutex;
 	DARRAY(struct encoder_callback) callbacks;
 
+	/* bitrate requested with obs_encoder_set_bitrate, applied between
+	 * frames by the encoder thread.  protected by callbacks_mutex */
+	int                             pending_bitrate;
+
 	const char                      *profile_encoder_encode_name;
 };
 
@@ -19,6 +19,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
 #if defined(__FreeBSD__)
 #include <sys/sysctl.h>
 #endif
@@ -32,6 +34,11 @@
 #include <inttypes.h>
 #include "util/dstr.h"
 #include "obs-internal.h"
+#include "obsconfig.h"
+
+#if HAVE_XINPUT2
+#include <X11/extensions/XInput2.h>
+#endif
 
 const char *get_module_extension(void)
 {
@@ -266,6 +273,22 @@ struct obs_hotkeys_platform {
 	xcb_keysym_t *keysyms;
 	int num_keysyms;
 	int syms_per_code;
+
+	/* key and button states shared by all lookups of a query.  fetched
+	 * at most once per query when polling, or kept up to date from
+	 * XInput2 raw events */
+	uint8_t keys[32];
+	uint16_t buttons;
+	bool keys_valid;
+	bool buttons_valid;
+
+#if HAVE_XINPUT2
+	/* separate connection, only used by the hotkey thread */
+	Display *xi_display;
+	int xi_opcode;
+	bool xi_failed;
+	int wake_fds[2];
+#endif
 };
 
 #define MOUSE_1 (1<<16)
@@ -646,6 +669,205 @@ error1:
 	return error != NULL || reply == NULL;
 }
 
+#if HAVE_XINPUT2
+/*
+ *   In input event mode the hotkey thread selects XInput2 raw key and button
+ * events on the root window of its own connection, which are sent for every
+ * key press and release whichever window has focus, and keeps the key and
+ * button states from them.  The thread then only wakes when a key or button
+ * changes state, and queries no state from the server.
+ */
+
+static void xi_stop(obs_hotkeys_platform_t *context)
+{
+	if (context->xi_display) {
+		XCloseDisplay(context->xi_display);
+		context->xi_display = NULL;
+		context->keys_valid = false;
+		context->buttons_valid = false;
+	}
+}
+
+static bool xi_start(obs_hotkeys_platform_t *context)
+{
+	unsigned char bits[XIMaskLen(XI_LASTEVENT)] = {0};
+	XIEventMask mask;
+	Display *display;
+	int major = 2, minor = 1;
+	int event, error;
+	Window root, child;
+	int root_x, root_y, x, y;
+	unsigned int state;
+
+	if (context->xi_display)
+		return true;
+	if (context->xi_failed)
+		return false;
+
+	display = XOpenDisplay(NULL);
+	if (!display)
+		goto fail;
+
+	if (!XQueryExtension(display, "XInputExtension", &context->xi_opcode,
+				&event, &error) ||
+	    XIQueryVersion(display, &major, &minor) != Success ||
+	    major < 2) {
+		XCloseDisplay(display);
+		goto fail;
+	}
+
+	XISetMask(bits, XI_RawKeyPress);
+	XISetMask(bits, XI_RawKeyRelease);
+	XISetMask(bits, XI_RawButtonPress);
+	XISetMask(bits, XI_RawButtonRelease);
+
+	mask.deviceid = XIAllMasterDevices;
+	mask.mask_len = sizeof(bits);
+	mask.mask     = bits;
+
+	root = DefaultRootWindow(display);
+	XISelectEvents(display, root, &mask, 1);
+
+	/* events from here on are applied on top of the current state */
+	XQueryKeymap(display, (char*)context->keys);
+	XQueryPointer(display, root, &root, &child, &root_x, &root_y, &x, &y,
+			&state);
+
+	context->buttons = (uint16_t)(state & (Button1Mask | Button2Mask |
+				Button3Mask | Button4Mask | Button5Mask));
+	context->keys_valid = true;
+	context->buttons_valid = true;
+	context->xi_display = display;
+
+	blog(LOG_INFO, "Hotkeys: waiting for XInput %d.%d raw input events",
+			major, minor);
+	return true;
+
+fail:
+	blog(LOG_WARNING, "Hotkeys: XInput 2 is not available, "
+	                  "polling key states instead");
+	context->xi_failed = true;
+	return false;
+}
+
+static inline bool set_key(obs_hotkeys_platform_t *context, int code,
+		bool pressed)
+{
+	uint8_t old_keys = context->keys[code / 8];
+	uint8_t bit      = (uint8_t)(1 << (code % 8));
+
+	if (pressed)
+		context->keys[code / 8] |= bit;
+	else
+		context->keys[code / 8] &= (uint8_t)~bit;
+
+	return context->keys[code / 8] != old_keys;
+}
+
+static inline bool set_button(obs_hotkeys_platform_t *context, int button,
+		bool pressed)
+{
+	uint16_t old_buttons = context->buttons;
+	uint16_t bit = (uint16_t)(XCB_BUTTON_MASK_1 << (button - 1));
+
+	if (pressed)
+		context->buttons |= bit;
+	else
+		context->buttons &= (uint16_t)~bit;
+
+	return context->buttons != old_buttons;
+}
+
+/* returns true if any key or button changed state */
+static bool xi_process_events(obs_hotkeys_platform_t *context)
+{
+	Display *display = context->xi_display;
+	bool changed = false;
+
+	while (XPending(display)) {
+		XGenericEventCookie *cookie;
+		XIRawEvent *raw;
+		XEvent event;
+		bool pressed;
+
+		XNextEvent(display, &event);
+
+		cookie = &event.xcookie;
+		if (cookie->type != GenericEvent ||
+		    cookie->extension != context->xi_opcode ||
+		    !XGetEventData(display, cookie))
+			continue;
+
+		raw = cookie->data;
+
+		switch (cookie->evtype) {
+		case XI_RawKeyPress:
+		case XI_RawKeyRelease:
+			pressed = cookie->evtype == XI_RawKeyPress;
+			if (raw->detail > 0 && raw->detail < 256)
+				changed |= set_key(context, raw->detail,
+						pressed);
+			break;
+
+		case XI_RawButtonPress:
+		case XI_RawButtonRelease:
+			pressed = cookie->evtype == XI_RawButtonPress;
+			if (raw->detail >= 1 && raw->detail <= 5)
+				changed |= set_button(context,
+						raw->detail, pressed);
+			break;
+		}
+
+		XFreeEventData(display, cookie);
+	}
+
+	return changed;
+}
+
+static bool xi_wait(struct obs_core_hotkeys *hotkeys)
+{
+	obs_hotkeys_platform_t *context = hotkeys->platform_context;
+	struct pollfd fds[2] = {
+		{ConnectionNumber(context->xi_display), POLLIN, 0},
+		{context->wake_fds[0], POLLIN, 0}
+	};
+	char buf[64];
+
+	for (;;) {
+		bool changed = xi_process_events(context);
+
+		if (os_event_try(hotkeys->stop_event) != EAGAIN)
+			return false;
+		if (changed || !hotkeys->input_events)
+			return true;
+
+		if (poll(fds, 2, -1) < 0 && errno != EINTR) {
+			blog(LOG_WARNING, "Hotkeys: poll failed, "
+			                  "polling key states instead");
+			xi_stop(context);
+			context->xi_failed = true;
+			return true;
+		}
+
+		if (fds[1].revents & POLLIN) {
+			while (read(context->wake_fds[0], buf, sizeof(buf)) > 0);
+		}
+	}
+}
+
+static bool create_wake_pipe(int *fds)
+{
+	if (pipe(fds) != 0) {
+		fds[0] = fds[1] = -1;
+		return false;
+	}
+
+	fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+	fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+	return true;
+}
+#endif
+
 bool obs_hotkeys_platform_init(struct obs_core_hotkeys *hotkeys)
 {
 	Display *display = XOpenDisplay(NULL);
@@ -655,6 +877,11 @@ bool obs_hotkeys_platform_init(struct obs_core_hotkeys *hotkeys)
 	hotkeys->platform_context = bzalloc(sizeof(obs_hotkeys_platform_t));
 	hotkeys->platform_context->display = display;
 
+#if HAVE_XINPUT2
+	if (!create_wake_pipe(hotkeys->platform_context->wake_fds))
+		hotkeys->platform_context->xi_failed = true;
+#endif
+
 	fill_base_keysyms(hotkeys);
 	fill_keycodes(hotkeys);
 	return true;
@@ -667,6 +894,15 @@ void obs_hotkeys_platform_free(struct obs_core_hotkeys *hotkeys)
 	for (size_t i = 0; i < OBS_KEY_LAST_VALUE; i++)
 		da_free(context->keycodes[i].list);
 
+#if HAVE_XINPUT2
+	xi_stop(context);
+
+	if (context->wake_fds[0] != -1) {
+		close(context->wake_fds[0]);
+		close(context->wake_fds[1]);
+	}
+#endif
+
 	XCloseDisplay(context->display);
 	bfree(context->keysyms);
 	bfree(context);
@@ -702,82 +938,139 @@ static inline xcb_window_t root_window(obs_hotkeys_platform_t *context,
 	return 0;
 }
 
-static bool mouse_button_pressed(xcb_connection_t *connection,
-		obs_hotkeys_platform_t *context, obs_key_t key)
+static void query_buttons(obs_hotkeys_platform_t *context)
 {
+	xcb_connection_t *connection = XGetXCBConnection(context->display);
 	xcb_generic_error_t *error = NULL;
 	xcb_query_pointer_cookie_t qpc;
 	xcb_query_pointer_reply_t *reply;
-	bool ret = false;
 
 	qpc = xcb_query_pointer(connection, root_window(context, connection));
 	reply = xcb_query_pointer_reply(connection, qpc, &error);
 
 	if (error) {
 		blog(LOG_WARNING, "xcb_query_pointer_reply failed");
+		context->buttons = 0;
 	} else {
-		uint16_t buttons = reply->mask;
-
-		switch (key) {
-		case OBS_KEY_MOUSE1: ret = buttons & XCB_BUTTON_MASK_1; break;
-		case OBS_KEY_MOUSE2: ret = buttons & XCB_BUTTON_MASK_3; break;
-		case OBS_KEY_MOUSE3: ret = buttons & XCB_BUTTON_MASK_2; break;
-		default:;
-		}
+		context->buttons = reply->mask;
 	}
 
+	context->buttons_valid = true;
+
 	free(reply);
 	free(error);
-	return ret;
 }
 
-static inline bool keycode_pressed(xcb_query_keymap_reply_t *reply,
-		xcb_keycode_t code)
+static void query_keymap(obs_hotkeys_platform_t *context)
 {
-	return (reply->keys[code / 8] & (1 << (code % 8))) != 0;
-}
-
-static bool key_pressed(xcb_connection_t *connection,
-		obs_hotkeys_platform_t *context, obs_key_t key)
-{
-	struct keycode_list *codes = &context->keycodes[key];
+	xcb_connection_t *connection = XGetXCBConnection(context->display);
 	xcb_generic_error_t *error = NULL;
 	xcb_query_keymap_reply_t *reply;
-	bool pressed = false;
 
 	reply = xcb_query_keymap_reply(connection,
 			xcb_query_keymap(connection), &error);
+
 	if (error) {
 		blog(LOG_WARNING, "xcb_query_keymap failed");
-
-	} else if (key == OBS_KEY_META) {
-		pressed = keycode_pressed(reply, context->super_l_code) ||
-		          keycode_pressed(reply, context->super_r_code);
-
+		memset(context->keys, 0, sizeof(context->keys));
 	} else {
-		for (size_t i = 0; i < codes->list.num; i++) {
-			if (keycode_pressed(reply, codes->list.array[i])) {
-				pressed = true;
-				break;
-			}
-		}
+		memcpy(context->keys, reply->keys, sizeof(context->keys));
 	}
 
+	context->keys_valid = true;
+
 	free(reply);
 	free(error);
-	return pressed;
 }
 
-bool obs_hotkeys_platform_is_pressed(obs_hotkeys_platform_t *context,
+static bool mouse_button_pressed(obs_hotkeys_platform_t *context,
 		obs_key_t key)
 {
-	xcb_connection_t *conn = XGetXCBConnection(context->display);
+	uint16_t buttons;
+
+	if (!context->buttons_valid)
+		query_buttons(context);
+
+	buttons = context->buttons;
+
+	switch (key) {
+	case OBS_KEY_MOUSE1: return (buttons & XCB_BUTTON_MASK_1) != 0;
+	case OBS_KEY_MOUSE2: return (buttons & XCB_BUTTON_MASK_3) != 0;
+	case OBS_KEY_MOUSE3: return (buttons & XCB_BUTTON_MASK_2) != 0;
+	default:;
+	}
+
+	return false;
+}
+
+static inline bool keycode_pressed(const uint8_t *keys, xcb_keycode_t code)
+{
+	return (keys[code / 8] & (1 << (code % 8))) != 0;
+}
+
+static bool key_pressed(obs_hotkeys_platform_t *context, obs_key_t key)
+{
+	struct keycode_list *codes = &context->keycodes[key];
+
+	if (!context->keys_valid)
+		query_keymap(context);
+
+	if (key == OBS_KEY_META)
+		return keycode_pressed(context->keys, context->super_l_code) ||
+		       keycode_pressed(context->keys, context->super_r_code);
+
+	for (size_t i = 0; i < codes->list.num; i++) {
+		if (keycode_pressed(context->keys, codes->list.array[i]))
+			return true;
+	}
 
+	return false;
+}
+
+bool obs_hotkeys_platform_is_pressed(obs_hotkeys_platform_t *context,
+		obs_key_t key)
+{
 	if (key >= OBS_KEY_MOUSE1 && key <= OBS_KEY_MOUSE29) {
-		return mouse_button_pressed(conn, context, key);
+		return mouse_button_pressed(context, key);
 	} else {
-		return key_pressed(conn, context, key);
+		return key_pressed(context, key);
+	}
+}
+
+bool obs_hotkeys_platform_wait(struct obs_core_hotkeys *hotkeys)
+{
+	obs_hotkeys_platform_t *context = hotkeys->platform_context;
+
+#if HAVE_XINPUT2
+	if (hotkeys->input_events && xi_start(context))
+		return xi_wait(hotkeys);
+
+	xi_stop(context);
+#endif
+
+	if (os_event_timedwait(hotkeys->stop_event, OBS_HOTKEY_POLL_MS) !=
+			ETIMEDOUT)
+		return false;
+
+	context->keys_valid = false;
+	context->buttons_valid = false;
+	return true;
+}
+
+void obs_hotkeys_platform_wake(struct obs_core_hotkeys *hotkeys)
+{
+#if HAVE_XINPUT2
+	obs_hotkeys_platform_t *context = hotkeys->platform_context;
+	char c = 0;
+
+	/* the pipe is non-blocking; when it is full, a wake is pending */
+	if (context && context->wake_fds[1] != -1) {
+		ssize_t ret = write(context->wake_fds[1], &c, 1);
+		UNUSED_PARAMETER(ret);
 	}
+#else
+	UNUSED_PARAMETER(hotkeys);
+#endif
 }
 
 static bool get_key_translation(struct dstr *dstr, xcb_keycode_t keycode)
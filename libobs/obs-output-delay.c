@@ -25,11 +25,17 @@ static inline void push_packet(struct obs_output *output,
 
 	dd.msg = DELAY_MSG_PACKET;
 	dd.ts  = t;
-	obs_duplicate_encoder_packet(&dd.packet, packet);
+
+	/* the packet is written to the spill file outside of the delay
+	 * mutex, but it has to be queued before the next packet is written */
+	pthread_mutex_lock(&output->delay_spill.write_mutex);
+	if (!delay_spill_write(&output->delay_spill, &dd, packet))
+		obs_encoder_packet_ref(&dd.packet, packet);
 
 	pthread_mutex_lock(&output->delay_mutex);
 	circlebuf_push_back(&output->delay_data, &dd, sizeof(dd));
 	pthread_mutex_unlock(&output->delay_mutex);
+	pthread_mutex_unlock(&output->delay_spill.write_mutex);
 }
 
 static inline void process_delay_data(struct obs_output *output,
@@ -38,7 +44,7 @@ static inline void process_delay_data(struct obs_output *output,
 	switch (dd->msg) {
 	case DELAY_MSG_PACKET:
 		if (!output->delay_active || !output->delay_capturing)
-			obs_free_encoder_packet(&dd->packet);
+			obs_encoder_packet_release(&dd->packet);
 		else
 			output->delay_callback(output, &dd->packet);
 		break;
@@ -58,25 +64,56 @@ void obs_output_cleanup_delay(obs_output_t *output)
 	while (output->delay_data.size) {
 		circlebuf_pop_front(&output->delay_data, &dd, sizeof(dd));
 		if (dd.msg == DELAY_MSG_PACKET) {
-			obs_free_encoder_packet(&dd.packet);
+			obs_encoder_packet_release(&dd.packet);
 		}
 	}
 
+	delay_spill_close(&output->delay_spill);
+
 	output->active_delay_ns = 0;
 	output->delay_restart_refs = 0;
 }
 
+void obs_output_open_delay_spill(obs_output_t *output)
+{
+	if (!output->delay_spill_dir || output->delay_spill.file)
+		return;
+
+	if (delay_spill_open(&output->delay_spill, output->delay_spill_dir,
+				output->delay_spill_size,
+				output->delay_spill_window)) {
+		blog(LOG_INFO, "Output '%s': delayed packets are kept in a "
+		               "spill file in '%s' (%"PRIu64" MB, %"PRIu64
+		               " MB window)",
+		               output->context.name,
+		               output->delay_spill_dir,
+		               output->delay_spill.size / (1024 * 1024),
+		               (uint64_t)output->delay_spill.window /
+		               (1024 * 1024));
+	} else {
+		blog(LOG_WARNING, "Output '%s': failed to create a delay "
+		                  "spill file in '%s', keeping delayed "
+		                  "packets in memory",
+		                  output->context.name,
+		                  output->delay_spill_dir);
+	}
+}
+
 static inline bool pop_packet(struct obs_output *output, uint64_t t)
 {
 	uint64_t elapsed_time;
 	struct delay_data dd;
 	bool popped = false;
+	bool valid = false;
 	bool preserve;
 
 	/* ------------------------------------------------ */
 
 	preserve = (output->delay_cur_flags & OBS_OUTPUT_DELAY_PRESERVE) != 0;
 
+	/* packets have to be read back from the spill file in the order
+	 * they are popped */
+	pthread_mutex_lock(&output->delay_spill.read_mutex);
 	pthread_mutex_lock(&output->delay_mutex);
 
 	if (output->delay_data.size) {
@@ -95,9 +132,14 @@ static inline bool pop_packet(struct obs_output *output, uint64_t t)
 
 	pthread_mutex_unlock(&output->delay_mutex);
 
+	if (popped)
+		valid = delay_spill_read(&output->delay_spill, &dd);
+
+	pthread_mutex_unlock(&output->delay_spill.read_mutex);
+
 	/* ------------------------------------------------ */
 
-	if (popped)
+	if (popped && valid)
 		process_delay_data(output, &dd);
 
 	return popped;
@@ -184,6 +226,18 @@ void obs_output_set_delay(obs_output_t *output, uint32_t delay_sec,
 	output->delay_flags = flags;
 }
 
+void obs_output_set_delay_spill(obs_output_t *output, const char *dir,
+		uint64_t file_size, size_t window)
+{
+	if (!obs_output_valid(output, "obs_output_set_delay_spill"))
+		return;
+
+	bfree(output->delay_spill_dir);
+	output->delay_spill_dir    = dir && *dir ? bstrdup(dir) : NULL;
+	output->delay_spill_size   = file_size;
+	output->delay_spill_window = window;
+}
+
 uint32_t obs_output_get_delay(const obs_output_t *output)
 {
 	return obs_output_valid(output, "obs_output_set_delay") ?
@@ -0,0 +1,201 @@
+/******************************************************************************
+    Copyright (C) 2016 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "obs-internal.h"
+
+/* below this many consumed packets, a track is not compacted yet */
+#define MIN_COMPACT_SIZE 32
+
+static inline struct interleave_track *get_track(
+		struct interleave_queue *queue,
+		const struct encoder_packet *packet)
+{
+	return packet->type == OBS_ENCODER_VIDEO ?
+		&queue->tracks[0] : &queue->tracks[packet->track_idx + 1];
+}
+
+static inline bool comes_before(const struct interleaved_packet *a,
+		const struct interleaved_packet *b)
+{
+	if (a->packet.dts_usec != b->packet.dts_usec)
+		return a->packet.dts_usec < b->packet.dts_usec;
+	return a->order < b->order;
+}
+
+/* returns the track holding the next packet after the given positions, or
+ * INTERLEAVE_TRACKS if there are no more packets */
+static size_t next_track(struct interleave_queue *queue, const size_t *pos)
+{
+	struct interleaved_packet *best = NULL;
+	size_t best_track = INTERLEAVE_TRACKS;
+
+	for (size_t i = 0; i < INTERLEAVE_TRACKS; i++) {
+		struct interleave_track *track = &queue->tracks[i];
+		struct interleaved_packet *cur;
+
+		if (pos[i] >= track->packets.num)
+			continue;
+
+		cur = track->packets.array + pos[i];
+		if (!best || comes_before(cur, best)) {
+			best = cur;
+			best_track = i;
+		}
+	}
+
+	return best_track;
+}
+
+static inline void get_first_positions(struct interleave_queue *queue,
+		size_t *pos)
+{
+	for (size_t i = 0; i < INTERLEAVE_TRACKS; i++)
+		pos[i] = queue->tracks[i].first;
+}
+
+void interleave_queue_free(struct interleave_queue *queue)
+{
+	for (size_t i = 0; i < INTERLEAVE_TRACKS; i++) {
+		struct interleave_track *track = &queue->tracks[i];
+
+		for (size_t j = track->first; j < track->packets.num; j++)
+			obs_encoder_packet_release(
+					&track->packets.array[j].packet);
+
+		da_free(track->packets);
+		track->first = 0;
+	}
+
+	queue->num_packets = 0;
+	queue->next_order  = 0;
+}
+
+void interleave_queue_push(struct interleave_queue *queue,
+		struct encoder_packet *packet)
+{
+	struct interleave_track *track = get_track(queue, packet);
+	struct interleaved_packet new_packet;
+	size_t idx = track->packets.num;
+
+	new_packet.packet = *packet;
+	new_packet.order  = queue->next_order++;
+
+	/* packets of a track normally arrive in dts order, so this only
+	 * ever has to look at the last packet */
+	while (idx > track->first && track->packets.array[idx - 1]
+			.packet.dts_usec > packet->dts_usec)
+		idx--;
+
+	da_insert(track->packets, idx, &new_packet);
+	queue->num_packets++;
+}
+
+static inline void compact_track(struct interleave_track *track)
+{
+	if (track->first == track->packets.num) {
+		da_resize(track->packets, 0);
+		track->first = 0;
+
+	} else if (track->first >= MIN_COMPACT_SIZE &&
+	           track->first * 2 >= track->packets.num) {
+		da_erase_range(track->packets, 0, track->first);
+		track->first = 0;
+	}
+}
+
+bool interleave_queue_pop(struct interleave_queue *queue,
+		struct encoder_packet *packet)
+{
+	struct interleave_track *track;
+	size_t pos[INTERLEAVE_TRACKS];
+	size_t idx;
+
+	get_first_positions(queue, pos);
+	idx = next_track(queue, pos);
+	if (idx == INTERLEAVE_TRACKS)
+		return false;
+
+	track   = &queue->tracks[idx];
+	*packet = track->packets.array[track->first++].packet;
+	compact_track(track);
+
+	queue->num_packets--;
+	return true;
+}
+
+struct encoder_packet *interleave_queue_peek(struct interleave_queue *queue,
+		size_t idx)
+{
+	size_t pos[INTERLEAVE_TRACKS];
+	size_t track;
+
+	if (idx >= queue->num_packets)
+		return NULL;
+
+	get_first_positions(queue, pos);
+
+	for (;;) {
+		track = next_track(queue, pos);
+		if (!idx--)
+			break;
+		pos[track]++;
+	}
+
+	return &queue->tracks[track].packets.array[pos[track]].packet;
+}
+
+struct encoder_packet *interleave_queue_track_front(
+		struct interleave_queue *queue, enum obs_encoder_type type,
+		size_t track_idx)
+{
+	struct interleave_track *track = type == OBS_ENCODER_VIDEO ?
+		&queue->tracks[0] : &queue->tracks[track_idx + 1];
+
+	return track->first < track->packets.num ?
+		&track->packets.array[track->first].packet : NULL;
+}
+
+void interleave_queue_enum(struct interleave_queue *queue,
+		void (*callback)(void *param, struct encoder_packet *packet),
+		void *param)
+{
+	for (size_t i = 0; i < INTERLEAVE_TRACKS; i++) {
+		struct interleave_track *track = &queue->tracks[i];
+
+		for (size_t j = track->first; j < track->packets.num; j++)
+			callback(param, &track->packets.array[j].packet);
+	}
+}
+
+/* numbers the packets in their current interleaved order, so that packets
+ * which end up with the same dts after their timestamps are adjusted stay in
+ * that order */
+void interleave_queue_reset_order(struct interleave_queue *queue)
+{
+	size_t   pos[INTERLEAVE_TRACKS];
+	uint64_t order = 0;
+	size_t   idx;
+
+	get_first_positions(queue, pos);
+
+	while ((idx = next_track(queue, pos)) != INTERLEAVE_TRACKS) {
+		struct interleave_track *track = &queue->tracks[idx];
+		track->packets.array[pos[idx]++].order = order++;
+	}
+
+	queue->next_order = order;
+}
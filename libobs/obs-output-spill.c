@@ -0,0 +1,244 @@
+/******************************************************************************
+    Copyright (C) 2016 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <inttypes.h>
+#include "obs-internal.h"
+
+#define SPILL_ALIGN 16
+
+static inline uint64_t spill_size(size_t size)
+{
+	return ((uint64_t)size + SPILL_ALIGN - 1) & ~(uint64_t)(SPILL_ALIGN - 1);
+}
+
+static void unmap_view(struct delay_spill *spill, struct delay_spill_view *view)
+{
+	if (view->data) {
+		os_mmap_file_unmap(spill->file, view->data, view->size);
+		view->data = NULL;
+	}
+}
+
+/* returns a pointer to the data at 'offset', moving the view there if
+ * the data is not inside of it */
+static uint8_t *get_view_data(struct delay_spill *spill,
+		struct delay_spill_view *view, uint64_t offset, size_t size)
+{
+	size_t   alignment = os_mmap_file_alignment();
+	uint64_t start;
+	size_t   view_size;
+
+	if (view->data && offset >= view->offset &&
+	    offset + size <= view->offset + view->size)
+		return view->data + (offset - view->offset);
+
+	unmap_view(spill, view);
+
+	start = offset / alignment * alignment;
+	view_size = spill->window;
+	if (start + view_size > spill->size)
+		view_size = (size_t)(spill->size - start);
+	if (offset + size > start + view_size)
+		return NULL;
+
+	view->data = os_mmap_file_map(spill->file, start, view_size);
+	if (!view->data)
+		return NULL;
+
+	view->offset = start;
+	view->size   = view_size;
+	return view->data + (offset - start);
+}
+
+bool delay_spill_init(struct delay_spill *spill)
+{
+	memset(spill, 0, sizeof(*spill));
+	pthread_mutex_init_value(&spill->mutex);
+	pthread_mutex_init_value(&spill->write_mutex);
+	pthread_mutex_init_value(&spill->read_mutex);
+
+	if (pthread_mutex_init(&spill->mutex, NULL) != 0)
+		return false;
+	if (pthread_mutex_init(&spill->write_mutex, NULL) != 0)
+		return false;
+	if (pthread_mutex_init(&spill->read_mutex, NULL) != 0)
+		return false;
+	return true;
+}
+
+void delay_spill_free(struct delay_spill *spill)
+{
+	delay_spill_close(spill);
+	pthread_mutex_destroy(&spill->mutex);
+	pthread_mutex_destroy(&spill->write_mutex);
+	pthread_mutex_destroy(&spill->read_mutex);
+}
+
+bool delay_spill_open(struct delay_spill *spill, const char *dir,
+		uint64_t size, size_t window)
+{
+	size_t alignment = os_mmap_file_alignment();
+
+	delay_spill_close(spill);
+
+	/* the window has to hold a whole packet past the aligned start of
+	 * its view */
+	window = (window + alignment - 1) / alignment * alignment;
+	if (window < alignment * 2)
+		window = alignment * 2;
+	if (size < window)
+		size = window;
+
+	spill->file = os_mmap_file_create(dir, size);
+	if (!spill->file)
+		return false;
+
+	spill->size   = size;
+	spill->window = window;
+	return true;
+}
+
+void delay_spill_close(struct delay_spill *spill)
+{
+	if (spill->file) {
+		unmap_view(spill, &spill->write_view);
+		unmap_view(spill, &spill->read_view);
+		os_mmap_file_destroy(spill->file);
+	}
+
+	spill->file            = NULL;
+	spill->size            = 0;
+	spill->window          = 0;
+	spill->head            = 0;
+	spill->tail            = 0;
+	spill->num_packets     = 0;
+	spill->warned_full     = false;
+	spill->warned_oversize = false;
+}
+
+/* finds room for 'size' bytes after the newest packet in the ring */
+static bool alloc_space(struct delay_spill *spill, uint64_t size,
+		uint64_t *offset)
+{
+	bool success = true;
+
+	pthread_mutex_lock(&spill->mutex);
+
+	if (!spill->num_packets)
+		spill->head = spill->tail = 0;
+
+	if (spill->tail >= spill->head) {
+		if (spill->tail + size <= spill->size)
+			*offset = spill->tail;
+		else if (size < spill->head)
+			*offset = 0;
+		else
+			success = false;
+
+	} else if (spill->tail + size < spill->head) {
+		*offset = spill->tail;
+
+	} else {
+		success = false;
+	}
+
+	if (success) {
+		spill->tail = *offset + size;
+		spill->num_packets++;
+	}
+
+	pthread_mutex_unlock(&spill->mutex);
+	return success;
+}
+
+bool delay_spill_write(struct delay_spill *spill, struct delay_data *dd,
+		struct encoder_packet *packet)
+{
+	size_t   alignment = os_mmap_file_alignment();
+	uint64_t prev_tail = spill->tail;
+	uint64_t offset;
+	uint8_t  *data;
+
+	if (!spill->file || !packet->size)
+		return false;
+
+	if (packet->size > spill->window - alignment) {
+		if (!spill->warned_oversize) {
+			blog(LOG_WARNING, "Output delay packet of %"PRIu64
+			                  " bytes is larger than the spill "
+			                  "window, keeping it in memory",
+			                  (uint64_t)packet->size);
+			spill->warned_oversize = true;
+		}
+		return false;
+	}
+
+	if (!alloc_space(spill, spill_size(packet->size), &offset)) {
+		if (!spill->warned_full) {
+			blog(LOG_WARNING, "Output delay spill file is full, "
+			                  "keeping delayed packets in memory");
+			spill->warned_full = true;
+		}
+		return false;
+	}
+
+	data = get_view_data(spill, &spill->write_view, offset, packet->size);
+	if (!data) {
+		/* undo the allocation, it is still the newest one because
+		 * the writers are serialized */
+		pthread_mutex_lock(&spill->mutex);
+		spill->tail = prev_tail;
+		spill->num_packets--;
+		pthread_mutex_unlock(&spill->mutex);
+		return false;
+	}
+
+	memcpy(data, packet->data, packet->size);
+
+	dd->packet       = *packet;
+	dd->packet.data  = NULL;
+	dd->spilled      = true;
+	dd->spill_offset = offset;
+	return true;
+}
+
+bool delay_spill_read(struct delay_spill *spill, struct delay_data *dd)
+{
+	struct encoder_packet packet = dd->packet;
+	bool success = false;
+
+	if (!dd->spilled)
+		return true;
+
+	packet.data = get_view_data(spill, &spill->read_view,
+			dd->spill_offset, packet.size);
+	if (packet.data) {
+		obs_encoder_packet_create_instance(&dd->packet, &packet);
+		success = true;
+	} else {
+		blog(LOG_ERROR, "Failed to map output delay spill file");
+	}
+
+	/* packets are read in the order they were written */
+	pthread_mutex_lock(&spill->mutex);
+	spill->head = dd->spill_offset + spill_size(packet.size);
+	spill->num_packets--;
+	pthread_mutex_unlock(&spill->mutex);
+
+	dd->spilled = false;
+	return success;
+}
@@ -70,10 +70,15 @@ obs_output_t *obs_output_create(const char *id, const char *name,
 
 	output = bzalloc(sizeof(struct obs_output));
 	pthread_mutex_init_value(&output->interleaved_mutex);
+	pthread_mutex_init_value(&output->packet_stats_mutex);
 	pthread_mutex_init_value(&output->delay_mutex);
 
+	if (!delay_spill_init(&output->delay_spill))
+		goto fail;
 	if (pthread_mutex_init(&output->interleaved_mutex, NULL) != 0)
 		goto fail;
+	if (pthread_mutex_init(&output->packet_stats_mutex, NULL) != 0)
+		goto fail;
 	if (pthread_mutex_init(&output->delay_mutex, NULL) != 0)
 		goto fail;
 	if (!init_output_handlers(output, name, settings, hotkey_data))
@@ -124,9 +129,7 @@ fail:
 
 static inline void free_packets(struct obs_output *output)
 {
-	for (size_t i = 0; i < output->interleaved_packets.num; i++)
-		obs_free_encoder_packet(output->interleaved_packets.array+i);
-	da_free(output->interleaved_packets);
+	interleave_queue_free(&output->interleaved_packets);
 }
 
 void obs_output_destroy(obs_output_t *output)
@@ -160,10 +163,13 @@ void obs_output_destroy(obs_output_t *output)
 		}
 
 		pthread_mutex_destroy(&output->interleaved_mutex);
+		pthread_mutex_destroy(&output->packet_stats_mutex);
 		pthread_mutex_destroy(&output->delay_mutex);
+		delay_spill_free(&output->delay_spill);
 		os_event_destroy(output->reconnect_stop_event);
 		obs_context_data_free(&output->context);
 		circlebuf_free(&output->delay_data);
+		bfree(output->delay_spill_dir);
 		if (output->owns_info_id)
 			bfree((void*)output->info.id);
 		bfree(output);
@@ -253,6 +259,20 @@ static void log_frame_info(struct obs_output *output)
 	}
 }
 
+static void log_packet_stats(struct obs_output *output)
+{
+	struct obs_output_packet_stats stats;
+
+	obs_output_get_packet_stats(output, &stats);
+	if (!stats.packets)
+		return;
+
+	blog(LOG_INFO, "Output '%s': Encoded data: %"PRIu64" packets, "
+			"%"PRIu64" bytes, %"PRIu64" bytes copied",
+			output->context.name, stats.packets, stats.bytes,
+			stats.bytes_copied);
+}
+
 void obs_output_actual_stop(obs_output_t *output, bool force)
 {
 	output->stopped = true;
@@ -266,6 +286,8 @@ void obs_output_actual_stop(obs_output_t *output, bool force)
 
 	if (output->video)
 		log_frame_info(output);
+	if ((output->info.flags & OBS_OUTPUT_ENCODED) != 0)
+		log_packet_stats(output);
 
 	if (output->delay_active && (force || !output->delay_restart_refs)) {
 		output->delay_active = false;
@@ -583,6 +605,40 @@ int obs_output_get_total_frames(const obs_output_t *output)
 		output->total_frames : 0;
 }
 
+void obs_output_get_packet_stats(const obs_output_t *output,
+		struct obs_output_packet_stats *stats)
+{
+	if (!stats)
+		return;
+
+	memset(stats, 0, sizeof(*stats));
+	if (!obs_output_valid(output, "obs_output_get_packet_stats"))
+		return;
+
+	pthread_mutex_lock((pthread_mutex_t*)&output->packet_stats_mutex);
+	*stats = output->packet_stats;
+	pthread_mutex_unlock((pthread_mutex_t*)&output->packet_stats_mutex);
+}
+
+void obs_output_add_bytes_copied(obs_output_t *output, size_t bytes)
+{
+	if (!obs_output_valid(output, "obs_output_add_bytes_copied"))
+		return;
+
+	pthread_mutex_lock(&output->packet_stats_mutex);
+	output->packet_stats.bytes_copied += bytes;
+	pthread_mutex_unlock(&output->packet_stats_mutex);
+}
+
+static inline void count_packet(struct obs_output *output,
+		const struct encoder_packet *packet)
+{
+	pthread_mutex_lock(&output->packet_stats_mutex);
+	output->packet_stats.packets++;
+	output->packet_stats.bytes += packet->size;
+	pthread_mutex_unlock(&output->packet_stats_mutex);
+}
+
 void obs_output_set_preferred_size(obs_output_t *output, uint32_t width,
 		uint32_t height)
 {
@@ -848,7 +904,8 @@ static inline bool has_higher_opposing_ts(struct obs_output *output,
 
 static inline void send_interleaved(struct obs_output *output)
 {
-	struct encoder_packet out = output->interleaved_packets.array[0];
+	struct encoder_packet out =
+		*interleave_queue_peek(&output->interleaved_packets, 0);
 
 	/* do not send an interleaved packet if there's no packet of the
 	 * opposing type of a higher timstamp in the interleave buffer.
@@ -859,10 +916,12 @@ static inline void send_interleaved(struct obs_output *output)
 	if (out.type == OBS_ENCODER_VIDEO)
 		output->total_frames++;
 
-	da_erase(output->interleaved_packets, 0);
-	if (!output->stopped)
+	interleave_queue_pop(&output->interleaved_packets, &out);
+	if (!output->stopped) {
+		count_packet(output, &out);
 		output->info.encoded_packet(output->context.data, &out);
-	obs_free_encoder_packet(&out);
+	}
+	obs_encoder_packet_release(&out);
 }
 
 static inline void set_higher_ts(struct obs_output *output,
@@ -877,23 +936,22 @@ static inline void set_higher_ts(struct obs_output *output,
 	}
 }
 
-static bool can_prune_interleaved_packet(struct obs_output *output, size_t idx)
+static bool can_prune_interleaved_packet(struct obs_output *output)
 {
 	struct encoder_packet *packet;
 	struct encoder_packet *next;
 
-	if (idx >= (output->interleaved_packets.num - 1))
+	next = interleave_queue_peek(&output->interleaved_packets, 1);
+	if (!next)
 		return false;
 
-	packet = &output->interleaved_packets.array[idx];
+	packet = interleave_queue_peek(&output->interleaved_packets, 0);
 
 	/* audio packets will almost always come before video packets,
 	 * so it should only ever be necessary to prune audio packets */
 	if (packet->type != OBS_ENCODER_AUDIO)
 		return false;
 
-	next = &output->interleaved_packets.array[idx + 1];
-
 	if (next->type == OBS_ENCODER_VIDEO &&
 	    next->dts_usec == packet->dts_usec)
 		return false;
@@ -903,40 +961,17 @@ static bool can_prune_interleaved_packet(struct obs_output *output, size_t idx)
 
 static void prune_interleaved_packets(struct obs_output *output)
 {
-	size_t start_idx = 0;
-
-	while (can_prune_interleaved_packet(output, start_idx))
-		start_idx++;
+	struct encoder_packet packet;
 
-	if (start_idx) {
-		for (size_t i = 0; i < start_idx; i++) {
-			struct encoder_packet *packet =
-				&output->interleaved_packets.array[i];
-			obs_free_encoder_packet(packet);
-		}
-
-		da_erase_range(output->interleaved_packets, 0, start_idx);
+	while (can_prune_interleaved_packet(output)) {
+		interleave_queue_pop(&output->interleaved_packets, &packet);
+		obs_encoder_packet_release(&packet);
 	}
 }
 
-static struct encoder_packet *find_first_packet_type(struct obs_output *output,
-		enum obs_encoder_type type, size_t audio_idx)
+static void apply_offset_callback(void *param, struct encoder_packet *packet)
 {
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-
-		if (packet->type == type) {
-			if (type == OBS_ENCODER_AUDIO &&
-			    packet->track_idx != audio_idx) {
-				continue;
-			}
-
-			return packet;
-		}
-	}
-
-	return NULL;
+	apply_interleaved_packet_offset(param, packet);
 }
 
 static bool initialize_interleaved_packets(struct obs_output *output)
@@ -945,12 +980,15 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 	struct encoder_packet *audio[MAX_AUDIO_MIXES];
 	size_t audio_mixes = num_audio_mixes(output);
 
-	video = find_first_packet_type(output, OBS_ENCODER_VIDEO, 0);
+	video = interleave_queue_track_front(&output->interleaved_packets,
+			OBS_ENCODER_VIDEO, 0);
 	if (!video)
 		output->received_video = false;
 
 	for (size_t i = 0; i < audio_mixes; i++) {
-		audio[i] = find_first_packet_type(output, OBS_ENCODER_AUDIO, i);
+		audio[i] = interleave_queue_track_front(
+				&output->interleaved_packets,
+				OBS_ENCODER_AUDIO, i);
 		if (!audio[i]) {
 			output->received_audio = false;
 			return false;
@@ -970,45 +1008,15 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 	output->highest_audio_ts -= audio[0]->dts_usec;
 	output->highest_video_ts -= video->dts_usec;
 
-	/* apply new offsets to all existing packet DTS/PTS values */
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		apply_interleaved_packet_offset(output, packet);
-	}
+	/* apply new offsets to all existing packet DTS/PTS values.  packets
+	 * that end up with the same dts keep their current order. */
+	interleave_queue_reset_order(&output->interleaved_packets);
+	interleave_queue_enum(&output->interleaved_packets,
+			apply_offset_callback, output);
 
 	return true;
 }
 
-static inline void insert_interleaved_packet(struct obs_output *output,
-		struct encoder_packet *out)
-{
-	size_t idx;
-	for (idx = 0; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *cur_packet;
-		cur_packet = output->interleaved_packets.array + idx;
-
-		if (out->dts_usec < cur_packet->dts_usec)
-			break;
-	}
-
-	da_insert(output->interleaved_packets, idx, out);
-}
-
-static void resort_interleaved_packets(struct obs_output *output)
-{
-	DARRAY(struct encoder_packet) old_array;
-
-	old_array.da = output->interleaved_packets.da;
-	memset(&output->interleaved_packets, 0,
-			sizeof(output->interleaved_packets));
-
-	for (size_t i = 0; i < old_array.num; i++)
-		insert_interleaved_packet(output, &old_array.array[i]);
-
-	da_free(old_array);
-}
-
 static void interleave_packets(void *data, struct encoder_packet *packet)
 {
 	struct obs_output     *output = data;
@@ -1025,14 +1033,14 @@ static void interleave_packets(void *data, struct encoder_packet *packet)
 	if (output->active_delay_ns)
 		out = *packet;
 	else
-		obs_duplicate_encoder_packet(&out, packet);
+		obs_encoder_packet_ref(&out, packet);
 
 	if (was_started)
 		apply_interleaved_packet_offset(output, &out);
 	else
 		check_received(output, packet);
 
-	insert_interleaved_packet(output, &out);
+	interleave_queue_push(&output->interleaved_packets, &out);
 	set_higher_ts(output, &out);
 
 	/* when both video and audio have been received, we're ready
@@ -1040,10 +1048,8 @@ static void interleave_packets(void *data, struct encoder_packet *packet)
 	if (output->received_audio && output->received_video) {
 		if (!was_started) {
 			prune_interleaved_packets(output);
-			if (initialize_interleaved_packets(output)) {
-				resort_interleaved_packets(output);
+			if (initialize_interleaved_packets(output))
 				send_interleaved(output);
-			}
 		} else {
 			send_interleaved(output);
 		}
@@ -1059,10 +1065,12 @@ static void default_encoded_callback(void *param, struct encoder_packet *packet)
 	if (packet->type == OBS_ENCODER_AUDIO)
 		packet->track_idx = get_track_index(output, packet);
 
-	if (!output->stopped)
+	if (!output->stopped) {
+		count_packet(output, packet);
 		output->info.encoded_packet(output->context.data, packet);
+	}
 	if (output->active_delay_ns)
-		obs_free_encoder_packet(packet);
+		obs_encoder_packet_release(packet);
 
 	if (packet->type == OBS_ENCODER_VIDEO)
 		output->total_frames++;
@@ -1137,6 +1145,8 @@ static void hook_data_capture(struct obs_output *output, bool encoded,
 			encoded_callback = process_delay;
 			output->delay_active = true;
 
+			obs_output_open_delay_spill(output);
+
 			blog(LOG_INFO, "Output '%s': %"PRIu32" second delay "
 			               "active, preserve on disconnect is %s",
 			               output->context.name,
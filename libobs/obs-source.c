@@ -104,8 +104,13 @@ bool obs_source_init_context(struct obs_source *source,
 				hotkey_data))
 		return false;
 
-	return signal_handler_add_array(source->context.signals,
-			source_signals);
+	if (!signal_handler_add_array(source->context.signals, source_signals))
+		return false;
+
+	/* emitted for every audio packet, so signalled by ID */
+	source->audio_data_signal = signal_handler_get_id(
+			source->context.signals, "audio_data");
+	return true;
 }
 
 const char *obs_source_get_display_name(enum obs_source_type type,
@@ -329,11 +334,12 @@ void obs_source_frame_init(struct obs_source_frame *frame,
 static inline void obs_source_frame_decref(struct obs_source_frame *frame)
 {
 	if (os_atomic_dec_long(&frame->refs) == 0)
-		obs_source_frame_destroy(frame);
+		obs_frame_pool_release(frame);
 }
 
 static bool obs_source_filter_remove_refless(obs_source_t *source,
 		obs_source_t *filter);
+static inline void free_async_cache(struct obs_source *source);
 
 void obs_source_destroy(struct obs_source *source)
 {
@@ -366,8 +372,7 @@ void obs_source_destroy(struct obs_source *source)
 	obs_hotkey_unregister(source->push_to_mute_key);
 	obs_hotkey_pair_unregister(source->mute_unmute_key);
 
-	for (i = 0; i < source->async_cache.num; i++)
-		obs_source_frame_decref(source->async_cache.array[i].frame);
+	free_async_cache(source);
 
 	gs_enter_context(obs->video.graphics);
 	if (source->async_convert_texrender)
@@ -882,17 +887,14 @@ static inline void handle_ts_jump(obs_source_t *source, uint64_t expected,
 static void source_signal_audio_data(obs_source_t *source,
 		struct audio_data *in, bool muted)
 {
-	struct calldata data;
+	union call_arg args[3];
 
-	calldata_init(&data);
-
-	calldata_set_ptr(&data, "source", source);
-	calldata_set_ptr(&data, "data",   in);
-	calldata_set_bool(&data, "muted", muted);
+	args[0].ptr = source;
+	args[1].ptr = in;
+	args[2].b   = muted;
 
-	signal_handler_signal(source->context.signals, "audio_data", &data);
-
-	calldata_free(&data);
+	signal_handler_signal_args(source->context.signals,
+			source->audio_data_signal, args);
 }
 
 static inline uint64_t uint64_diff(uint64_t ts1, uint64_t ts2)
@@ -1849,27 +1851,40 @@ static inline bool async_texture_changed(struct obs_source *source,
 	       prev != cur;
 }
 
+/* releases the frames queued for display */
+static inline void flush_async_frames(struct obs_source *source)
+{
+	for (size_t i = 0; i < source->async_frames.num; i++)
+		remove_async_frame(source, source->async_frames.array[i]);
+
+	if (source->cur_async_frame)
+		remove_async_frame(source, source->cur_async_frame);
+
+	da_resize(source->async_frames, 0);
+	source->cur_async_frame = NULL;
+}
+
 static inline void free_async_cache(struct obs_source *source)
 {
+	flush_async_frames(source);
+
 	for (size_t i = 0; i < source->async_cache.num; i++)
 		obs_source_frame_decref(source->async_cache.array[i].frame);
 
 	da_resize(source->async_cache, 0);
-	da_resize(source->async_frames, 0);
-	source->cur_async_frame = NULL;
 }
 
 #define MAX_UNUSED_FRAME_DURATION 5
 
-/* frees frame allocations if they haven't been used for a specific period
- * of time */
+/* returns frames to the frame pool if they haven't been used for a specific
+ * period of time */
 static void clean_cache(obs_source_t *source)
 {
 	for (size_t i = source->async_cache.num; i > 0; i--) {
 		struct async_frame *af = &source->async_cache.array[i - 1];
 		if (!af->used) {
 			if (++af->unused_count == MAX_UNUSED_FRAME_DURATION) {
-				obs_source_frame_destroy(af->frame);
+				obs_frame_pool_release(af->frame);
 				da_erase(source->async_cache, i - 1);
 			}
 		}
@@ -1878,18 +1893,15 @@ static void clean_cache(obs_source_t *source)
 
 #define MAX_ASYNC_FRAMES 30
 
-static inline struct obs_source_frame *cache_video(struct obs_source *source,
+/* call with the async mutex held.  returns false if the frame has to be
+ * dropped because too many frames are queued */
+static inline bool prepare_async_queue(struct obs_source *source,
 		const struct obs_source_frame *frame)
 {
-	struct obs_source_frame *new_frame = NULL;
-
-	pthread_mutex_lock(&source->async_mutex);
-
 	if (source->async_frames.num >= MAX_ASYNC_FRAMES) {
 		free_async_cache(source);
 		source->last_frame_ts = 0;
-		pthread_mutex_unlock(&source->async_mutex);
-		return NULL;
+		return false;
 	}
 
 	if (async_texture_changed(source, frame)) {
@@ -1899,6 +1911,21 @@ static inline struct obs_source_frame *cache_video(struct obs_source *source,
 		source->async_cache_format = frame->format;
 	}
 
+	return true;
+}
+
+static inline struct obs_source_frame *cache_video(struct obs_source *source,
+		const struct obs_source_frame *frame)
+{
+	struct obs_source_frame *new_frame = NULL;
+
+	pthread_mutex_lock(&source->async_mutex);
+
+	if (!prepare_async_queue(source, frame)) {
+		pthread_mutex_unlock(&source->async_mutex);
+		return NULL;
+	}
+
 	for (size_t i = 0; i < source->async_cache.num; i++) {
 		struct async_frame *af = &source->async_cache.array[i];
 		if (!af->used) {
@@ -1914,7 +1941,7 @@ static inline struct obs_source_frame *cache_video(struct obs_source *source,
 	if (!new_frame) {
 		struct async_frame new_af;
 
-		new_frame = obs_source_frame_create(frame->format,
+		new_frame = obs_frame_pool_get(frame->format,
 				frame->width, frame->height);
 		new_af.frame = new_frame;
 		new_af.used = true;
@@ -1931,7 +1958,7 @@ static inline struct obs_source_frame *cache_video(struct obs_source *source,
 	copy_frame_data(new_frame, frame);
 
 	if (os_atomic_dec_long(&new_frame->refs) == 0) {
-		obs_source_frame_destroy(new_frame);
+		obs_frame_pool_release(new_frame);
 		new_frame = NULL;
 	}
 
@@ -1945,6 +1972,10 @@ void obs_source_output_video(obs_source_t *source,
 		return;
 
 	if (!frame) {
+		pthread_mutex_lock(&source->async_mutex);
+		flush_async_frames(source);
+		pthread_mutex_unlock(&source->async_mutex);
+
 		source->async_active = false;
 		return;
 	}
@@ -1962,6 +1993,36 @@ void obs_source_output_video(obs_source_t *source,
 	}
 }
 
+void obs_source_output_video_ref(obs_source_t *source,
+		const struct obs_source_frame *frame,
+		void (*release)(void *param), void *param)
+{
+	struct obs_source_frame *output;
+
+	if (!obs_source_valid(source, "obs_source_output_video_ref") ||
+	    !obs_ptr_valid(frame, "obs_source_output_video_ref")) {
+		if (release)
+			release(param);
+		return;
+	}
+
+	/* the queue holds the only reference until the frame is displayed */
+	output = obs_frame_pool_wrap(frame, release, param);
+	output->refs = 1;
+
+	pthread_mutex_lock(&source->async_mutex);
+
+	if (!prepare_async_queue(source, frame)) {
+		pthread_mutex_unlock(&source->async_mutex);
+		obs_source_frame_decref(output);
+		return;
+	}
+
+	da_push_back(source->async_frames, &output);
+	pthread_mutex_unlock(&source->async_mutex);
+	source->async_active = true;
+}
+
 static inline struct obs_audio_data *filter_async_audio(obs_source_t *source,
 		struct obs_audio_data *in)
 {
@@ -2141,17 +2202,26 @@ static inline bool frame_out_of_bounds(const obs_source_t *source, uint64_t ts)
 		return ((ts - source->last_frame_ts) > MAX_TS_VAR);
 }
 
+/* drops the reference held for display.  cached frames are owned by the
+ * cache and just become available again, frames from
+ * obs_source_output_video_ref aren't in the cache and are released once the
+ * last reference is gone */
 static void remove_async_frame(obs_source_t *source,
 		struct obs_source_frame *frame)
 {
+	if (!frame)
+		return;
+
 	for (size_t i = 0; i < source->async_cache.num; i++) {
 		struct async_frame *f = &source->async_cache.array[i];
 
 		if (f->frame == frame) {
 			f->used = false;
-			break;
+			return;
 		}
 	}
+
+	obs_source_frame_decref(frame);
 }
 
 /* #define DEBUG_ASYNC_FRAMES 1 */
@@ -2297,12 +2367,12 @@ void obs_source_release_frame(obs_source_t *source,
 		return;
 
 	if (!source) {
-		obs_source_frame_destroy(frame);
+		obs_frame_pool_release(frame);
 	} else {
 		pthread_mutex_lock(&source->async_mutex);
 
 		if (os_atomic_dec_long(&frame->refs) == 0)
-			obs_source_frame_destroy(frame);
+			obs_frame_pool_release(frame);
 		else
 			remove_async_frame(source, frame);
 
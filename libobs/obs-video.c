@@ -125,14 +125,37 @@ static inline void set_render_size(uint32_t width, uint32_t height)
 	gs_set_viewport(0, 0, width, height);
 }
 
-static inline void unmap_last_surface(struct obs_core_video *video)
+/* surfaces handed to video-io stay mapped until every consumer has released
+ * them, everything else is unmapped on the next frame like before */
+static inline void unmap_released_surfaces(struct obs_core_video *video)
 {
-	if (video->mapped_surface) {
-		gs_stagesurface_unmap(video->mapped_surface);
-		video->mapped_surface = NULL;
+	for (size_t i = 0; i < NUM_COPY_SURFACES; i++) {
+		if (video->copy_surfaces_mapped[i] &&
+		    video->copy_surface_refs[i] == 0) {
+			gs_stagesurface_unmap(video->copy_surfaces[i]);
+			video->copy_surfaces_mapped[i] = false;
+		}
 	}
 }
 
+static inline bool copy_surface_free(struct obs_core_video *video, int idx)
+{
+	return !video->copy_surfaces_mapped[idx] &&
+		video->copy_surface_refs[idx] == 0 &&
+		idx != video->staged_surface &&
+		idx != video->download_surface;
+}
+
+static inline int find_free_copy_surface(struct obs_core_video *video)
+{
+	for (int i = 0; i < NUM_COPY_SURFACES; i++) {
+		if (copy_surface_free(video, i))
+			return i;
+	}
+
+	return -1;
+}
+
 static const char *render_main_texture_name = "render_main_texture";
 static inline void render_main_texture(struct obs_core_video *video,
 		int cur_texture)
@@ -314,13 +337,13 @@ end:
 
 static const char *stage_output_texture_name = "stage_output_texture";
 static inline void stage_output_texture(struct obs_core_video *video,
-		int cur_texture, int prev_texture)
+		int prev_texture)
 {
 	profile_start(stage_output_texture_name);
 
 	gs_texture_t   *texture;
 	bool        texture_ready;
-	gs_stagesurf_t *copy = video->copy_surfaces[cur_texture];
+	int         copy;
 
 	if (video->gpu_conversion) {
 		texture = video->convert_textures[prev_texture];
@@ -330,14 +353,25 @@ static inline void stage_output_texture(struct obs_core_video *video,
 		texture_ready = video->output_textures[prev_texture];
 	}
 
-	unmap_last_surface(video);
+	unmap_released_surfaces(video);
+
+	/* the surface staged last frame is the one downloaded this frame */
+	video->download_surface = video->staged_surface;
+	video->staged_surface   = -1;
 
 	if (!texture_ready)
 		goto end;
 
-	gs_stage_texture(copy, texture);
+	copy = find_free_copy_surface(video);
+	if (copy == -1) {
+		blog(LOG_WARNING, "stage_output_texture: no free staging "
+		                  "surface");
+		goto end;
+	}
 
-	video->textures_copied[cur_texture] = true;
+	gs_stage_texture(video->copy_surfaces[copy], texture);
+
+	video->staged_surface = copy;
 
 end:
 	profile_end(stage_output_texture_name);
@@ -356,7 +390,7 @@ static inline void render_video(struct obs_core_video *video, int cur_texture,
 	if (video->gpu_conversion)
 		render_convert_texture(video, cur_texture, prev_texture);
 
-	stage_output_texture(video, cur_texture, prev_texture);
+	stage_output_texture(video, prev_texture);
 
 	gs_set_render_target(NULL, NULL);
 	gs_enable_blending(true);
@@ -365,17 +399,21 @@ static inline void render_video(struct obs_core_video *video, int cur_texture,
 }
 
 static inline bool download_frame(struct obs_core_video *video,
-		int prev_texture, struct video_data *frame)
+		struct video_data *frame, int *surface)
 {
-	gs_stagesurf_t *surface = video->copy_surfaces[prev_texture];
+	int idx = video->download_surface;
 
-	if (!video->textures_copied[prev_texture])
+	if (idx == -1)
 		return false;
 
-	if (!gs_stagesurface_map(surface, &frame->data[0], &frame->linesize[0]))
+	video->download_surface = -1;
+
+	if (!gs_stagesurface_map(video->copy_surfaces[idx],
+				&frame->data[0], &frame->linesize[0]))
 		return false;
 
-	video->mapped_surface = surface;
+	video->copy_surfaces_mapped[idx] = true;
+	*surface = idx;
 	return true;
 }
 
@@ -461,24 +499,25 @@ static void set_gpu_converted_data(struct obs_core_video *video,
 
 static void convert_frame(
 		struct video_frame *output, const struct video_data *input,
-		const struct video_output_info *info)
+		const struct video_output_info *info,
+		uint32_t start_y, uint32_t end_y)
 {
 	if (info->format == VIDEO_FORMAT_I420) {
 		compress_uyvx_to_i420(
 				input->data[0], input->linesize[0],
-				0, info->height,
+				start_y, end_y,
 				output->data, output->linesize);
 
 	} else if (info->format == VIDEO_FORMAT_NV12) {
 		compress_uyvx_to_nv12(
 				input->data[0], input->linesize[0],
-				0, info->height,
+				start_y, end_y,
 				output->data, output->linesize);
 
 	} else if (info->format == VIDEO_FORMAT_I444) {
 		convert_uyvx_to_i444(
 				input->data[0], input->linesize[0],
-				0, info->height,
+				start_y, end_y,
 				output->data, output->linesize);
 
 	} else {
@@ -488,16 +527,18 @@ static void convert_frame(
 
 static inline void copy_rgbx_frame(
 		struct video_frame *output, const struct video_data *input,
-		const struct video_output_info *info)
+		const struct video_output_info *info,
+		uint32_t start_y, uint32_t end_y)
 {
-	uint8_t *in_ptr = input->data[0];
-	uint8_t *out_ptr = output->data[0];
+	uint8_t *in_ptr = input->data[0] + start_y * input->linesize[0];
+	uint8_t *out_ptr = output->data[0] + start_y * output->linesize[0];
 
 	/* if the line sizes match, do a single copy */
 	if (input->linesize[0] == output->linesize[0]) {
-		memcpy(out_ptr, in_ptr, input->linesize[0] * info->height);
+		memcpy(out_ptr, in_ptr,
+				input->linesize[0] * (end_y - start_y));
 	} else {
-		for (size_t y = 0; y < info->height; y++) {
+		for (size_t y = start_y; y < end_y; y++) {
 			memcpy(out_ptr, in_ptr, info->width * 4);
 			in_ptr += input->linesize[0];
 			out_ptr += output->linesize[0];
@@ -505,8 +546,139 @@ static inline void copy_rgbx_frame(
 	}
 }
 
+struct convert_slices {
+	struct video_frame             *output;
+	const struct video_data        *input;
+	const struct video_output_info *info;
+	uint32_t                       slice_height;
+	bool                           yuv;
+};
+
+static void convert_slice(void *param, size_t idx)
+{
+	struct convert_slices *slices = param;
+	const char *name = obs->video.conversion_slice_names.array[idx];
+	uint32_t start_y = (uint32_t)idx * slices->slice_height;
+	uint32_t end_y   = start_y + slices->slice_height;
+
+	if (end_y > slices->info->height)
+		end_y = slices->info->height;
+	if (start_y >= end_y)
+		return;
+
+	/* slices run on the conversion worker threads as well as the
+	 * graphics thread */
+	profile_reenable_thread();
+	profile_start(name);
+
+	if (slices->yuv)
+		convert_frame(slices->output, slices->input, slices->info,
+				start_y, end_y);
+	else
+		copy_rgbx_frame(slices->output, slices->input, slices->info,
+				start_y, end_y);
+
+	profile_end(name);
+}
+
+static void convert_frame_slices(struct obs_core_video *video,
+		struct video_frame *output, const struct video_data *input,
+		const struct video_output_info *info)
+{
+	size_t count = video->conversion_slice_names.num;
+	struct convert_slices slices = {
+		.output = output,
+		.input  = input,
+		.info   = info,
+		.yuv    = format_is_yuv(info->format)
+	};
+
+	/* slice boundaries must stay on even lines for 4:2:0 chroma */
+	slices.slice_height = (info->height + (uint32_t)count - 1) /
+		(uint32_t)count;
+	slices.slice_height = (slices.slice_height + 1) & ~1;
+
+	worker_pool_run(video->conversion_pool, convert_slice, &slices, count);
+}
+
+static void release_copy_surface(void *param)
+{
+	os_atomic_dec_long((volatile long*)param);
+}
+
+/* the mapped surface can be handed to video-io as is when its planes can be
+ * described with plain linesizes: GPU converted frames without row padding,
+ * or RGB frames with any row padding */
+static bool get_referenced_frame(struct obs_core_video *video,
+		struct video_data *output, const struct video_data *input,
+		const struct video_output_info *info)
+{
+	memset(output, 0, sizeof(*output));
+
+	if (video->gpu_conversion) {
+		if (input->linesize[0] != video->output_width*4)
+			return false;
+
+		for (size_t i = 0; i < 3; i++) {
+			if (video->plane_linewidth[i] == 0)
+				break;
+
+			output->linesize[i] = video->plane_linewidth[i];
+			output->data[i] =
+				input->data[0] + video->plane_offsets[i];
+		}
+
+	} else if (!format_is_yuv(info->format)) {
+		output->data[0]     = input->data[0];
+		output->linesize[0] = input->linesize[0];
+
+	} else {
+		return false;
+	}
+
+	output->timestamp = input->timestamp;
+	return true;
+}
+
+/* only hand off a surface if another one will still be free for staging the
+ * next frame, so the graphics thread never waits on video-io consumers */
+static inline bool can_reference_surface(struct obs_core_video *video,
+		int surface)
+{
+	for (int i = 0; i < NUM_COPY_SURFACES; i++) {
+		if (i != surface && i != video->staged_surface &&
+		    video->copy_surface_refs[i] == 0)
+			return true;
+	}
+
+	return false;
+}
+
+static bool output_referenced_frame(struct obs_core_video *video,
+		const struct video_data *input_frame, int surface, int count,
+		const struct video_output_info *info)
+{
+	volatile long *refs = &video->copy_surface_refs[surface];
+	struct video_data frame;
+
+	if (!get_referenced_frame(video, &frame, input_frame, info))
+		return false;
+	if (!can_reference_surface(video, surface))
+		return false;
+
+	os_atomic_inc_long(refs);
+
+	/* if the cache is full the frame is dropped just like with
+	 * video_output_lock_frame, so there's nothing left to copy */
+	if (!video_output_ref_frame(video->video, &frame, count,
+				release_copy_surface, (void*)refs))
+		os_atomic_dec_long(refs);
+
+	return true;
+}
+
 static inline void output_video_data(struct obs_core_video *video,
-		struct video_data *input_frame, int count)
+		struct video_data *input_frame, int surface, int count)
 {
 	const struct video_output_info *info;
 	struct video_frame output_frame;
@@ -514,6 +686,9 @@ static inline void output_video_data(struct obs_core_video *video,
 
 	info = video_output_get_info(video->video);
 
+	if (output_referenced_frame(video, input_frame, surface, count, info))
+		return;
+
 	locked = video_output_lock_frame(video->video, &output_frame, count,
 			input_frame->timestamp);
 	if (locked) {
@@ -521,10 +696,9 @@ static inline void output_video_data(struct obs_core_video *video,
 			set_gpu_converted_data(video, &output_frame,
 					input_frame, info);
 
-		} else if (format_is_yuv(info->format)) {
-			convert_frame(&output_frame, input_frame, info);
 		} else {
-			copy_rgbx_frame(&output_frame, input_frame, info);
+			convert_frame_slices(video, &output_frame,
+					input_frame, info);
 		}
 
 		video_output_unlock_frame(video->video);
@@ -558,12 +732,27 @@ static const char *output_frame_render_video_name = "render_video";
 static const char *output_frame_download_frame_name = "download_frame";
 static const char *output_frame_gs_flush_name = "gs_flush";
 static const char *output_frame_output_video_data_name = "output_video_data";
+static const char *draw_calls_name = "draw_calls";
+static const char *upload_bytes_name = "upload_bytes";
+static const char *sprite_uploads_name = "sprite_uploads";
+
+/* records the rendering counters of the whole frame, including the
+ * displays, in the profiler */
+static inline void count_frame_stats(const struct gs_stats *stats)
+{
+	profile_count(draw_calls_name, stats->draw_calls);
+	profile_count(upload_bytes_name, stats->upload_bytes);
+	profile_count(sprite_uploads_name, stats->sprite_uploads);
+}
+
 static inline void output_frame(void)
 {
 	struct obs_core_video *video = &obs->video;
 	int cur_texture  = video->cur_texture;
 	int prev_texture = cur_texture == 0 ? NUM_TEXTURES-1 : cur_texture-1;
 	struct video_data frame;
+	struct gs_stats stats;
+	int surface = -1;
 	bool frame_ready;
 
 	memset(&frame, 0, sizeof(struct video_data));
@@ -576,16 +765,21 @@ static inline void output_frame(void)
 	profile_end(output_frame_render_video_name);
 
 	profile_start(output_frame_download_frame_name);
-	frame_ready = download_frame(video, prev_texture, &frame);
+	frame_ready = download_frame(video, &frame, &surface);
 	profile_end(output_frame_download_frame_name);
 
 	profile_start(output_frame_gs_flush_name);
 	gs_flush();
 	profile_end(output_frame_gs_flush_name);
 
+	gs_get_stats(&stats);
+	gs_reset_stats();
+
 	gs_leave_context();
 	profile_end(output_frame_gs_context_name);
 
+	count_frame_stats(&stats);
+
 	if (frame_ready) {
 		struct obs_vframe_info vframe_info;
 		circlebuf_pop_front(&video->vframe_info_buffer, &vframe_info,
@@ -593,7 +787,7 @@ static inline void output_frame(void)
 
 		frame.timestamp = vframe_info.timestamp;
 		profile_start(output_frame_output_video_data_name);
-		output_video_data(video, &frame, vframe_info.count);
+		output_video_data(video, &frame, surface, vframe_info.count);
 		profile_end(output_frame_output_video_data_name);
 	}
 
@@ -604,6 +798,7 @@ static inline void output_frame(void)
 #define NBSP "\xC2\xA0"
 
 static const char *tick_sources_name = "tick_sources";
+static const char *update_volmeters_name = "update_volmeters";
 static const char *render_displays_name = "render_displays";
 static const char *output_frame_name = "output_frame";
 void *obs_video_thread(void *param)
@@ -627,6 +822,10 @@ void *obs_video_thread(void *param)
 		last_time = tick_sources(obs->video.video_time, last_time);
 		profile_end(tick_sources_name);
 
+		profile_start(update_volmeters_name);
+		obs_volmeters_update();
+		profile_end(update_volmeters_name);
+
 		profile_start(render_displays_name);
 		render_displays();
 		profile_end(render_displays_name);
@@ -380,6 +380,17 @@ void obs_hotkeys_platform_free(struct obs_core_hotkeys *hotkeys)
 	hotkeys->platform_context = NULL;
 }
 
+bool obs_hotkeys_platform_wait(struct obs_core_hotkeys *hotkeys)
+{
+	return os_event_timedwait(hotkeys->stop_event, OBS_HOTKEY_POLL_MS) ==
+		ETIMEDOUT;
+}
+
+void obs_hotkeys_platform_wake(struct obs_core_hotkeys *hotkeys)
+{
+	UNUSED_PARAMETER(hotkeys);
+}
+
 static bool vk_down(DWORD vk)
 {
 	short state = GetAsyncKeyState(vk);
@@ -190,13 +190,18 @@ static bool obs_init_textures(struct obs_video_info *ovi)
 		video->conversion_height : ovi->output_height;
 	size_t i;
 
-	for (i = 0; i < NUM_TEXTURES; i++) {
+	for (i = 0; i < NUM_COPY_SURFACES; i++) {
 		video->copy_surfaces[i] = gs_stagesurface_create(
 				ovi->output_width, output_height, GS_RGBA);
 
 		if (!video->copy_surfaces[i])
 			return false;
+	}
 
+	video->staged_surface   = -1;
+	video->download_surface = -1;
+
+	for (i = 0; i < NUM_TEXTURES; i++) {
 		video->render_textures[i] = gs_texture_create(
 				ovi->base_width, ovi->base_height,
 				GS_RGBA, 1, NULL, GS_RENDER_TARGET);
@@ -215,6 +220,50 @@ static bool obs_init_textures(struct obs_video_info *ovi)
 	return true;
 }
 
+#define MAX_AUTO_CONVERSION_THREADS 4
+#define MAX_CONVERSION_THREADS      32
+
+static void obs_init_conversion_threads(struct obs_video_info *ovi)
+{
+	struct obs_core_video *video = &obs->video;
+	uint32_t threads = ovi->conversion_threads;
+
+	video->conversion_threads = ovi->conversion_threads;
+
+	if (!threads) {
+		threads = (uint32_t)os_get_logical_cores() / 2;
+		if (threads > MAX_AUTO_CONVERSION_THREADS)
+			threads = MAX_AUTO_CONVERSION_THREADS;
+	}
+
+	/* each slice needs at least a pair of lines */
+	if (threads > ovi->output_height / 2)
+		threads = ovi->output_height / 2;
+	if (threads > MAX_CONVERSION_THREADS)
+		threads = MAX_CONVERSION_THREADS;
+	if (!threads)
+		threads = 1;
+
+	/* the graphics thread converts one of the slices itself */
+	if (!video->gpu_conversion && threads > 1)
+		video->conversion_pool = worker_pool_create(
+				"libobs: video conversion thread",
+				threads - 1);
+
+	threads = (uint32_t)worker_pool_num_threads(video->conversion_pool)
+		+ 1;
+
+	for (uint32_t i = 0; i < threads; i++) {
+		const char *name = profile_store_name(
+				obs_get_profiler_name_store(),
+				"convert_frame_slice(%u/%u)", i + 1, threads);
+		da_push_back(video->conversion_slice_names, &name);
+	}
+
+	if (!video->gpu_conversion)
+		blog(LOG_INFO, "CPU video conversion threads: %u", threads);
+}
+
 static int obs_init_graphics(struct obs_video_info *ovi)
 {
 	struct obs_core_video *video = &obs->video;
@@ -354,6 +403,8 @@ static int obs_init_video(struct obs_video_info *ovi)
 
 	gs_leave_context();
 
+	obs_init_conversion_threads(ovi);
+
 	errorcode = pthread_create(&video->video_thread, NULL,
 			obs_video_thread, obs);
 	if (errorcode != 0)
@@ -391,18 +442,25 @@ static void obs_free_video(void)
 
 		gs_enter_context(video->graphics);
 
-		if (video->mapped_surface) {
-			gs_stagesurface_unmap(video->mapped_surface);
-			video->mapped_surface = NULL;
+		/* video_output_close has released every referenced frame */
+		for (size_t i = 0; i < NUM_COPY_SURFACES; i++) {
+			if (video->copy_surfaces_mapped[i])
+				gs_stagesurface_unmap(video->copy_surfaces[i]);
+			gs_stagesurface_destroy(video->copy_surfaces[i]);
+
+			video->copy_surfaces[i]        = NULL;
+			video->copy_surfaces_mapped[i] = false;
+			video->copy_surface_refs[i]    = 0;
 		}
 
+		video->staged_surface   = -1;
+		video->download_surface = -1;
+
 		for (size_t i = 0; i < NUM_TEXTURES; i++) {
-			gs_stagesurface_destroy(video->copy_surfaces[i]);
 			gs_texture_destroy(video->render_textures[i]);
 			gs_texture_destroy(video->convert_textures[i]);
 			gs_texture_destroy(video->output_textures[i]);
 
-			video->copy_surfaces[i]    = NULL;
 			video->render_textures[i]  = NULL;
 			video->convert_textures[i] = NULL;
 			video->output_textures[i]  = NULL;
@@ -412,12 +470,14 @@ static void obs_free_video(void)
 
 		circlebuf_free(&video->vframe_info_buffer);
 
+		worker_pool_destroy(video->conversion_pool);
+		video->conversion_pool = NULL;
+		da_free(video->conversion_slice_names);
+
 		memset(&video->textures_rendered, 0,
 				sizeof(video->textures_rendered));
 		memset(&video->textures_output, 0,
 				sizeof(video->textures_output));
-		memset(&video->textures_copied, 0,
-				sizeof(video->textures_copied));
 		memset(&video->textures_converted, 0,
 				sizeof(video->textures_converted));
 
@@ -504,6 +564,8 @@ static bool obs_init_data(void)
 		goto fail;
 	if (pthread_mutex_init(&data->services_mutex, &attr) != 0)
 		goto fail;
+	if (pthread_mutex_init(&data->volmeters_mutex, &attr) != 0)
+		goto fail;
 	if (!obs_view_init(&data->main_view))
 		goto fail;
 
@@ -567,6 +629,10 @@ static void obs_free_data(void)
 	pthread_mutex_destroy(&data->outputs_mutex);
 	pthread_mutex_destroy(&data->encoders_mutex);
 	pthread_mutex_destroy(&data->services_mutex);
+
+	da_free(data->volmeters);
+	da_free(data->volmeters_updating);
+	pthread_mutex_destroy(&data->volmeters_mutex);
 }
 
 static const char *obs_signals[] = {
@@ -658,6 +724,7 @@ static inline void stop_hotkeys(void)
 
 	if (hotkeys->hotkey_thread_initialized) {
 		os_event_signal(hotkeys->stop_event);
+		obs_hotkeys_platform_wake(hotkeys);
 		pthread_join(hotkeys->hotkey_thread, &thread_ret);
 		hotkeys->hotkey_thread_initialized = false;
 	}
@@ -703,6 +770,10 @@ static bool obs_init(const char *locale, const char *module_config_path,
 
 	if (!obs_init_data())
 		return false;
+	if (!obs_frame_pool_init(&obs->frame_pool))
+		return false;
+	if (!obs_image_cache_init(&obs->image_cache))
+		return false;
 	if (!obs_init_handlers())
 		return false;
 	if (!obs_init_hotkeys())
@@ -780,10 +851,12 @@ void obs_shutdown(void)
 	stop_hotkeys();
 
 	obs_free_data();
+	obs_image_cache_free(&obs->image_cache);
 	obs_free_video();
 	obs_free_hotkeys();
 	obs_free_graphics();
 	obs_free_audio();
+	obs_frame_pool_free(&obs->frame_pool);
 	proc_handler_destroy(obs->procs);
 	signal_handler_destroy(obs->signals);
 
@@ -922,15 +995,19 @@ bool obs_reset_audio(const struct obs_audio_info *oai)
 	ai.format = AUDIO_FORMAT_FLOAT_PLANAR;
 	ai.speakers = oai->speakers;
 	ai.buffer_ms = oai->buffer_ms;
+	ai.frames_per_tick = oai->frames_per_tick ?
+		oai->frames_per_tick : AUDIO_OUTPUT_FRAMES_PER_TICK;
 
 	blog(LOG_INFO, "---------------------------------");
 	blog(LOG_INFO, "audio settings reset:\n"
 	               "\tsamples per sec: %d\n"
 	               "\tspeakers:        %d\n"
-	               "\tbuffering (ms):  %d",
+	               "\tbuffering (ms):  %d\n"
+	               "\tframes per tick: %d",
 	               (int)ai.samples_per_sec,
 	               (int)ai.speakers,
-	               (int)ai.buffer_ms);
+	               (int)ai.buffer_ms,
+	               (int)ai.frames_per_tick);
 
 	return obs_init_audio(&ai);
 }
@@ -952,6 +1029,7 @@ bool obs_get_video_info(struct obs_video_info *ovi)
 	ovi->base_height   = video->base_height;
 	ovi->gpu_conversion= video->gpu_conversion;
 	ovi->scale_type    = video->scale_type;
+	ovi->conversion_threads = video->conversion_threads;
 	ovi->colorspace    = info->colorspace;
 	ovi->range         = info->range;
 	ovi->output_width  = info->width;
@@ -976,6 +1054,7 @@ bool obs_get_audio_info(struct obs_audio_info *oai)
 	oai->samples_per_sec = info->samples_per_sec;
 	oai->speakers = info->speakers;
 	oai->buffer_ms = info->buffer_ms;
+	oai->frames_per_tick = info->frames_per_tick;
 	return true;
 }
 
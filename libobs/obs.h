@@ -172,6 +172,12 @@ struct obs_video_info {
 	enum video_range_type range;       /**< YUV range (if YUV) */
 
 	enum obs_scale_type scale_type;    /**< How to scale if scaling */
+
+	/**
+	 * Number of threads used for CPU color conversion when GPU conversion
+	 * is off or unavailable (0 = automatic)
+	 */
+	uint32_t            conversion_threads;
 };
 
 /**
@@ -181,6 +187,12 @@ struct obs_audio_info {
 	uint32_t            samples_per_sec;
 	enum speaker_layout speakers;
 	uint64_t            buffer_ms;
+
+	/**
+	 * Number of frames mixed at a time (0 = default).  Smaller values
+	 * allow a lower buffering time.
+	 */
+	uint32_t            frames_per_tick;
 };
 
 /**
@@ -233,6 +245,7 @@ struct obs_source_frame {
 
 	/* used internally by libobs */
 	volatile long       refs;
+	bool                pooled;
 };
 
 /* ------------------------------------------------------------------------- */
@@ -915,6 +928,16 @@ EXPORT void obs_source_draw(gs_texture_t *image, int x, int y,
 EXPORT void obs_source_output_video(obs_source_t *source,
 		const struct obs_source_frame *frame);
 
+/**
+ * Outputs asynchronous video data without copying it.  The frame data must
+ * stay valid until 'release' is called with 'param', which happens once the
+ * frame has been uploaded to a texture or dropped.  'release' can be called
+ * from any thread, including from within this function.
+ */
+EXPORT void obs_source_output_video_ref(obs_source_t *source,
+		const struct obs_source_frame *frame,
+		void (*release)(void *param), void *param);
+
 /** Outputs audio data (always asynchronous) */
 EXPORT void obs_source_output_audio(obs_source_t *source,
 		const struct obs_source_audio *audio);
@@ -1164,6 +1187,25 @@ EXPORT void obs_output_stop(obs_output_t *output);
 EXPORT void obs_output_set_delay(obs_output_t *output, uint32_t delay_sec,
 		uint32_t flags);
 
+/**
+ * Keeps the data of delayed packets in a preallocated file instead of in
+ * memory, for long delays at high bitrates.  The file is memory mapped in
+ * views of 'window' bytes, which bounds the memory used by the delay.
+ *
+ * The file is created with a unique name in 'dir' when the delay becomes
+ * active and deleted when it ends.  'file_size' should cover the delay at the
+ * combined bitrate of the encoders; if the file is full, or a packet is larger
+ * than the window, packets are kept in memory.  Like the delay value, this
+ * only takes effect the next time the output is activated.
+ *
+ * @param  dir        Directory to create the file in, or NULL to keep delayed
+ *                    packets in memory
+ * @param  file_size  Size of the file, in bytes
+ * @param  window     Size of the mapped views, in bytes
+ */
+EXPORT void obs_output_set_delay_spill(obs_output_t *output, const char *dir,
+		uint64_t file_size, size_t window);
+
 /** Gets the currently set delay value, in seconds. */
 EXPORT uint32_t obs_output_get_delay(const obs_output_t *output);
 
@@ -1280,6 +1322,26 @@ EXPORT uint64_t obs_output_get_total_bytes(const obs_output_t *output);
 EXPORT int obs_output_get_frames_dropped(const obs_output_t *output);
 EXPORT int obs_output_get_total_frames(const obs_output_t *output);
 
+struct obs_output_packet_stats {
+	uint64_t packets;      /**< Encoded packets given to the output */
+	uint64_t bytes;        /**< Encoded bytes given to the output */
+	uint64_t bytes_copied; /**< Bytes the output had to copy */
+};
+
+/**
+ * Gets the encoded packet statistics of this output.  Encoded packets are
+ * shared between all outputs, so 'bytes_copied' only includes data that the
+ * output itself reported with obs_output_add_bytes_copied.
+ */
+EXPORT void obs_output_get_packet_stats(const obs_output_t *output,
+		struct obs_output_packet_stats *stats);
+
+/**
+ * Reports encoded packet data that had to be copied (for example because it
+ * was transformed) for the packet statistics.  Callable from any thread.
+ */
+EXPORT void obs_output_add_bytes_copied(obs_output_t *output, size_t bytes);
+
 /**
  * Sets the preferred scaled resolution for this output.  Set width and height
  * to 0 to disable scaling.
@@ -1455,6 +1517,14 @@ EXPORT obs_properties_t *obs_encoder_properties(const obs_encoder_t *encoder);
  */
 EXPORT void obs_encoder_update(obs_encoder_t *encoder, obs_data_t *settings);
 
+/**
+ * Changes the bitrate (in kbps) of an active encoder without changing its
+ * settings.  The encoder is reconfigured on its own thread before the next
+ * frame it encodes, and goes back to the configured bitrate when it's
+ * restarted or updated.  Can be called from any thread.
+ */
+EXPORT void obs_encoder_set_bitrate(obs_encoder_t *encoder, int kbps);
+
 /** Gets extra data (headers) associated with this context */
 EXPORT bool obs_encoder_get_extra_data(const obs_encoder_t *encoder,
 		uint8_t **extra_data, size_t *size);
@@ -1487,12 +1557,33 @@ EXPORT void *obs_encoder_get_type_data(obs_encoder_t *encoder);
 
 EXPORT const char *obs_encoder_get_id(const obs_encoder_t *encoder);
 
-/** Duplicates an encoder packet */
+/**
+ * Duplicates an encoder packet into a plain allocation.  Packets duplicated
+ * this way must be freed with obs_free_encoder_packet.
+ */
 EXPORT void obs_duplicate_encoder_packet(struct encoder_packet *dst,
 		const struct encoder_packet *src);
 
 EXPORT void obs_free_encoder_packet(struct encoder_packet *packet);
 
+/**
+ * Copies the data of a packet into a new reference counted packet with a
+ * single reference.  'dst' and 'src' may be the same packet.
+ */
+EXPORT void obs_encoder_packet_create_instance(struct encoder_packet *dst,
+		const struct encoder_packet *src);
+
+/**
+ * Adds a reference to a reference counted packet.  Packets given to the
+ * encoded_packet callback of outputs are reference counted, so outputs can
+ * keep them without copying the data.  The data must not be modified.
+ */
+EXPORT void obs_encoder_packet_ref(struct encoder_packet *dst,
+		struct encoder_packet *src);
+
+/** Releases a reference of a reference counted packet */
+EXPORT void obs_encoder_packet_release(struct encoder_packet *packet);
+
 
 /* ------------------------------------------------------------------------- */
 /* Stream Services */
@@ -1574,6 +1665,99 @@ EXPORT const char *obs_service_get_id(const obs_service_t *service);
 EXPORT void obs_source_frame_init(struct obs_source_frame *frame,
 		enum video_format format, uint32_t width, uint32_t height);
 
+/**
+ * Statistics of the pool that async source frames are allocated from.
+ * Frames a source no longer needs are kept for reuse by any source until the
+ * idle frames exceed the pool limit.
+ */
+struct obs_frame_pool_stats {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evicted;
+
+	/** All frames allocated by the pool, both in use and idle */
+	uint64_t frames_resident;
+	uint64_t bytes_resident;
+
+	uint64_t frames_idle;
+	uint64_t bytes_idle;
+	uint64_t bytes_limit;
+};
+
+EXPORT void obs_get_frame_pool_stats(struct obs_frame_pool_stats *stats);
+
+/** Sets the maximum number of bytes kept in idle frames */
+EXPORT void obs_set_frame_pool_limit(uint64_t max_idle_bytes);
+
+
+/* ------------------------------------------------------------------------- */
+/* Image cache */
+
+/**
+ * Statistics of the cache of image file textures.  Textures are shared by
+ * every user of the same file, and ones no longer used are kept for reuse
+ * until the idle textures exceed the cache limit.
+ */
+struct obs_image_cache_stats {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evicted;
+
+	/** All cached textures, both in use and idle */
+	uint64_t images_resident;
+	uint64_t bytes_resident;
+
+	uint64_t images_idle;
+	uint64_t bytes_idle;
+	uint64_t bytes_limit;
+};
+
+EXPORT void obs_get_image_cache_stats(struct obs_image_cache_stats *stats);
+
+/** Sets the maximum number of bytes kept in idle textures */
+EXPORT void obs_set_image_cache_limit(uint64_t max_idle_bytes);
+
+/** Identifies a version of an image file */
+struct obs_image_file_key {
+	int64_t mtime_ns;
+	int64_t size;
+};
+
+/**
+ * Gets the modification time, in nanoseconds, and the size of an image file.
+ * Returns false if the file could not be found.
+ */
+EXPORT bool obs_image_file_get_key(const char *file,
+		struct obs_image_file_key *key);
+
+/**
+ * Returns a new reference to the cached texture of an image file, or NULL if
+ * the file is not cached.  Cached textures are matched by the path,
+ * modification time and size of the file.  Does not require the graphics
+ * context.
+ */
+EXPORT gs_texture_t *obs_image_cache_get(const char *file);
+
+/**
+ * Creates a texture from the decoded pixels of an image file, caches it, and
+ * returns a reference to it.  If the file was cached in the meantime the
+ * cached texture is returned instead.  Must be called within the graphics
+ * context.
+ *
+ * 'key' has to be taken before the file is decoded, and the file should only
+ * be cached if it was unchanged once decoded.  If 'key' is NULL, the texture
+ * is returned without being cached.
+ */
+EXPORT gs_texture_t *obs_image_cache_add(const char *file,
+		const struct obs_image_file_key *key, const uint8_t *data,
+		enum gs_color_format format, uint32_t cx, uint32_t cy);
+
+/**
+ * Releases a reference to a cached texture.  Must be called within the
+ * graphics context.
+ */
+EXPORT void obs_image_cache_release(gs_texture_t *tex);
+
 static inline void obs_source_frame_free(struct obs_source_frame *frame)
 {
 	if (frame) {
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2014 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "bmem.h"
+#include "dstr.h"
+#include "mmap-file.h"
+
+struct os_mmap_file {
+	int  fd;
+};
+
+static bool preallocate(int fd, uint64_t size)
+{
+#ifndef __APPLE__
+	int ret = posix_fallocate(fd, 0, (off_t)size);
+	if (ret == 0)
+		return true;
+	if (ret != EINVAL && ret != EOPNOTSUPP)
+		return false;
+#endif
+	return ftruncate(fd, (off_t)size) == 0;
+}
+
+os_mmap_file_t *os_mmap_file_create(const char *dir, uint64_t size)
+{
+	struct os_mmap_file *mf;
+	struct dstr path = {0};
+	int fd;
+
+	if (!dir || !*dir || !size)
+		return NULL;
+
+	dstr_copy(&path, dir);
+	dstr_cat(&path, "/obs-mmap-XXXXXX");
+
+	/* mkstemp only ever creates a new file, and the name is removed
+	 * right away, so the file disappears once it's closed, even if the
+	 * process doesn't exit cleanly */
+	fd = mkstemp(path.array);
+	if (fd != -1)
+		unlink(path.array);
+	dstr_free(&path);
+
+	if (fd == -1)
+		return NULL;
+
+	if (!preallocate(fd, size)) {
+		close(fd);
+		return NULL;
+	}
+
+	mf = bzalloc(sizeof(struct os_mmap_file));
+	mf->fd = fd;
+	return mf;
+}
+
+void os_mmap_file_destroy(os_mmap_file_t *mf)
+{
+	if (mf) {
+		close(mf->fd);
+		bfree(mf);
+	}
+}
+
+size_t os_mmap_file_alignment(void)
+{
+	return (size_t)sysconf(_SC_PAGESIZE);
+}
+
+void *os_mmap_file_map(os_mmap_file_t *mf, uint64_t offset, size_t size)
+{
+	void *data;
+
+	if (!mf || !size)
+		return NULL;
+
+	data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, mf->fd,
+			(off_t)offset);
+	return data == MAP_FAILED ? NULL : data;
+}
+
+void os_mmap_file_unmap(os_mmap_file_t *mf, void *data, size_t size)
+{
+	if (mf && data)
+		munmap(data, size);
+}
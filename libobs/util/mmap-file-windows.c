@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2014 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include "platform.h"
+#include "bmem.h"
+#include "dstr.h"
+#include "threading.h"
+#include "mmap-file.h"
+
+struct os_mmap_file {
+	HANDLE file;
+	HANDLE mapping;
+};
+
+#define MAX_CREATE_ATTEMPTS 16
+
+/* CREATE_NEW never opens an existing file, so only a file created here is
+ * ever deleted on close */
+static HANDLE create_unique_file(const char *dir)
+{
+	static volatile long counter = 0;
+	HANDLE file = INVALID_HANDLE_VALUE;
+	struct dstr path = {0};
+
+	for (int i = 0; i < MAX_CREATE_ATTEMPTS; i++) {
+		wchar_t *wpath = NULL;
+
+		dstr_printf(&path, "%s/obs-mmap-%lu-%ld.tmp", dir,
+				(unsigned long)GetCurrentProcessId(),
+				os_atomic_inc_long(&counter));
+
+		os_utf8_to_wcs_ptr(path.array, 0, &wpath);
+		if (!wpath)
+			break;
+
+		file = CreateFileW(wpath, GENERIC_READ | GENERIC_WRITE, 0,
+				NULL, CREATE_NEW,
+				FILE_ATTRIBUTE_TEMPORARY |
+				FILE_FLAG_DELETE_ON_CLOSE, NULL);
+		bfree(wpath);
+
+		if (file != INVALID_HANDLE_VALUE ||
+		    GetLastError() != ERROR_FILE_EXISTS)
+			break;
+	}
+
+	dstr_free(&path);
+	return file;
+}
+
+os_mmap_file_t *os_mmap_file_create(const char *dir, uint64_t size)
+{
+	struct os_mmap_file *mf;
+	HANDLE  file;
+	HANDLE  mapping;
+
+	if (!dir || !*dir || !size)
+		return NULL;
+
+	file = create_unique_file(dir);
+	if (file == INVALID_HANDLE_VALUE)
+		return NULL;
+
+	/* creating the mapping extends the file to the full size */
+	mapping = CreateFileMappingW(file, NULL, PAGE_READWRITE,
+			(DWORD)(size >> 32), (DWORD)(size & 0xFFFFFFFF),
+			NULL);
+	if (!mapping) {
+		CloseHandle(file);
+		return NULL;
+	}
+
+	mf = bzalloc(sizeof(struct os_mmap_file));
+	mf->file = file;
+	mf->mapping = mapping;
+	return mf;
+}
+
+void os_mmap_file_destroy(os_mmap_file_t *mf)
+{
+	if (mf) {
+		CloseHandle(mf->mapping);
+		CloseHandle(mf->file);
+		bfree(mf);
+	}
+}
+
+size_t os_mmap_file_alignment(void)
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (size_t)info.dwAllocationGranularity;
+}
+
+void *os_mmap_file_map(os_mmap_file_t *mf, uint64_t offset, size_t size)
+{
+	if (!mf || !size)
+		return NULL;
+
+	return MapViewOfFile(mf->mapping, FILE_MAP_ALL_ACCESS,
+			(DWORD)(offset >> 32), (DWORD)(offset & 0xFFFFFFFF),
+			size);
+}
+
+void os_mmap_file_unmap(os_mmap_file_t *mf, void *data, size_t size)
+{
+	if (mf && data)
+		UnmapViewOfFile(data);
+
+	UNUSED_PARAMETER(size);
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2014 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "c99defs.h"
+
+/*
+ * Preallocated temporary file that is accessed through memory mapped views,
+ * so that only the parts of the file currently mapped take up memory.  The
+ * file is deleted when it is destroyed.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct os_mmap_file;
+typedef struct os_mmap_file os_mmap_file_t;
+
+/**
+ * Creates a new file with a unique name in the directory 'dir' and
+ * preallocates 'size' bytes.  Existing files are never opened or removed.
+ */
+EXPORT os_mmap_file_t *os_mmap_file_create(const char *dir, uint64_t size);
+EXPORT void os_mmap_file_destroy(os_mmap_file_t *mf);
+
+/** Offsets of views have to be a multiple of this value */
+EXPORT size_t os_mmap_file_alignment(void);
+
+/** Maps a read/write view of part of the file, returns NULL on failure */
+EXPORT void *os_mmap_file_map(os_mmap_file_t *mf, uint64_t offset,
+		size_t size);
+EXPORT void os_mmap_file_unmap(os_mmap_file_t *mf, void *data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
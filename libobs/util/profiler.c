@@ -27,6 +27,7 @@ struct profiler_snapshot_entry {
 	uint64_t min_time_between_calls;
 	uint64_t max_time_between_calls;
 	uint64_t overall_between_calls_count;
+	bool counter;
 	DARRAY(profiler_snapshot_entry_t) children;
 };
 
@@ -44,6 +45,8 @@ struct profile_call {
 	uint64_t overhead_end;
 #endif
 	uint64_t expected_time_between_calls;
+	bool counter;
+	uint64_t value;
 	DARRAY(profile_call) children;
 	profile_call *parent;
 };
@@ -75,6 +78,7 @@ struct profile_entry {
 #endif
 	uint64_t expected_time_between_calls;
 	profile_times_table times_between_calls;
+	bool counter;
 	DARRAY(profile_entry) children;
 };
 
@@ -231,6 +235,14 @@ static profile_entry *get_child(profile_entry *parent, const char *name)
 static void merge_call(profile_entry *entry, profile_call *call,
 		profile_call *prev_call)
 {
+	/* counters keep their values in place of the call times */
+	if (call->counter) {
+		entry->counter = true;
+		migrate_old_entries(&entry->times, true);
+		add_hashmap_entry(&entry->times, call->value, 1);
+		return;
+	}
+
 	const size_t num = call->children.num;
 	for (size_t i = 0; i < num; i++) {
 		profile_call *child = &call->children.array[i];
@@ -443,6 +455,27 @@ void profile_end(const char *name)
 	merge_context(call);
 }
 
+void profile_count(const char *name, uint64_t value)
+{
+	if (!thread_enabled)
+		return;
+
+	profile_call *parent = thread_context;
+	if (!parent) {
+		blog(LOG_ERROR, "Called profile count with no active profile");
+		return;
+	}
+
+	profile_call counter = {
+		.name = name,
+		.counter = true,
+		.value = value,
+		.parent = parent,
+	};
+
+	da_push_back(parent->children, &counter);
+}
+
 static int profiler_time_entry_compare(const void *first, const void *second)
 {
 	int64_t diff = ((profiler_time_entry*)second)->time_delta -
@@ -579,7 +612,14 @@ static void profile_print_entry(profiler_snapshot_entry_t *entry,
 
 	make_indent_string(indent_buffer, indent, active);
 
-	if (min_ == max_) {
+	if (entry->counter) {
+		dstr_printf(output_buffer, "%s%s: min=%"PRIu64", "
+				"median=%"PRIu64", max=%"PRIu64", "
+				"99th percentile=%"PRIu64,
+				indent_buffer->array, entry->name,
+				min_, median, max_, percentile99);
+
+	} else if (min_ == max_) {
 		dstr_printf(output_buffer, "%s%s: %"G_MS,
 				indent_buffer->array, entry->name,
 				min_ / 1000.);
@@ -894,6 +934,7 @@ static void add_entry_to_snapshot(profile_entry *entry,
 		profiler_snapshot_entry_t *s_entry)
 {
 	s_entry->name = entry->name;
+	s_entry->counter = entry->counter;
 
 	s_entry->overall_count = copy_map_to_array(&entry->times,
 			&s_entry->times,
@@ -1130,6 +1171,11 @@ profiler_time_entries_t *profiler_snapshot_entry_times(
 	return entry ? &entry->times : NULL;
 }
 
+bool profiler_snapshot_entry_is_counter(profiler_snapshot_entry_t *entry)
+{
+	return entry ? entry->counter : false;
+}
+
 uint64_t profiler_snapshot_entry_overall_count(
 		profiler_snapshot_entry_t *entry)
 {
@@ -20,6 +20,11 @@ EXPORT void profile_register_root(const char *name,
 EXPORT void profile_start(const char *name);
 EXPORT void profile_end(const char *name);
 
+/** Records a value, such as the number of draw calls, in the currently
+ * active profile.  Counters are printed with their value distribution in
+ * place of call times. */
+EXPORT void profile_count(const char *name, uint64_t value);
+
 EXPORT void profile_reenable_thread(void);
 
 /* ------------------------------------------------------------------------- */
@@ -97,6 +102,9 @@ EXPORT uint64_t profiler_snapshot_entry_min_time(
 		profiler_snapshot_entry_t *entry);
 EXPORT uint64_t profiler_snapshot_entry_max_time(
 		profiler_snapshot_entry_t *entry);
+EXPORT bool profiler_snapshot_entry_is_counter(
+		profiler_snapshot_entry_t *entry);
+
 EXPORT uint64_t profiler_snapshot_entry_overall_count(
 		profiler_snapshot_entry_t *entry);
 
@@ -261,11 +261,21 @@ bool os_atomic_compare_swap_long(volatile long *val, long old_val, long new_val)
 	return __sync_bool_compare_and_swap(val, old_val, new_val);
 }
 
+long os_atomic_load_long(const volatile long *val)
+{
+	return __atomic_load_n(val, __ATOMIC_SEQ_CST);
+}
+
 bool os_atomic_set_bool(volatile bool *ptr, bool val)
 {
 	return __sync_lock_test_and_set(ptr, val);
 }
 
+bool os_atomic_load_bool(const volatile bool *ptr)
+{
+	return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
 void os_set_thread_name(const char *name)
 {
 #if defined(__APPLE__)
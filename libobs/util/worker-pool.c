@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2015 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "base.h"
+#include "bmem.h"
+#include "darray.h"
+#include "threading.h"
+#include "worker-pool.h"
+
+struct worker_pool {
+	DARRAY(pthread_t)  threads;
+	char               *name;
+
+	/* only one run can be in progress at a time */
+	pthread_mutex_t    run_mutex;
+	os_sem_t           *wake_sem;
+	os_event_t         *done_event;
+	volatile bool      stop;
+
+	/* current run */
+	worker_pool_task_t task;
+	void               *param;
+	long               count;
+	volatile long      next_idx;
+
+	/* threads still working on the current run, including the caller */
+	volatile long      active;
+};
+
+static inline void process_tasks(struct worker_pool *pool)
+{
+	long idx;
+
+	while ((idx = os_atomic_inc_long(&pool->next_idx) - 1) < pool->count)
+		pool->task(pool->param, (size_t)idx);
+
+	if (os_atomic_dec_long(&pool->active) == 0)
+		os_event_signal(pool->done_event);
+}
+
+static void *worker_thread(void *data)
+{
+	struct worker_pool *pool = data;
+
+	os_set_thread_name(pool->name);
+
+	for (;;) {
+		if (os_sem_wait(pool->wake_sem) != 0 || pool->stop)
+			break;
+
+		process_tasks(pool);
+	}
+
+	return NULL;
+}
+
+worker_pool_t *worker_pool_create(const char *name, size_t threads)
+{
+	struct worker_pool *pool = bzalloc(sizeof(struct worker_pool));
+
+	pool->name = bstrdup(name ? name : "libobs: worker thread");
+
+	if (pthread_mutex_init(&pool->run_mutex, NULL) != 0)
+		goto fail_mutex;
+	if (os_sem_init(&pool->wake_sem, 0) != 0)
+		goto fail_sem;
+	if (os_event_init(&pool->done_event, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail_event;
+
+	for (size_t i = 0; i < threads; i++) {
+		pthread_t thread;
+
+		if (pthread_create(&thread, NULL, worker_thread, pool) != 0) {
+			blog(LOG_WARNING, "worker_pool_create: failed to "
+					"create thread %u of %u for '%s'",
+					(unsigned)i + 1, (unsigned)threads,
+					pool->name);
+			break;
+		}
+
+		da_push_back(pool->threads, &thread);
+	}
+
+	return pool;
+
+fail_event:
+	os_sem_destroy(pool->wake_sem);
+fail_sem:
+	pthread_mutex_destroy(&pool->run_mutex);
+fail_mutex:
+	bfree(pool->name);
+	bfree(pool);
+	return NULL;
+}
+
+void worker_pool_destroy(worker_pool_t *pool)
+{
+	if (!pool)
+		return;
+
+	pool->stop = true;
+	for (size_t i = 0; i < pool->threads.num; i++)
+		os_sem_post(pool->wake_sem);
+	for (size_t i = 0; i < pool->threads.num; i++)
+		pthread_join(pool->threads.array[i], NULL);
+
+	da_free(pool->threads);
+	os_event_destroy(pool->done_event);
+	os_sem_destroy(pool->wake_sem);
+	pthread_mutex_destroy(&pool->run_mutex);
+	bfree(pool->name);
+	bfree(pool);
+}
+
+size_t worker_pool_num_threads(const worker_pool_t *pool)
+{
+	return pool ? pool->threads.num : 0;
+}
+
+void worker_pool_run(worker_pool_t *pool, worker_pool_task_t task,
+		void *param, size_t count)
+{
+	size_t wake;
+
+	if (!pool || !pool->threads.num || count <= 1) {
+		for (size_t i = 0; i < count; i++)
+			task(param, i);
+		return;
+	}
+
+	wake = count - 1;
+	if (wake > pool->threads.num)
+		wake = pool->threads.num;
+
+	pthread_mutex_lock(&pool->run_mutex);
+
+	pool->task     = task;
+	pool->param    = param;
+	pool->count    = (long)count;
+	pool->next_idx = 0;
+	pool->active   = (long)wake + 1;
+
+	for (size_t i = 0; i < wake; i++)
+		os_sem_post(pool->wake_sem);
+
+	/* every woken thread checks out through 'active' before the run is
+	 * considered done, so no thread can still be looking at this run's
+	 * task when the next run starts */
+	process_tasks(pool);
+	os_event_wait(pool->done_event);
+
+	pthread_mutex_unlock(&pool->run_mutex);
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2015 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "c99defs.h"
+
+/*
+ * Persistent worker thread pool for splitting a piece of work into
+ * independent parts (for example row bands of a frame) and running them in
+ * parallel.  The thread calling worker_pool_run participates in the work,
+ * so a pool created with N threads runs work on up to N+1 threads.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct worker_pool;
+typedef struct worker_pool worker_pool_t;
+
+typedef void (*worker_pool_task_t)(void *param, size_t idx);
+
+EXPORT worker_pool_t *worker_pool_create(const char *name, size_t threads);
+EXPORT void worker_pool_destroy(worker_pool_t *pool);
+
+EXPORT size_t worker_pool_num_threads(const worker_pool_t *pool);
+
+/**
+ * Calls task(param, idx) once for every idx in [0, count), spread over the
+ * pool's threads and the calling thread, and returns when all calls have
+ * completed.  If pool is NULL the tasks are simply run on the calling
+ * thread.
+ */
+EXPORT void worker_pool_run(worker_pool_t *pool, worker_pool_task_t task,
+		void *param, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -24,21 +24,6 @@ void VolControl::OBSVolumeChanged(void *data, calldata_t *calldata)
 	QMetaObject::invokeMethod(volControl, "VolumeChanged");
 }
 
-void VolControl::OBSVolumeLevel(void *data, calldata_t *calldata)
-{
-	VolControl *volControl = static_cast<VolControl*>(data);
-	float peak      = calldata_float(calldata, "level");
-	float mag       = calldata_float(calldata, "magnitude");
-	float peakHold  = calldata_float(calldata, "peak");
-	bool  muted     = calldata_bool (calldata, "muted");
-
-	QMetaObject::invokeMethod(volControl, "VolumeLevel",
-		Q_ARG(float, mag),
-		Q_ARG(float, peak),
-		Q_ARG(float, peakHold),
-		Q_ARG(bool,  muted));
-}
-
 void VolControl::OBSVolumeMuted(void *data, calldata_t *calldata)
 {
 	VolControl *volControl = static_cast<VolControl*>(data);
@@ -68,6 +53,21 @@ void VolControl::VolumeLevel(float mag, float peak, float peakHold, bool muted)
 	volMeter->setLevels(mag, peak, peakHold);
 }
 
+void VolControl::UpdateLevels()
+{
+	float peak, mag, peakHold;
+	bool  muted;
+
+	/* follows the update interval if it's changed after creation */
+	int interval = (int)obs_volmeter_get_update_interval(obs_volmeter);
+	if (levelTimer->interval() != interval)
+		levelTimer->setInterval(interval);
+
+	if (obs_volmeter_get_levels(obs_volmeter, &peak, &mag, &peakHold,
+				&muted))
+		VolumeLevel(mag, peak, peakHold, muted);
+}
+
 void VolControl::VolumeMuted(bool muted)
 {
 	if (mute->isChecked() != muted)
@@ -177,9 +177,6 @@ VolControl::VolControl(OBSSource source_, bool showConfig)
 	signal_handler_connect(obs_fader_get_signal_handler(obs_fader),
 			"volume_changed", OBSVolumeChanged, this);
 
-	signal_handler_connect(obs_volmeter_get_signal_handler(obs_volmeter),
-			"levels_updated", OBSVolumeLevel, this);
-
 	signal_handler_connect(obs_source_get_signal_handler(source),
 			"mute", OBSVolumeMuted, this);
 
@@ -191,6 +188,12 @@ VolControl::VolControl(OBSSource source_, bool showConfig)
 	obs_fader_attach_source(obs_fader, source);
 	obs_volmeter_attach_source(obs_volmeter, source);
 
+	/* the levels are measured by the audio thread, and polled here once
+	 * per update interval of the meter */
+	levelTimer = new QTimer(this);
+	connect(levelTimer, SIGNAL(timeout()), this, SLOT(UpdateLevels()));
+	levelTimer->start(obs_volmeter_get_update_interval(obs_volmeter));
+
 	slider->setStyle(new SliderAbsoluteSetStyle(slider->style()));
 
 	/* Call volume changed once to init the slider position and label */
@@ -199,12 +202,11 @@ VolControl::VolControl(OBSSource source_, bool showConfig)
 
 VolControl::~VolControl()
 {
+	levelTimer->stop();
+
 	signal_handler_disconnect(obs_fader_get_signal_handler(obs_fader),
 			"volume_changed", OBSVolumeChanged, this);
 
-	signal_handler_disconnect(obs_volmeter_get_signal_handler(obs_volmeter),
-			"levels_updated", OBSVolumeLevel, this);
-
 	signal_handler_disconnect(obs_source_get_signal_handler(source),
 			"mute", OBSVolumeMuted, this);
 
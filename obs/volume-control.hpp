@@ -55,9 +55,9 @@ private:
 	float           levelCount;
 	obs_fader_t     *obs_fader;
 	obs_volmeter_t  *obs_volmeter;
+	QTimer          *levelTimer;
 
 	static void OBSVolumeChanged(void *param, calldata_t *calldata);
-	static void OBSVolumeLevel(void *data, calldata_t *calldata);
 	static void OBSVolumeMuted(void *data, calldata_t *calldata);
 
 	void EmitConfigClicked();
@@ -66,6 +66,7 @@ private slots:
 	void VolumeChanged();
 	void VolumeMuted(bool muted);
 	void VolumeLevel(float mag, float peak, float peakHold, bool muted);
+	void UpdateLevels();
 
 	void SetMuted(bool checked);
 	void SliderChanged(int vol);
@@ -6,6 +6,22 @@
 
 using namespace std;
 
+#define DELAY_SPILL_WINDOW (16 * 1024 * 1024)
+
+/* keeps the delayed packets of a long delay in a file in DelaySpillDir
+ * instead of in memory, if a directory is set */
+static void SetDelaySpill(OBSBasic *main, obs_output_t *output, bool useDelay)
+{
+	const char *dir = config_get_string(main->Config(), "Output",
+			"DelaySpillDir");
+	uint64_t sizeMB = config_get_uint(main->Config(), "Output",
+			"DelaySpillMB");
+
+	obs_output_set_delay_spill(output,
+			useDelay && dir && *dir ? dir : nullptr,
+			sizeMB * 1024 * 1024, DELAY_SPILL_WINDOW);
+}
+
 static void OBSStreamStarting(void *data, calldata_t *params)
 {
 	BasicOutputHandler *output = static_cast<BasicOutputHandler*>(data);
@@ -401,6 +417,7 @@ bool SimpleOutput::StartStreaming(obs_service_t *service)
 
 	obs_output_set_delay(streamOutput, useDelay ? delaySec : 0,
 			preserveDelay ? OBS_OUTPUT_DELAY_PRESERVE : 0);
+	SetDelaySpill(main, streamOutput, useDelay);
 
 	obs_output_set_reconnect_settings(streamOutput, maxRetries,
 			retryDelay);
@@ -910,6 +927,7 @@ bool AdvancedOutput::StartStreaming(obs_service_t *service)
 
 	obs_output_set_delay(streamOutput, useDelay ? delaySec : 0,
 			preserveDelay ? OBS_OUTPUT_DELAY_PRESERVE : 0);
+	SetDelaySpill(main, streamOutput, useDelay);
 
 	obs_output_set_reconnect_settings(streamOutput, maxRetries,
 			retryDelay);
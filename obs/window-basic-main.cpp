@@ -682,6 +682,7 @@ bool OBSBasic::InitBasicConfigDefaults()
 	config_set_default_bool  (basicConfig, "Output", "DelayEnable", false);
 	config_set_default_uint  (basicConfig, "Output", "DelaySec", 20);
 	config_set_default_bool  (basicConfig, "Output", "DelayPreserve", true);
+	config_set_default_uint  (basicConfig, "Output", "DelaySpillMB", 1024);
 
 	config_set_default_bool  (basicConfig, "Output", "Reconnect", true);
 	config_set_default_uint  (basicConfig, "Output", "RetryDelay", 10);
@@ -712,11 +713,14 @@ bool OBSBasic::InitBasicConfigDefaults()
 	config_set_default_string(basicConfig, "Video", "ColorSpace", "601");
 	config_set_default_string(basicConfig, "Video", "ColorRange",
 			"Partial");
+	config_set_default_uint  (basicConfig, "Video", "ConversionThreads",
+			0);
 
 	config_set_default_uint  (basicConfig, "Audio", "SampleRate", 44100);
 	config_set_default_string(basicConfig, "Audio", "ChannelSetup",
 			"Stereo");
 	config_set_default_uint  (basicConfig, "Audio", "BufferingTime", 1000);
+	config_set_default_uint  (basicConfig, "Audio", "FramesPerTick", 0);
 
 	return true;
 }
@@ -2150,6 +2154,8 @@ int OBSBasic::ResetVideo()
 	ovi.adapter        = 0;
 	ovi.gpu_conversion = true;
 	ovi.scale_type     = GetScaleType(basicConfig);
+	ovi.conversion_threads = (uint32_t)config_get_uint(basicConfig,
+			"Video", "ConversionThreads");
 
 	ret = AttemptToResetVideo(&ovi);
 	if (IS_WIN32 && ret != OBS_VIDEO_SUCCESS) {
@@ -2187,6 +2193,8 @@ bool OBSBasic::ResetAudio()
 		ai.speakers = SPEAKERS_STEREO;
 
 	ai.buffer_ms = config_get_uint(basicConfig, "Audio", "BufferingTime");
+	ai.frames_per_tick = (uint32_t)config_get_uint(basicConfig, "Audio",
+			"FramesPerTick");
 
 	return obs_reset_audio(&ai);
 }
@@ -0,0 +1,211 @@
+#include <util/threading.h>
+#include <util/platform.h>
+#include "image-loader.h"
+
+struct image_load {
+	volatile long        refs;
+	bool                 done;
+	char                 *file;
+
+	/* the version of the file that was decoded, if it did not change
+	 * while it was decoded */
+	struct obs_image_file_key key;
+	bool                 keyed;
+
+	uint8_t              *data;
+	enum gs_color_format format;
+	uint32_t             cx;
+	uint32_t             cy;
+
+	struct image_load    *next;
+};
+
+struct image_loader {
+	pthread_t            thread;
+	pthread_mutex_t      mutex;
+	os_sem_t             *sem;
+	bool                 active;
+	volatile bool        exit;
+
+	struct image_load    *first;
+	struct image_load    *last;
+};
+
+static struct image_loader loader = {0};
+
+static inline bool same_key(const struct obs_image_file_key *a,
+		const struct obs_image_file_key *b)
+{
+	return a->mtime_ns == b->mtime_ns && a->size == b->size;
+}
+
+static void image_load_decode(struct image_load *load)
+{
+	struct obs_image_file_key key;
+
+	load->keyed = obs_image_file_get_key(load->file, &load->key);
+	load->data = gs_create_texture_file_data(load->file, &load->format,
+			&load->cx, &load->cy);
+
+	/* a file that is written to while it's decoded is not cached, the
+	 * decoded pixels may not match any version of it */
+	if (load->keyed && (!obs_image_file_get_key(load->file, &key) ||
+	                    !same_key(&load->key, &key)))
+		load->keyed = false;
+}
+
+static struct image_load *pop_load(void)
+{
+	struct image_load *load;
+
+	pthread_mutex_lock(&loader.mutex);
+
+	load = loader.first;
+	if (load) {
+		loader.first = load->next;
+		if (!loader.first)
+			loader.last = NULL;
+	}
+
+	pthread_mutex_unlock(&loader.mutex);
+	return load;
+}
+
+static void *image_loader_thread(void *unused)
+{
+	os_set_thread_name("image-source: loader");
+
+	while (os_sem_wait(loader.sem) == 0 && !loader.exit) {
+		struct image_load *load = pop_load();
+		if (!load)
+			continue;
+
+		/* the loader holds the last reference if the request was
+		 * released while it was queued */
+		if (load->refs > 1)
+			image_load_decode(load);
+
+		pthread_mutex_lock(&loader.mutex);
+		load->done = true;
+		pthread_mutex_unlock(&loader.mutex);
+
+		image_load_release(load);
+	}
+
+	UNUSED_PARAMETER(unused);
+	return NULL;
+}
+
+bool image_loader_init(void)
+{
+	pthread_mutex_init_value(&loader.mutex);
+
+	if (pthread_mutex_init(&loader.mutex, NULL) != 0)
+		goto fail_mutex;
+	if (os_sem_init(&loader.sem, 0) != 0)
+		goto fail;
+	if (pthread_create(&loader.thread, NULL, image_loader_thread,
+				NULL) != 0)
+		goto fail;
+
+	loader.active = true;
+	return true;
+
+fail:
+	os_sem_destroy(loader.sem);
+	pthread_mutex_destroy(&loader.mutex);
+	loader.sem = NULL;
+fail_mutex:
+	blog(LOG_WARNING, "[image_source] Failed to start the loader thread, "
+	                  "images will be decoded in place");
+	return false;
+}
+
+void image_loader_free(void)
+{
+	struct image_load *load;
+
+	if (!loader.active)
+		return;
+
+	os_atomic_set_bool(&loader.exit, true);
+	os_sem_post(loader.sem);
+	pthread_join(loader.thread, NULL);
+
+	while ((load = pop_load()) != NULL)
+		image_load_release(load);
+
+	os_sem_destroy(loader.sem);
+	pthread_mutex_destroy(&loader.mutex);
+	memset(&loader, 0, sizeof(loader));
+}
+
+struct image_load *image_load_queue(const char *file)
+{
+	struct image_load *load = bzalloc(sizeof(struct image_load));
+	load->file = bstrdup(file);
+	load->refs = 1;
+
+	if (!loader.active) {
+		image_load_decode(load);
+		load->done = true;
+		return load;
+	}
+
+	os_atomic_inc_long(&load->refs);
+
+	pthread_mutex_lock(&loader.mutex);
+	if (loader.last)
+		loader.last->next = load;
+	else
+		loader.first = load;
+	loader.last = load;
+	pthread_mutex_unlock(&loader.mutex);
+
+	os_sem_post(loader.sem);
+	return load;
+}
+
+void image_load_release(struct image_load *load)
+{
+	if (load && os_atomic_dec_long(&load->refs) == 0) {
+		bfree(load->data);
+		bfree(load->file);
+		bfree(load);
+	}
+}
+
+bool image_load_done(struct image_load *load)
+{
+	bool done;
+
+	if (!loader.active)
+		return load->done;
+
+	pthread_mutex_lock(&loader.mutex);
+	done = load->done;
+	pthread_mutex_unlock(&loader.mutex);
+
+	return done;
+}
+
+gs_texture_t *image_load_create_texture(struct image_load *load)
+{
+	gs_texture_t *tex = NULL;
+
+	if (load->data) {
+		tex = obs_image_cache_add(load->file,
+				load->keyed ? &load->key : NULL, load->data,
+				load->format, load->cx, load->cy);
+
+		bfree(load->data);
+		load->data = NULL;
+	}
+
+	return tex;
+}
+
+const char *image_load_get_file(const struct image_load *load)
+{
+	return load->file;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <obs-module.h>
+
+/*
+ * Decodes image files on a background thread, so that the graphics context
+ * is only entered to upload the decoded pixels rather than for the whole
+ * decode.  Requests are decoded one at a time in the order they are queued;
+ * a request released before it is decoded is skipped.
+ */
+
+struct image_load;
+
+extern bool image_loader_init(void);
+extern void image_loader_free(void);
+
+/**
+ * Queues a file for decoding and returns a reference to the request, which
+ * must be released with image_load_release.  Decodes on the calling thread
+ * if the loader is not running.
+ */
+extern struct image_load *image_load_queue(const char *file);
+extern void image_load_release(struct image_load *load);
+
+/** Returns true once the file has been decoded, successfully or not */
+extern bool image_load_done(struct image_load *load);
+
+/**
+ * Adds the decoded pixels to the image cache, frees them, and returns a
+ * reference to the cached texture (release with obs_image_cache_release).
+ * Must be called within the graphics context once the request is done.
+ * Returns NULL if the file could not be decoded.
+ */
+extern gs_texture_t *image_load_create_texture(struct image_load *load);
+
+extern const char *image_load_get_file(const struct image_load *load);
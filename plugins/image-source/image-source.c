@@ -1,6 +1,8 @@
 #include <obs-module.h>
 #include <util/platform.h>
+#include <util/threading.h>
 #include <sys/stat.h>
+#include "image-loader.h"
 
 #define blog(log_level, format, ...) \
 	blog(log_level, "[image_source: '%s'] " format, \
@@ -24,6 +26,10 @@ struct image_source {
 	gs_texture_t *tex;
 	uint32_t     cx;
 	uint32_t     cy;
+
+	/* pending decode, the current texture is kept until it is done */
+	pthread_mutex_t   load_mutex;
+	struct image_load *load;
 };
 
 
@@ -40,44 +46,92 @@ static const char *image_source_get_name(void *unused)
 	return obs_module_text("ImageInput");
 }
 
+static void image_source_cancel_load(struct image_source *context)
+{
+	struct image_load *load;
+
+	pthread_mutex_lock(&context->load_mutex);
+	load = context->load;
+	context->load = NULL;
+	pthread_mutex_unlock(&context->load_mutex);
+
+	image_load_release(load);
+}
+
+/* must be called within the graphics context */
+static void image_source_set_texture(struct image_source *context,
+		gs_texture_t *tex)
+{
+	obs_image_cache_release(context->tex);
+	context->tex = tex;
+
+	if (tex) {
+		context->cx = gs_texture_get_width(tex);
+		context->cy = gs_texture_get_height(tex);
+	}
+}
+
+static void image_source_unload(struct image_source *context)
+{
+	image_source_cancel_load(context);
+
+	obs_enter_graphics();
+	image_source_set_texture(context, NULL);
+	obs_leave_graphics();
+}
+
 static void image_source_load(struct image_source *context)
 {
 	char *file = context->file;
+	struct image_load *load;
+	gs_texture_t *tex;
 
-	obs_enter_graphics();
+	if (!file || !*file) {
+		image_source_unload(context);
+		return;
+	}
 
-	if (context->tex)
-		gs_texture_destroy(context->tex);
-	context->tex = NULL;
-
-	if (file && *file) {
-		debug("loading texture '%s'", file);
-		context->file_timestamp = get_modified_timestamp(file);
-		context->tex = gs_texture_create_from_file(file);
-		context->update_time_elapsed = 0;
-
-		if (context->tex) {
-			context->cx = gs_texture_get_width(context->tex);
-			context->cy = gs_texture_get_height(context->tex);
-		} else {
-			warn("failed to load texture '%s'", file);
-			context->cx = 0;
-			context->cy = 0;
-		}
+	context->file_timestamp = get_modified_timestamp(file);
+	context->update_time_elapsed = 0;
+
+	/* images already used by any source are shared */
+	tex = obs_image_cache_get(file);
+	if (tex) {
+		image_source_cancel_load(context);
+
+		obs_enter_graphics();
+		image_source_set_texture(context, tex);
+		obs_leave_graphics();
+		return;
 	}
 
-	obs_leave_graphics();
+	debug("loading texture '%s'", file);
+	load = image_load_queue(file);
+
+	pthread_mutex_lock(&context->load_mutex);
+	image_load_release(context->load);
+	context->load = load;
+	pthread_mutex_unlock(&context->load_mutex);
 }
 
-static void image_source_unload(struct image_source *context)
+/* uploads the decoded image, only this needs the graphics context */
+static void image_source_upload(struct image_source *context,
+		struct image_load *load)
 {
+	gs_texture_t *tex;
+
 	obs_enter_graphics();
+	tex = image_load_create_texture(load);
+	image_source_set_texture(context, tex);
+	obs_leave_graphics();
 
-	if (context->tex)
-		gs_texture_destroy(context->tex);
-	context->tex = NULL;
+	if (!tex) {
+		warn("failed to load texture '%s'", image_load_get_file(load));
+		context->cx = 0;
+		context->cy = 0;
+	}
 
-	obs_leave_graphics();
+	image_load_release(load);
 }
 
 static void image_source_update(void *data, obs_data_t *settings)
@@ -124,6 +178,12 @@ static void *image_source_create(obs_data_t *settings, obs_source_t *source)
 	struct image_source *context = bzalloc(sizeof(struct image_source));
 	context->source = source;
 
+	pthread_mutex_init_value(&context->load_mutex);
+	if (pthread_mutex_init(&context->load_mutex, NULL) != 0) {
+		bfree(context);
+		return NULL;
+	}
+
 	image_source_update(context, settings);
 	return context;
 }
@@ -133,6 +193,7 @@ static void image_source_destroy(void *data)
 	struct image_source *context = data;
 
 	image_source_unload(context);
+	pthread_mutex_destroy(&context->load_mutex);
 
 	if (context->file)
 		bfree(context->file);
@@ -167,6 +228,17 @@ static void image_source_render(void *data, gs_effect_t *effect)
 static void image_source_tick(void *data, float seconds)
 {
 	struct image_source *context = data;
+	struct image_load *load = NULL;
+
+	pthread_mutex_lock(&context->load_mutex);
+	if (context->load && image_load_done(context->load)) {
+		load = context->load;
+		context->load = NULL;
+	}
+	pthread_mutex_unlock(&context->load_mutex);
+
+	if (load)
+		image_source_upload(context, load);
 
 	if (!obs_source_showing(context->source)) return;
 
@@ -229,6 +301,12 @@ OBS_MODULE_USE_DEFAULT_LOCALE("image-source", "en-US")
 
 bool obs_module_load(void)
 {
+	image_loader_init();
 	obs_register_source(&image_source_info);
 	return true;
 }
+
+void obs_module_unload(void)
+{
+	image_loader_free();
+}
@@ -63,6 +63,43 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define blog(level, msg, ...) blog(level, "v4l2-input: " msg, ##__VA_ARGS__)
 
+/* number of buffers that always stay queued in the driver, the others can be
+ * handed to libobs without copying them */
+#define MIN_DRIVER_BUFFERS 2
+
+/* how long to wait for libobs to release buffers when stopping, so that
+ * the device can be set up again right away */
+#define BUFFER_RELEASE_TIMEOUT_MS 2000
+
+struct v4l2_buffer_set;
+
+/**
+ * Release context of a mapped buffer handed to libobs
+ */
+struct v4l2_buffer_ref {
+	struct v4l2_buffer_set *set;
+	uint32_t index;
+};
+
+/**
+ * Mapped buffers of one capture, and the device they belong to
+ *
+ * The capture holds one reference and every buffer handed to libobs holds
+ * another, so the buffers stay mapped and the device open until libobs has
+ * released all of them, even after the source stopped capturing or was
+ * destroyed.
+ */
+struct v4l2_buffer_set {
+	volatile long refs;
+	int_fast32_t dev;
+	struct v4l2_buffer_data buffers;
+	struct v4l2_buffer_ref *buffer_refs;
+
+	/* buffers currently referenced by libobs */
+	volatile long buffers_out;
+	volatile bool capturing;
+};
+
 /**
  * Data structure for the v4l2 source
  */
@@ -85,7 +122,7 @@ struct v4l2_data {
 	int width;
 	int height;
 	int linesize;
-	struct v4l2_buffer_data buffers;
+	struct v4l2_buffer_set *set;
 };
 
 /* forward declarations */
@@ -142,12 +179,105 @@ static void v4l2_prep_obs_frame(struct v4l2_data *data,
 	}
 }
 
+/**
+ * Create the buffer set of a capture, which takes over the device
+ */
+static struct v4l2_buffer_set *v4l2_buffer_set_create(int_fast32_t dev)
+{
+	struct v4l2_buffer_set *set = bzalloc(sizeof(struct v4l2_buffer_set));
+	set->refs = 1;
+	set->dev  = dev;
+	return set;
+}
+
+/**
+ * Release a reference to a buffer set, unmapping the buffers and closing the
+ * device with the last one
+ */
+static void v4l2_buffer_set_release(struct v4l2_buffer_set *set)
+{
+	if (!set || os_atomic_dec_long(&set->refs) != 0)
+		return;
+
+	v4l2_destroy_mmap(&set->buffers);
+	bfree(set->buffer_refs);
+	if (set->dev != -1)
+		v4l2_close(set->dev);
+	bfree(set);
+}
+
+/**
+ * Requeue a buffer once libobs is done with it
+ *
+ * This is called from the graphics thread after the frame has been uploaded,
+ * or from whichever thread drops the frame.  Buffers of a capture that has
+ * stopped are not requeued, only their reference to the set is released.
+ */
+static void v4l2_release_buffer(void *param)
+{
+	struct v4l2_buffer_ref *ref = param;
+	struct v4l2_buffer_set *set = ref->set;
+	struct v4l2_buffer buf;
+
+	if (os_atomic_load_bool(&set->capturing)) {
+		memset(&buf, 0, sizeof(buf));
+		buf.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		buf.index  = ref->index;
+
+		if (v4l2_ioctl(set->dev, VIDIOC_QBUF, &buf) < 0)
+			blog(LOG_DEBUG, "failed to enqueue buffer");
+	}
+
+	os_atomic_dec_long(&set->buffers_out);
+	v4l2_buffer_set_release(set);
+}
+
+/**
+ * Check if a dequeued buffer can be handed to libobs without copying
+ *
+ * Each buffer given to libobs is only requeued once it has been uploaded, so
+ * this makes sure the driver is never left without buffers to fill.
+ */
+static inline bool v4l2_can_ref_buffer(struct v4l2_buffer_set *set)
+{
+	return set->buffers_out + MIN_DRIVER_BUFFERS <
+		(long)set->buffers.count;
+}
+
+/**
+ * Wait until libobs has released all referenced buffers of a set
+ *
+ * Only needed so that the device is free to be set up again, the buffers
+ * stay valid for as long as libobs references them either way.
+ *
+ * @return false if buffers are still referenced after the timeout
+ */
+static bool v4l2_wait_for_buffers(struct v4l2_data *data,
+		struct v4l2_buffer_set *set)
+{
+	if (!set->buffers_out)
+		return true;
+
+	/* drops the frames libobs has queued but not displayed yet */
+	obs_source_output_video(data->source, NULL);
+
+	for (int i = 0; i < BUFFER_RELEASE_TIMEOUT_MS / 10; i++) {
+		if (!set->buffers_out)
+			return true;
+		os_sleep_ms(10);
+	}
+
+	return !set->buffers_out;
+}
+
 /*
  * Worker thread to get video data
  */
 static void *v4l2_thread(void *vptr)
 {
 	V4L2_DATA(vptr);
+	struct v4l2_buffer_set *set = data->set;
 	int r;
 	fd_set fds;
 	uint8_t *start;
@@ -158,8 +288,9 @@ static void *v4l2_thread(void *vptr)
 	struct obs_source_frame out;
 	size_t plane_offsets[MAX_AV_PLANES];
 
-	if (v4l2_start_capture(data->dev, &data->buffers) < 0)
+	if (v4l2_start_capture(data->dev, &set->buffers) < 0)
 		goto exit;
+	os_atomic_set_bool(&set->capturing, true);
 
 	frames   = 0;
 	first_ts = 0;
@@ -197,9 +328,20 @@ static void *v4l2_thread(void *vptr)
 			first_ts = out.timestamp;
 		out.timestamp -= first_ts;
 
-		start = (uint8_t *) data->buffers.info[buf.index].start;
+		start = (uint8_t *) set->buffers.info[buf.index].start;
 		for (uint_fast32_t i = 0; i < MAX_AV_PLANES; ++i)
 			out.data[i] = start + plane_offsets[i];
+
+		if (v4l2_can_ref_buffer(set)) {
+			os_atomic_inc_long(&set->refs);
+			os_atomic_inc_long(&set->buffers_out);
+			obs_source_output_video_ref(data->source, &out,
+					v4l2_release_buffer,
+					&set->buffer_refs[buf.index]);
+			frames++;
+			continue;
+		}
+
 		obs_source_output_video(data->source, &out);
 
 		if (v4l2_ioctl(data->dev, VIDIOC_QBUF, &buf) < 0) {
@@ -213,6 +355,7 @@ static void *v4l2_thread(void *vptr)
 	blog(LOG_INFO, "Stopped capture after %"PRIu64" frames", frames);
 
 exit:
+	os_atomic_set_bool(&set->capturing, false);
 	v4l2_stop_capture(data->dev);
 	return NULL;
 }
@@ -784,9 +927,18 @@ static void v4l2_terminate(struct v4l2_data *data)
 		data->thread = 0;
 	}
 
-	v4l2_destroy_mmap(&data->buffers);
+	if (data->set) {
+		/* buffers still referenced by libobs (e.g. held by a filter)
+		 * keep the set, and with it the device, alive */
+		if (!v4l2_wait_for_buffers(data, data->set))
+			blog(LOG_WARNING, "%ld buffers still in use",
+					data->set->buffers_out);
 
-	if (data->dev != -1) {
+		v4l2_buffer_set_release(data->set);
+		data->set = NULL;
+		data->dev = -1;
+
+	} else if (data->dev != -1) {
 		v4l2_close(data->dev);
 		data->dev = -1;
 	}
@@ -892,11 +1044,19 @@ static void v4l2_init(struct v4l2_data *data)
 	blog(LOG_INFO, "Framerate: %.2f fps", (float) fps_denom / fps_num);
 
 	/* map buffers */
-	if (v4l2_create_mmap(data->dev, &data->buffers) < 0) {
+	data->set = v4l2_buffer_set_create(data->dev);
+	if (v4l2_create_mmap(data->dev, &data->set->buffers) < 0) {
 		blog(LOG_ERROR, "Failed to map buffers");
 		goto fail;
 	}
 
+	data->set->buffer_refs = bzalloc(data->set->buffers.count *
+			sizeof(struct v4l2_buffer_ref));
+	for (uint_fast32_t i = 0; i < data->set->buffers.count; ++i) {
+		data->set->buffer_refs[i].set   = data->set;
+		data->set->buffer_refs[i].index = i;
+	}
+
 	/* start the capture thread */
 	if (os_event_init(&data->event, OS_EVENT_TYPE_MANUAL) != 0)
 		goto fail;
@@ -21,6 +21,9 @@
 
 #define MILLISECOND_DEN   1000
 
+/* largest codec specific header in front of the data of an FLV tag body */
+#define FLV_MAX_BODY_HEADER_SIZE 5
+
 static uint32_t get_ms_time(struct encoder_packet *packet, int64_t val)
 {
 	return (uint32_t)(val * MILLISECOND_DEN / packet->timebase_den);
@@ -32,3 +35,9 @@ extern bool flv_meta_data(obs_output_t *context, uint8_t **output, size_t *size,
 		bool write_header, size_t audio_idx);
 extern void flv_packet_mux(struct encoder_packet *packet,
 		uint8_t **output, size_t *size, bool is_header);
+
+/* writes the codec specific header that goes in front of the packet data in
+ * the FLV tag body, returns its size */
+extern size_t flv_packet_body_header(struct encoder_packet *packet,
+		bool is_header, uint8_t *header);
+extern uint32_t flv_packet_timestamp(struct encoder_packet *packet);
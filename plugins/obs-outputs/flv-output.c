@@ -98,7 +98,8 @@ static int write_packet(struct flv_output *stream,
 	flv_packet_mux(packet, &data, &size, is_header);
 	fwrite(data, 1, size, stream->file);
 	bfree(data);
-	obs_free_encoder_packet(packet);
+
+	obs_output_add_bytes_copied(stream->output, size);
 
 	return ret;
 }
@@ -125,7 +126,7 @@ static void write_audio_header(struct flv_output *stream)
 	};
 
 	obs_encoder_get_extra_data(aencoder, &header, &packet.size);
-	packet.data = bmemdup(header, packet.size);
+	packet.data = header;
 	write_packet(stream, &packet, true);
 }
 
@@ -145,6 +146,7 @@ static void write_video_header(struct flv_output *stream)
 	obs_encoder_get_extra_data(vencoder, &header, &size);
 	packet.size = obs_parse_avc_header(&packet.data, header, size);
 	write_packet(stream, &packet, true);
+	bfree(packet.data);
 }
 
 static void write_headers(struct flv_output *stream)
@@ -197,6 +199,8 @@ static void flv_output_data(void *data, struct encoder_packet *packet)
 
 	if (packet->type == OBS_ENCODER_VIDEO) {
 		obs_parse_avc_packet(&parsed_packet, packet);
+		obs_output_add_bytes_copied(stream->output,
+				parsed_packet.size);
 		write_packet(stream, &parsed_packet, false);
 		obs_free_encoder_packet(&parsed_packet);
 	} else {
@@ -141,6 +141,7 @@ static void HandleClientBW(RTMP *r, const RTMPPacket *packet);
 
 static int ReadN(RTMP *r, char *buffer, int n);
 static int WriteN(RTMP *r, const char *buffer, int n);
+static int WriteIOV(RTMP *r, RTMPIOVec *iov, int count);
 
 static void DecodeTEA(AVal *key, AVal *text);
 
@@ -1403,6 +1404,7 @@ WriteN(RTMP *r, const char *buffer, int n)
             nBytes = r->m_customSendFunc(&r->m_sb, ptr, n, r->m_customSendParam);
         else
             nBytes = RTMPSockBuf_Send(&r->m_sb, ptr, n);
+        r->m_nSendCalls++;
         /*RTMP_Log(RTMP_LOGDEBUG, "%s: %d\n", __FUNCTION__, nBytes); */
 
         if (nBytes < 0)
@@ -1434,6 +1436,112 @@ WriteN(RTMP *r, const char *buffer, int n)
     return n == 0;
 }
 
+/* maximum number of buffers handed to a single vectored send call */
+#define RTMP_MAX_SEND_IOV 64
+
+/* sends all buffers, 'iov' is modified to track partial sends */
+static int
+WriteIOV(RTMP *r, RTMPIOVec *iov, int count)
+{
+#ifdef _WIN32
+    WSABUF bufs[RTMP_MAX_SEND_IOV];
+#else
+    struct iovec bufs[RTMP_MAX_SEND_IOV];
+    struct msghdr msg;
+#endif
+
+    /* only plain sockets can be written to directly */
+    if ((r->Link.protocol & RTMP_FEATURE_HTTP) ||
+            (r->m_bCustomSend && r->m_customSendFunc)
+#if defined(CRYPTO)
+            || r->Link.rc4keyOut || r->m_sb.sb_ssl
+#endif
+       )
+    {
+        char *buf, *ptr;
+        int i, total = 0, ret;
+
+        for (i = 0; i < count; i++)
+            total += iov[i].len;
+
+        buf = ptr = malloc(total);
+        if (!buf)
+            return FALSE;
+
+        for (i = 0; i < count; i++)
+        {
+            memcpy(ptr, iov[i].base, iov[i].len);
+            ptr += iov[i].len;
+        }
+
+        ret = WriteN(r, buf, total);
+        free(buf);
+        return ret;
+    }
+
+    while (count > 0)
+    {
+        int i, n = count < RTMP_MAX_SEND_IOV ? count : RTMP_MAX_SEND_IOV;
+        int nBytes;
+
+        for (i = 0; i < n; i++)
+        {
+#ifdef _WIN32
+            bufs[i].buf = (CHAR *)iov[i].base;
+            bufs[i].len = (ULONG)iov[i].len;
+#else
+            bufs[i].iov_base = (void *)iov[i].base;
+            bufs[i].iov_len = (size_t)iov[i].len;
+#endif
+        }
+
+#ifdef _WIN32
+        {
+            DWORD sent = 0;
+            nBytes = WSASend(r->m_sb.sb_socket, bufs, (DWORD)n, &sent, 0,
+                             NULL, NULL) == 0 ? (int)sent : -1;
+        }
+#else
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = bufs;
+        msg.msg_iovlen = n;
+        nBytes = (int)sendmsg(r->m_sb.sb_socket, &msg, 0);
+#endif
+        r->m_nSendCalls++;
+
+        if (nBytes < 0)
+        {
+            int sockerr = GetSockError();
+            RTMP_Log(RTMP_LOGERROR, "%s, RTMP send error %d", __FUNCTION__,
+                     sockerr);
+
+            if (sockerr == EINTR && !RTMP_ctrlC)
+                continue;
+
+            RTMP_Close(r);
+            return FALSE;
+        }
+
+        if (nBytes == 0)
+            return FALSE;
+
+        /* skip whatever was sent */
+        while (count > 0 && nBytes >= iov->len)
+        {
+            nBytes -= iov->len;
+            iov++;
+            count--;
+        }
+        if (count > 0 && nBytes)
+        {
+            iov->base += nBytes;
+            iov->len -= nBytes;
+        }
+    }
+
+    return TRUE;
+}
+
 #define SAVC(x)	static const AVal av_##x = AVC(#x)
 
 SAVC(app);
@@ -3905,18 +4013,14 @@ RTMP_SendChunk(RTMP *r, RTMPChunk *chunk)
     return wrote;
 }
 
-int
-RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
+/* makes room for the channel of an outgoing packet and compresses its header
+ * type based on the previous packet sent on the channel */
+static int
+PrepareOutPacket(RTMP *r, RTMPPacket *packet, uint32_t *last)
 {
     const RTMPPacket *prevPacket;
-    uint32_t last = 0;
-    int nSize;
-    int hSize, cSize;
-    char *header, *hptr, *hend, hbuf[RTMP_MAX_HEADER_SIZE], c;
-    uint32_t t;
-    char *buffer, *tbuf = NULL, *toff = NULL;
-    int nChunkSize;
-    int tlen;
+
+    *last = 0;
 
     if (packet->m_nChannel >= r->m_channelsAllocatedOut)
     {
@@ -3946,7 +4050,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
         if (prevPacket->m_nTimeStamp == packet->m_nTimeStamp
                 && packet->m_headerType == RTMP_PACKET_SIZE_SMALL)
             packet->m_headerType = RTMP_PACKET_SIZE_MINIMUM;
-        last = prevPacket->m_nTimeStamp;
+        *last = prevPacket->m_nTimeStamp;
     }
 
     if (packet->m_headerType > 3)	/* sanity */
@@ -3956,6 +4060,33 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
         return FALSE;
     }
 
+    return TRUE;
+}
+
+/* remembers the packet for compressing the next header on its channel */
+static void
+StoreOutPacket(RTMP *r, const RTMPPacket *packet)
+{
+    if (!r->m_vecChannelsOut[packet->m_nChannel])
+        r->m_vecChannelsOut[packet->m_nChannel] = malloc(sizeof(RTMPPacket));
+    memcpy(r->m_vecChannelsOut[packet->m_nChannel], packet, sizeof(RTMPPacket));
+}
+
+int
+RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
+{
+    uint32_t last = 0;
+    int nSize;
+    int hSize, cSize;
+    char *header, *hptr, *hend, hbuf[RTMP_MAX_HEADER_SIZE], c;
+    uint32_t t;
+    char *buffer, *tbuf = NULL, *toff = NULL;
+    int nChunkSize;
+    int tlen;
+
+    if (!PrepareOutPacket(r, packet, &last))
+        return FALSE;
+
     nSize = packetSize[packet->m_headerType];
     hSize = nSize;
     cSize = 0;
@@ -4116,9 +4247,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
         }
     }
 
-    if (!r->m_vecChannelsOut[packet->m_nChannel])
-        r->m_vecChannelsOut[packet->m_nChannel] = malloc(sizeof(RTMPPacket));
-    memcpy(r->m_vecChannelsOut[packet->m_nChannel], packet, sizeof(RTMPPacket));
+    StoreOutPacket(r, packet);
     return TRUE;
 }
 
@@ -5222,3 +5351,129 @@ RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx)
     }
     return size+s2;
 }
+
+/* sends an audio or video message whose body is given as a list of buffers.
+ * unlike RTMP_Write, the body is not copied: the chunk headers and slices of
+ * the body buffers are sent with vectored writes. */
+int
+RTMP_WriteV(RTMP *r, int packetType, uint32_t timestamp,
+            const RTMPIOVec *body, int count, int streamIdx)
+{
+    RTMPPacket packet;
+    RTMPIOVec *iov;
+    char hbuf[RTMP_MAX_HEADER_SIZE], cbuf[3], *hptr, *hend, c;
+    uint32_t last, t;
+    int nSize = 0, hSize, cSize = 0, chunkSize, chunks, remaining;
+    int i, idx = 0, off = 0, num = 0, ret;
+
+    for (i = 0; i < count; i++)
+        nSize += body[i].len;
+
+    memset(&packet, 0, sizeof(packet));
+    packet.m_nChannel = 0x04;	/* source channel */
+    packet.m_nInfoField2 = r->Link.streams[streamIdx].id;
+    packet.m_packetType = packetType;
+    packet.m_nTimeStamp = timestamp;
+    packet.m_nBodySize = nSize;
+    packet.m_headerType = timestamp ?
+                          RTMP_PACKET_SIZE_MEDIUM : RTMP_PACKET_SIZE_LARGE;
+
+    if (!PrepareOutPacket(r, &packet, &last))
+        return -1;
+
+    /* message header of the first chunk */
+    hSize = packetSize[packet.m_headerType];
+    t = packet.m_nTimeStamp - last;
+
+    if (packet.m_nChannel > 319)
+        cSize = 2;
+    else if (packet.m_nChannel > 63)
+        cSize = 1;
+
+    hptr = hbuf;
+    hend = hbuf + sizeof(hbuf);
+    c = packet.m_headerType << 6;
+    if (cSize == 0)
+        c |= packet.m_nChannel;
+    else if (cSize == 2)
+        c |= 1;
+    *hptr++ = c;
+    if (cSize)
+    {
+        int tmp = packet.m_nChannel - 64;
+        *hptr++ = tmp & 0xff;
+        if (cSize == 2)
+            *hptr++ = tmp >> 8;
+    }
+    if (hSize > 1)
+        hptr = AMF_EncodeInt24(hptr, hend, t > 0xffffff ? 0xffffff : t);
+    if (hSize > 4)
+    {
+        hptr = AMF_EncodeInt24(hptr, hend, packet.m_nBodySize);
+        *hptr++ = packet.m_packetType;
+    }
+    if (hSize > 8)
+        hptr += EncodeInt32LE(hptr, packet.m_nInfoField2);
+    if (hSize > 1 && t >= 0xffffff)
+        hptr = AMF_EncodeInt32(hptr, hend, t);
+    hSize = (int)(hptr - hbuf);
+
+    /* header of the following chunks, same as in RTMP_SendPacket */
+    memcpy(cbuf, hbuf, cSize + 1);
+    cbuf[0] = (0xc0 | c);
+
+    chunkSize = r->m_outChunkSize;
+    chunks = (nSize + chunkSize - 1) / chunkSize;
+
+    /* every chunk needs a header and at most one slice more than there are
+     * body buffers */
+    iov = malloc(sizeof(RTMPIOVec) * (2 * chunks + count + 1));
+    if (!iov)
+        return -1;
+
+    iov[num].base = hbuf;
+    iov[num++].len = hSize;
+
+    remaining = nSize;
+    while (remaining > 0)
+    {
+        int chunk = remaining < chunkSize ? remaining : chunkSize;
+
+        if (remaining != nSize)
+        {
+            iov[num].base = cbuf;
+            iov[num++].len = cSize + 1;
+        }
+        remaining -= chunk;
+
+        while (chunk > 0)
+        {
+            int len = body[idx].len - off;
+            if (len > chunk)
+                len = chunk;
+
+            if (len)
+            {
+                iov[num].base = body[idx].base + off;
+                iov[num++].len = len;
+            }
+
+            off += len;
+            chunk -= len;
+            if (off == body[idx].len)
+            {
+                idx++;
+                off = 0;
+            }
+        }
+    }
+
+    ret = WriteIOV(r, iov, num);
+    free(iov);
+
+    if (!ret)
+        return -1;
+
+    StoreOutPacket(r, &packet);
+    return nSize;
+}
@@ -140,6 +140,13 @@ extern "C"
         char *m_body;
     } RTMPPacket;
 
+    /* part of a message body, see RTMP_WriteV */
+    typedef struct RTMPIOVec
+    {
+        const char *base;
+        int len;
+    } RTMPIOVec;
+
     typedef struct RTMPSockBuf
     {
         SOCKET sb_socket;
@@ -295,6 +302,7 @@ extern "C"
         uint8_t m_bCustomSend;
         void*   m_customSendParam;
         CUSTOMSEND m_customSendFunc;
+        uint32_t m_nSendCalls;	/* send calls made on the socket */
 
         RTMP_BINDINFO m_bindIP;
 
@@ -413,6 +421,8 @@ extern "C"
     void RTMP_DropRequest(RTMP *r, int i, int freeit);
     int RTMP_Read(RTMP *r, char *buf, int size);
     int RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx);
+    int RTMP_WriteV(RTMP *r, int packetType, uint32_t timestamp,
+                    const RTMPIOVec *body, int count, int streamIdx);
 
     /* hashswf.c */
     int RTMP_HashSWF(const char *url, unsigned int *size, unsigned char *hash,
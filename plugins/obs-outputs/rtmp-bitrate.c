@@ -0,0 +1,138 @@
+/******************************************************************************
+    Copyright (C) 2014 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <string.h>
+#include "rtmp-bitrate.h"
+
+/* how often the queue is evaluated */
+#define INTERVAL_NS       500000000ULL
+
+/* data sent at the old bitrate is still queued for a while after a change,
+ * so do not lower the bitrate again right away */
+#define COOLDOWN_NS       2000000000ULL
+
+/* how long the queue has to stay clear before (and between) raises */
+#define RAISE_DELAY_NS    5000000000ULL
+
+#define MIN_KBPS          100
+
+void rtmp_bitrate_init(struct rtmp_bitrate *br, int kbps,
+		int64_t drop_threshold_usec, uint64_t now_ns)
+{
+	memset(br, 0, sizeof(*br));
+
+	br->orig_kbps = kbps;
+	br->cur_kbps  = kbps;
+	br->min_kbps  = kbps / 5;
+	if (br->min_kbps < MIN_KBPS)
+		br->min_kbps = kbps < MIN_KBPS ? kbps : MIN_KBPS;
+
+	br->congested_usec = drop_threshold_usec / 3;
+	br->clear_usec     = drop_threshold_usec / 12;
+
+	br->interval_start_ns = now_ns;
+}
+
+static inline int min_int(int a, int b)
+{
+	return a < b ? a : b;
+}
+
+static inline int max_int(int a, int b)
+{
+	return a > b ? a : b;
+}
+
+static bool lower_bitrate(struct rtmp_bitrate *br, int drained_kbps,
+		uint64_t now_ns)
+{
+	int new_kbps;
+
+	if (now_ns - br->last_change_ns < COOLDOWN_NS)
+		return false;
+
+	/* a bit below what the connection actually managed to send, but
+	 * never more than half at once in case the connection just stalled
+	 * for a moment */
+	new_kbps = min_int(br->cur_kbps * 85 / 100, drained_kbps * 9 / 10);
+	new_kbps = max_int(new_kbps, br->cur_kbps / 2);
+	new_kbps = max_int(new_kbps, br->min_kbps);
+
+	if (new_kbps >= br->cur_kbps)
+		return false;
+
+	br->cur_kbps       = new_kbps;
+	br->last_change_ns = now_ns;
+	return true;
+}
+
+static bool raise_bitrate(struct rtmp_bitrate *br, uint64_t now_ns)
+{
+	int step = max_int(br->orig_kbps / 10, 50);
+
+	if (br->cur_kbps >= br->orig_kbps)
+		return false;
+	if (now_ns - br->clear_since_ns < RAISE_DELAY_NS ||
+	    now_ns - br->last_change_ns < RAISE_DELAY_NS)
+		return false;
+
+	br->cur_kbps       = min_int(br->cur_kbps + step, br->orig_kbps);
+	br->last_change_ns = now_ns;
+	br->clear_since_ns = now_ns;
+	return true;
+}
+
+bool rtmp_bitrate_update(struct rtmp_bitrate *br, size_t bytes_sent,
+		int64_t buffer_usec, uint64_t now_ns)
+{
+	uint64_t elapsed_ns;
+	int      drained_kbps;
+	bool     changed = false;
+
+	br->interval_bytes += bytes_sent;
+	if (br->interval_max_buffer_usec < buffer_usec)
+		br->interval_max_buffer_usec = buffer_usec;
+
+	elapsed_ns = now_ns - br->interval_start_ns;
+	if (elapsed_ns < INTERVAL_NS)
+		return false;
+
+	drained_kbps = (int)(br->interval_bytes * 8000000ULL / elapsed_ns);
+
+	if (buffer_usec >= br->congested_usec) {
+		br->clear_since_ns = 0;
+
+		/* if the queue is already shrinking the current bitrate is
+		 * low enough, it just needs time to drain */
+		if (buffer_usec >= br->prev_buffer_usec)
+			changed = lower_bitrate(br, drained_kbps, now_ns);
+
+	} else if (br->interval_max_buffer_usec <= br->clear_usec) {
+		if (!br->clear_since_ns)
+			br->clear_since_ns = now_ns;
+		changed = raise_bitrate(br, now_ns);
+
+	} else {
+		br->clear_since_ns = 0;
+	}
+
+	br->interval_start_ns        = now_ns;
+	br->interval_bytes           = 0;
+	br->interval_max_buffer_usec = 0;
+	br->prev_buffer_usec         = buffer_usec;
+	return changed;
+}
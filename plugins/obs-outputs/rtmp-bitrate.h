@@ -0,0 +1,66 @@
+/******************************************************************************
+    Copyright (C) 2014 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * Video bitrate controller for the RTMP output.
+ *
+ * The send thread reports every packet it sends along with how much data is
+ * still waiting in the send queue.  Once per interval the controller looks
+ * at the queue: if data keeps piling up, the connection cannot keep up, so
+ * the bitrate is lowered to a bit below what was actually drained.  After
+ * the queue has stayed empty for a while, the bitrate is raised again step
+ * by step until it is back to the configured bitrate.
+ */
+
+struct rtmp_bitrate {
+	int      orig_kbps;
+	int      min_kbps;
+	int      cur_kbps;
+
+	int64_t  congested_usec;
+	int64_t  clear_usec;
+
+	uint64_t interval_start_ns;
+	uint64_t interval_bytes;
+	int64_t  interval_max_buffer_usec;
+	int64_t  prev_buffer_usec;
+	uint64_t last_change_ns;
+	uint64_t clear_since_ns;
+};
+
+/**
+ * Initializes the controller with the configured bitrate of the video
+ * encoder.  'drop_threshold_usec' is the buffer duration at which the output
+ * starts dropping frames, the thresholds of the controller are below it.
+ */
+extern void rtmp_bitrate_init(struct rtmp_bitrate *br, int kbps,
+		int64_t drop_threshold_usec, uint64_t now_ns);
+
+/**
+ * Reports a sent packet.  'buffer_usec' is the duration of the data still
+ * queued for sending.
+ *
+ * @return true if the target bitrate (cur_kbps) changed
+ */
+extern bool rtmp_bitrate_update(struct rtmp_bitrate *br, size_t bytes_sent,
+		int64_t buffer_usec, uint64_t now_ns);
@@ -0,0 +1,170 @@
+/******************************************************************************
+    Copyright (C) 2014 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <string.h>
+#include <util/bmem.h>
+#include "rtmp-packet-queue.h"
+
+#define INITIAL_CAPACITY 256
+
+static inline struct queued_packet *get_slot(const struct packet_queue *queue,
+		uint64_t seq)
+{
+	return &queue->slots[seq & (queue->capacity - 1)];
+}
+
+static inline bool is_droppable(const struct encoder_packet *packet)
+{
+	return packet->type == OBS_ENCODER_VIDEO &&
+		packet->drop_priority >= 0 &&
+		packet->drop_priority < OBS_NAL_PRIORITY_HIGHEST;
+}
+
+void packet_queue_init(struct packet_queue *queue)
+{
+	memset(queue, 0, sizeof(*queue));
+}
+
+void packet_queue_free(struct packet_queue *queue)
+{
+	packet_queue_clear(queue);
+
+	for (size_t i = 0; i < OBS_NAL_PRIORITY_HIGHEST; i++)
+		circlebuf_free(&queue->droppable[i]);
+	bfree(queue->slots);
+
+	memset(queue, 0, sizeof(*queue));
+}
+
+static void grow(struct packet_queue *queue)
+{
+	size_t new_capacity = queue->capacity ?
+		queue->capacity * 2 : INITIAL_CAPACITY;
+	struct queued_packet *new_slots =
+		bmalloc(new_capacity * sizeof(struct queued_packet));
+
+	for (uint64_t seq = queue->head; seq < queue->tail; seq++)
+		new_slots[seq & (new_capacity - 1)] = *get_slot(queue, seq);
+
+	bfree(queue->slots);
+	queue->slots    = new_slots;
+	queue->capacity = new_capacity;
+}
+
+/* keeps the first slot a packet that has not been dropped */
+static inline void skip_dropped(struct packet_queue *queue)
+{
+	while (queue->head < queue->tail && get_slot(queue, queue->head)->dropped)
+		queue->head++;
+}
+
+void packet_queue_push(struct packet_queue *queue,
+		struct encoder_packet *packet)
+{
+	struct queued_packet *slot;
+	uint64_t seq = queue->tail;
+
+	if (seq - queue->head == queue->capacity)
+		grow(queue);
+
+	slot          = get_slot(queue, seq);
+	slot->packet  = *packet;
+	slot->dropped = false;
+
+	if (is_droppable(packet))
+		circlebuf_push_back(&queue->droppable[packet->drop_priority],
+				&seq, sizeof(seq));
+
+	queue->tail++;
+	queue->num_packets++;
+}
+
+bool packet_queue_pop(struct packet_queue *queue,
+		struct encoder_packet *packet)
+{
+	struct queued_packet *slot;
+
+	if (!queue->num_packets)
+		return false;
+
+	slot    = get_slot(queue, queue->head);
+	*packet = slot->packet;
+
+	/* droppable packets are indexed in send order, so a popped packet
+	 * is always first in the index of its priority */
+	if (is_droppable(packet))
+		circlebuf_pop_front(&queue->droppable[packet->drop_priority],
+				NULL, sizeof(uint64_t));
+
+	queue->head++;
+	queue->num_packets--;
+	skip_dropped(queue);
+	return true;
+}
+
+const struct encoder_packet *packet_queue_front(
+		const struct packet_queue *queue)
+{
+	if (!queue->num_packets)
+		return NULL;
+	return &get_slot(queue, queue->head)->packet;
+}
+
+void packet_queue_clear(struct packet_queue *queue)
+{
+	struct encoder_packet packet;
+
+	while (packet_queue_pop(queue, &packet))
+		obs_encoder_packet_release(&packet);
+
+	queue->head = queue->tail = 0;
+}
+
+size_t packet_queue_drop(struct packet_queue *queue, int priority,
+		int *max_priority)
+{
+	size_t num_dropped = 0;
+
+	if (priority > OBS_NAL_PRIORITY_HIGHEST)
+		priority = OBS_NAL_PRIORITY_HIGHEST;
+
+	for (int i = 0; i < priority; i++) {
+		struct circlebuf *index = &queue->droppable[i];
+
+		if (!index->size)
+			continue;
+
+		while (index->size) {
+			struct queued_packet *slot;
+			uint64_t seq;
+
+			circlebuf_pop_front(index, &seq, sizeof(seq));
+
+			slot = get_slot(queue, seq);
+			obs_encoder_packet_release(&slot->packet);
+			slot->dropped = true;
+			num_dropped++;
+		}
+
+		if (max_priority)
+			*max_priority = i;
+	}
+
+	queue->num_packets -= num_dropped;
+	skip_dropped(queue);
+	return num_dropped;
+}
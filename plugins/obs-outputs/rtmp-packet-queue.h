@@ -0,0 +1,85 @@
+/******************************************************************************
+    Copyright (C) 2014 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <obs.h>
+#include <obs-avc.h>
+#include <util/circlebuf.h>
+
+/*
+ * Send queue of the RTMP output.
+ *
+ * Packets are kept in send order in a ring.  Video packets that may be
+ * dropped are additionally indexed by their drop priority, in dts order, so
+ * dropping frames only touches the packets that are actually dropped: they
+ * are released and their slots marked as dropped, which the queue then skips
+ * when packets are popped.  Audio packets and video packets of the highest
+ * drop priority (keyframes) are never dropped.
+ *
+ * Not thread safe, the output locks around it.
+ */
+
+struct queued_packet {
+	struct encoder_packet packet;
+	bool                  dropped;
+};
+
+struct packet_queue {
+	struct queued_packet  *slots;
+	size_t                capacity;
+	uint64_t              head;
+	uint64_t              tail;
+	size_t                num_packets;
+
+	/* sequence numbers of droppable packets, per drop priority */
+	struct circlebuf      droppable[OBS_NAL_PRIORITY_HIGHEST];
+};
+
+extern void packet_queue_init(struct packet_queue *queue);
+
+/** Releases all queued packets and frees the queue */
+extern void packet_queue_free(struct packet_queue *queue);
+
+/** Adds a packet to the back of the queue, which takes over the reference */
+extern void packet_queue_push(struct packet_queue *queue,
+		struct encoder_packet *packet);
+
+/** Removes the first packet, the caller takes over the reference */
+extern bool packet_queue_pop(struct packet_queue *queue,
+		struct encoder_packet *packet);
+
+/** Returns the first packet without removing it, or NULL if empty */
+extern const struct encoder_packet *packet_queue_front(
+		const struct packet_queue *queue);
+
+/** Releases all queued packets */
+extern void packet_queue_clear(struct packet_queue *queue);
+
+/**
+ * Drops all queued video packets with a drop priority below 'priority'.
+ *
+ * @param  max_priority  receives the highest drop priority that was dropped
+ * @return               number of packets dropped
+ */
+extern size_t packet_queue_drop(struct packet_queue *queue, int priority,
+		int *max_priority);
+
+static inline size_t packet_queue_size(const struct packet_queue *queue)
+{
+	return queue->num_packets;
+}
@@ -18,13 +18,14 @@
 #include <obs-module.h>
 #include <obs-avc.h>
 #include <util/platform.h>
-#include <util/circlebuf.h>
 #include <util/dstr.h>
 #include <util/threading.h>
 #include <inttypes.h>
 #include "librtmp/rtmp.h"
 #include "librtmp/log.h"
 #include "flv-mux.h"
+#include "rtmp-bitrate.h"
+#include "rtmp-packet-queue.h"
 
 #define do_log(level, format, ...) \
 	blog(level, "[rtmp stream: '%s'] " format, \
@@ -36,6 +37,7 @@
 
 #define OPT_DROP_THRESHOLD "drop_threshold_ms"
 #define OPT_MAX_SHUTDOWN_TIME_SEC "max_shutdown_time_sec"
+#define OPT_DYN_BITRATE "dyn_bitrate"
 
 //#define TEST_FRAMEDROPS
 
@@ -43,7 +45,7 @@ struct rtmp_stream {
 	obs_output_t     *output;
 
 	pthread_mutex_t  packets_mutex;
-	struct circlebuf packets;
+	struct packet_queue packets;
 	bool             sent_headers;
 
 	volatile bool    connecting;
@@ -70,6 +72,10 @@ struct rtmp_stream {
 
 	int64_t          last_dts_usec;
 
+	/* dynamic bitrate variables */
+	bool             dyn_bitrate;
+	struct rtmp_bitrate bitrate;
+
 	uint64_t         total_bytes_sent;
 	int              dropped_frames;
 
@@ -101,11 +107,7 @@ static inline void free_packets(struct rtmp_stream *stream)
 	num_packets = num_buffered_packets(stream);
 	info("Freeing %d remaining packets", (int)num_packets);
 
-	while (stream->packets.size) {
-		struct encoder_packet packet;
-		circlebuf_pop_front(&stream->packets, &packet, sizeof(packet));
-		obs_free_encoder_packet(&packet);
-	}
+	packet_queue_clear(&stream->packets);
 	pthread_mutex_unlock(&stream->packets_mutex);
 }
 
@@ -147,7 +149,7 @@ static void rtmp_stream_destroy(void *data)
 		os_event_destroy(stream->stop_event);
 		os_sem_destroy(stream->send_sem);
 		pthread_mutex_destroy(&stream->packets_mutex);
-		circlebuf_free(&stream->packets);
+		packet_queue_free(&stream->packets);
 		bfree(stream);
 	}
 }
@@ -157,6 +159,7 @@ static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 	struct rtmp_stream *stream = bzalloc(sizeof(struct rtmp_stream));
 	stream->output = output;
 	pthread_mutex_init_value(&stream->packets_mutex);
+	packet_queue_init(&stream->packets);
 
 	RTMP_Init(&stream->rtmp);
 	RTMP_LogSetCallback(log_rtmp);
@@ -167,6 +170,9 @@ static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 	if (os_event_init(&stream->stop_event, OS_EVENT_TYPE_MANUAL) != 0)
 		goto fail;
 
+	signal_handler_add(obs_output_get_signal_handler(output),
+			"void video_bitrate(ptr output, int bitrate)");
+
 	UNUSED_PARAMETER(settings);
 	return stream;
 
@@ -234,39 +240,70 @@ static inline void set_rtmp_dstr(AVal *val, struct dstr *str)
 static inline bool get_next_packet(struct rtmp_stream *stream,
 		struct encoder_packet *packet)
 {
-	bool new_packet = false;
+	bool new_packet;
 
 	pthread_mutex_lock(&stream->packets_mutex);
-	if (stream->packets.size) {
-		circlebuf_pop_front(&stream->packets, packet,
-				sizeof(struct encoder_packet));
-		new_packet = true;
-	}
+	new_packet = packet_queue_pop(&stream->packets, packet);
 	pthread_mutex_unlock(&stream->packets_mutex);
 
 	return new_packet;
 }
 
-static int send_packet(struct rtmp_stream *stream,
-		struct encoder_packet *packet, bool is_header, size_t idx)
+static int send_header_packet(struct rtmp_stream *stream,
+		struct encoder_packet *packet, size_t idx)
 {
 	uint8_t *data;
 	size_t  size;
 	int     ret = 0;
 
-	flv_packet_mux(packet, &data, &size, is_header);
-#ifdef TEST_FRAMEDROPS
-	os_sleep_ms(rand() % 40);
-#endif
+	flv_packet_mux(packet, &data, &size, true);
 	ret = RTMP_Write(&stream->rtmp, (char*)data, (int)size, (int)idx);
 	bfree(data);
+	bfree(packet->data);
 
-	obs_free_encoder_packet(packet);
+	obs_output_add_bytes_copied(stream->output, size);
 
 	stream->total_bytes_sent += size;
 	return ret;
 }
 
+static int send_packet(struct rtmp_stream *stream,
+		struct encoder_packet *packet, bool is_header, size_t idx)
+{
+	uint8_t    body_header[FLV_MAX_BODY_HEADER_SIZE];
+	RTMPIOVec  body[2];
+	int        type;
+	int        ret = 0;
+
+	if (is_header)
+		return send_header_packet(stream, packet, idx);
+
+	if (!packet->data || !packet->size) {
+		obs_encoder_packet_release(packet);
+		return 0;
+	}
+
+	/* send the codec header and the packet data straight from the
+	 * encoder packet rather than muxing them into a new FLV tag */
+	body[0].base = (const char*)body_header;
+	body[0].len  = (int)flv_packet_body_header(packet, false, body_header);
+	body[1].base = (const char*)packet->data;
+	body[1].len  = (int)packet->size;
+
+	type = packet->type == OBS_ENCODER_VIDEO ?
+		RTMP_PACKET_TYPE_VIDEO : RTMP_PACKET_TYPE_AUDIO;
+
+#ifdef TEST_FRAMEDROPS
+	os_sleep_ms(rand() % 40);
+#endif
+	ret = RTMP_WriteV(&stream->rtmp, type, flv_packet_timestamp(packet),
+			body, 2, (int)idx);
+
+	stream->total_bytes_sent += body[0].len + body[1].len;
+	obs_encoder_packet_release(packet);
+	return ret;
+}
+
 static inline void send_headers(struct rtmp_stream *stream);
 
 static bool send_remaining_packets(struct rtmp_stream *stream)
@@ -294,6 +331,83 @@ static bool send_remaining_packets(struct rtmp_stream *stream)
 	return true;
 }
 
+static int64_t buffered_duration_usec(struct rtmp_stream *stream)
+{
+	const struct encoder_packet *first;
+	int64_t duration = 0;
+
+	pthread_mutex_lock(&stream->packets_mutex);
+	first = packet_queue_front(&stream->packets);
+	if (first)
+		duration = stream->last_dts_usec - first->dts_usec;
+	pthread_mutex_unlock(&stream->packets_mutex);
+
+	return duration;
+}
+
+static void set_video_bitrate(struct rtmp_stream *stream, int kbps)
+{
+	obs_encoder_t *vencoder = obs_output_get_video_encoder(stream->output);
+	struct calldata params = {0};
+
+	obs_encoder_set_bitrate(vencoder, kbps);
+
+	calldata_set_ptr(&params, "output", stream->output);
+	calldata_set_int(&params, "bitrate", kbps);
+	signal_handler_signal(obs_output_get_signal_handler(stream->output),
+			"video_bitrate", &params);
+	calldata_free(&params);
+}
+
+static void init_dyn_bitrate(struct rtmp_stream *stream)
+{
+	obs_encoder_t *vencoder = obs_output_get_video_encoder(stream->output);
+	obs_data_t *settings;
+	int kbps;
+
+	if (!stream->dyn_bitrate)
+		return;
+
+	settings = obs_encoder_get_settings(vencoder);
+	kbps = (int)obs_data_get_int(settings, "bitrate");
+	obs_data_release(settings);
+
+	if (kbps <= 0) {
+		info("Video encoder has no bitrate setting, dynamic bitrate "
+		     "disabled");
+		stream->dyn_bitrate = false;
+		return;
+	}
+
+	rtmp_bitrate_init(&stream->bitrate, kbps, stream->drop_threshold_usec,
+			os_gettime_ns());
+}
+
+static void update_dyn_bitrate(struct rtmp_stream *stream, uint64_t bytes)
+{
+	struct rtmp_bitrate *br = &stream->bitrate;
+	int prev_kbps = br->cur_kbps;
+
+	if (rtmp_bitrate_update(br, (size_t)bytes,
+				buffered_duration_usec(stream),
+				os_gettime_ns())) {
+		info("Congestion: changing video bitrate from %d to %d kbps",
+				prev_kbps, br->cur_kbps);
+		set_video_bitrate(stream, br->cur_kbps);
+	}
+}
+
+static void reset_dyn_bitrate(struct rtmp_stream *stream)
+{
+	struct rtmp_bitrate *br = &stream->bitrate;
+
+	if (stream->dyn_bitrate && br->cur_kbps != br->orig_kbps) {
+		info("Restoring video bitrate to %d kbps", br->orig_kbps);
+		br->cur_kbps = br->orig_kbps;
+		set_video_bitrate(stream, br->orig_kbps);
+	}
+}
+
 static void *send_thread(void *data)
 {
 	struct rtmp_stream *stream = data;
@@ -302,6 +416,7 @@ static void *send_thread(void *data)
 
 	while (os_sem_wait(stream->send_sem) == 0) {
 		struct encoder_packet packet;
+		uint64_t prev_bytes_sent;
 
 		if (stopping(stream))
 			break;
@@ -311,12 +426,21 @@ static void *send_thread(void *data)
 		if (!stream->sent_headers)
 			send_headers(stream);
 
+		prev_bytes_sent = stream->total_bytes_sent;
+
 		if (send_packet(stream, &packet, false, packet.track_idx) < 0) {
 			os_atomic_set_bool(&stream->disconnected, true);
 			break;
 		}
+
+		if (stream->dyn_bitrate)
+			update_dyn_bitrate(stream,
+					stream->total_bytes_sent -
+					prev_bytes_sent);
 	}
 
+	reset_dyn_bitrate(stream);
+
 	if (!stream->disconnected && !send_remaining_packets(stream))
 		os_atomic_set_bool(&stream->disconnected, true);
 
@@ -439,6 +563,7 @@ static int init_send(struct rtmp_stream *stream)
 #endif
 
 	reset_semaphore(stream);
+	init_dyn_bitrate(stream);
 
 	ret = pthread_create(&stream->send_thread, NULL, send_thread, stream);
 	if (ret != 0) {
@@ -542,6 +667,8 @@ static bool init_connect(struct rtmp_stream *stream)
 		(int64_t)obs_data_get_int(settings, OPT_DROP_THRESHOLD) * 1000;
 	stream->max_shutdown_time_sec =
 		(int)obs_data_get_int(settings, OPT_MAX_SHUTDOWN_TIME_SEC);
+	stream->dyn_bitrate =
+		obs_data_get_bool(settings, OPT_DYN_BITRATE);
 	obs_data_release(settings);
 	return true;
 }
@@ -589,74 +716,51 @@ static bool rtmp_stream_start(void *data)
 static inline bool add_packet(struct rtmp_stream *stream,
 		struct encoder_packet *packet)
 {
-	circlebuf_push_back(&stream->packets, packet,
-			sizeof(struct encoder_packet));
+	packet_queue_push(&stream->packets, packet);
 	stream->last_dts_usec = packet->dts_usec;
 	return true;
 }
 
 static inline size_t num_buffered_packets(struct rtmp_stream *stream)
 {
-	return stream->packets.size / sizeof(struct encoder_packet);
+	return packet_queue_size(&stream->packets);
 }
 
 static void drop_frames(struct rtmp_stream *stream)
 {
-	struct circlebuf new_buf            = {0};
-	int              drop_priority      = 0;
-	uint64_t         last_drop_dts_usec = 0;
-	int              num_frames_dropped = 0;
+	int    drop_priority = 0;
+	size_t num_frames_dropped;
 
 	debug("Previous packet count: %d", (int)num_buffered_packets(stream));
 
-	circlebuf_reserve(&new_buf, sizeof(struct encoder_packet) * 8);
-
-	while (stream->packets.size) {
-		struct encoder_packet packet;
-		circlebuf_pop_front(&stream->packets, &packet, sizeof(packet));
-
-		last_drop_dts_usec = packet.dts_usec;
-
-		/* do not drop audio data or video keyframes */
-		if (packet.type          == OBS_ENCODER_AUDIO ||
-		    packet.drop_priority == OBS_NAL_PRIORITY_HIGHEST) {
-			circlebuf_push_back(&new_buf, &packet, sizeof(packet));
-
-		} else {
-			if (drop_priority < packet.drop_priority)
-				drop_priority = packet.drop_priority;
+	/* do not drop audio data or video keyframes */
+	num_frames_dropped = packet_queue_drop(&stream->packets,
+			OBS_NAL_PRIORITY_HIGHEST, &drop_priority);
 
-			num_frames_dropped++;
-			obs_free_encoder_packet(&packet);
-		}
-	}
-
-	circlebuf_free(&stream->packets);
-	stream->packets           = new_buf;
 	stream->min_priority      = drop_priority;
-	stream->min_drop_dts_usec = last_drop_dts_usec;
+	stream->min_drop_dts_usec = stream->last_dts_usec;
 
-	stream->dropped_frames += num_frames_dropped;
+	stream->dropped_frames += (int)num_frames_dropped;
 	debug("New packet count: %d", (int)num_buffered_packets(stream));
 }
 
 static void check_to_drop_frames(struct rtmp_stream *stream)
 {
-	struct encoder_packet first;
+	const struct encoder_packet *first;
 	int64_t buffer_duration_usec;
 
 	if (num_buffered_packets(stream) < 5)
 		return;
 
-	circlebuf_peek_front(&stream->packets, &first, sizeof(first));
+	first = packet_queue_front(&stream->packets);
 
 	/* do not drop frames if frames were just dropped within this time */
-	if (first.dts_usec < stream->min_drop_dts_usec)
+	if (first->dts_usec < stream->min_drop_dts_usec)
 		return;
 
 	/* if the amount of time stored in the buffered packets waiting to be
 	 * sent is higher than threshold, drop frames */
-	buffer_duration_usec = stream->last_dts_usec - first.dts_usec;
+	buffer_duration_usec = stream->last_dts_usec - first->dts_usec;
 
 	if (buffer_duration_usec > stream->drop_threshold_usec) {
 		drop_frames(stream);
@@ -691,10 +795,12 @@ static void rtmp_stream_data(void *data, struct encoder_packet *packet)
 	if (stream->disconnected)
 		return;
 
-	if (packet->type == OBS_ENCODER_VIDEO)
-		obs_parse_avc_packet(&new_packet, packet);
-	else
-		obs_duplicate_encoder_packet(&new_packet, packet);
+	if (packet->type == OBS_ENCODER_VIDEO) {
+		obs_parse_avc_packet_ref(&new_packet, packet);
+		obs_output_add_bytes_copied(stream->output, new_packet.size);
+	} else {
+		obs_encoder_packet_ref(&new_packet, packet);
+	}
 
 	pthread_mutex_lock(&stream->packets_mutex);
 
@@ -707,13 +813,14 @@ static void rtmp_stream_data(void *data, struct encoder_packet *packet)
 	if (added_packet)
 		os_sem_post(stream->send_sem);
 	else
-		obs_free_encoder_packet(&new_packet);
+		obs_encoder_packet_release(&new_packet);
 }
 
 static void rtmp_stream_defaults(obs_data_t *defaults)
 {
 	obs_data_set_default_int(defaults, OPT_DROP_THRESHOLD, 600);
 	obs_data_set_default_int(defaults, OPT_MAX_SHUTDOWN_TIME_SEC, 5);
+	obs_data_set_default_bool(defaults, OPT_DYN_BITRATE, false);
 }
 
 static obs_properties_t *rtmp_stream_properties(void *unused)
@@ -725,6 +832,8 @@ static obs_properties_t *rtmp_stream_properties(void *unused)
 	obs_properties_add_int(props, OPT_DROP_THRESHOLD,
 			obs_module_text("RTMPStream.DropThreshold"),
 			200, 10000, 100);
+	obs_properties_add_bool(props, OPT_DYN_BITRATE,
+			obs_module_text("RTMPStream.DynamicBitrate"));
 	return props;
 }
 
@@ -0,0 +1,290 @@
+/******************************************************************************
+Copyright (C) 2014 by Nibbles
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "glyph-atlas.h"
+
+#define texbuf_w 2048
+#define texbuf_h 2048
+
+extern FT_Library ft2_lib;
+
+static pthread_mutex_t    atlas_list_mutex;
+static struct glyph_atlas *first_atlas = NULL;
+
+bool glyph_atlas_init(void)
+{
+	pthread_mutex_init_value(&atlas_list_mutex);
+	return pthread_mutex_init(&atlas_list_mutex, NULL) == 0;
+}
+
+void glyph_atlas_free(void)
+{
+	if (first_atlas)
+		blog(LOG_WARNING, "FT2-text: Glyph atlases still in use on "
+		                  "unload");
+
+	pthread_mutex_destroy(&atlas_list_mutex);
+}
+
+#define glyph_pos x + (y*slot->bitmap.pitch)
+#define buf_pos (dx + x) + ((dy + y) * texbuf_w)
+
+/* renders the glyphs not in the atlas yet, returns the number of new glyphs.
+ * call with the atlas mutex locked. */
+static int cache_glyphs(struct glyph_atlas *atlas, const wchar_t *text,
+		bool *full)
+{
+	FT_GlyphSlot slot = atlas->face->glyph;
+	FT_UInt glyph_index = 0;
+
+	uint32_t dx = atlas->texbuf_x, dy = atlas->texbuf_y;
+	uint8_t alpha;
+
+	int32_t cached_glyphs = 0;
+	size_t len = wcslen(text);
+
+	for (size_t i = 0; i < len; i++) {
+		struct glyph_info *glyph;
+
+		glyph_index = FT_Get_Char_Index(atlas->face, text[i]);
+
+		if (glyph_index >= num_cache_slots ||
+		    atlas->glyphs[glyph_index] != NULL)
+			continue;
+
+		FT_Load_Glyph(atlas->face, glyph_index, FT_LOAD_DEFAULT);
+		FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL);
+
+		uint32_t g_w = slot->bitmap.width;
+		uint32_t g_h = slot->bitmap.rows;
+
+		if (atlas->max_h < g_h) atlas->max_h = g_h;
+
+		if (dx + g_w >= texbuf_w) {
+			dx = 0;
+			dy += atlas->max_h + 1;
+		}
+
+		if (dy + g_h >= texbuf_h) {
+			*full = true;
+			break;
+		}
+
+		glyph = bzalloc(sizeof(struct glyph_info));
+		glyph->u = (float)dx / (float)texbuf_w;
+		glyph->u2 = (float)(dx + g_w) / (float)texbuf_w;
+		glyph->v = (float)dy / (float)texbuf_h;
+		glyph->v2 = (float)(dy + g_h) / (float)texbuf_h;
+		glyph->w = g_w;
+		glyph->h = g_h;
+		glyph->yoff = slot->bitmap_top;
+		glyph->xoff = slot->bitmap_left;
+		glyph->xadv = slot->advance.x >> 6;
+
+		for (uint32_t y = 0; y < g_h; y++) {
+			for (uint32_t x = 0; x < g_w; x++) {
+				alpha = slot->bitmap.buffer[glyph_pos];
+				atlas->texbuf[buf_pos] =
+					0x00FFFFFF ^ ((uint32_t)alpha << 24);
+			}
+		}
+
+		atlas->glyphs[glyph_index] = glyph;
+
+		dx += (g_w + 1);
+		if (dx >= texbuf_w) {
+			dx = 0;
+			dy += atlas->max_h;
+		}
+
+		cached_glyphs++;
+	}
+
+	atlas->texbuf_x = dx;
+	atlas->texbuf_y = dy;
+
+	return cached_glyphs;
+}
+
+bool glyph_atlas_cache(struct glyph_atlas *atlas, const wchar_t *text)
+{
+	int cached_glyphs;
+	bool full = false;
+
+	if (!atlas || !text)
+		return true;
+
+	pthread_mutex_lock(&atlas->mutex);
+	cached_glyphs = cache_glyphs(atlas, text, &full);
+	pthread_mutex_unlock(&atlas->mutex);
+
+	if (cached_glyphs > 0) {
+		obs_enter_graphics();
+		pthread_mutex_lock(&atlas->mutex);
+
+		if (atlas->tex == NULL)
+			atlas->tex = gs_texture_create(texbuf_w, texbuf_h,
+					GS_RGBA, 1, NULL, GS_DYNAMIC);
+		if (atlas->tex != NULL)
+			gs_texture_set_image(atlas->tex,
+					(const uint8_t*)atlas->texbuf,
+					texbuf_w * 4, false);
+
+		pthread_mutex_unlock(&atlas->mutex);
+		obs_leave_graphics();
+	}
+
+	return !full;
+}
+
+static void glyph_atlas_destroy(struct glyph_atlas *atlas)
+{
+	for (uint32_t i = 0; i < num_cache_slots; i++)
+		bfree(atlas->glyphs[i]);
+
+	if (atlas->tex) {
+		obs_enter_graphics();
+		gs_texture_destroy(atlas->tex);
+		obs_leave_graphics();
+	}
+
+	if (atlas->face)
+		FT_Done_Face(atlas->face);
+
+	pthread_mutex_destroy(&atlas->mutex);
+	bfree(atlas->texbuf);
+	bfree(atlas->path);
+	bfree(atlas);
+}
+
+static struct glyph_atlas *glyph_atlas_create(const char *path,
+		FT_Long index, uint16_t size, uint32_t flags)
+{
+	struct glyph_atlas *atlas = bzalloc(sizeof(struct glyph_atlas));
+
+	pthread_mutex_init_value(&atlas->mutex);
+	if (pthread_mutex_init(&atlas->mutex, NULL) != 0) {
+		bfree(atlas);
+		return NULL;
+	}
+
+	atlas->path  = bstrdup(path);
+	atlas->index = index;
+	atlas->size  = size;
+	atlas->flags = flags;
+	atlas->refs  = 1;
+
+	if (FT_New_Face(ft2_lib, path, index, &atlas->face) != 0) {
+		atlas->face = NULL;
+		glyph_atlas_destroy(atlas);
+		return NULL;
+	}
+
+	FT_Set_Pixel_Sizes(atlas->face, 0, size);
+	FT_Select_Charmap(atlas->face, FT_ENCODING_UNICODE);
+
+	atlas->texbuf = bzalloc(texbuf_w * texbuf_h * 4);
+	return atlas;
+}
+
+struct glyph_atlas *glyph_atlas_get(const char *path, FT_Long index,
+		uint16_t size, uint32_t flags)
+{
+	struct glyph_atlas *atlas;
+	bool created = false;
+
+	pthread_mutex_lock(&atlas_list_mutex);
+
+	atlas = first_atlas;
+	while (atlas) {
+		if (atlas->index == index && atlas->size == size &&
+		    atlas->flags == flags && strcmp(atlas->path, path) == 0)
+			break;
+		atlas = atlas->next;
+	}
+
+	if (atlas) {
+		atlas->refs++;
+	} else {
+		atlas = glyph_atlas_create(path, index, size, flags);
+		if (atlas) {
+			atlas->next   = first_atlas;
+			atlas->listed = true;
+			first_atlas   = atlas;
+			created       = true;
+		}
+	}
+
+	pthread_mutex_unlock(&atlas_list_mutex);
+
+	if (created)
+		glyph_atlas_cache(atlas, L"abcdefghijklmnopqrstuvwxyz" \
+			L"ABCDEFGHIJKLMNOPQRSTUVWXYZ1234567890" \
+			L"!@#$%^&*()-_=+,<.>/?\\|[]{}`~ \'\"\0");
+
+	return atlas;
+}
+
+/* call with the list mutex locked */
+static void unlist_atlas(struct glyph_atlas *atlas)
+{
+	struct glyph_atlas **prev = &first_atlas;
+
+	if (!atlas->listed)
+		return;
+
+	while (*prev != atlas)
+		prev = &(*prev)->next;
+	*prev = atlas->next;
+	atlas->listed = false;
+}
+
+void glyph_atlas_release(struct glyph_atlas *atlas)
+{
+	bool destroy = false;
+
+	if (!atlas)
+		return;
+
+	pthread_mutex_lock(&atlas_list_mutex);
+
+	if (--atlas->refs == 0) {
+		unlist_atlas(atlas);
+		destroy = true;
+	}
+
+	pthread_mutex_unlock(&atlas_list_mutex);
+
+	if (destroy)
+		glyph_atlas_destroy(atlas);
+}
+
+struct glyph_atlas *glyph_atlas_renew(struct glyph_atlas *atlas)
+{
+	if (!atlas)
+		return NULL;
+
+	pthread_mutex_lock(&atlas_list_mutex);
+	if (atlas->listed)
+		blog(LOG_INFO, "FT2-text: Glyph atlas of %s is full, "
+		               "creating a new one", atlas->path);
+	unlist_atlas(atlas);
+	pthread_mutex_unlock(&atlas_list_mutex);
+
+	return glyph_atlas_get(atlas->path, atlas->index, atlas->size,
+			atlas->flags);
+}
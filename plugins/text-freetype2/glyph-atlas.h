@@ -0,0 +1,99 @@
+/******************************************************************************
+Copyright (C) 2014 by Nibbles
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <obs-module.h>
+#include <util/threading.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#define num_cache_slots 65535
+
+struct glyph_info {
+	float u, v, u2, v2;
+	int32_t w, h, xoff, yoff;
+	int32_t xadv;
+};
+
+/*
+ * Glyph atlas shared by every text source that uses the same font file,
+ * face, size and flags: the face, the rendered glyphs and their texture
+ * exist once no matter how many sources draw with them.
+ *
+ * An atlas that is full is taken out of the list, so that sources that need
+ * more glyphs move to a new atlas for the font while the others keep drawing
+ * with the full one until they release it.
+ *
+ * The mutex guards the face, the glyph table and the texture buffer.  The
+ * texture is only replaced within the graphics context; to avoid lock order
+ * inversions, the mutex may be locked within the graphics context but the
+ * graphics context must not be entered while holding the mutex.
+ */
+struct glyph_atlas {
+	char              *path;
+	FT_Long           index;
+	uint16_t          size;
+	uint32_t          flags;
+	long              refs;
+	bool              listed;
+
+	pthread_mutex_t   mutex;
+	FT_Face           face;
+	uint32_t          max_h;
+
+	/* indexed by glyph index */
+	struct glyph_info *glyphs[num_cache_slots];
+
+	uint32_t          *texbuf;
+	uint32_t          texbuf_x, texbuf_y;
+	gs_texture_t      *tex;
+
+	struct glyph_atlas *next;
+};
+
+extern bool glyph_atlas_init(void);
+extern void glyph_atlas_free(void);
+
+/**
+ * Returns a reference to the atlas of a font, creating it if no source uses
+ * the font yet.  Returns NULL if the font could not be loaded.
+ */
+extern struct glyph_atlas *glyph_atlas_get(const char *path, FT_Long index,
+		uint16_t size, uint32_t flags);
+extern void glyph_atlas_release(struct glyph_atlas *atlas);
+
+/**
+ * Returns a reference to a new atlas for the font of a full atlas, and stops
+ * sharing the full one.  The reference to the full atlas is not released.
+ */
+extern struct glyph_atlas *glyph_atlas_renew(struct glyph_atlas *atlas);
+
+/**
+ * Renders any glyphs of the text not in the atlas yet, and uploads them.
+ * Returns false if the atlas is full and some of the glyphs are missing.
+ */
+extern bool glyph_atlas_cache(struct glyph_atlas *atlas, const wchar_t *text);
+
+/** Returns the glyph of a character, call with the atlas mutex locked */
+static inline struct glyph_info *glyph_atlas_find(struct glyph_atlas *atlas,
+		wchar_t c)
+{
+	FT_UInt glyph_index = FT_Get_Char_Index(atlas->face, c);
+	return glyph_index < num_cache_slots ?
+		atlas->glyphs[glyph_index] : NULL;
+}
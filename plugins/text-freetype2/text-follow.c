@@ -0,0 +1,486 @@
+/******************************************************************************
+Copyright (C) 2014 by Nibbles
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <errno.h>
+#include <util/bmem.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include "text-follow.h"
+
+#ifdef __linux__
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#define USE_INOTIFY
+#endif
+
+#define POLL_INTERVAL_MS 1000
+#define READ_BLOCK_SIZE  4096
+
+struct text_follow {
+	char              *path;
+	size_t            max_lines;
+
+	/* only used by the follow thread once it runs */
+	int64_t           offset;
+	bool              utf16;
+	bool              open_failed;
+	DARRAY(uint8_t)   partial;
+	size_t            scanned;
+
+	/* ring of the last complete lines, oldest at first */
+	wchar_t           **lines;
+	size_t            first;
+	size_t            num_lines;
+
+	pthread_mutex_t   mutex;
+	wchar_t           *text;
+
+	pthread_t         thread;
+	bool              thread_active;
+	os_event_t        *stop_event;
+#ifdef USE_INOTIFY
+	int               inotify_fd;
+	int               watch;
+	int               wake_fd;
+#endif
+};
+
+static wchar_t *to_wcs(const uint8_t *data, size_t size, bool utf16)
+{
+	wchar_t *wcs;
+	size_t len = 0;
+
+	if (utf16) {
+		const uint16_t *units = (const uint16_t*)data;
+		size_t num_units = size / 2;
+
+		wcs = bmalloc((num_units + 1) * sizeof(wchar_t));
+		for (size_t i = 0; i < num_units; i++) {
+			if (units[i] != L'\r')
+				wcs[len++] = (wchar_t)units[i];
+		}
+		wcs[len] = 0;
+		return wcs;
+	}
+
+	if (!size)
+		return bzalloc(sizeof(wchar_t));
+
+	char *str = bstrdup_n((const char*)data, size);
+	os_utf8_to_wcs_ptr(str, size, &wcs);
+	bfree(str);
+
+	for (size_t i = 0; wcs[i] != 0; i++) {
+		if (wcs[i] != L'\r')
+			wcs[len++] = wcs[i];
+	}
+	wcs[len] = 0;
+	return wcs;
+}
+
+static inline bool is_line_break(const uint8_t *data, bool utf16)
+{
+	return utf16 ? (data[0] == '\n' && data[1] == 0) : data[0] == '\n';
+}
+
+static void push_line(struct text_follow *follow, const uint8_t *data,
+		size_t size)
+{
+	wchar_t *line = to_wcs(data, size, follow->utf16);
+	size_t idx;
+
+	if (follow->num_lines == follow->max_lines) {
+		bfree(follow->lines[follow->first]);
+		follow->lines[follow->first] = line;
+		follow->first = (follow->first + 1) % follow->max_lines;
+		return;
+	}
+
+	idx = (follow->first + follow->num_lines++) % follow->max_lines;
+	follow->lines[idx] = line;
+}
+
+/* moves the complete lines of the partial line buffer to the ring */
+static void split_lines(struct text_follow *follow)
+{
+	const uint8_t *data = follow->partial.array;
+	size_t step = follow->utf16 ? 2 : 1;
+	size_t start = 0;
+	size_t i;
+
+	for (i = follow->scanned; i + step <= follow->partial.num; i += step) {
+		if (is_line_break(data + i, follow->utf16)) {
+			push_line(follow, data + start, i - start);
+			start = i + step;
+		}
+	}
+
+	if (start)
+		da_erase_range(follow->partial, 0, start);
+	follow->scanned = i - start;
+}
+
+static void clear_lines(struct text_follow *follow)
+{
+	for (size_t i = 0; i < follow->num_lines; i++)
+		bfree(follow->lines[(follow->first + i) % follow->max_lines]);
+
+	follow->first     = 0;
+	follow->num_lines = 0;
+	follow->scanned   = 0;
+	da_resize(follow->partial, 0);
+}
+
+static void publish_text(struct text_follow *follow)
+{
+	wchar_t *partial = to_wcs(follow->partial.array, follow->partial.num,
+			follow->utf16);
+	size_t len = wcslen(partial) + 1;
+	wchar_t *text;
+	wchar_t *pos;
+
+	for (size_t i = 0; i < follow->num_lines; i++) {
+		size_t idx = (follow->first + i) % follow->max_lines;
+		len += wcslen(follow->lines[idx]) + 1;
+	}
+
+	text = bmalloc(len * sizeof(wchar_t));
+	pos  = text;
+
+	for (size_t i = 0; i < follow->num_lines; i++) {
+		size_t idx = (follow->first + i) % follow->max_lines;
+		size_t line_len = wcslen(follow->lines[idx]);
+
+		if (i)
+			*(pos++) = L'\n';
+		memcpy(pos, follow->lines[idx], line_len * sizeof(wchar_t));
+		pos += line_len;
+	}
+
+	if (*partial) {
+		size_t partial_len = wcslen(partial);
+
+		if (follow->num_lines)
+			*(pos++) = L'\n';
+		memcpy(pos, partial, partial_len * sizeof(wchar_t));
+		pos += partial_len;
+	}
+	*pos = 0;
+	bfree(partial);
+
+	pthread_mutex_lock(&follow->mutex);
+	bfree(follow->text);
+	follow->text = text;
+	pthread_mutex_unlock(&follow->mutex);
+}
+
+/* returns the offset just past the line break before the last lines of the
+ * file.  reads backwards a block at a time rather than a character at a
+ * time, and stops as soon as enough lines have been seen. */
+static int64_t find_tail(struct text_follow *follow, FILE *file,
+		int64_t start, int64_t size)
+{
+	uint8_t block[READ_BLOCK_SIZE];
+	size_t step = follow->utf16 ? 2 : 1;
+	size_t line_breaks = 0;
+	int64_t pos = size;
+
+	/* keep utf-16 reads aligned to whole characters */
+	if (follow->utf16)
+		pos -= (pos - start) & 1;
+
+	while (pos > start) {
+		int64_t block_start = pos - READ_BLOCK_SIZE;
+		size_t block_size;
+
+		if (block_start < start)
+			block_start = start;
+		block_size = (size_t)(pos - block_start);
+
+		if (os_fseeki64(file, block_start, SEEK_SET) != 0 ||
+		    fread(block, 1, block_size, file) != block_size)
+			return start;
+
+		for (size_t i = block_size; i >= step; i -= step) {
+			if (!is_line_break(block + i - step, follow->utf16))
+				continue;
+
+			/* one more line break than lines, the last line of
+			 * the file ends with one */
+			if (++line_breaks > follow->max_lines)
+				return block_start + (int64_t)i;
+		}
+
+		pos = block_start;
+	}
+
+	return start;
+}
+
+/* reads what was appended to the file since the last read.  if the file
+ * shrank, or is read for the first time, starts over from its last lines.
+ * returns true if the text changed. */
+static bool follow_read(struct text_follow *follow, bool reset)
+{
+	uint8_t block[READ_BLOCK_SIZE];
+	int64_t size = os_get_file_size(follow->path);
+	FILE *file;
+
+	if (size < 0)
+		return false;
+	if (size < follow->offset)
+		reset = true;
+	if (!reset && size == follow->offset)
+		return false;
+
+	file = os_fopen(follow->path, "rb");
+	if (!file) {
+		if (!follow->open_failed) {
+			blog(LOG_WARNING, "FT2-text: Failed to open %s for "
+			                  "reading", follow->path);
+			follow->open_failed = true;
+		}
+		return false;
+	}
+
+	follow->open_failed = false;
+
+	if (reset || follow->offset == 0) {
+		uint8_t bom[3] = {0};
+		size_t bom_size = fread(bom, 1, 3, file);
+		int64_t start = 0;
+
+		follow->utf16 = false;
+		if (bom_size >= 2 && bom[0] == 0xFF && bom[1] == 0xFE) {
+			follow->utf16 = true;
+			start = 2;
+		} else if (bom_size == 3 && bom[0] == 0xEF &&
+		           bom[1] == 0xBB && bom[2] == 0xBF) {
+			start = 3;
+		}
+
+		clear_lines(follow);
+		follow->offset = find_tail(follow, file, start, size);
+	}
+
+	if (os_fseeki64(file, follow->offset, SEEK_SET) == 0) {
+		size_t bytes;
+
+		while (follow->offset < size &&
+		       (bytes = fread(block, 1, sizeof(block), file)) > 0) {
+			if ((int64_t)bytes > size - follow->offset)
+				bytes = (size_t)(size - follow->offset);
+
+			da_push_back_array(follow->partial, block, bytes);
+			follow->offset += (int64_t)bytes;
+		}
+	}
+
+	fclose(file);
+
+	split_lines(follow);
+	publish_text(follow);
+	return true;
+}
+
+#ifdef USE_INOTIFY
+#define WATCH_EVENTS (IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | \
+		IN_MOVE_SELF | IN_DELETE_SELF)
+
+/* waits for changes to the file itself.  when the file is moved or deleted
+ * (log rotation), the watch is dropped, and the path is polled until a file
+ * exists there again, which is then read from its end */
+static void follow_inotify(struct text_follow *follow)
+{
+	struct pollfd fds[2] = {
+		{.fd = follow->wake_fd,    .events = POLLIN},
+		{.fd = follow->inotify_fd, .events = POLLIN}
+	};
+	char buf[4096]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
+
+	for (;;) {
+		int timeout = follow->watch == -1 ? POLL_INTERVAL_MS : -1;
+		bool reset = false;
+		int ret = poll(fds, 2, timeout);
+
+		if (ret < 0 && errno != EINTR)
+			break;
+		if (fds[0].revents & POLLIN)
+			break;
+
+		if (fds[1].revents & POLLIN) {
+			ssize_t len = read(follow->inotify_fd, buf, sizeof(buf));
+			char *ptr = buf;
+
+			while (len > 0 && ptr < buf + len) {
+				struct inotify_event *event = (void*)ptr;
+
+				if (event->wd == follow->watch &&
+				    event->mask & (IN_MOVE_SELF |
+				                   IN_DELETE_SELF |
+				                   IN_IGNORED)) {
+					if (!(event->mask & IN_IGNORED))
+						inotify_rm_watch(
+							follow->inotify_fd,
+							follow->watch);
+					follow->watch = -1;
+				}
+
+				ptr += sizeof(struct inotify_event) +
+					event->len;
+			}
+		}
+
+		if (follow->watch == -1) {
+			follow->watch = inotify_add_watch(follow->inotify_fd,
+					follow->path, WATCH_EVENTS);
+			reset = follow->watch != -1;
+		}
+
+		follow_read(follow, reset);
+	}
+}
+#endif
+
+static void *follow_thread(void *data)
+{
+	struct text_follow *follow = data;
+
+	os_set_thread_name("text-freetype2: file follow");
+
+#ifdef USE_INOTIFY
+	if (follow->inotify_fd != -1) {
+		follow_inotify(follow);
+		return NULL;
+	}
+#endif
+
+	while (os_event_timedwait(follow->stop_event, POLL_INTERVAL_MS) ==
+			ETIMEDOUT)
+		follow_read(follow, false);
+
+	return NULL;
+}
+
+struct text_follow *text_follow_create(const char *path, size_t max_lines)
+{
+	struct text_follow *follow;
+
+	if (!path || !*path || !max_lines)
+		return NULL;
+
+	follow = bzalloc(sizeof(struct text_follow));
+	follow->path      = bstrdup(path);
+	follow->max_lines = max_lines;
+	follow->lines     = bzalloc(max_lines * sizeof(wchar_t*));
+
+	pthread_mutex_init_value(&follow->mutex);
+	if (pthread_mutex_init(&follow->mutex, NULL) != 0)
+		goto fail_mutex;
+	if (os_event_init(&follow->stop_event, OS_EVENT_TYPE_MANUAL) != 0)
+		goto fail_event;
+
+#ifdef USE_INOTIFY
+	follow->wake_fd    = eventfd(0, EFD_CLOEXEC);
+	follow->inotify_fd = inotify_init1(IN_CLOEXEC);
+	follow->watch      = -1;
+
+	if (follow->inotify_fd != -1)
+		follow->watch = inotify_add_watch(follow->inotify_fd, path,
+				WATCH_EVENTS);
+
+	if (follow->wake_fd == -1 && follow->inotify_fd != -1) {
+		close(follow->inotify_fd);
+		follow->inotify_fd = -1;
+	}
+#endif
+
+	/* read the initial text before the thread starts, so it can be
+	 * shown right away */
+	if (!follow_read(follow, true))
+		publish_text(follow);
+
+	follow->thread_active = pthread_create(&follow->thread, NULL,
+			follow_thread, follow) == 0;
+	if (!follow->thread_active)
+		blog(LOG_WARNING, "FT2-text: Failed to create file follow "
+		                  "thread, %s will not be updated", path);
+
+	return follow;
+
+fail_event:
+	pthread_mutex_destroy(&follow->mutex);
+fail_mutex:
+	bfree(follow->lines);
+	bfree(follow->path);
+	bfree(follow);
+	return NULL;
+}
+
+void text_follow_destroy(struct text_follow *follow)
+{
+	if (!follow)
+		return;
+
+	if (follow->thread_active) {
+		os_event_signal(follow->stop_event);
+#ifdef USE_INOTIFY
+		if (follow->wake_fd != -1) {
+			uint64_t val = 1;
+			if (write(follow->wake_fd, &val, sizeof(val)) < 0)
+				blog(LOG_WARNING, "FT2-text: Failed to stop "
+				                  "file follow thread");
+		}
+#endif
+		pthread_join(follow->thread, NULL);
+	}
+
+#ifdef USE_INOTIFY
+	if (follow->inotify_fd != -1)
+		close(follow->inotify_fd);
+	if (follow->wake_fd != -1)
+		close(follow->wake_fd);
+#endif
+
+	clear_lines(follow);
+	da_free(follow->partial);
+	os_event_destroy(follow->stop_event);
+	pthread_mutex_destroy(&follow->mutex);
+	bfree(follow->text);
+	bfree(follow->lines);
+	bfree(follow->path);
+	bfree(follow);
+}
+
+wchar_t *text_follow_get_text(struct text_follow *follow)
+{
+	wchar_t *text;
+
+	if (!follow)
+		return NULL;
+
+	pthread_mutex_lock(&follow->mutex);
+	text = follow->text;
+	follow->text = NULL;
+	pthread_mutex_unlock(&follow->mutex);
+
+	return text;
+}
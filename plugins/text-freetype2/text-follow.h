@@ -0,0 +1,46 @@
+/******************************************************************************
+Copyright (C) 2014 by Nibbles
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <obs-module.h>
+
+/*
+ * Follows the end of a text file that is being appended to, such as a chat
+ * log.  A background thread waits for the file to change (with inotify on
+ * Linux, by polling its size elsewhere), reads only the bytes appended since
+ * the last read, and keeps the last lines of the file.  Each change
+ * publishes a new copy of the text, which the source takes as a whole.
+ *
+ * A file that shrinks or is replaced is followed again from its end.
+ */
+
+struct text_follow;
+
+/**
+ * Reads the last lines of a file and starts following it.  The initial text
+ * is available from text_follow_get_text as soon as this returns.
+ */
+extern struct text_follow *text_follow_create(const char *path,
+		size_t max_lines);
+extern void text_follow_destroy(struct text_follow *follow);
+
+/**
+ * Returns the text if it changed since the last call, or NULL.  The caller
+ * takes ownership of the returned string and frees it with bfree.
+ */
+extern wchar_t *text_follow_get_text(struct text_follow *follow);
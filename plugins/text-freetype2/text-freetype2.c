@@ -29,8 +29,6 @@ FT_Library ft2_lib;
 OBS_DECLARE_MODULE()
 OBS_MODULE_USE_DEFAULT_LOCALE("text-freetype2", "en-US")
 
-uint32_t texbuf_w = 2048, texbuf_h = 2048;
-
 static struct obs_source_info freetype2_source_info = {
 	.id = "text_ft2_source",
 	.type = OBS_SOURCE_TYPE_INPUT,
@@ -61,6 +59,12 @@ bool obs_module_load()
 		return false;
 	}
 
+	if (!glyph_atlas_init()) {
+		blog(LOG_WARNING, "FT2-text: Failed to initialize glyph atlases.");
+		FT_Done_FreeType(ft2_lib);
+		return false;
+	}
+
 	if (!load_cached_os_font_list())
 		load_os_font_list();
 
@@ -72,6 +76,7 @@ bool obs_module_load()
 void obs_module_unload(void)
 {
 	free_os_font_list();
+	glyph_atlas_free();
 	FT_Done_FreeType(ft2_lib);
 }
 
@@ -149,17 +154,11 @@ static void ft2_source_destroy(void *data)
 {
 	struct ft2_source *srcdata = data;
 
-	if (srcdata->font_face != NULL) {
-		FT_Done_Face(srcdata->font_face);
-		srcdata->font_face = NULL;
-	}
-	
-	for (uint32_t i = 0; i < num_cache_slots; i++) {
-		if (srcdata->cacheglyphs[i] != NULL) {
-			bfree(srcdata->cacheglyphs[i]);
-			srcdata->cacheglyphs[i] = NULL;
-		}
-	}
+	text_follow_destroy(srcdata->follow);
+	srcdata->follow = NULL;
+
+	glyph_atlas_release(srcdata->atlas);
+	srcdata->atlas = NULL;
 
 	if (srcdata->font_name != NULL)
 		bfree(srcdata->font_name);
@@ -167,19 +166,15 @@ static void ft2_source_destroy(void *data)
 		bfree(srcdata->font_style);
 	if (srcdata->text != NULL)
 		bfree(srcdata->text);
-	if (srcdata->texbuf != NULL)
-		bfree(srcdata->texbuf);
 	if (srcdata->colorbuf != NULL)
 		bfree(srcdata->colorbuf);
 	if (srcdata->text_file != NULL)
 		bfree(srcdata->text_file);
+	bfree(srcdata->layout_text);
+	da_free(srcdata->lines);
 
 	obs_enter_graphics();
 
-	if (srcdata->tex != NULL) {
-		gs_texture_destroy(srcdata->tex);
-		srcdata->tex = NULL;
-	}
 	if (srcdata->vbuf != NULL) {
 		gs_vertexbuffer_destroy(srcdata->vbuf);
 		srcdata->vbuf = NULL;
@@ -199,35 +194,76 @@ static void ft2_source_render(void *data, gs_effect_t *effect)
 	struct ft2_source *srcdata = data;
 	if (srcdata == NULL) return;
 
-	if (srcdata->tex == NULL || srcdata->vbuf == NULL) return;
+	if (srcdata->atlas == NULL || srcdata->atlas->tex == NULL ||
+	    srcdata->vbuf == NULL) return;
 
 	gs_reset_blend_state();
 	if (srcdata->outline_text) draw_outlines(srcdata);
 	if (srcdata->drop_shadow) draw_drop_shadow(srcdata);
 
-	draw_uv_vbuffer(srcdata->vbuf, srcdata->tex,
-		srcdata->draw_effect, (uint32_t)wcslen(srcdata->text) * 6);
+	draw_uv_vbuffer(srcdata->vbuf, srcdata->atlas->tex,
+		srcdata->draw_effect, srcdata->num_glyphs * 6);
 
 	UNUSED_PARAMETER(effect);
 }
 
+/* the atlas texture may be in use by the render */
+static void set_atlas(struct ft2_source *srcdata, struct glyph_atlas *atlas)
+{
+	struct glyph_atlas *old_atlas;
+
+	obs_enter_graphics();
+	old_atlas = srcdata->atlas;
+	srcdata->atlas = atlas;
+	srcdata->layout_valid = false;
+	obs_leave_graphics();
+
+	glyph_atlas_release(old_atlas);
+}
+
+/* moves to a new atlas if the glyphs of the text do not fit in the one that
+ * is shared with the other sources */
+static void cache_text(struct ft2_source *srcdata)
+{
+	struct glyph_atlas *atlas;
+
+	if (glyph_atlas_cache(srcdata->atlas, srcdata->text))
+		return;
+
+	atlas = glyph_atlas_renew(srcdata->atlas);
+	if (!atlas)
+		return;
+
+	set_atlas(srcdata, atlas);
+
+	if (!glyph_atlas_cache(srcdata->atlas, srcdata->text))
+		blog(LOG_WARNING, "FT2-text: Text of '%s' does not fit in a "
+		                  "glyph atlas",
+		                  obs_source_get_name(srcdata->src));
+}
+
 static void ft2_video_tick(void *data, float seconds)
 {
 	struct ft2_source *srcdata = data;
 	if (srcdata == NULL) return;
 	if (!srcdata->from_file || !srcdata->text_file) return;
 
-	if (os_gettime_ns() - srcdata->last_checked >= 1000000000) {
+	if (srcdata->follow) {
+		wchar_t *text = text_follow_get_text(srcdata->follow);
+
+		if (text) {
+			bfree(srcdata->text);
+			srcdata->text = text;
+			cache_text(srcdata);
+			set_up_vertex_buffer(srcdata);
+		}
+	} else if (os_gettime_ns() - srcdata->last_checked >= 1000000000) {
 		time_t t = get_modified_timestamp(srcdata->text_file);
 		srcdata->last_checked = os_gettime_ns();
 
 		if (srcdata->m_timestamp != t) {
-			if (srcdata->log_mode)
-				read_from_end(srcdata, srcdata->text_file);
-			else
-				load_text_from_file(srcdata,
-					srcdata->text_file);
-			cache_glyphs(srcdata, srcdata->text);
+			load_text_from_file(srcdata, srcdata->text_file);
+			cache_text(srcdata);
 			set_up_vertex_buffer(srcdata);
 		}
 	}
@@ -235,20 +271,35 @@ static void ft2_video_tick(void *data, float seconds)
 	UNUSED_PARAMETER(seconds);
 }
 
+/* replaces the file follower, and takes its initial text */
+static void follow_file(struct ft2_source *srcdata, const char *file)
+{
+	wchar_t *text;
+
+	text_follow_destroy(srcdata->follow);
+	srcdata->follow = text_follow_create(file, LOG_MODE_LINES);
+
+	text = text_follow_get_text(srcdata->follow);
+	if (text) {
+		bfree(srcdata->text);
+		srcdata->text = text;
+	}
+}
+
 static bool init_font(struct ft2_source *srcdata)
 {
+	struct glyph_atlas *atlas;
 	FT_Long index;
 	const char *path = get_font_path(srcdata->font_name, srcdata->font_size,
 			srcdata->font_style, srcdata->font_flags, &index);
 	if (!path)
 		return false;
 
-	if (srcdata->font_face != NULL) {
-		FT_Done_Face(srcdata->font_face);
-		srcdata->font_face = NULL;
-	}
+	atlas = glyph_atlas_get(path, index, srcdata->font_size,
+			srcdata->font_flags);
 
-	return FT_New_Face(ft2_lib, path, index, &srcdata->font_face) == 0;
+	set_atlas(srcdata, atlas);
+	return atlas != NULL;
 }
 
 static void ft2_source_update(void *data, obs_data_t *settings)
@@ -304,6 +355,11 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 
 	srcdata->log_mode = chat_log_mode;
 
+	if (!from_file || !chat_log_mode) {
+		text_follow_destroy(srcdata->follow);
+		srcdata->follow = NULL;
+	}
+
 	if (ft2_lib == NULL) goto error;
 
 	if (srcdata->draw_effect == NULL) {
@@ -343,7 +399,6 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 		bfree(srcdata->font_style);
 		srcdata->font_name = NULL;
 		srcdata->font_style = NULL;
-		srcdata->max_h = 0;
 		vbuf_needs_update = true;
 	}
 
@@ -352,26 +407,16 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 	srcdata->font_size  = font_size;
 	srcdata->font_flags = font_flags;
 
-	if (!init_font(srcdata) || srcdata->font_face == NULL) {
+	if (!init_font(srcdata)) {
 		blog(LOG_WARNING, "FT2-text: Failed to load font %s",
 			srcdata->font_name);
 		goto error;
 	}
-	else {
-		FT_Set_Pixel_Sizes(srcdata->font_face, 0, srcdata->font_size); 
-		FT_Select_Charmap(srcdata->font_face, FT_ENCODING_UNICODE);
-	}
-
-	if (srcdata->texbuf != NULL) {
-		bfree(srcdata->texbuf);
-		srcdata->texbuf = NULL;
-	}
-	srcdata->texbuf = bzalloc(texbuf_w * texbuf_h * 4);
-
-	if (srcdata->font_face)
-		cache_standard_glyphs(srcdata);
 
 skip_font_load:
+	if (vbuf_needs_update)
+		srcdata->layout_valid = false;
+
 	if (from_file) {
 		const char *tmp = obs_data_get_string(settings, "text_file");
 
@@ -387,18 +432,22 @@ skip_font_load:
 			                  "reading", tmp);
 		}
 		else {
-			if (srcdata->text_file != NULL &&
-				strcmp(srcdata->text_file, tmp) == 0 &&
-				!vbuf_needs_update)
+			bool same_file = srcdata->text_file != NULL &&
+				strcmp(srcdata->text_file, tmp) == 0;
+
+			if (same_file && !vbuf_needs_update &&
+			    chat_log_mode == (srcdata->follow != NULL))
 				goto error;
 
 			bfree(srcdata->text_file);
 
 			srcdata->text_file = bstrdup(tmp);
-			if (chat_log_mode)
-				read_from_end(srcdata, tmp);
-			else
+			if (chat_log_mode) {
+				if (!same_file || !srcdata->follow)
+					follow_file(srcdata, tmp);
+			} else {
 				load_text_from_file(srcdata, tmp);
+			}
 			srcdata->last_checked = os_gettime_ns();
 		}
 	}
@@ -414,8 +463,8 @@ skip_font_load:
 		os_utf8_to_wcs_ptr(tmp, strlen(tmp), &srcdata->text);
 	}
 
-	if (srcdata->font_face) {
-		cache_glyphs(srcdata, srcdata->text);
+	if (srcdata->atlas) {
+		cache_text(srcdata);
 		set_up_vertex_buffer(srcdata);
 	}
 
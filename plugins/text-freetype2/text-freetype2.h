@@ -16,15 +16,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
 #include <obs-module.h>
+#include <util/darray.h>
 #include <ft2build.h>
-
-#define num_cache_slots 65535
-#define src_glyph srcdata->cacheglyphs[glyph_index]
-
-struct glyph_info {
-	float u, v, u2, v2;
-	int32_t w, h, xoff, yoff;
-	int32_t xadv;
+#include "glyph-atlas.h"
+#include "text-follow.h"
+
+/* number of lines of the file shown in chat log mode */
+#define LOG_MODE_LINES 6
+
+/* a line of text in the vertex buffer, from one line break to the next */
+struct text_line {
+	size_t   start;
+	size_t   len;
+	uint32_t first_glyph;
+	uint32_t num_glyphs;
+	uint32_t dy, end_dy;
+	uint32_t max_y;
 };
 
 struct ft2_source {
@@ -39,22 +46,26 @@ struct ft2_source {
 	wchar_t *text;
 	time_t m_timestamp;
 	uint64_t last_checked;
+	struct text_follow *follow;
 
-	uint32_t cx, cy, max_h, custom_width;
-	uint32_t texbuf_x, texbuf_y;
+	uint32_t cx, cy, custom_width;
 	uint32_t color[2];
 	uint32_t *colorbuf;
 
 	int32_t cur_scroll, scroll_speed;
 
-	gs_texture_t *tex;
-
-	struct glyph_info *cacheglyphs[num_cache_slots];
+	struct glyph_atlas *atlas;
 
-	FT_Face	font_face;
-
-	uint32_t *texbuf;
 	gs_vertbuffer_t *vbuf;
+	uint32_t vbuf_glyphs;
+	uint32_t num_glyphs;
+
+	/* the text currently in the vertex buffer, lines that are the same
+	 * and at the same place are not laid out again */
+	wchar_t *layout_text;
+	DARRAY(struct text_line) lines;
+	uint32_t layout_max_h;
+	bool layout_valid;
 
 	gs_effect_t *draw_effect;
 	bool outline_text, drop_shadow;
@@ -81,14 +92,10 @@ static obs_properties_t *ft2_source_properties(void *unused);
 
 static const char *ft2_source_get_name(void *unused);
 
+/* call with the atlas mutex locked */
 uint32_t get_ft2_text_width(wchar_t *text, struct ft2_source *srcdata);
 
 time_t get_modified_timestamp(char *filename);
 void load_text_from_file(struct ft2_source *srcdata, const char *filename);
-void read_from_end(struct ft2_source *srcdata, const char *filename);
-
-void cache_standard_glyphs(struct ft2_source *srcdata);
-void cache_glyphs(struct ft2_source *srcdata, wchar_t *cache_glyphs);
 
 void set_up_vertex_buffer(struct ft2_source *srcdata);
-void fill_vertex_buffer(struct ft2_source *srcdata);
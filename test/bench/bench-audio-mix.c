@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <media-io/audio-mix.h>
+
+/*
+ * Benchmarks each CPU kernel set of the audio mixer by mixing a varying number
+ * of audio lines into all four mixes, the same way the audio thread does, and
+ * checks that every kernel set produces output identical to the C kernels.
+ *
+ * usage: bench-audio-mix [iterations]
+ */
+
+#define NUM_MIXES   4
+#define FRAMES      1024
+#define MAX_LINES   64
+
+/* not a multiple of any kernel width, and offset from the buffer start like
+ * a line that starts partway into a tick */
+#define FRAME_OFFSET 3
+
+static const size_t line_counts[] = {1, 2, 4, 8, 16, 32, 64};
+
+static float *lines[MAX_LINES];
+
+static void mix_lines(float *mix_data[], size_t num_lines)
+{
+	float *mixes[NUM_MIXES];
+
+	for (size_t i = 0; i < NUM_MIXES; i++) {
+		memset(mix_data[i], 0, FRAMES * sizeof(float));
+		mixes[i] = mix_data[i] + FRAME_OFFSET;
+	}
+
+	for (size_t i = 0; i < num_lines; i++)
+		audio_mix_float(mixes, NUM_MIXES, lines[i],
+				FRAMES - FRAME_OFFSET);
+
+	for (size_t i = 0; i < NUM_MIXES; i++)
+		audio_clamp_float(mix_data[i], FRAMES);
+}
+
+static bool bench_lines(size_t num_lines, int iterations)
+{
+	float *ref[NUM_MIXES];
+	bool  success = true;
+
+	audio_mix_set_isa(AUDIO_MIX_C);
+	for (size_t i = 0; i < NUM_MIXES; i++)
+		ref[i] = bmalloc(FRAMES * sizeof(float));
+	mix_lines(ref, num_lines);
+
+	for (int isa = AUDIO_MIX_C; isa <= AUDIO_MIX_AVX; isa++) {
+		float    *out[NUM_MIXES];
+		uint64_t start, elapsed;
+		double   samples;
+		bool     match = true;
+
+		if (!audio_mix_set_isa(isa))
+			continue;
+
+		for (size_t i = 0; i < NUM_MIXES; i++)
+			out[i] = bmalloc(FRAMES * sizeof(float));
+
+		mix_lines(out, num_lines);
+		for (size_t i = 0; i < NUM_MIXES; i++)
+			if (memcmp(ref[i], out[i], FRAMES * sizeof(float)))
+				match = false;
+
+		start = os_gettime_ns();
+		for (int i = 0; i < iterations; i++)
+			mix_lines(out, num_lines);
+		elapsed = os_gettime_ns() - start;
+
+		/* samples read from the lines per iteration */
+		samples = (double)num_lines * (FRAMES - FRAME_OFFSET) *
+			iterations;
+
+		printf("%2u lines  %-3s  %7.3f ns/sample  %8.2f us/tick  %s\n",
+		       (unsigned)num_lines, audio_mix_isa_name(isa),
+		       (double)elapsed / samples,
+		       (double)elapsed / iterations / 1000.0,
+		       match ? "ok" : "MISMATCH");
+
+		if (!match)
+			success = false;
+
+		for (size_t i = 0; i < NUM_MIXES; i++)
+			bfree(out[i]);
+	}
+
+	for (size_t i = 0; i < NUM_MIXES; i++)
+		bfree(ref[i]);
+	return success;
+}
+
+int main(int argc, char *argv[])
+{
+	int  iterations = argc > 1 ? atoi(argv[1]) : 2000;
+	bool success    = true;
+
+	if (iterations <= 0)
+		iterations = 1;
+
+	/* loud enough that the sum of many lines needs clamping */
+	for (size_t i = 0; i < MAX_LINES; i++) {
+		lines[i] = bmalloc(FRAMES * sizeof(float));
+		for (size_t j = 0; j < FRAMES; j++)
+			lines[i][j] = (float)rand() / (float)RAND_MAX - 0.5f;
+	}
+
+	printf("best supported kernel set: %s\n\n",
+			audio_mix_isa_name(audio_mix_get_isa()));
+
+	for (size_t i = 0; i < sizeof(line_counts) / sizeof(line_counts[0]);
+	     i++) {
+		if (!bench_lines(line_counts[i], iterations))
+			success = false;
+	}
+
+	for (size_t i = 0; i < MAX_LINES; i++)
+		bfree(lines[i]);
+
+	return success ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <media-io/format-conversion.h>
+
+/*
+ * Benchmarks each CPU kernel set of the packed UYVX conversion functions at
+ * common output resolutions and checks that every kernel set produces output
+ * identical to the SSE2 reference.
+ *
+ * usage: bench-format-conversion [iterations]
+ */
+
+struct resolution {
+	uint32_t cx, cy;
+};
+
+static const struct resolution resolutions[] = {
+	{1280, 720},
+	{1920, 1080},
+	{2560, 1440},
+	{3840, 2160},
+	{1284, 720},  /* not a multiple of any kernel width */
+};
+
+enum target_format {
+	TARGET_I420,
+	TARGET_NV12,
+	TARGET_I444
+};
+
+static const char *target_names[] = {"I420", "NV12", "I444"};
+
+struct planes {
+	uint8_t  *data[3];
+	uint32_t linesize[3];
+	size_t   size[3];
+};
+
+static void planes_init(struct planes *p, enum target_format format,
+		uint32_t cx, uint32_t cy)
+{
+	memset(p, 0, sizeof(*p));
+
+	p->linesize[0] = cx;
+	p->size[0]     = cx * cy;
+
+	if (format == TARGET_I444) {
+		p->linesize[1] = p->linesize[2] = cx;
+		p->size[1]     = p->size[2]     = cx * cy;
+	} else if (format == TARGET_I420) {
+		p->linesize[1] = p->linesize[2] = cx / 2;
+		p->size[1]     = p->size[2]     = cx / 2 * cy / 2;
+	} else {
+		p->linesize[1] = cx;
+		p->size[1]     = cx * cy / 2;
+	}
+
+	/* extra room: like the SSE2 reference, every kernel writes up to the
+	 * next multiple of 4 pixels */
+	for (size_t i = 0; i < 3; i++)
+		if (p->size[i])
+			p->data[i] = bzalloc(p->size[i] + 64);
+}
+
+static void planes_free(struct planes *p)
+{
+	for (size_t i = 0; i < 3; i++)
+		bfree(p->data[i]);
+}
+
+static bool planes_equal(const struct planes *a, const struct planes *b)
+{
+	for (size_t i = 0; i < 3; i++)
+		if (a->size[i] && memcmp(a->data[i], b->data[i], a->size[i]))
+			return false;
+	return true;
+}
+
+static void convert(enum target_format format, const uint8_t *input,
+		uint32_t in_linesize, uint32_t cy, struct planes *out)
+{
+	switch (format) {
+	case TARGET_I420:
+		compress_uyvx_to_i420(input, in_linesize, 0, cy,
+				out->data, out->linesize);
+		break;
+	case TARGET_NV12:
+		compress_uyvx_to_nv12(input, in_linesize, 0, cy,
+				out->data, out->linesize);
+		break;
+	case TARGET_I444:
+		convert_uyvx_to_i444(input, in_linesize, 0, cy,
+				out->data, out->linesize);
+	}
+}
+
+static bool bench_resolution(const struct resolution *res, int iterations)
+{
+	uint32_t in_linesize = res->cx * 4;
+	size_t   in_size     = (size_t)in_linesize * res->cy;
+	uint8_t  *input      = bmalloc(in_size);
+	bool     success     = true;
+
+	for (size_t i = 0; i < in_size; i++)
+		input[i] = (uint8_t)rand();
+
+	for (int f = TARGET_I420; f <= TARGET_I444; f++) {
+		struct planes ref;
+
+		planes_init(&ref, f, res->cx, res->cy);
+		format_conversion_set_isa(FORMAT_CONVERSION_SSE2);
+		convert(f, input, in_linesize, res->cy, &ref);
+
+		for (int isa = FORMAT_CONVERSION_SSE2;
+		     isa <= FORMAT_CONVERSION_AVX512BW; isa++) {
+			struct planes out;
+			uint64_t start, elapsed;
+			double   gbps;
+			bool     match;
+
+			if (!format_conversion_set_isa(isa))
+				continue;
+
+			planes_init(&out, f, res->cx, res->cy);
+			convert(f, input, in_linesize, res->cy, &out);
+			match = planes_equal(&ref, &out);
+
+			start = os_gettime_ns();
+			for (int i = 0; i < iterations; i++)
+				convert(f, input, in_linesize, res->cy, &out);
+			elapsed = os_gettime_ns() - start;
+
+			gbps = (double)in_size * iterations / (double)elapsed;
+
+			printf("%4ux%-4u  %s  %-9s  %7.3f ms/frame  "
+			       "%6.2f GB/s  %s\n",
+			       res->cx, res->cy, target_names[f],
+			       format_conversion_isa_name(isa),
+			       (double)elapsed / iterations / 1000000.0,
+			       gbps, match ? "ok" : "MISMATCH");
+
+			if (!match)
+				success = false;
+
+			planes_free(&out);
+		}
+
+		planes_free(&ref);
+	}
+
+	bfree(input);
+	return success;
+}
+
+int main(int argc, char *argv[])
+{
+	int  iterations = argc > 1 ? atoi(argv[1]) : 200;
+	bool success    = true;
+
+	if (iterations <= 0)
+		iterations = 1;
+
+	printf("best supported kernel set: %s\n\n",
+			format_conversion_isa_name(
+				format_conversion_get_isa()));
+
+	for (size_t i = 0; i < sizeof(resolutions) / sizeof(resolutions[0]);
+	     i++) {
+		if (!bench_resolution(&resolutions[i], iterations))
+			success = false;
+	}
+
+	return success ? 0 : 1;
+}
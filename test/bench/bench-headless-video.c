@@ -0,0 +1,301 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <obs.h>
+#include <util/platform.h>
+#include <util/profiler.h>
+#include <util/threading.h>
+
+/*
+ * Runs the video pipeline of libobs without a GPU, using the null graphics
+ * module: a scene of sprites is composited, scaled, converted and downloaded
+ * every frame, and the raw frames are passed to a video-io callback.
+ * Optionally also encodes and outputs the stream with the given encoders and
+ * output (which loads the plugins).  Reports the frames delivered and
+ * skipped, and the CPU time per frame, then prints the profiler results,
+ * which include the draw call and upload counters per frame.
+ *
+ * usage: bench-headless-video [seconds] [sprites]
+ *                             [video encoder id] [audio encoder id]
+ *                             [output id] [output path]
+ */
+
+#define BASE_CX    1920
+#define BASE_CY    1080
+#define OUTPUT_CX  1280
+#define OUTPUT_CY  720
+#define SPRITE_CX  320
+#define SPRITE_CY  180
+
+struct bench_sprite {
+	gs_texture_t *tex;
+};
+
+static volatile long raw_frames = 0;
+
+static const char *bench_sprite_get_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Bench Sprite";
+}
+
+static void *bench_sprite_create(obs_data_t *settings, obs_source_t *source)
+{
+	struct bench_sprite *bs = bzalloc(sizeof(struct bench_sprite));
+	uint32_t *pixels = bmalloc(SPRITE_CX * SPRITE_CY * 4);
+
+	for (size_t i = 0; i < SPRITE_CX * SPRITE_CY; i++)
+		pixels[i] = 0xFF000000 | (uint32_t)(i * 2654435761U >> 8);
+
+	obs_enter_graphics();
+	bs->tex = gs_texture_create(SPRITE_CX, SPRITE_CY, GS_BGRA, 1,
+			(const uint8_t**)&pixels, 0);
+	obs_leave_graphics();
+
+	bfree(pixels);
+
+	UNUSED_PARAMETER(settings);
+	UNUSED_PARAMETER(source);
+	return bs;
+}
+
+static void bench_sprite_destroy(void *data)
+{
+	struct bench_sprite *bs = data;
+
+	obs_enter_graphics();
+	gs_texture_destroy(bs->tex);
+	obs_leave_graphics();
+
+	bfree(bs);
+}
+
+static uint32_t bench_sprite_get_width(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return SPRITE_CX;
+}
+
+static uint32_t bench_sprite_get_height(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return SPRITE_CY;
+}
+
+static void bench_sprite_render(void *data, gs_effect_t *effect)
+{
+	struct bench_sprite *bs = data;
+
+	gs_reset_blend_state();
+	gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"),
+			bs->tex);
+	gs_draw_sprite(bs->tex, 0, SPRITE_CX, SPRITE_CY);
+}
+
+static struct obs_source_info bench_sprite_info = {
+	.id           = "bench_sprite",
+	.type         = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO,
+	.get_name     = bench_sprite_get_name,
+	.create       = bench_sprite_create,
+	.destroy      = bench_sprite_destroy,
+	.get_width    = bench_sprite_get_width,
+	.get_height   = bench_sprite_get_height,
+	.video_render = bench_sprite_render,
+};
+
+static void raw_video(void *param, struct video_data *frame)
+{
+	os_atomic_inc_long(&raw_frames);
+
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(frame);
+}
+
+static bool reset_obs(void)
+{
+	struct obs_video_info ovi = {0};
+	struct obs_audio_info oai = {0};
+
+	ovi.graphics_module = DL_NULL;
+	ovi.fps_num         = 60;
+	ovi.fps_den         = 1;
+	ovi.base_width      = BASE_CX;
+	ovi.base_height     = BASE_CY;
+	ovi.output_width    = OUTPUT_CX;
+	ovi.output_height   = OUTPUT_CY;
+	ovi.output_format   = VIDEO_FORMAT_NV12;
+	ovi.gpu_conversion  = true;
+	ovi.colorspace      = VIDEO_CS_709;
+	ovi.range           = VIDEO_RANGE_PARTIAL;
+	ovi.scale_type      = OBS_SCALE_BICUBIC;
+
+	if (obs_reset_video(&ovi) != OBS_VIDEO_SUCCESS) {
+		printf("failed to initialize video with '%s'\n", DL_NULL);
+		return false;
+	}
+
+	oai.samples_per_sec = 48000;
+	oai.speakers        = SPEAKERS_STEREO;
+	oai.buffer_ms       = 1000;
+
+	if (!obs_reset_audio(&oai)) {
+		printf("failed to initialize audio\n");
+		return false;
+	}
+
+	return true;
+}
+
+static obs_scene_t *create_scene(int sprites)
+{
+	obs_scene_t *scene = obs_scene_create("bench scene");
+
+	for (int i = 0; i < sprites; i++) {
+		obs_source_t *source = obs_source_create(OBS_SOURCE_TYPE_INPUT,
+				"bench_sprite", "bench sprite", NULL, NULL);
+		obs_sceneitem_t *item = obs_scene_add(scene, source);
+		struct vec2 pos;
+
+		vec2_set(&pos,
+				(float)(i * 97 % (BASE_CX - SPRITE_CX)),
+				(float)(i * 61 % (BASE_CY - SPRITE_CY)));
+		obs_sceneitem_set_pos(item, &pos);
+		obs_source_release(source);
+	}
+
+	obs_set_output_source(0, obs_scene_get_source(scene));
+	return scene;
+}
+
+static obs_output_t *start_output(const char *venc_id, const char *aenc_id,
+		const char *output_id, const char *path)
+{
+	obs_encoder_t *venc, *aenc;
+	obs_output_t  *output;
+	obs_data_t    *settings = obs_data_create();
+
+	obs_load_all_modules();
+
+	venc = obs_video_encoder_create(venc_id, "bench video", NULL, NULL);
+	aenc = obs_audio_encoder_create(aenc_id, "bench audio", NULL, 0, NULL);
+
+	obs_data_set_string(settings, "path", path);
+	output = obs_output_create(output_id, "bench output", settings, NULL);
+	obs_data_release(settings);
+
+	if (!venc || !aenc || !output) {
+		printf("failed to create '%s', '%s' or '%s'\n", venc_id,
+				aenc_id, output_id);
+		goto fail;
+	}
+
+	obs_encoder_set_video(venc, obs_get_video());
+	obs_encoder_set_audio(aenc, obs_get_audio());
+	obs_output_set_video_encoder(output, venc);
+	obs_output_set_audio_encoder(output, aenc, 0);
+
+	if (!obs_output_start(output)) {
+		printf("failed to start '%s'\n", output_id);
+		goto fail;
+	}
+
+	obs_encoder_release(venc);
+	obs_encoder_release(aenc);
+	return output;
+
+fail:
+	obs_output_release(output);
+	obs_encoder_release(venc);
+	obs_encoder_release(aenc);
+	return NULL;
+}
+
+static uint64_t cpu_ns(void)
+{
+	return (uint64_t)clock() * 1000000000ULL / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char *argv[])
+{
+	int          seconds = argc > 1 ? atoi(argv[1]) : 10;
+	int          sprites = argc > 2 ? atoi(argv[2]) : 16;
+	obs_output_t *output = NULL;
+	obs_scene_t  *scene;
+	video_t      *video;
+	uint32_t     skipped, total;
+	uint64_t     start, cpu;
+	long         frames;
+	bool         success = true;
+
+	if (seconds <= 0)
+		seconds = 1;
+
+	profiler_start();
+
+	if (!obs_startup("en-US", NULL, NULL)) {
+		printf("failed to start libobs\n");
+		return 1;
+	}
+
+	if (!reset_obs()) {
+		obs_shutdown();
+		return 1;
+	}
+
+	obs_register_source(&bench_sprite_info);
+	scene = create_scene(sprites);
+	video = obs_get_video();
+
+	if (argc > 6) {
+		output = start_output(argv[3], argv[4], argv[5], argv[6]);
+		success = output != NULL;
+	}
+
+	video_output_connect(video, NULL, raw_video, NULL);
+
+	start   = cpu_ns();
+	skipped = video_output_get_skipped_frames(video);
+	total   = video_output_get_total_frames(video);
+
+	os_sleep_ms((uint32_t)seconds * 1000);
+
+	cpu     = cpu_ns() - start;
+	skipped = video_output_get_skipped_frames(video) - skipped;
+	total   = video_output_get_total_frames(video) - total;
+
+	video_output_disconnect(video, raw_video, NULL);
+	frames = raw_frames;
+
+	if (output) {
+		printf("output: %llu bytes, %d frames dropped\n",
+				(unsigned long long)
+				obs_output_get_total_bytes(output),
+				obs_output_get_frames_dropped(output));
+		obs_output_stop(output);
+		obs_output_release(output);
+	}
+
+	printf("%d sprites, %dx%d -> %dx%d NV12 at 60 FPS, %d s\n",
+			sprites, BASE_CX, BASE_CY, OUTPUT_CX, OUTPUT_CY,
+			seconds);
+	printf("frames: %ld delivered, %u total, %u skipped\n", frames,
+			total, skipped);
+	printf("CPU: %.3f ms per frame\n", frames ?
+			(double)cpu / 1000000.0 / (double)frames : 0.0);
+
+	if (!frames)
+		success = false;
+
+	obs_set_output_source(0, NULL);
+	obs_scene_release(scene);
+	obs_shutdown();
+
+	profiler_print(NULL);
+	profiler_print_time_between_calls(NULL);
+	profiler_stop();
+	profiler_free();
+
+	return success ? 0 : 1;
+}
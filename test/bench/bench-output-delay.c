@@ -0,0 +1,283 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <obs-internal.h>
+#include <util/circlebuf.h>
+#include <util/platform.h>
+
+/*
+ * Runs the output delay buffer over a long delay at high bitrates, once
+ * keeping the delayed packets in memory and once spilling them to a memory
+ * mapped file.  The stream is 60 FPS video plus four 160 kbps audio tracks,
+ * simulated faster than real time: packets are pushed and popped like the
+ * delay of an output does, for twice the delay plus 10 seconds so that the
+ * spill file wraps around.  Each run is done in a child process, and reports
+ * the peak resident memory of the process and the CPU time per second of
+ * media.  Checks that every packet comes out of the delay with its data
+ * intact.
+ *
+ * usage: bench-output-delay [delay seconds] [spill directory]
+ */
+
+#define FPS             60
+#define AUDIO_TRACKS    4
+#define AUDIO_KBPS      160
+#define AUDIO_PACKET_NS 21333333ULL
+#define SPILL_WINDOW    (8 * 1024 * 1024)
+
+static const int bitrates_mbps[] = {6, 20, 50};
+
+struct delay_sim {
+	bool               spill_mode;
+	struct delay_spill spill;
+	struct circlebuf   delay_data;
+	uint64_t           delay_ns;
+
+	uint64_t           packets;
+	uint64_t           bad_packets;
+	size_t             base_rss;
+	size_t             peak_rss;
+};
+
+static size_t resident_bytes(void)
+{
+	unsigned long size, resident;
+	FILE *file = fopen("/proc/self/statm", "r");
+	int  count;
+
+	if (!file)
+		return 0;
+
+	count = fscanf(file, "%lu %lu", &size, &resident);
+	fclose(file);
+
+	return count == 2 ? (size_t)resident * (size_t)sysconf(_SC_PAGESIZE) :
+		0;
+}
+
+static uint64_t cpu_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint8_t fill_byte(uint64_t id, size_t pos)
+{
+	return (uint8_t)(id * 31 + pos);
+}
+
+/* the data of each packet depends on its id, spot checks it */
+static bool check_packet(struct encoder_packet *packet)
+{
+	uint64_t id = (uint64_t)packet->pts;
+	size_t   step = packet->size / 16 + 1;
+
+	for (size_t i = 0; i < packet->size; i += step) {
+		if (packet->data[i] != fill_byte(id, i))
+			return false;
+	}
+
+	return packet->data[packet->size - 1] ==
+		fill_byte(id, packet->size - 1);
+}
+
+static void push_packet(struct delay_sim *sim, struct encoder_packet *packet,
+		uint64_t t)
+{
+	struct delay_data dd = {0};
+
+	dd.msg = DELAY_MSG_PACKET;
+	dd.ts  = t;
+
+	pthread_mutex_lock(&sim->spill.write_mutex);
+	if (!sim->spill_mode ||
+	    !delay_spill_write(&sim->spill, &dd, packet))
+		obs_encoder_packet_ref(&dd.packet, packet);
+
+	circlebuf_push_back(&sim->delay_data, &dd, sizeof(dd));
+	pthread_mutex_unlock(&sim->spill.write_mutex);
+}
+
+static bool pop_packet(struct delay_sim *sim, uint64_t t)
+{
+	struct delay_data dd;
+
+	if (!sim->delay_data.size)
+		return false;
+
+	circlebuf_peek_front(&sim->delay_data, &dd, sizeof(dd));
+	if (t - dd.ts <= sim->delay_ns)
+		return false;
+
+	circlebuf_pop_front(&sim->delay_data, NULL, sizeof(dd));
+
+	pthread_mutex_lock(&sim->spill.read_mutex);
+	if (!delay_spill_read(&sim->spill, &dd) || !check_packet(&dd.packet))
+		sim->bad_packets++;
+	pthread_mutex_unlock(&sim->spill.read_mutex);
+
+	sim->packets++;
+	obs_encoder_packet_release(&dd.packet);
+	return true;
+}
+
+/* creates a packet like an encoder does and passes it to the delay */
+static void encode_packet(struct delay_sim *sim, struct encoder_packet *src,
+		uint8_t *buf, uint64_t id, uint64_t t)
+{
+	struct encoder_packet packet;
+
+	for (size_t i = 0; i < src->size; i++)
+		buf[i] = fill_byte(id, i);
+
+	src->data = buf;
+	src->pts  = src->dts = (int64_t)id;
+
+	obs_encoder_packet_create_instance(&packet, src);
+	push_packet(sim, &packet, t);
+	obs_encoder_packet_release(&packet);
+
+	while (pop_packet(sim, t));
+}
+
+static bool run(bool spill_mode, int mbps, int delay_sec, const char *dir)
+{
+	struct delay_sim sim = {0};
+	size_t   frame_size = (size_t)mbps * 1000000 / 8 / FPS;
+	size_t   audio_size = AUDIO_KBPS * 1000 / 8 * AUDIO_PACKET_NS /
+		1000000000ULL;
+	uint64_t frame_ns = 1000000000ULL / FPS;
+	int      seconds = delay_sec * 2 + 10;
+	uint64_t end_ns = (uint64_t)seconds * 1000000000ULL;
+	uint64_t video_t = 0, audio_t = 0, next_sample = 0;
+	uint64_t id = 0, start;
+	uint8_t  *buf = bmalloc(frame_size * 4);
+	bool     success;
+
+	if (!delay_spill_init(&sim.spill)) {
+		bfree(buf);
+		return false;
+	}
+
+	sim.spill_mode = spill_mode;
+	sim.delay_ns   = (uint64_t)delay_sec * 1000000000ULL;
+	sim.base_rss   = resident_bytes();
+
+	if (spill_mode) {
+		/* the delay at the stream bitrate, plus some headroom */
+		uint64_t size = ((uint64_t)mbps * 1000000 +
+				AUDIO_TRACKS * AUDIO_KBPS * 1000) / 8 *
+			(uint64_t)delay_sec * 5 / 4;
+
+		if (!delay_spill_open(&sim.spill, dir, size, SPILL_WINDOW)) {
+			printf("failed to create a spill file in '%s'\n", dir);
+			delay_spill_free(&sim.spill);
+			bfree(buf);
+			return false;
+		}
+	}
+
+	start = cpu_ns();
+
+	while (video_t < end_ns) {
+		struct encoder_packet src = {0};
+
+		src.timebase_num = 1;
+		src.timebase_den = 1000;
+
+		if (audio_t <= video_t) {
+			src.type = OBS_ENCODER_AUDIO;
+			src.size = audio_size;
+
+			for (size_t i = 0; i < AUDIO_TRACKS; i++) {
+				src.track_idx = i;
+				encode_packet(&sim, &src, buf, id++, audio_t);
+			}
+			audio_t += AUDIO_PACKET_NS;
+
+		} else {
+			bool keyframe = (video_t / frame_ns) % (FPS * 2) == 0;
+
+			src.type     = OBS_ENCODER_VIDEO;
+			src.keyframe = keyframe;
+			src.size     = keyframe ? frame_size * 4 : frame_size;
+			encode_packet(&sim, &src, buf, id++, video_t);
+			video_t += frame_ns;
+		}
+
+		if (video_t >= next_sample) {
+			size_t rss = resident_bytes();
+			if (sim.peak_rss < rss)
+				sim.peak_rss = rss;
+			next_sample += 1000000000ULL;
+		}
+	}
+
+	/* flush, like an output that is stopped */
+	while (pop_packet(&sim, UINT64_MAX));
+
+	success = sim.bad_packets == 0 && sim.packets == id;
+
+	printf("%5d  %-6s  %10.1f  %10.1f  %12.2f  %s\n", mbps,
+			spill_mode ? "spill" : "memory",
+			(double)(sim.peak_rss - sim.base_rss) / 1048576.0,
+			(double)sim.spill.size / 1048576.0,
+			(double)(cpu_ns() - start) / 1000000.0 /
+				(double)seconds,
+			success ? "ok" : "FAILED");
+
+	delay_spill_free(&sim.spill);
+	circlebuf_free(&sim.delay_data);
+	bfree(buf);
+	return success;
+}
+
+/* runs each test in a new process so that memory freed by the previous test
+ * does not hide the memory used by the next one */
+static bool run_child(bool spill_mode, int mbps, int delay_sec,
+		const char *dir)
+{
+	pid_t pid;
+	int   status;
+
+	fflush(stdout);
+
+	pid = fork();
+	if (pid == 0)
+		exit(run(spill_mode, mbps, delay_sec, dir) ? 0 : 1);
+	if (pid < 0 || waitpid(pid, &status, 0) != pid)
+		return false;
+
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int        delay_sec = argc > 1 ? atoi(argv[1]) : 60;
+	const char *dir = argc > 2 ? argv[2] : ".";
+	bool       success = true;
+
+	if (delay_sec <= 0)
+		delay_sec = 1;
+
+	printf("%d s delay, %d audio tracks, %d MB spill window\n\n",
+			delay_sec, AUDIO_TRACKS, SPILL_WINDOW / (1024 * 1024));
+	printf("%5s  %-6s  %10s  %10s  %12s\n", "Mbps", "mode",
+			"peak RSS", "file", "CPU ms/sec");
+	printf("%5s  %-6s  %10s  %10s  %12s\n", "", "", "MB", "MB", "");
+
+	for (size_t i = 0; i < sizeof(bitrates_mbps) / sizeof(bitrates_mbps[0]);
+			i++) {
+		for (int spill_mode = 0; spill_mode <= 1; spill_mode++) {
+			if (!run_child(spill_mode, bitrates_mbps[i], delay_sec,
+						dir))
+				success = false;
+		}
+	}
+
+	return success ? 0 : 1;
+}
@@ -0,0 +1,294 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <util/bmem.h>
+#include <util/darray.h>
+#include <util/platform.h>
+
+#include "flv-mux.h"
+#include "librtmp/rtmp.h"
+
+/*
+ * Sends a synthetic 60 FPS video + AAC audio stream over RTMP chunking to a
+ * loopback TCP sink, once by muxing each packet into an FLV tag and passing
+ * it to RTMP_Write (the old send path), and once with RTMP_WriteV straight
+ * from the packet data.  Reports send calls and sender CPU time per second
+ * of media, and checks that both paths put identical bytes on the wire.
+ *
+ * usage: bench-rtmp-send [media seconds]
+ */
+
+#define FPS            60
+#define KEYINT         (FPS * 2)
+#define AUDIO_BITRATE  160
+#define AUDIO_FRAMES   1024
+#define SAMPLE_RATE    48000
+#define CHUNK_SIZE     4096
+
+static const double bitrates[] = {2.5, 6.0, 20.0, 50.0};
+
+enum send_mode {
+	MODE_COPY,
+	MODE_VECTORED
+};
+
+static const char *mode_names[] = {"copy", "vectored"};
+
+struct sink {
+	int             fd;
+	pthread_t       thread;
+	bool            capture;
+	DARRAY(uint8_t) data;
+	uint64_t        bytes;
+};
+
+static void *sink_thread(void *param)
+{
+	struct sink *sink = param;
+	uint8_t buf[65536];
+	ssize_t n;
+
+	while ((n = recv(sink->fd, buf, sizeof(buf), 0)) > 0) {
+		if (sink->capture)
+			da_push_back_array(sink->data, buf, (size_t)n);
+		sink->bytes += (uint64_t)n;
+	}
+
+	return NULL;
+}
+
+/* connects 'rtmp' to a new loopback sink */
+static bool connect_sink(RTMP *rtmp, struct sink *sink, bool capture)
+{
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	int listener, fd, on = 1;
+
+	memset(sink, 0, sizeof(*sink));
+	sink->capture = capture;
+
+	listener = socket(AF_INET, SOCK_STREAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family      = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (bind(listener, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+	    listen(listener, 1) < 0 ||
+	    getsockname(listener, (struct sockaddr*)&addr, &len) < 0) {
+		close(listener);
+		return false;
+	}
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+		close(fd);
+		close(listener);
+		return false;
+	}
+
+	sink->fd = accept(listener, NULL, NULL);
+	close(listener);
+	if (sink->fd < 0) {
+		close(fd);
+		return false;
+	}
+
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+	pthread_create(&sink->thread, NULL, sink_thread, sink);
+
+	RTMP_Init(rtmp);
+	rtmp->m_sb.sb_socket     = fd;
+	rtmp->m_outChunkSize     = CHUNK_SIZE;
+	rtmp->Link.streams[0].id = 1;
+	return true;
+}
+
+static void close_sink(RTMP *rtmp, struct sink *sink)
+{
+	shutdown(rtmp->m_sb.sb_socket, SHUT_WR);
+	pthread_join(sink->thread, NULL);
+	close(sink->fd);
+	RTMP_Close(rtmp);
+
+	for (int i = 0; i < rtmp->m_channelsAllocatedOut; i++)
+		free(rtmp->m_vecChannelsOut[i]);
+	free(rtmp->m_vecChannelsOut);
+}
+
+static int send_copy(RTMP *rtmp, struct encoder_packet *packet)
+{
+	uint8_t *data;
+	size_t  size;
+	int     ret;
+
+	flv_packet_mux(packet, &data, &size, false);
+	ret = RTMP_Write(rtmp, (char*)data, (int)size, 0);
+	bfree(data);
+	return ret;
+}
+
+static int send_vectored(RTMP *rtmp, struct encoder_packet *packet)
+{
+	uint8_t   header[FLV_MAX_BODY_HEADER_SIZE];
+	RTMPIOVec body[2];
+
+	body[0].base = (const char*)header;
+	body[0].len  = (int)flv_packet_body_header(packet, false, header);
+	body[1].base = (const char*)packet->data;
+	body[1].len  = (int)packet->size;
+
+	return RTMP_WriteV(rtmp, packet->type == OBS_ENCODER_VIDEO ?
+			RTMP_PACKET_TYPE_VIDEO : RTMP_PACKET_TYPE_AUDIO,
+			flv_packet_timestamp(packet), body, 2, 0);
+}
+
+static uint64_t thread_cpu_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+struct stream_result {
+	uint64_t cpu_ns;
+	uint32_t send_calls;
+	uint64_t bytes;
+};
+
+/* sends 'seconds' of interleaved media as fast as possible */
+static bool send_stream(enum send_mode mode, double mbps, int seconds,
+		uint8_t *payload, struct sink *sink,
+		struct stream_result *result)
+{
+	RTMP     rtmp;
+	size_t   frame_size = (size_t)(mbps * 1000000.0 / 8.0 / FPS);
+	size_t   audio_size = AUDIO_BITRATE * 1000 / 8 * AUDIO_FRAMES /
+		SAMPLE_RATE;
+	int64_t  video_frames = (int64_t)seconds * FPS;
+	int64_t  video_idx = 0, audio_idx = 0;
+	uint64_t start;
+	bool     success = true;
+
+	if (!connect_sink(&rtmp, sink, sink->capture))
+		return false;
+
+	start = thread_cpu_ns();
+
+	while (video_idx < video_frames) {
+		struct encoder_packet packet = {0};
+		int64_t video_ms = video_idx * 1000 / FPS;
+		int64_t audio_ms = audio_idx * AUDIO_FRAMES * 1000 /
+			SAMPLE_RATE;
+
+		packet.timebase_num = 1;
+		packet.timebase_den = 1000;
+
+		if (audio_ms <= video_ms) {
+			packet.type = OBS_ENCODER_AUDIO;
+			packet.data = payload;
+			packet.size = audio_size;
+			packet.pts  = packet.dts = audio_ms;
+			audio_idx++;
+		} else {
+			bool keyframe = (video_idx % KEYINT) == 0;
+
+			packet.type     = OBS_ENCODER_VIDEO;
+			packet.data     = payload;
+			packet.size     = keyframe ? frame_size * 8 : frame_size;
+			packet.pts      = packet.dts = video_ms;
+			packet.keyframe = keyframe;
+			video_idx++;
+		}
+
+		if ((mode == MODE_COPY ? send_copy(&rtmp, &packet) :
+		                         send_vectored(&rtmp, &packet)) < 0) {
+			success = false;
+			break;
+		}
+	}
+
+	result->cpu_ns     = thread_cpu_ns() - start;
+	result->send_calls = rtmp.m_nSendCalls;
+
+	close_sink(&rtmp, sink);
+	result->bytes = sink->bytes;
+	return success;
+}
+
+static bool verify(uint8_t *payload)
+{
+	struct stream_result result;
+	struct sink copy = {0}, vectored = {0};
+	bool   match;
+
+	copy.capture = vectored.capture = true;
+
+	if (!send_stream(MODE_COPY, 6.0, 2, payload, &copy, &result) ||
+	    !send_stream(MODE_VECTORED, 6.0, 2, payload, &vectored, &result))
+		return false;
+
+	match = copy.data.num == vectored.data.num &&
+		memcmp(copy.data.array, vectored.data.array,
+				copy.data.num) == 0;
+
+	printf("wire output: %s (%zu bytes)\n\n",
+			match ? "identical" : "MISMATCH", copy.data.num);
+
+	da_free(copy.data);
+	da_free(vectored.data);
+	return match;
+}
+
+int main(int argc, char *argv[])
+{
+	int     seconds = argc > 1 ? atoi(argv[1]) : 20;
+	size_t  max_size = (size_t)(50.0 * 1000000.0 / 8.0 / FPS) * 8;
+	uint8_t *payload;
+	bool    success;
+
+	if (seconds <= 0)
+		seconds = 1;
+
+	payload = bmalloc(max_size);
+	for (size_t i = 0; i < max_size; i++)
+		payload[i] = (uint8_t)rand();
+
+	success = verify(payload);
+
+	printf("%-6s  %-8s  %12s  %14s  %14s\n", "Mbps", "path",
+			"sends/sec", "CPU ms/sec", "CPU us/Mbps");
+
+	for (size_t i = 0; i < sizeof(bitrates) / sizeof(bitrates[0]); i++) {
+		for (int mode = MODE_COPY; mode <= MODE_VECTORED; mode++) {
+			struct stream_result result;
+			struct sink sink = {0};
+			double cpu_ms;
+
+			if (!send_stream(mode, bitrates[i], seconds, payload,
+						&sink, &result)) {
+				printf("%6.1f  %-8s  send failed\n",
+						bitrates[i], mode_names[mode]);
+				success = false;
+				continue;
+			}
+
+			/* per second of media */
+			cpu_ms = (double)result.cpu_ns / 1000000.0 / seconds;
+
+			printf("%6.1f  %-8s  %12.0f  %14.3f  %14.2f\n",
+					bitrates[i], mode_names[mode],
+					(double)result.send_calls / seconds,
+					cpu_ms, cpu_ms * 1000.0 / bitrates[i]);
+		}
+	}
+
+	bfree(payload);
+	return success ? 0 : 1;
+}
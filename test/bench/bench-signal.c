@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <util/platform.h>
+#include <callback/signal.h>
+
+/*
+ * Benchmarks signal dispatch on a handler with the signals of a source,
+ * emitting a signal that sits near the end of the declarations like
+ * audio_data: by name with a calldata stack built per emit as before, by ID
+ * with calldata, and by ID with typed arguments, with no callbacks and with
+ * each kind of callback.  Also checks that arguments and out parameters
+ * pass between calldata and typed callbacks.
+ *
+ * usage: bench-signal [emits]
+ */
+
+static const char *signals[] = {
+	"void destroy(ptr source)",
+	"void add(ptr source)",
+	"void remove(ptr source)",
+	"void activate(ptr source)",
+	"void deactivate(ptr source)",
+	"void show(ptr source)",
+	"void hide(ptr source)",
+	"void mute(ptr source, bool muted)",
+	"void push_to_mute_changed(ptr source, bool enabled)",
+	"void push_to_mute_delay(ptr source, int delay)",
+	"void push_to_talk_changed(ptr source, bool enabled)",
+	"void push_to_talk_delay(ptr source, int delay)",
+	"void enable(ptr source, bool enabled)",
+	"void rename(ptr source, string new_name, string prev_name)",
+	"void volume(ptr source, in out float volume)",
+	"void update_properties(ptr source)",
+	"void update_flags(ptr source, int flags)",
+	"void audio_sync(ptr source, int out int offset)",
+	"void audio_data(ptr source, ptr data, bool muted)",
+	"void audio_mixers(ptr source, in out int mixers)",
+	"void filter_add(ptr source, ptr filter)",
+	"void filter_remove(ptr source, ptr filter)",
+	"void reorder_filters(ptr source)",
+	NULL
+};
+
+static int      source_obj;
+static int      packet_obj;
+static long     calls;
+static long     bad_calls;
+
+static void check_args(void *source, void *data, bool muted)
+{
+	if (source != &source_obj || data != &packet_obj || !muted)
+		bad_calls++;
+	calls++;
+}
+
+static void audio_data_calldata(void *param, calldata_t *cd)
+{
+	check_args(calldata_ptr(cd, "source"), calldata_ptr(cd, "data"),
+			calldata_bool(cd, "muted"));
+	(void)param;
+}
+
+static void audio_data_args(void *param, union call_arg *args)
+{
+	check_args(args[0].ptr, args[1].ptr, args[2].b);
+	(void)param;
+}
+
+static void emit_name(signal_handler_t *handler, signal_id_t id)
+{
+	struct calldata cd;
+
+	calldata_init(&cd);
+	calldata_set_ptr(&cd, "source", &source_obj);
+	calldata_set_ptr(&cd, "data", &packet_obj);
+	calldata_set_bool(&cd, "muted", true);
+
+	signal_handler_signal(handler, "audio_data", &cd);
+	calldata_free(&cd);
+	(void)id;
+}
+
+static void emit_id(signal_handler_t *handler, signal_id_t id)
+{
+	struct calldata cd;
+
+	calldata_init(&cd);
+	calldata_set_ptr(&cd, "source", &source_obj);
+	calldata_set_ptr(&cd, "data", &packet_obj);
+	calldata_set_bool(&cd, "muted", true);
+
+	signal_handler_signal_id(handler, id, &cd);
+	calldata_free(&cd);
+}
+
+static void emit_args(signal_handler_t *handler, signal_id_t id)
+{
+	union call_arg args[3];
+
+	args[0].ptr = &source_obj;
+	args[1].ptr = &packet_obj;
+	args[2].b   = true;
+
+	signal_handler_signal_args(handler, id, args);
+}
+
+typedef void (*emit_func_t)(signal_handler_t*, signal_id_t);
+
+static bool bench(signal_handler_t *handler, signal_id_t id, int emits,
+		const char *name, emit_func_t emit, long expected_calls)
+{
+	uint64_t start;
+	double   ns;
+
+	calls = bad_calls = 0;
+
+	start = os_gettime_ns();
+	for (int i = 0; i < emits; i++)
+		emit(handler, id);
+	ns = (double)(os_gettime_ns() - start) / emits;
+
+	printf("%-40s %8.1f ns per emit\n", name, ns);
+	return calls == expected_calls * emits && !bad_calls;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void volume_calldata(void *param, calldata_t *cd)
+{
+	calldata_set_float(cd, "volume", calldata_float(cd, "volume") * 2.0);
+	(void)param;
+}
+
+static void volume_args(void *param, union call_arg *args)
+{
+	args[1].f *= 3.0;
+	(void)param;
+}
+
+/* a calldata callback then a typed callback must both see the volume set
+ * by the callback before them, whichever way the signal is emitted */
+static bool check_out_params(signal_handler_t *handler)
+{
+	signal_id_t    id = signal_handler_get_id(handler, "volume");
+	union call_arg args[2];
+	struct calldata cd;
+	double         volume;
+	bool           success;
+
+	signal_handler_connect(handler, "volume", volume_calldata, NULL);
+	signal_handler_connect_args(handler, "volume", volume_args, NULL);
+
+	args[0].ptr = &source_obj;
+	args[1].f   = 1.0;
+	signal_handler_signal_args(handler, id, args);
+
+	calldata_init(&cd);
+	calldata_set_ptr(&cd, "source", &source_obj);
+	calldata_set_float(&cd, "volume", 1.0);
+	signal_handler_signal(handler, "volume", &cd);
+	volume = calldata_float(&cd, "volume");
+	calldata_free(&cd);
+
+	signal_handler_disconnect(handler, "volume", volume_calldata, NULL);
+	signal_handler_disconnect_args(handler, "volume", volume_args, NULL);
+
+	success = args[1].f == 6.0 && volume == 6.0;
+	printf("out parameters: typed emit %.1f, calldata emit %.1f, %s\n",
+			args[1].f, volume, success ? "ok" : "FAILED");
+	return success;
+}
+
+int main(int argc, char *argv[])
+{
+	int              emits   = argc > 1 ? atoi(argv[1]) : 1000000;
+	bool             success = true;
+	signal_handler_t *handler;
+	signal_id_t      id;
+
+	if (emits <= 0)
+		emits = 1;
+
+	handler = signal_handler_create();
+	signal_handler_add_array(handler, signals);
+	id = signal_handler_get_id(handler, "audio_data");
+
+	if (id == SIGNAL_INVALID_ID || signal_handler_get_id(handler,
+				"nonexistent") != SIGNAL_INVALID_ID) {
+		printf("signal IDs not found as expected\n");
+		return 1;
+	}
+
+	success &= bench(handler, id, emits, "no callbacks, name + calldata",
+			emit_name, 0);
+	success &= bench(handler, id, emits, "no callbacks, ID + calldata",
+			emit_id, 0);
+	success &= bench(handler, id, emits, "no callbacks, ID + typed",
+			emit_args, 0);
+
+	signal_handler_connect(handler, "audio_data", audio_data_calldata,
+			NULL);
+	success &= bench(handler, id, emits,
+			"calldata callback, name + calldata", emit_name, 1);
+	success &= bench(handler, id, emits, "calldata callback, ID + calldata",
+			emit_id, 1);
+	success &= bench(handler, id, emits, "calldata callback, ID + typed",
+			emit_args, 1);
+	signal_handler_disconnect(handler, "audio_data", audio_data_calldata,
+			NULL);
+
+	signal_handler_connect_args(handler, "audio_data", audio_data_args,
+			NULL);
+	success &= bench(handler, id, emits, "typed callback, name + calldata",
+			emit_name, 1);
+	success &= bench(handler, id, emits, "typed callback, ID + typed",
+			emit_args, 1);
+	signal_handler_disconnect_args(handler, "audio_data", audio_data_args,
+			NULL);
+
+	success &= check_out_params(handler);
+
+	signal_handler_destroy(handler);
+
+	if (!success)
+		printf("FAILED: wrong arguments or callback counts\n");
+	return success ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <obs.h>
+#include <util/platform.h>
+#include "text-freetype2.h"
+
+/*
+ * Benchmarks text updates of the freetype2 text source with a scoreboard
+ * setup: many sources drawing with a few fonts, each updating one line of
+ * its text at a time (a clock or a score), and for comparison updates that
+ * change every line.  Runs on the null graphics module, so it measures the
+ * CPU side of glyph caching and layout, and reports the number of glyph
+ * atlases against the number of sources.
+ *
+ * usage: bench-text-layout <font file> [updates per source]
+ */
+
+#define NUM_SOURCES 30
+#define NUM_SIZES   3
+#define NUM_LINES   8
+
+FT_Library ft2_lib;
+
+static const uint16_t font_sizes[NUM_SIZES] = {24, 32, 48};
+
+static struct ft2_source sources[NUM_SOURCES];
+
+static void set_text(struct ft2_source *src, int source, int update,
+		bool all_lines)
+{
+	char    text[1024];
+	size_t  len = 0;
+
+	for (int i = 0; i < NUM_LINES; i++) {
+		int value = (all_lines || i == 3) ? update : 0;
+
+		len += snprintf(text + len, sizeof(text) - len,
+				"%sTeam %c  %3d - %3d  %02d:%02d",
+				i ? "\n" : "", 'A' + source % 26, value % 100,
+				(value / 7) % 100, (value / 60) % 60,
+				value % 60);
+	}
+
+	bfree(src->text);
+	src->text = NULL;
+	os_utf8_to_wcs_ptr(text, len, &src->text);
+}
+
+static double run_updates(int updates, bool all_lines)
+{
+	uint64_t start = os_gettime_ns();
+
+	for (int u = 1; u <= updates; u++) {
+		for (int i = 0; i < NUM_SOURCES; i++) {
+			struct ft2_source *src = &sources[i];
+
+			set_text(src, i, u, all_lines);
+			glyph_atlas_cache(src->atlas, src->text);
+			set_up_vertex_buffer(src);
+		}
+	}
+
+	return (double)(NUM_SOURCES * updates) * 1000000000.0 /
+		(double)(os_gettime_ns() - start);
+}
+
+static bool reset_video(void)
+{
+	struct obs_video_info ovi = {0};
+
+	ovi.graphics_module = DL_NULL;
+	ovi.fps_num         = 30;
+	ovi.fps_den         = 1;
+	ovi.base_width      = 640;
+	ovi.base_height     = 360;
+	ovi.output_width    = 640;
+	ovi.output_height   = 360;
+	ovi.output_format   = VIDEO_FORMAT_NV12;
+	ovi.colorspace      = VIDEO_CS_709;
+	ovi.range           = VIDEO_RANGE_PARTIAL;
+	ovi.scale_type      = OBS_SCALE_BILINEAR;
+
+	return obs_reset_video(&ovi) == OBS_VIDEO_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+	int    updates = argc > 2 ? atoi(argv[2]) : 200;
+	struct glyph_atlas *atlases[NUM_SIZES] = {0};
+	size_t num_atlases = 0;
+	double partial, full;
+	bool   success = true;
+
+	if (argc < 2) {
+		printf("usage: %s <font file> [updates per source]\n",
+				argv[0]);
+		return 1;
+	}
+	if (updates <= 0)
+		updates = 1;
+
+	if (!obs_startup("en-US", NULL, NULL) || !reset_video()) {
+		printf("failed to start libobs with '%s'\n", DL_NULL);
+		obs_shutdown();
+		return 1;
+	}
+
+	FT_Init_FreeType(&ft2_lib);
+	glyph_atlas_init();
+
+	for (int i = 0; i < NUM_SOURCES; i++) {
+		struct ft2_source *src = &sources[i];
+
+		src->font_size = font_sizes[i % NUM_SIZES];
+		src->color[0] = src->color[1] = 0xFFFFFFFF;
+		src->atlas = glyph_atlas_get(argv[1], 0, src->font_size, 0);
+		if (!src->atlas) {
+			printf("failed to load font '%s'\n", argv[1]);
+			success = false;
+			goto cleanup;
+		}
+
+		for (size_t j = 0; j < NUM_SIZES; j++) {
+			if (atlases[j] == src->atlas)
+				break;
+			if (!atlases[j]) {
+				atlases[j] = src->atlas;
+				num_atlases++;
+				break;
+			}
+		}
+	}
+
+	/* the first update lays out every line of every source */
+	run_updates(1, true);
+
+	partial = run_updates(updates, false);
+	full    = run_updates(updates, true);
+
+	printf("%d sources, %d sizes: %d glyph atlases (%d MB of atlas "
+	       "texture)\n", NUM_SOURCES, NUM_SIZES, (int)num_atlases,
+	       (int)num_atlases * 16);
+	printf("one of %d lines changed: %10.0f updates/s\n", NUM_LINES,
+			partial);
+	printf("all %d lines changed:    %10.0f updates/s\n", NUM_LINES,
+			full);
+
+	if (num_atlases != NUM_SIZES)
+		success = false;
+
+cleanup:
+	obs_enter_graphics();
+	for (int i = 0; i < NUM_SOURCES; i++) {
+		struct ft2_source *src = &sources[i];
+
+		gs_vertexbuffer_destroy(src->vbuf);
+		bfree(src->colorbuf);
+		bfree(src->text);
+		bfree(src->layout_text);
+		da_free(src->lines);
+	}
+	obs_leave_graphics();
+
+	for (int i = 0; i < NUM_SOURCES; i++)
+		glyph_atlas_release(sources[i].atlas);
+
+	glyph_atlas_free();
+	FT_Done_FreeType(ft2_lib);
+	obs_shutdown();
+
+	return success ? 0 : 1;
+}
@@ -0,0 +1,314 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <inttypes.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <media-io/audio-io.h>
+#include <media-io/audio-mix.h>
+
+/*
+ * Benchmarks each CPU kernel set of the level meter by metering a mixer's
+ * worth of stereo lines, with and without true peaks, and checks that the
+ * peaks match the C kernels exactly and the sums up to rounding.  Then runs
+ * lines through the audio thread in real time while another thread polls
+ * their levels, and checks that no torn or out of order levels are read.
+ *
+ * usage: bench-volmeter [iterations] [seconds]
+ */
+
+#define NUM_LINES      40
+#define NUM_CHANNELS   2
+#define FRAMES         1024
+
+#define SAMPLE_RATE    48000
+#define PACKET_FRAMES  480
+#define PACKET_NS      10000000ULL
+#define BUFFER_MS      100
+
+#define PI_F           3.14159265f
+
+static float *samples[NUM_LINES][NUM_CHANNELS];
+
+struct meter_result {
+	float sum[NUM_LINES];
+	float peak[NUM_LINES];
+	float true_peak[NUM_LINES];
+};
+
+static void meter_lines(struct meter_result *res, bool true_peak)
+{
+	float history[AUDIO_TRUE_PEAK_TAPS - 1];
+
+	for (size_t i = 0; i < NUM_LINES; i++) {
+		res->sum[i] = res->peak[i] = res->true_peak[i] = 0.0f;
+
+		for (size_t ch = 0; ch < NUM_CHANNELS; ch++) {
+			audio_meter_float(samples[i][ch], FRAMES,
+					&res->sum[i], &res->peak[i]);
+
+			if (!true_peak)
+				continue;
+
+			memset(history, 0, sizeof(history));
+			audio_true_peak_float(history, samples[i][ch], FRAMES,
+					&res->true_peak[i]);
+		}
+	}
+}
+
+static bool bench_kernels(int iterations, bool true_peak)
+{
+	struct meter_result ref, res;
+	bool success = true;
+
+	audio_mix_set_isa(AUDIO_MIX_C);
+	meter_lines(&ref, true_peak);
+
+	for (int isa = AUDIO_MIX_C; isa <= AUDIO_MIX_AVX; isa++) {
+		uint64_t start, elapsed;
+		bool     match = true;
+
+		if (!audio_mix_set_isa((enum audio_mix_isa)isa))
+			continue;
+
+		start = os_gettime_ns();
+		for (int i = 0; i < iterations; i++)
+			meter_lines(&res, true_peak);
+		elapsed = os_gettime_ns() - start;
+
+		for (size_t i = 0; i < NUM_LINES; i++) {
+			float diff = fabsf(res.sum[i] - ref.sum[i]);
+
+			if (res.peak[i] != ref.peak[i] ||
+			    res.true_peak[i] != ref.true_peak[i] ||
+			    diff > ref.sum[i] * 1e-5f)
+				match = false;
+		}
+
+		printf("%-4s %-10s %8.3f us per tick of %d lines, %s\n",
+				audio_mix_isa_name((enum audio_mix_isa)isa),
+				true_peak ? "true peak" : "peak",
+				(double)elapsed / 1000.0 / iterations,
+				NUM_LINES,
+				match ? "matches C" : "MISMATCH");
+
+		if (!match)
+			success = false;
+	}
+
+	return success;
+}
+
+/* a sine at a quarter of the sample rate, sampled 45 degrees off its peaks,
+ * has samples of +-0.707 but a true peak of 1.0 */
+static bool check_true_peak(void)
+{
+	float history[AUDIO_TRUE_PEAK_TAPS - 1] = {0};
+	float data[FRAMES];
+	float sum = 0.0f, peak = 0.0f, true_peak = 0.0f;
+
+	for (size_t i = 0; i < FRAMES; i++)
+		data[i] = sinf(PI_F * 0.5f * (float)i + PI_F * 0.25f);
+
+	audio_meter_float(data, FRAMES, &sum, &peak);
+	audio_true_peak_float(history, data, FRAMES, &true_peak);
+
+	printf("quarter rate sine: peak %.3f, true peak %.3f\n", peak,
+			true_peak);
+	return peak < 0.71f && true_peak > 0.98f && true_peak < 1.02f;
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct line_thread {
+	pthread_t    thread;
+	audio_line_t *line;
+	float        value;
+	uint64_t     last_index;
+};
+
+static struct line_thread lines[NUM_LINES];
+static uint64_t start_ts;
+static uint64_t end_ts;
+
+static volatile bool stop_polling;
+static long polls;
+static long levels_read;
+static long bad_levels;
+
+static void *line_thread(void *param)
+{
+	struct line_thread *lt = param;
+	float    *planes[NUM_CHANNELS];
+	uint64_t ts = start_ts;
+
+	for (size_t ch = 0; ch < NUM_CHANNELS; ch++) {
+		planes[ch] = bmalloc(PACKET_FRAMES * sizeof(float));
+		for (size_t i = 0; i < PACKET_FRAMES; i++)
+			planes[ch][i] = (i & 1) ? lt->value : -lt->value;
+	}
+
+	/* the levels are measured before the volume is applied, so the
+	 * volume must not show up in them */
+	while (ts < end_ts) {
+		struct audio_data data = {
+			.data      = {(uint8_t*)planes[0], (uint8_t*)planes[1]},
+			.frames    = PACKET_FRAMES,
+			.timestamp = ts,
+			.volume    = 0.5f
+		};
+
+		os_sleepto_ns(ts);
+		audio_line_output(lt->line, &data);
+		ts += PACKET_NS;
+	}
+
+	for (size_t ch = 0; ch < NUM_CHANNELS; ch++)
+		bfree(planes[ch]);
+	return NULL;
+}
+
+static bool check_levels(struct line_thread *lt,
+		const struct audio_line_levels *levels)
+{
+	float expected;
+
+	if (levels->index <= lt->last_index)
+		return false;
+	lt->last_index = levels->index;
+
+	if (!levels->frames || levels->frames % PACKET_FRAMES)
+		return false;
+	if (levels->peak != lt->value)
+		return false;
+
+	expected = lt->value * lt->value * levels->frames * NUM_CHANNELS;
+	return fabsf(levels->sum - expected) <= expected * 1e-5f;
+}
+
+static void *poll_thread(void *param)
+{
+	struct audio_line_levels levels[AUDIO_LINE_LEVELS];
+
+	while (!stop_polling) {
+		for (size_t i = 0; i < NUM_LINES; i++) {
+			struct line_thread *lt = &lines[i];
+			size_t num = audio_line_get_levels(lt->line,
+					lt->last_index, levels,
+					AUDIO_LINE_LEVELS);
+
+			for (size_t j = 0; j < num; j++) {
+				if (!check_levels(lt, &levels[j]))
+					bad_levels++;
+				levels_read++;
+			}
+		}
+
+		polls++;
+		os_sleep_ms(1);
+	}
+
+	(void)param;
+	return NULL;
+}
+
+static bool stress_levels(int seconds)
+{
+	pthread_t poller;
+	audio_t   *audio;
+	long      expected;
+
+	struct audio_output_info info = {
+		.name            = "bench",
+		.samples_per_sec = SAMPLE_RATE,
+		.format          = AUDIO_FORMAT_FLOAT_PLANAR,
+		.speakers        = SPEAKERS_STEREO,
+		.buffer_ms       = BUFFER_MS,
+		.frames_per_tick = PACKET_FRAMES
+	};
+
+	if (audio_output_open(&audio, &info) != AUDIO_OUTPUT_SUCCESS) {
+		printf("failed to open audio output\n");
+		return false;
+	}
+
+	start_ts = os_gettime_ns() + 50000000ULL;
+	end_ts   = start_ts + (uint64_t)seconds * 1000000000ULL;
+
+	/* powers of two, so the squares and their sums are exact */
+	for (size_t i = 0; i < NUM_LINES; i++) {
+		lines[i].value = 1.0f / (float)(1 << (i % 8 + 1));
+		lines[i].line  = audio_output_create_line(audio, "bench", 1);
+		audio_line_enable_true_peak(lines[i].line, i % 2 == 0);
+	}
+
+	pthread_create(&poller, NULL, poll_thread, NULL);
+	for (size_t i = 0; i < NUM_LINES; i++)
+		pthread_create(&lines[i].thread, NULL, line_thread, &lines[i]);
+	for (size_t i = 0; i < NUM_LINES; i++)
+		pthread_join(lines[i].thread, NULL);
+
+	/* the last levels are published once their audio is mixed */
+	os_sleep_ms(BUFFER_MS + 50);
+	stop_polling = true;
+	pthread_join(poller, NULL);
+
+	for (size_t i = 0; i < NUM_LINES; i++)
+		audio_line_destroy(lines[i].line);
+
+	os_sleep_ms(BUFFER_MS * 2);
+	audio_output_close(audio);
+
+	/* roughly one entry per packet, fewer when packets share a tick */
+	expected = (long)seconds * 100 * NUM_LINES;
+
+	printf("%d lines, %d seconds: %ld polls, %ld levels read "
+	       "(expected ~%ld), %ld bad\n", NUM_LINES, seconds, polls,
+	       levels_read, expected, bad_levels);
+
+	return !bad_levels && levels_read >= expected * 8 / 10;
+}
+
+int main(int argc, char *argv[])
+{
+	int  iterations = argc > 1 ? atoi(argv[1]) : 2000;
+	int  seconds    = argc > 2 ? atoi(argv[2]) : 3;
+	bool success    = true;
+
+	if (iterations <= 0)
+		iterations = 1;
+	if (seconds <= 0)
+		seconds = 1;
+
+	srand(1);
+	for (size_t i = 0; i < NUM_LINES; i++) {
+		for (size_t ch = 0; ch < NUM_CHANNELS; ch++) {
+			samples[i][ch] = bmalloc(FRAMES * sizeof(float));
+
+			for (size_t j = 0; j < FRAMES; j++)
+				samples[i][ch][j] = (float)rand() /
+					(float)RAND_MAX * 2.0f - 1.0f;
+		}
+	}
+
+	success &= bench_kernels(iterations, false);
+	success &= bench_kernels(iterations / 10 + 1, true);
+	success &= check_true_peak();
+
+	/* back to the best kernels for the audio thread */
+	for (int isa = AUDIO_MIX_AVX; isa > AUDIO_MIX_C; isa--) {
+		if (audio_mix_set_isa((enum audio_mix_isa)isa))
+			break;
+	}
+
+	success &= stress_levels(seconds);
+
+	for (size_t i = 0; i < NUM_LINES; i++)
+		for (size_t ch = 0; ch < NUM_CHANNELS; ch++)
+			bfree(samples[i][ch]);
+
+	return success ? 0 : 1;
+}
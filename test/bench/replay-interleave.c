@@ -0,0 +1,665 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <obs-internal.h>
+#include <util/darray.h>
+#include <util/platform.h>
+
+/*
+ * Replays packet traces through the interleaver of the outputs, once with the
+ * old implementation (a single array sorted by insertion) and once with the
+ * per-track queues, and checks that both send exactly the same packets in
+ * the same order with the same timestamps.  Also reports the time spent per
+ * packet.
+ *
+ * Traces are text files with one packet per line in arrival order:
+ *
+ *   <v|a> <track> <dts> <pts> <timebase num> <timebase den> <dts usec>
+ *
+ * where 'dts usec' is the system time based dts the encoder assigns.  Without
+ * arguments, a set of generated traces is replayed: 60 FPS video with B
+ * frames and one to four (all mixes) AAC tracks, with encoders that started at different
+ * times, video encoder latency, a video encoder that stalls for a while, and
+ * arrival jitter between the encoder threads.
+ *
+ * usage: replay-interleave [trace files...]
+ */
+
+#define FPS            60
+#define SAMPLE_RATE    48000
+#define AUDIO_FRAMES   1024
+
+typedef DARRAY(struct encoder_packet) packet_array_t;
+
+struct sent_packet {
+	enum obs_encoder_type type;
+	size_t                track_idx;
+	int64_t               dts;
+	int64_t               pts;
+	int64_t               dts_usec;
+	int64_t               id;
+};
+
+/* the parts of struct obs_output used by the interleaver */
+struct sim_output {
+	size_t                  audio_mixes;
+	bool                    received_video;
+	bool                    received_audio;
+	int64_t                 video_offset;
+	int64_t                 audio_offsets[MAX_AUDIO_MIXES];
+	int64_t                 highest_audio_ts;
+	int64_t                 highest_video_ts;
+
+	packet_array_t          legacy_packets;
+	struct interleave_queue interleaved_packets;
+
+	DARRAY(struct sent_packet) sent;
+	size_t                  max_queued;
+};
+
+/* ------------------------------------------------------------------------- */
+/* shared by both implementations */
+
+static inline void check_received(struct sim_output *output,
+		struct encoder_packet *out)
+{
+	if (out->type == OBS_ENCODER_VIDEO) {
+		if (!output->received_video)
+			output->received_video = true;
+	} else {
+		if (!output->received_audio)
+			output->received_audio = true;
+	}
+}
+
+static inline void apply_interleaved_packet_offset(struct sim_output *output,
+		struct encoder_packet *out)
+{
+	int64_t offset;
+
+	offset = (out->type == OBS_ENCODER_VIDEO) ?
+		output->video_offset : output->audio_offsets[out->track_idx];
+
+	out->dts -= offset;
+	out->pts -= offset;
+	out->dts_usec = packet_dts_usec(out);
+}
+
+static inline bool has_higher_opposing_ts(struct sim_output *output,
+		struct encoder_packet *packet)
+{
+	if (packet->type == OBS_ENCODER_VIDEO)
+		return output->highest_audio_ts > packet->dts_usec;
+	else
+		return output->highest_video_ts > packet->dts_usec;
+}
+
+static inline void set_higher_ts(struct sim_output *output,
+		struct encoder_packet *packet)
+{
+	if (packet->type == OBS_ENCODER_VIDEO) {
+		if (output->highest_video_ts < packet->dts_usec)
+			output->highest_video_ts = packet->dts_usec;
+	} else {
+		if (output->highest_audio_ts < packet->dts_usec)
+			output->highest_audio_ts = packet->dts_usec;
+	}
+}
+
+static void send_packet(struct sim_output *output, struct encoder_packet *out)
+{
+	struct sent_packet sent;
+
+	sent.type      = out->type;
+	sent.track_idx = out->track_idx;
+	sent.dts       = out->dts;
+	sent.pts       = out->pts;
+	sent.dts_usec  = out->dts_usec;
+	sent.id        = (int64_t)out->size;
+	da_push_back(output->sent, &sent);
+}
+
+/* ------------------------------------------------------------------------- */
+/* old implementation */
+
+static inline void legacy_send_interleaved(struct sim_output *output)
+{
+	struct encoder_packet out = output->legacy_packets.array[0];
+
+	if (!has_higher_opposing_ts(output, &out))
+		return;
+
+	da_erase(output->legacy_packets, 0);
+	send_packet(output, &out);
+}
+
+static bool legacy_can_prune(struct sim_output *output, size_t idx)
+{
+	struct encoder_packet *packet;
+	struct encoder_packet *next;
+
+	if (idx >= (output->legacy_packets.num - 1))
+		return false;
+
+	packet = &output->legacy_packets.array[idx];
+	if (packet->type != OBS_ENCODER_AUDIO)
+		return false;
+
+	next = &output->legacy_packets.array[idx + 1];
+	if (next->type == OBS_ENCODER_VIDEO &&
+	    next->dts_usec == packet->dts_usec)
+		return false;
+
+	return true;
+}
+
+static void legacy_prune(struct sim_output *output)
+{
+	size_t start_idx = 0;
+
+	while (legacy_can_prune(output, start_idx))
+		start_idx++;
+
+	if (start_idx)
+		da_erase_range(output->legacy_packets, 0, start_idx);
+}
+
+static struct encoder_packet *legacy_find_first(struct sim_output *output,
+		enum obs_encoder_type type, size_t audio_idx)
+{
+	for (size_t i = 0; i < output->legacy_packets.num; i++) {
+		struct encoder_packet *packet =
+			&output->legacy_packets.array[i];
+
+		if (packet->type == type) {
+			if (type == OBS_ENCODER_AUDIO &&
+			    packet->track_idx != audio_idx)
+				continue;
+			return packet;
+		}
+	}
+
+	return NULL;
+}
+
+static bool legacy_initialize(struct sim_output *output)
+{
+	struct encoder_packet *video;
+	struct encoder_packet *audio[MAX_AUDIO_MIXES];
+
+	video = legacy_find_first(output, OBS_ENCODER_VIDEO, 0);
+	if (!video)
+		output->received_video = false;
+
+	for (size_t i = 0; i < output->audio_mixes; i++) {
+		audio[i] = legacy_find_first(output, OBS_ENCODER_AUDIO, i);
+		if (!audio[i]) {
+			output->received_audio = false;
+			return false;
+		}
+	}
+
+	if (!video)
+		return false;
+
+	output->video_offset = video->dts;
+	for (size_t i = 0; i < output->audio_mixes; i++)
+		output->audio_offsets[i] = audio[i]->dts;
+
+	output->highest_audio_ts -= audio[0]->dts_usec;
+	output->highest_video_ts -= video->dts_usec;
+
+	for (size_t i = 0; i < output->legacy_packets.num; i++)
+		apply_interleaved_packet_offset(output,
+				&output->legacy_packets.array[i]);
+
+	return true;
+}
+
+static inline void legacy_insert(struct sim_output *output,
+		struct encoder_packet *out)
+{
+	size_t idx;
+	for (idx = 0; idx < output->legacy_packets.num; idx++) {
+		struct encoder_packet *cur_packet;
+		cur_packet = output->legacy_packets.array + idx;
+
+		if (out->dts_usec < cur_packet->dts_usec)
+			break;
+	}
+
+	da_insert(output->legacy_packets, idx, out);
+}
+
+static void legacy_resort(struct sim_output *output)
+{
+	packet_array_t old_array;
+
+	old_array.da = output->legacy_packets.da;
+	memset(&output->legacy_packets, 0, sizeof(output->legacy_packets));
+
+	for (size_t i = 0; i < old_array.num; i++)
+		legacy_insert(output, &old_array.array[i]);
+
+	da_free(old_array);
+}
+
+static void legacy_interleave(struct sim_output *output,
+		struct encoder_packet *packet)
+{
+	struct encoder_packet out = *packet;
+	bool was_started = output->received_audio && output->received_video;
+
+	if (was_started)
+		apply_interleaved_packet_offset(output, &out);
+	else
+		check_received(output, packet);
+
+	legacy_insert(output, &out);
+	set_higher_ts(output, &out);
+
+	if (output->received_audio && output->received_video) {
+		if (!was_started) {
+			legacy_prune(output);
+			if (legacy_initialize(output)) {
+				legacy_resort(output);
+				legacy_send_interleaved(output);
+			}
+		} else {
+			legacy_send_interleaved(output);
+		}
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* per-track queues, as in obs-output.c */
+
+static inline void send_interleaved(struct sim_output *output)
+{
+	struct encoder_packet out =
+		*interleave_queue_peek(&output->interleaved_packets, 0);
+
+	if (!has_higher_opposing_ts(output, &out))
+		return;
+
+	interleave_queue_pop(&output->interleaved_packets, &out);
+	send_packet(output, &out);
+}
+
+static bool can_prune_interleaved_packet(struct sim_output *output)
+{
+	struct encoder_packet *packet;
+	struct encoder_packet *next;
+
+	next = interleave_queue_peek(&output->interleaved_packets, 1);
+	if (!next)
+		return false;
+
+	packet = interleave_queue_peek(&output->interleaved_packets, 0);
+	if (packet->type != OBS_ENCODER_AUDIO)
+		return false;
+
+	if (next->type == OBS_ENCODER_VIDEO &&
+	    next->dts_usec == packet->dts_usec)
+		return false;
+
+	return true;
+}
+
+static void prune_interleaved_packets(struct sim_output *output)
+{
+	struct encoder_packet packet;
+
+	while (can_prune_interleaved_packet(output))
+		interleave_queue_pop(&output->interleaved_packets, &packet);
+}
+
+static void apply_offset_callback(void *param, struct encoder_packet *packet)
+{
+	apply_interleaved_packet_offset(param, packet);
+}
+
+static bool initialize_interleaved_packets(struct sim_output *output)
+{
+	struct encoder_packet *video;
+	struct encoder_packet *audio[MAX_AUDIO_MIXES];
+
+	video = interleave_queue_track_front(&output->interleaved_packets,
+			OBS_ENCODER_VIDEO, 0);
+	if (!video)
+		output->received_video = false;
+
+	for (size_t i = 0; i < output->audio_mixes; i++) {
+		audio[i] = interleave_queue_track_front(
+				&output->interleaved_packets,
+				OBS_ENCODER_AUDIO, i);
+		if (!audio[i]) {
+			output->received_audio = false;
+			return false;
+		}
+	}
+
+	if (!video)
+		return false;
+
+	output->video_offset = video->dts;
+	for (size_t i = 0; i < output->audio_mixes; i++)
+		output->audio_offsets[i] = audio[i]->dts;
+
+	output->highest_audio_ts -= audio[0]->dts_usec;
+	output->highest_video_ts -= video->dts_usec;
+
+	interleave_queue_reset_order(&output->interleaved_packets);
+	interleave_queue_enum(&output->interleaved_packets,
+			apply_offset_callback, output);
+	return true;
+}
+
+static void interleave(struct sim_output *output,
+		struct encoder_packet *packet)
+{
+	struct encoder_packet out = *packet;
+	bool was_started = output->received_audio && output->received_video;
+
+	if (was_started)
+		apply_interleaved_packet_offset(output, &out);
+	else
+		check_received(output, packet);
+
+	interleave_queue_push(&output->interleaved_packets, &out);
+	set_higher_ts(output, &out);
+
+	if (output->received_audio && output->received_video) {
+		if (!was_started) {
+			prune_interleaved_packets(output);
+			if (initialize_interleaved_packets(output))
+				send_interleaved(output);
+		} else {
+			send_interleaved(output);
+		}
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* traces */
+
+struct trace_packet {
+	struct encoder_packet packet;
+	int64_t               arrival_ns;
+};
+
+typedef DARRAY(struct trace_packet) trace_t;
+
+static int cmp_arrival(const void *a, const void *b)
+{
+	const struct trace_packet *pa = a;
+	const struct trace_packet *pb = b;
+
+	if (pa->arrival_ns != pb->arrival_ns)
+		return pa->arrival_ns < pb->arrival_ns ? -1 : 1;
+	return pa->packet.size < pb->packet.size ? -1 : 1;
+}
+
+struct scenario {
+	const char *name;
+	int        seconds;
+	size_t     audio_tracks;
+	int64_t    video_start_ms;   /* encoder start time relative to audio */
+	int64_t    video_latency_ms; /* encoder delay of the video packets */
+	int64_t    stall_at_ms;      /* video encoder stalls here ... */
+	int64_t    stall_ms;         /* ... for this long */
+	int64_t    jitter_us;        /* random delay of each packet */
+	bool       same_audio_start; /* audio encoders started together */
+};
+
+static const struct scenario scenarios[] = {
+	{"1 track",                 30, 1,    0,   50,     0,    0, 2000, true},
+	{"4 tracks",                30, 4,   17,   50,     0,    0, 2000, true},
+	{"4 tracks, staggered",     30, 4,   33,  200,     0,    0, 5000, false},
+	{"4 tracks, video late",    30, 4, 1500,  100,     0,    0, 3000, false},
+	{"4 tracks, video stall",   60, 4,    0,   80, 10000, 5000, 2000, true},
+	{"4 tracks, 2 s latency",   60, 4,    0, 2000,     0,    0, 1000, true},
+};
+
+static int64_t jitter(const struct scenario *sc)
+{
+	return sc->jitter_us ? (int64_t)(rand() % sc->jitter_us) * 1000 : 0;
+}
+
+/* packets have no data, their size is used as id */
+static void add_trace_packet(trace_t *trace, struct encoder_packet *packet,
+		int64_t arrival_ns, int64_t *last_arrival_ns)
+{
+	struct trace_packet *tp = da_push_back_new((*trace));
+
+	/* packets of one encoder arrive in order */
+	if (arrival_ns < *last_arrival_ns)
+		arrival_ns = *last_arrival_ns;
+	*last_arrival_ns = arrival_ns;
+
+	tp->packet      = *packet;
+	tp->packet.size = trace->num;
+	tp->arrival_ns  = arrival_ns;
+}
+
+static void generate_trace(const struct scenario *sc, trace_t *trace)
+{
+	int64_t last_arrival[MAX_AUDIO_MIXES + 1] = {0};
+	int64_t audio_start_us[MAX_AUDIO_MIXES];
+	int64_t video_start_us = 1000000 + sc->video_start_ms * 1000;
+	int64_t end_us = 1000000 + (int64_t)sc->seconds * 1000000;
+
+	for (size_t i = 0; i < sc->audio_tracks; i++)
+		audio_start_us[i] = 1000000 +
+			(sc->same_audio_start ? 0 : (int64_t)i * 7333);
+
+	/* video: I P B B P B B ..., dts one frame behind pts for B frames */
+	for (int64_t frame = 0;; frame++) {
+		struct encoder_packet packet = {0};
+		int64_t capture_us = video_start_us + frame * 1000000 / FPS;
+		int64_t arrival_ns;
+
+		if (capture_us >= end_us)
+			break;
+
+		packet.type         = OBS_ENCODER_VIDEO;
+		packet.timebase_num = 1;
+		packet.timebase_den = FPS;
+		packet.dts          = frame - 2;
+		packet.pts          = frame % 3 == 1 ? frame + 1 :
+			(frame % 3 == 2 ? frame - 1 : frame);
+		packet.keyframe     = frame % (FPS * 2) == 0;
+		packet.dts_usec     = video_start_us / 1000 * 1000 +
+			packet_dts_usec(&packet);
+
+		arrival_ns = (capture_us + sc->video_latency_ms * 1000) * 1000 +
+			jitter(sc);
+		if (sc->stall_ms && capture_us >= sc->stall_at_ms * 1000 &&
+		    capture_us < (sc->stall_at_ms + sc->stall_ms) * 1000)
+			arrival_ns = (sc->stall_at_ms + sc->stall_ms) *
+				1000000;
+
+		add_trace_packet(trace, &packet, arrival_ns, &last_arrival[0]);
+	}
+
+	for (size_t i = 0; i < sc->audio_tracks; i++) {
+		for (int64_t idx = 0;; idx++) {
+			struct encoder_packet packet = {0};
+			int64_t dts = idx * AUDIO_FRAMES;
+			int64_t capture_us = audio_start_us[i] +
+				dts * 1000000 / SAMPLE_RATE;
+
+			if (capture_us >= end_us)
+				break;
+
+			packet.type         = OBS_ENCODER_AUDIO;
+			packet.track_idx    = i;
+			packet.timebase_num = 1;
+			packet.timebase_den = SAMPLE_RATE;
+			packet.dts          = packet.pts = dts;
+			packet.dts_usec     = audio_start_us[i] / 1000 * 1000 +
+				packet_dts_usec(&packet);
+
+			add_trace_packet(trace, &packet,
+					(capture_us + 25000) * 1000 +
+					jitter(sc), &last_arrival[i + 1]);
+		}
+	}
+
+	qsort(trace->array, trace->num, sizeof(*trace->array), cmp_arrival);
+}
+
+static bool load_trace(const char *path, trace_t *trace, size_t *audio_tracks)
+{
+	FILE *file = fopen(path, "r");
+	char type;
+	struct encoder_packet packet = {0};
+	long long track, dts, pts, num, den, dts_usec;
+
+	if (!file)
+		return false;
+
+	*audio_tracks = 0;
+
+	while (fscanf(file, " %c %lld %lld %lld %lld %lld %lld", &type,
+				&track, &dts, &pts, &num, &den,
+				&dts_usec) == 7) {
+		struct trace_packet *tp;
+
+		if (track < 0 || track >= MAX_AUDIO_MIXES || den <= 0)
+			continue;
+
+		packet.type         = type == 'v' ? OBS_ENCODER_VIDEO :
+			OBS_ENCODER_AUDIO;
+		packet.track_idx    = (size_t)track;
+		packet.dts          = dts;
+		packet.pts          = pts;
+		packet.timebase_num = (int32_t)num;
+		packet.timebase_den = (int32_t)den;
+		packet.dts_usec     = dts_usec;
+
+		if (packet.type == OBS_ENCODER_AUDIO &&
+		    *audio_tracks <= packet.track_idx)
+			*audio_tracks = packet.track_idx + 1;
+
+		tp = da_push_back_new((*trace));
+		tp->packet      = packet;
+		tp->packet.size = trace->num;
+	}
+
+	fclose(file);
+	return trace->num > 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static uint64_t replay(trace_t *trace, size_t audio_tracks, bool legacy,
+		struct sim_output *output)
+{
+	uint64_t start;
+
+	memset(output, 0, sizeof(*output));
+	output->audio_mixes = audio_tracks;
+
+	start = os_gettime_ns();
+
+	for (size_t i = 0; i < trace->num; i++) {
+		size_t queued;
+
+		if (legacy) {
+			legacy_interleave(output, &trace->array[i].packet);
+			queued = output->legacy_packets.num;
+		} else {
+			interleave(output, &trace->array[i].packet);
+			queued = output->interleaved_packets.num_packets;
+		}
+
+		if (output->max_queued < queued)
+			output->max_queued = queued;
+	}
+
+	return os_gettime_ns() - start;
+}
+
+static bool compare(const char *name, trace_t *trace, size_t audio_tracks)
+{
+	struct sim_output legacy, queued;
+	uint64_t legacy_ns, queued_ns;
+	bool     match;
+
+	legacy_ns = replay(trace, audio_tracks, true, &legacy);
+	queued_ns = replay(trace, audio_tracks, false, &queued);
+
+	match = legacy.sent.num == queued.sent.num &&
+		memcmp(legacy.sent.array, queued.sent.array,
+				legacy.sent.num * sizeof(struct sent_packet))
+		== 0;
+
+	if (!match) {
+		size_t num = legacy.sent.num < queued.sent.num ?
+			legacy.sent.num : queued.sent.num;
+		size_t i;
+
+		for (i = 0; i < num; i++) {
+			if (memcmp(legacy.sent.array + i, queued.sent.array + i,
+					sizeof(struct sent_packet)) != 0)
+				break;
+		}
+
+		printf("%s: mismatch at sent packet %zu (%zu vs %zu sent)\n",
+				name, i, legacy.sent.num, queued.sent.num);
+	}
+
+	printf("%-24s  %7zu  %7zu  %7zu  %10.3f  %10.3f  %s\n", name,
+			trace->num, legacy.sent.num, legacy.max_queued,
+			(double)legacy_ns / (double)trace->num,
+			(double)queued_ns / (double)trace->num,
+			match ? "identical" : "MISMATCH");
+
+	da_free(legacy.sent);
+	da_free(legacy.legacy_packets);
+	da_free(queued.sent);
+	interleave_queue_free(&queued.interleaved_packets);
+	return match;
+}
+
+int main(int argc, char *argv[])
+{
+	bool success = true;
+
+	printf("%-24s  %7s  %7s  %7s  %10s  %10s\n", "trace", "packets",
+			"sent", "queued", "array ns", "queues ns");
+
+	if (argc > 1) {
+		for (int i = 1; i < argc; i++) {
+			trace_t trace = {0};
+			size_t  audio_tracks;
+
+			if (!load_trace(argv[i], &trace, &audio_tracks)) {
+				printf("%s: failed to load trace\n", argv[i]);
+				success = false;
+			} else if (!compare(argv[i], &trace, audio_tracks)) {
+				success = false;
+			}
+
+			da_free(trace);
+		}
+
+		return success ? 0 : 1;
+	}
+
+	srand(1);
+
+	for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+		trace_t trace = {0};
+
+		generate_trace(&scenarios[i], &trace);
+		if (!compare(scenarios[i].name, &trace,
+					scenarios[i].audio_tracks))
+			success = false;
+		da_free(trace);
+	}
+
+	return success ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <media-io/audio-io.h>
+
+/*
+ * Pushes audio from many lines, each on its own thread, through the audio
+ * mixer in real time, and checks that every mixed frame in the middle of the
+ * run is exactly the sum of all lines (the values are chosen so that float
+ * addition is exact).  Each line destroys itself when it's done.
+ *
+ * If 'stall_ms' is given, the mixer is blocked that long halfway through the
+ * run, while the lines keep sending audio, which must all still be mixed.
+ *
+ * usage: stress-audio-lines [lines] [seconds] [stall_ms]
+ */
+
+#define SAMPLE_RATE    48000
+#define PACKET_FRAMES  480
+#define PACKET_NS      10000000ULL
+#define BUFFER_MS      100
+#define MARGIN_NS      200000000ULL
+
+struct line_thread {
+	pthread_t    thread;
+	audio_line_t *line;
+	float        value;
+};
+
+static audio_t  *audio;
+static uint64_t start_ts;
+static uint64_t end_ts;
+static float    expected_sum;
+static int      stall_ms;
+static bool     stalled;
+
+static volatile long checked_frames;
+static volatile long bad_frames;
+
+static void *line_thread(void *param)
+{
+	struct line_thread *lt = param;
+	float    *planes[2];
+	uint64_t ts = start_ts;
+
+	planes[0] = bmalloc(PACKET_FRAMES * sizeof(float));
+	planes[1] = bmalloc(PACKET_FRAMES * sizeof(float));
+
+	for (size_t i = 0; i < PACKET_FRAMES; i++)
+		planes[0][i] = planes[1][i] = lt->value;
+
+	while (ts < end_ts) {
+		struct audio_data data = {
+			.data      = {(uint8_t*)planes[0], (uint8_t*)planes[1]},
+			.frames    = PACKET_FRAMES,
+			.timestamp = ts,
+			.volume    = 1.0f
+		};
+
+		os_sleepto_ns(ts);
+		audio_line_output(lt->line, &data);
+		ts += PACKET_NS;
+	}
+
+	audio_line_destroy(lt->line);
+	bfree(planes[0]);
+	bfree(planes[1]);
+	return NULL;
+}
+
+static void mix_callback(void *param, size_t mix_idx, struct audio_data *data)
+{
+	uint64_t frame_ns = 1000000000ULL / SAMPLE_RATE;
+
+	if (stall_ms && !stalled &&
+	    data->timestamp >= start_ts + (end_ts - start_ts) / 2) {
+		stalled = true;
+		os_sleep_ms(stall_ms);
+	}
+
+	for (uint32_t i = 0; i < data->frames; i++) {
+		uint64_t ts = data->timestamp + i * frame_ns;
+
+		if (ts < start_ts + MARGIN_NS || ts >= end_ts - MARGIN_NS)
+			continue;
+
+		for (size_t plane = 0; plane < 2; plane++) {
+			float val = ((float*)data->data[plane])[i];
+			if (val != expected_sum)
+				os_atomic_inc_long(&bad_frames);
+		}
+
+		os_atomic_inc_long(&checked_frames);
+	}
+
+	(void)param;
+	(void)mix_idx;
+}
+
+int main(int argc, char *argv[])
+{
+	int num_lines = argc > 1 ? atoi(argv[1]) : 64;
+	int seconds   = argc > 2 ? atoi(argv[2]) : 5;
+	stall_ms      = argc > 3 ? atoi(argv[3]) : 0;
+	struct line_thread *threads;
+	long expected_frames;
+
+	struct audio_output_info info = {
+		.name            = "stress",
+		.samples_per_sec = SAMPLE_RATE,
+		.format          = AUDIO_FORMAT_FLOAT_PLANAR,
+		.speakers        = SPEAKERS_STEREO,
+		.buffer_ms       = BUFFER_MS,
+		.frames_per_tick = PACKET_FRAMES
+	};
+
+	if (num_lines <= 0)
+		num_lines = 1;
+	if (seconds <= 0)
+		seconds = 1;
+	if (stall_ms < 0)
+		stall_ms = 0;
+
+	if (audio_output_open(&audio, &info) != AUDIO_OUTPUT_SUCCESS) {
+		printf("failed to open audio output\n");
+		return 1;
+	}
+
+	audio_output_connect(audio, 0, NULL, mix_callback, NULL);
+
+	start_ts = os_gettime_ns() + 50000000ULL;
+	end_ts   = start_ts + (uint64_t)seconds * 1000000000ULL;
+
+	/* multiples of 2^-12 that sum to less than 1.0 for up to 64 lines,
+	 * so there's no rounding or clamping */
+	threads = bzalloc(sizeof(struct line_thread) * num_lines);
+	for (int i = 0; i < num_lines; i++) {
+		threads[i].value = (float)(i % 64 + 1) / 4096.0f;
+		threads[i].line  = audio_output_create_line(audio, "stress",
+				1 << 0);
+		expected_sum    += threads[i].value;
+	}
+
+	for (int i = 0; i < num_lines; i++)
+		pthread_create(&threads[i].thread, NULL, line_thread,
+				&threads[i]);
+	for (int i = 0; i < num_lines; i++)
+		pthread_join(threads[i].thread, NULL);
+
+	/* let the mixer play out the buffered audio */
+	os_sleep_ms(BUFFER_MS * 2 + stall_ms);
+	audio_output_close(audio);
+	bfree(threads);
+
+	expected_frames = (long)((end_ts - start_ts - MARGIN_NS * 2) *
+			SAMPLE_RATE / 1000000000ULL);
+
+	printf("%d lines, %d seconds, %d ms stall: %ld frames checked "
+	       "(expected ~%ld), %ld bad samples\n", num_lines, seconds,
+	       stall_ms, checked_frames, expected_frames, bad_frames);
+
+	return (bad_frames || checked_frames < expected_frames * 9 / 10) ?
+		1 : 0;
+}
@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <X11/Xlib.h>
+#include <X11/keysym.h>
+#include <X11/extensions/XTest.h>
+#include <obs.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+/*
+ * Registers a large set of hotkey bindings (letters with every combination
+ * of shift, control and alt), then presses and releases keys through XTest
+ * and checks that exactly the matching hotkey is pressed and released, with
+ * the hotkey thread polling key states and then waiting for XInput2 input
+ * events.  Reports the press latency of each mode and the CPU time the
+ * process uses while no keys are pressed.
+ *
+ * Meant to be run on a virtual X server:
+ *
+ * usage: xvfb-run stress-hotkeys-x11 [presses]
+ */
+
+#define NUM_KEYS      26
+#define NUM_MODIFIERS 6
+#define NUM_HOTKEYS   (NUM_KEYS * NUM_MODIFIERS)
+
+static const uint32_t modifier_sets[NUM_MODIFIERS] = {
+	0,
+	INTERACT_SHIFT_KEY,
+	INTERACT_CONTROL_KEY,
+	INTERACT_ALT_KEY,
+	INTERACT_SHIFT_KEY | INTERACT_CONTROL_KEY,
+	INTERACT_CONTROL_KEY | INTERACT_ALT_KEY
+};
+
+static obs_hotkey_id hotkeys[NUM_HOTKEYS];
+
+static os_event_t    *changed_event;
+static volatile long last_hotkey = -1;
+static volatile long last_pressed;
+static volatile long num_changes;
+
+static void hotkey_func(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey,
+		bool pressed)
+{
+	last_hotkey  = (long)(intptr_t)data;
+	last_pressed = pressed;
+	os_atomic_inc_long(&num_changes);
+	os_event_signal(changed_event);
+
+	UNUSED_PARAMETER(id);
+	UNUSED_PARAMETER(hotkey);
+}
+
+static void register_hotkeys(void)
+{
+	for (long i = 0; i < NUM_HOTKEYS; i++) {
+		obs_key_combination_t combo;
+		char name[32];
+
+		combo.key       = (obs_key_t)(OBS_KEY_A + i % NUM_KEYS);
+		combo.modifiers = modifier_sets[i / NUM_KEYS];
+
+		snprintf(name, sizeof(name), "stress.%ld", i);
+		hotkeys[i] = obs_hotkey_register_frontend(name, name,
+				hotkey_func, (void*)(intptr_t)i);
+		obs_hotkey_load_bindings(hotkeys[i], &combo, 1);
+	}
+}
+
+/* presses or releases a letter, and waits for its unmodified hotkey */
+static bool send_key(Display *display, int letter, bool press,
+		uint64_t *latency)
+{
+	KeyCode  code = XKeysymToKeycode(display, XK_a + letter);
+	long     changes = num_changes;
+	uint64_t start;
+
+	*latency = 0;
+	os_event_reset(changed_event);
+
+	start = os_gettime_ns();
+	XTestFakeKeyEvent(display, code, press, CurrentTime);
+	XFlush(display);
+
+	if (os_event_timedwait(changed_event, 1000) != 0)
+		return false;
+
+	*latency = os_gettime_ns() - start;
+
+	/* any other hotkey triggering would be a mismatch */
+	os_sleep_ms(5);
+	return num_changes == changes + 1 && last_hotkey == letter &&
+	       last_pressed == (long)press;
+}
+
+static double cpu_ms(void)
+{
+	struct rusage usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_utime.tv_sec * 1000.0 +
+	       usage.ru_utime.tv_usec / 1000.0 +
+	       usage.ru_stime.tv_sec * 1000.0 +
+	       usage.ru_stime.tv_usec / 1000.0;
+}
+
+static bool run_mode(Display *display, bool input_events, int presses)
+{
+	uint64_t total = 0, max = 0, latency;
+	double   idle_cpu;
+	int      failures = 0;
+
+	obs_hotkey_enable_input_events(input_events);
+	os_sleep_ms(100);
+
+	for (int i = 0; i < presses; i++) {
+		int letter = i % NUM_KEYS;
+
+		if (!send_key(display, letter, true, &latency))
+			failures++;
+		total += latency;
+		if (latency > max)
+			max = latency;
+
+		if (!send_key(display, letter, false, &latency))
+			failures++;
+	}
+
+	idle_cpu = cpu_ms();
+	os_sleep_ms(1000);
+	idle_cpu = cpu_ms() - idle_cpu;
+
+	printf("%-12s %d presses of %d bindings: latency avg %.2f ms, "
+	       "max %.2f ms, %d missed or wrong, idle cpu %.2f ms/s\n",
+	       input_events ? "input events" : "polling", presses,
+	       NUM_HOTKEYS, (double)total / presses / 1000000.0,
+	       (double)max / 1000000.0, failures, idle_cpu);
+
+	return failures == 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int     presses = argc > 1 ? atoi(argv[1]) : 100;
+	bool    success = true;
+	Display *display;
+	int     event, error, major, minor;
+
+	if (presses <= 0)
+		presses = 1;
+
+	display = XOpenDisplay(NULL);
+	if (!display) {
+		printf("failed to open the X display\n");
+		return 1;
+	}
+
+	if (!XTestQueryExtension(display, &event, &error, &major, &minor)) {
+		printf("the X server has no XTest extension\n");
+		XCloseDisplay(display);
+		return 1;
+	}
+
+	if (!obs_startup("en-US", NULL, NULL)) {
+		printf("failed to start libobs\n");
+		XCloseDisplay(display);
+		return 1;
+	}
+
+	os_event_init(&changed_event, OS_EVENT_TYPE_MANUAL);
+	obs_hotkey_enable_background_press(true);
+	register_hotkeys();
+
+	success &= run_mode(display, false, presses);
+	success &= run_mode(display, true, presses);
+	success &= run_mode(display, false, presses);
+
+	for (int i = 0; i < NUM_HOTKEYS; i++)
+		obs_hotkey_unregister(hotkeys[i]);
+
+	obs_shutdown();
+	os_event_destroy(changed_event);
+	XCloseDisplay(display);
+
+	return success ? 0 : 1;
+}
@@ -0,0 +1,298 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <util/bmem.h>
+#include <util/circlebuf.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#include "rtmp-bitrate.h"
+
+/*
+ * Runs the RTMP bitrate controller in real time against a throttled loopback
+ * socket.  A simulated encoder produces 60 FPS video at the controller's
+ * target bitrate plus 160 kbps audio, a send loop like the one of the RTMP
+ * output writes it to the socket, and the receiving end only reads at the
+ * current link rate.  The link starts fast, is throttled below the encoder
+ * bitrate, and then recovers.
+ *
+ * Checks that the bitrate gets lowered below the throttled link rate while
+ * the link is throttled, and that it is back at the original bitrate at the
+ * end.
+ *
+ * usage: stress-rtmp-bitrate [bitrate kbps] [throttled kbps] [seconds]
+ */
+
+#define FPS             60
+#define AUDIO_KBPS      160
+#define AUDIO_PACKET_NS 21333333ULL
+#define DROP_THRESHOLD  600000
+#define SOCKET_BUF_SIZE 16384
+#define SINK_TICK_NS    5000000ULL
+
+/* link phases, relative to the total run time */
+#define THROTTLE_START  0.1
+#define THROTTLE_END    0.35
+
+struct sim_packet {
+	int64_t dts_usec;
+	size_t  size;
+};
+
+static pthread_mutex_t  queue_mutex;
+static struct circlebuf queue;
+static int64_t          last_dts_usec;
+static os_sem_t         *queue_sem;
+
+static volatile long    encoder_kbps;
+static volatile bool    running = true;
+
+static uint64_t         start_ns;
+static uint64_t         run_ns;
+static int              fast_kbps;
+static int              slow_kbps;
+
+static int link_kbps(uint64_t now_ns)
+{
+	double t = (double)(now_ns - start_ns) / (double)run_ns;
+	return (t >= THROTTLE_START && t < THROTTLE_END) ? slow_kbps :
+		fast_kbps;
+}
+
+static void push_packet(int64_t dts_usec, size_t size)
+{
+	struct sim_packet packet = {dts_usec, size};
+
+	pthread_mutex_lock(&queue_mutex);
+	circlebuf_push_back(&queue, &packet, sizeof(packet));
+	last_dts_usec = dts_usec;
+	pthread_mutex_unlock(&queue_mutex);
+
+	os_sem_post(queue_sem);
+}
+
+static void *encoder_thread(void *unused)
+{
+	uint64_t frame_ns = 1000000000ULL / FPS;
+	uint64_t video_ts = start_ns;
+	uint64_t audio_ts = start_ns;
+
+	while (running) {
+		if (audio_ts <= video_ts) {
+			os_sleepto_ns(audio_ts);
+			push_packet((int64_t)(audio_ts - start_ns) / 1000,
+					AUDIO_KBPS * 1000 / 8 *
+					AUDIO_PACKET_NS / 1000000000ULL);
+			audio_ts += AUDIO_PACKET_NS;
+		} else {
+			os_sleepto_ns(video_ts);
+			push_packet((int64_t)(video_ts - start_ns) / 1000,
+					(size_t)encoder_kbps * 1000 / 8 / FPS);
+			video_ts += frame_ns;
+		}
+	}
+
+	os_sem_post(queue_sem);
+	UNUSED_PARAMETER(unused);
+	return NULL;
+}
+
+/* reads from the socket no faster than the current link rate */
+static void *sink_thread(void *param)
+{
+	int      fd = (int)(intptr_t)param;
+	uint8_t  buf[65536];
+	uint64_t tick = os_gettime_ns();
+	double   allowance = 0.0;
+
+	for (;;) {
+		double per_tick = (double)link_kbps(tick) * 1000.0 / 8.0 *
+			(double)SINK_TICK_NS / 1000000000.0;
+		ssize_t n;
+
+		allowance += per_tick;
+		if (allowance > per_tick * 4.0)
+			allowance = per_tick * 4.0;
+
+		while (allowance >= 1.0) {
+			size_t want = (size_t)allowance;
+			if (want > sizeof(buf))
+				want = sizeof(buf);
+
+			n = recv(fd, buf, want, MSG_DONTWAIT);
+			if (n == 0)
+				return NULL;
+			if (n < 0)
+				break;
+			allowance -= (double)n;
+		}
+
+		tick += SINK_TICK_NS;
+		os_sleepto_ns(tick);
+	}
+}
+
+static bool open_link(int *send_fd, int *recv_fd)
+{
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	int size = SOCKET_BUF_SIZE, on = 1;
+	int listener = socket(AF_INET, SOCK_STREAM, 0);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family      = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	setsockopt(listener, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+	if (bind(listener, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+	    listen(listener, 1) < 0 ||
+	    getsockname(listener, (struct sockaddr*)&addr, &len) < 0) {
+		close(listener);
+		return false;
+	}
+
+	*send_fd = socket(AF_INET, SOCK_STREAM, 0);
+	setsockopt(*send_fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+	setsockopt(*send_fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+	if (connect(*send_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+		close(*send_fd);
+		close(listener);
+		return false;
+	}
+
+	*recv_fd = accept(listener, NULL, NULL);
+	close(listener);
+	return *recv_fd >= 0;
+}
+
+static bool send_all(int fd, const uint8_t *data, size_t size)
+{
+	while (size) {
+		ssize_t n = send(fd, data, size, 0);
+		if (n <= 0)
+			return false;
+		data += n;
+		size -= (size_t)n;
+	}
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	int      orig_kbps = argc > 1 ? atoi(argv[1]) : 6000;
+	int      seconds   = argc > 3 ? atoi(argv[3]) : 60;
+	struct rtmp_bitrate br;
+	pthread_t encoder, sink;
+	int      send_fd, recv_fd;
+	uint8_t  *data;
+	int64_t  max_buffer_usec = 0;
+	int      lowest_kbps;
+	bool     lowered_in_time = false;
+	bool     success;
+
+	slow_kbps = argc > 2 ? atoi(argv[2]) : orig_kbps / 2;
+	fast_kbps = orig_kbps + orig_kbps / 2;
+	if (orig_kbps <= 0 || slow_kbps <= 0 || seconds <= 0)
+		return 1;
+
+	if (!open_link(&send_fd, &recv_fd)) {
+		printf("failed to open the loopback link\n");
+		return 1;
+	}
+
+	data = bzalloc((size_t)fast_kbps * 1000 / 8);
+	pthread_mutex_init(&queue_mutex, NULL);
+	os_sem_init(&queue_sem, 0);
+
+	start_ns     = os_gettime_ns();
+	run_ns       = (uint64_t)seconds * 1000000000ULL;
+	encoder_kbps = orig_kbps;
+	lowest_kbps  = orig_kbps;
+
+	rtmp_bitrate_init(&br, orig_kbps, DROP_THRESHOLD, start_ns);
+
+	printf("encoder %d kbps, link %d kbps, throttled to %d kbps "
+	       "from %.1f to %.1f s\n", orig_kbps, fast_kbps, slow_kbps,
+	       seconds * THROTTLE_START, seconds * THROTTLE_END);
+
+	pthread_create(&encoder, NULL, encoder_thread, NULL);
+	pthread_create(&sink, NULL, sink_thread, (void*)(intptr_t)recv_fd);
+
+	while (os_sem_wait(queue_sem) == 0) {
+		struct sim_packet packet, first;
+		int64_t  buffer_usec = 0;
+		uint64_t now;
+
+		now = os_gettime_ns();
+		if (now - start_ns >= run_ns)
+			break;
+
+		pthread_mutex_lock(&queue_mutex);
+		if (!queue.size) {
+			pthread_mutex_unlock(&queue_mutex);
+			continue;
+		}
+		circlebuf_pop_front(&queue, &packet, sizeof(packet));
+		pthread_mutex_unlock(&queue_mutex);
+
+		if (!send_all(send_fd, data, packet.size)) {
+			printf("send failed\n");
+			break;
+		}
+
+		pthread_mutex_lock(&queue_mutex);
+		if (queue.size) {
+			circlebuf_peek_front(&queue, &first, sizeof(first));
+			buffer_usec = last_dts_usec - first.dts_usec;
+		}
+		pthread_mutex_unlock(&queue_mutex);
+
+		if (max_buffer_usec < buffer_usec)
+			max_buffer_usec = buffer_usec;
+
+		now = os_gettime_ns();
+		if (rtmp_bitrate_update(&br, packet.size, buffer_usec, now)) {
+			double t = (double)(now - start_ns) / 1000000000.0;
+
+			printf("%6.2f s  link %5d kbps  buffered %4"PRId64
+			       " ms  bitrate %5ld -> %5d kbps\n",
+			       t, link_kbps(now), buffer_usec / 1000,
+			       encoder_kbps, br.cur_kbps);
+
+			encoder_kbps = br.cur_kbps;
+			if (lowest_kbps > br.cur_kbps)
+				lowest_kbps = br.cur_kbps;
+			if (br.cur_kbps + AUDIO_KBPS <= slow_kbps &&
+			    link_kbps(now) == slow_kbps)
+				lowered_in_time = true;
+		}
+	}
+
+	running = false;
+	pthread_join(encoder, NULL);
+	shutdown(send_fd, SHUT_WR);
+	pthread_join(sink, NULL);
+	close(send_fd);
+	close(recv_fd);
+
+	success = lowered_in_time && br.cur_kbps == orig_kbps;
+
+	printf("lowest bitrate %d kbps, final bitrate %d kbps, "
+	       "max buffered %"PRId64" ms: %s\n",
+	       lowest_kbps, br.cur_kbps, max_buffer_usec / 1000,
+	       success ? "ok" : "FAILED");
+
+	circlebuf_free(&queue);
+	os_sem_destroy(queue_sem);
+	pthread_mutex_destroy(&queue_mutex);
+	bfree(data);
+	return success ? 0 : 1;
+}
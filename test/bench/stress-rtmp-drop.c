@@ -0,0 +1,444 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <obs.h>
+#include <obs-avc.h>
+#include <util/bmem.h>
+#include <util/circlebuf.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#include "rtmp-packet-queue.h"
+
+/*
+ * Measures how long the packet mutex of the RTMP output is held while frames
+ * are being dropped.  A simulated encoder produces 60 FPS video with a
+ * keyframe / P frame / B frame pattern plus audio, faster than real time, and
+ * feeds it through the frame dropping logic of the RTMP output, while a send
+ * loop drains the queue at half the encoder bitrate.  The backlog keeps
+ * hitting the drop threshold, so frames are dropped over and over again.
+ *
+ * This is done once with the old queue, which was rebuilt from scratch on
+ * every drop, and once with the priority indexed queue, both with packets
+ * that only the stream holds (dropping frees them) and with packets that are
+ * shared with a recording output (dropping only releases a reference, so the
+ * cost of the queue itself is what remains).  Reports the lock
+ * hold times of the encoder thread, how long the send loop had to wait for
+ * the lock, and checks that no audio packets or keyframes were dropped and
+ * that the send order was kept.
+ *
+ * usage: stress-rtmp-drop [media seconds] [speedup]
+ */
+
+#define FPS            60
+#define KEYINT         (FPS * 2)
+#define VIDEO_KBPS     6000
+#define AUDIO_KBPS     160
+#define AUDIO_PACKET_US 21333
+#define MIN_DROP_PACKETS 5
+
+static const int64_t thresholds_ms[] = {700, 5000, 20000};
+
+enum queue_mode {
+	MODE_REBUILD,
+	MODE_INDEXED
+};
+
+static const char *mode_names[] = {"rebuild", "indexed"};
+
+struct sim_output {
+	enum queue_mode     mode;
+	pthread_mutex_t     mutex;
+	struct circlebuf    legacy;
+	struct packet_queue queue;
+
+	int64_t             drop_threshold_usec;
+	int64_t             min_drop_dts_usec;
+	int64_t             last_dts_usec;
+	int                 min_priority;
+
+	uint64_t            speedup;
+	uint64_t            start_ns;
+	int64_t             media_usec;
+	volatile bool       producing;
+	bool                shared;
+	DARRAY(struct encoder_packet) recording;
+
+	/* producer */
+	DARRAY(uint64_t)    hold_ns;
+	DARRAY(uint64_t)    drop_hold_ns;
+	long                dropped;
+	long                produced_protected;
+
+	/* consumer */
+	uint64_t            max_wait_ns;
+	long                sent_protected;
+	bool                order_ok;
+};
+
+/* ------------------------------------------------------------------------- */
+/* the old queue, rebuilt on every drop */
+
+static size_t legacy_size(struct sim_output *out)
+{
+	return out->legacy.size / sizeof(struct encoder_packet);
+}
+
+static size_t legacy_drop(struct sim_output *out, int *max_priority)
+{
+	struct circlebuf new_buf = {0};
+	size_t           num_dropped = 0;
+
+	circlebuf_reserve(&new_buf, sizeof(struct encoder_packet) * 8);
+
+	while (out->legacy.size) {
+		struct encoder_packet packet;
+		circlebuf_pop_front(&out->legacy, &packet, sizeof(packet));
+
+		if (packet.type          == OBS_ENCODER_AUDIO ||
+		    packet.drop_priority == OBS_NAL_PRIORITY_HIGHEST) {
+			circlebuf_push_back(&new_buf, &packet, sizeof(packet));
+
+		} else {
+			if (*max_priority < packet.drop_priority)
+				*max_priority = packet.drop_priority;
+
+			num_dropped++;
+			obs_encoder_packet_release(&packet);
+		}
+	}
+
+	circlebuf_free(&out->legacy);
+	out->legacy = new_buf;
+	return num_dropped;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static size_t queue_size(struct sim_output *out)
+{
+	return out->mode == MODE_REBUILD ?
+		legacy_size(out) : packet_queue_size(&out->queue);
+}
+
+static int64_t queue_front_dts(struct sim_output *out)
+{
+	struct encoder_packet first;
+
+	if (out->mode == MODE_INDEXED)
+		return packet_queue_front(&out->queue)->dts_usec;
+
+	circlebuf_peek_front(&out->legacy, &first, sizeof(first));
+	return first.dts_usec;
+}
+
+static void queue_push(struct sim_output *out, struct encoder_packet *packet)
+{
+	if (out->mode == MODE_REBUILD)
+		circlebuf_push_back(&out->legacy, packet, sizeof(*packet));
+	else
+		packet_queue_push(&out->queue, packet);
+
+	out->last_dts_usec = packet->dts_usec;
+}
+
+static bool queue_pop(struct sim_output *out, struct encoder_packet *packet)
+{
+	if (out->mode == MODE_INDEXED)
+		return packet_queue_pop(&out->queue, packet);
+
+	if (!out->legacy.size)
+		return false;
+	circlebuf_pop_front(&out->legacy, packet, sizeof(*packet));
+	return true;
+}
+
+/* same logic as check_to_drop_frames / add_video_packet of the output */
+static bool check_to_drop_frames(struct sim_output *out)
+{
+	int    priority = 0;
+	size_t num_dropped;
+
+	if (queue_size(out) < MIN_DROP_PACKETS)
+		return false;
+	if (queue_front_dts(out) < out->min_drop_dts_usec)
+		return false;
+	if (out->last_dts_usec - queue_front_dts(out) <=
+			out->drop_threshold_usec)
+		return false;
+
+	num_dropped = out->mode == MODE_REBUILD ?
+		legacy_drop(out, &priority) :
+		packet_queue_drop(&out->queue, OBS_NAL_PRIORITY_HIGHEST,
+				&priority);
+
+	out->min_priority      = priority;
+	out->min_drop_dts_usec = out->last_dts_usec;
+	out->dropped          += (long)num_dropped;
+	return true;
+}
+
+static void add_packet(struct sim_output *out, struct encoder_packet *packet)
+{
+	bool     dropped_frames = false;
+	uint64_t locked, hold;
+
+	pthread_mutex_lock(&out->mutex);
+	locked = os_gettime_ns();
+
+	if (packet->type == OBS_ENCODER_VIDEO) {
+		dropped_frames = check_to_drop_frames(out);
+
+		if (packet->priority < out->min_priority) {
+			out->dropped++;
+			obs_encoder_packet_release(packet);
+		} else {
+			out->min_priority = 0;
+			queue_push(out, packet);
+		}
+	} else {
+		queue_push(out, packet);
+	}
+
+	hold = os_gettime_ns() - locked;
+	pthread_mutex_unlock(&out->mutex);
+
+	da_push_back(out->hold_ns, &hold);
+	if (dropped_frames)
+		da_push_back(out->drop_hold_ns, &hold);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline bool is_protected(const struct encoder_packet *packet)
+{
+	return packet->type == OBS_ENCODER_AUDIO ||
+		packet->drop_priority == OBS_NAL_PRIORITY_HIGHEST;
+}
+
+static inline uint64_t media_to_wall_ns(struct sim_output *out, int64_t usec)
+{
+	return out->start_ns + (uint64_t)usec * 1000 / out->speedup;
+}
+
+static void *encoder_thread(void *param)
+{
+	struct sim_output *out = param;
+	size_t   frame_size = VIDEO_KBPS * 1000 / 8 / FPS;
+	size_t   audio_size = AUDIO_KBPS * 1000 / 8 * AUDIO_PACKET_US / 1000000;
+	uint8_t  *payload = bzalloc(frame_size * 8);
+	int64_t  frame_us = 1000000 / FPS;
+	int64_t  video_idx = 0;
+	int64_t  audio_us = 0;
+
+	for (;;) {
+		struct encoder_packet src = {0}, packet;
+		int64_t video_us = video_idx * frame_us;
+
+		src.timebase_num = 1;
+		src.timebase_den = 1000000;
+		src.data         = payload;
+
+		if (audio_us <= video_us) {
+			src.type = OBS_ENCODER_AUDIO;
+			src.size = audio_size;
+			src.pts  = src.dts = src.dts_usec = audio_us;
+			audio_us += AUDIO_PACKET_US;
+
+		} else {
+			int frame = (int)(video_idx % KEYINT);
+			int priority;
+
+			/* I B B P B B P ... */
+			if (frame == 0)
+				priority = OBS_NAL_PRIORITY_HIGHEST;
+			else if (frame % 3 == 0)
+				priority = OBS_NAL_PRIORITY_HIGH;
+			else
+				priority = OBS_NAL_PRIORITY_DISPOSABLE;
+
+			src.type          = OBS_ENCODER_VIDEO;
+			src.keyframe      = frame == 0;
+			src.size          = frame == 0 ? frame_size * 4 :
+				(priority == OBS_NAL_PRIORITY_HIGH ?
+				 frame_size * 3 / 2 : frame_size / 2);
+			src.pts           = src.dts = src.dts_usec = video_us;
+			src.priority      = priority;
+			src.drop_priority = priority;
+			video_idx++;
+		}
+
+		if (src.dts_usec >= out->media_usec)
+			break;
+
+		os_sleepto_ns(media_to_wall_ns(out, src.dts_usec));
+
+		if (is_protected(&src))
+			out->produced_protected++;
+
+		obs_encoder_packet_create_instance(&packet, &src);
+		if (out->shared) {
+			struct encoder_packet *ref = da_push_back_new(
+					out->recording);
+			obs_encoder_packet_ref(ref, &packet);
+		}
+		add_packet(out, &packet);
+	}
+
+	out->producing = false;
+	bfree(payload);
+	return NULL;
+}
+
+/* drains the queue at half the media bitrate */
+static void send_loop(struct sim_output *out)
+{
+	uint64_t link_bytes_per_sec = (uint64_t)VIDEO_KBPS * 1000 / 8 / 2 *
+		out->speedup;
+	uint64_t next_ns = os_gettime_ns();
+	int64_t  last_dts[2] = {-1, -1};
+
+	for (;;) {
+		struct encoder_packet packet;
+		uint64_t wait_start, wait;
+		bool     producing = out->producing;
+		bool     have_packet;
+
+		wait_start = os_gettime_ns();
+		pthread_mutex_lock(&out->mutex);
+		wait = os_gettime_ns() - wait_start;
+		have_packet = queue_pop(out, &packet);
+		pthread_mutex_unlock(&out->mutex);
+
+		if (out->max_wait_ns < wait)
+			out->max_wait_ns = wait;
+
+		if (!have_packet) {
+			if (!producing)
+				break;
+			os_sleep_ms(1);
+			next_ns = os_gettime_ns();
+			continue;
+		}
+
+		if (packet.dts_usec < last_dts[packet.type])
+			out->order_ok = false;
+		last_dts[packet.type] = packet.dts_usec;
+
+		if (is_protected(&packet))
+			out->sent_protected++;
+
+		next_ns += packet.size * 1000000000ULL / link_bytes_per_sec;
+		obs_encoder_packet_release(&packet);
+		os_sleepto_ns(next_ns);
+	}
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t val_a = *(const uint64_t*)a;
+	uint64_t val_b = *(const uint64_t*)b;
+	return val_a < val_b ? -1 : (val_a > val_b ? 1 : 0);
+}
+
+static double percentile_us(uint64_t *values, size_t num, double pct)
+{
+	if (!num)
+		return 0.0;
+	return (double)values[(size_t)((double)(num - 1) * pct)] / 1000.0;
+}
+
+static bool run(enum queue_mode mode, bool shared, int64_t threshold_ms,
+		int seconds, int speedup)
+{
+	struct sim_output out;
+	pthread_t encoder;
+	double    avg_drop_us = 0.0;
+	bool      success;
+
+	memset(&out, 0, sizeof(out));
+	out.mode                = mode;
+	out.drop_threshold_usec = threshold_ms * 1000;
+	out.media_usec          = (int64_t)seconds * 1000000;
+	out.speedup             = (uint64_t)speedup;
+	out.producing           = true;
+	out.shared              = shared;
+	out.order_ok            = true;
+	packet_queue_init(&out.queue);
+	pthread_mutex_init(&out.mutex, NULL);
+
+	out.start_ns = os_gettime_ns();
+	pthread_create(&encoder, NULL, encoder_thread, &out);
+	send_loop(&out);
+	pthread_join(encoder, NULL);
+
+	qsort(out.hold_ns.array, out.hold_ns.num, sizeof(uint64_t), cmp_u64);
+	qsort(out.drop_hold_ns.array, out.drop_hold_ns.num, sizeof(uint64_t),
+			cmp_u64);
+
+	for (size_t i = 0; i < out.drop_hold_ns.num; i++)
+		avg_drop_us += (double)out.drop_hold_ns.array[i] / 1000.0;
+	if (out.drop_hold_ns.num)
+		avg_drop_us /= (double)out.drop_hold_ns.num;
+
+	success = out.order_ok &&
+		out.sent_protected == out.produced_protected;
+
+	printf("%7"PRId64"  %-6s  %-8s  %6zu  %8ld  %10.2f  %10.2f  %10.2f  "
+	       "%10.2f  %s\n",
+	       threshold_ms, shared ? "shared" : "owned", mode_names[mode], out.drop_hold_ns.num,
+	       out.dropped,
+	       percentile_us(out.hold_ns.array, out.hold_ns.num, 0.99),
+	       avg_drop_us,
+	       percentile_us(out.drop_hold_ns.array, out.drop_hold_ns.num,
+		       1.0),
+	       (double)out.max_wait_ns / 1000.0,
+	       success ? "ok" : "FAILED");
+
+	for (size_t i = 0; i < out.recording.num; i++)
+		obs_encoder_packet_release(out.recording.array + i);
+
+	da_free(out.recording);
+	da_free(out.hold_ns);
+	da_free(out.drop_hold_ns);
+	circlebuf_free(&out.legacy);
+	packet_queue_free(&out.queue);
+	pthread_mutex_destroy(&out.mutex);
+	return success;
+}
+
+int main(int argc, char *argv[])
+{
+	int  seconds = argc > 1 ? atoi(argv[1]) : 60;
+	int  speedup = argc > 2 ? atoi(argv[2]) : 20;
+	bool success = true;
+
+	if (seconds <= 0)
+		seconds = 1;
+	if (speedup <= 0)
+		speedup = 1;
+
+	printf("%d s of %d kbps video, drained at %d kbps, %dx real time\n\n",
+			seconds, VIDEO_KBPS, VIDEO_KBPS / 2, speedup);
+	printf("%7s  %-6s  %-8s  %6s  %8s  %10s  %10s  %10s  %10s\n",
+			"thr ms", "data", "queue", "storms", "dropped", "p99 hold",
+			"avg drop", "max drop", "max wait");
+	printf("%7s  %-6s  %-8s  %6s  %8s  %10s  %10s  %10s  %10s\n",
+			"", "", "", "", "", "us", "us", "us", "us");
+
+	for (size_t i = 0; i < sizeof(thresholds_ms) / sizeof(thresholds_ms[0]);
+			i++) {
+		for (int shared = 0; shared <= 1; shared++) {
+			for (int mode = MODE_REBUILD; mode <= MODE_INDEXED;
+					mode++) {
+				if (!run(mode, shared, thresholds_ms[i],
+							seconds, speedup))
+					success = false;
+			}
+		}
+	}
+
+	return success ? 0 : 1;
+}